@@ -63,7 +63,8 @@ public class View {
     public enum DepthPrepass {
         DEFAULT(-1),
         DISABLED(0),
-        ENABLED(1);
+        ENABLED(1),
+        ADAPTIVE(2);
 
         final int value;
 
@@ -22,9 +22,13 @@
 #include <filament/Box.h>
 #include <filament/Frustum.h>
 #include "details/Culler.h"
+#include "details/CullingBvh.h"
 
 #include <utils/Allocator.h>
+#include <utils/JobSystem.h>
 
+#include <algorithm>
+#include <cmath>
 #include <vector>
 #include <random>
 
@@ -104,3 +108,137 @@ BENCHMARK_F(FilamentFixture, sphereCulling)(benchmark::State& state) {
         state.SetItemsProcessed(state.iterations() * BATCH_SIZE);
     }
 }
+
+BENCHMARK_F(FilamentFixture, boxCullingReference)(benchmark::State& state) {
+    {
+        PerformanceCounters pc(state);
+        for (auto _ : state) {
+            Culler::Test::intersectsReference(visibles, frustum, boxesCenter.data(), boxesExtent.data(), BATCH_SIZE);
+        }
+        benchmark::ClobberMemory();
+        pc.stop();
+        state.SetItemsProcessed(state.iterations() * BATCH_SIZE);
+    }
+}
+
+BENCHMARK_F(FilamentFixture, sphereCullingReference)(benchmark::State& state) {
+    {
+        PerformanceCounters pc(state);
+        for (auto _ : state) {
+            Culler::Test::intersectsReference(visibles, frustum, spheres.data(), BATCH_SIZE);
+        }
+        benchmark::ClobberMemory();
+        pc.stop();
+        state.SetItemsProcessed(state.iterations() * BATCH_SIZE);
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+
+/*
+ * Culling of a large "open world", objects are spread evenly in a volume that grows with
+ * their count, so that only a small fraction of them is visible.
+ */
+class CullingFixture : public benchmark::Fixture {
+protected:
+    JobSystem* js = nullptr;
+    Frustum frustum{};
+    std::vector<float3> boxesCenter;
+    std::vector<float3> boxesExtent;
+    Culler::result_type* UTILS_RESTRICT visibles = nullptr;
+    CullingBvh bvh;
+
+public:
+    void SetUp(benchmark::State& state) override {
+        js = new JobSystem();
+        js->adopt();
+
+        const size_t count = size_t(state.range(0));
+        const float size = 10.0f * std::cbrt(float(count));
+
+        std::default_random_engine gen; // NOLINT
+        std::uniform_real_distribution<float> position(-size, size);
+        std::uniform_real_distribution<float> extent(0.1f, 2.0f);
+
+        std::vector<float3> centers(count);
+        std::vector<float3> extents(count);
+        for (size_t i = 0; i < count; i++) {
+            centers[i] = { position(gen), position(gen), position(gen) };
+            extents[i] = { extent(gen), extent(gen), extent(gen) };
+        }
+
+        // the BVH needs its objects sorted spatially (this doesn't matter for linear culling)
+        std::vector<uint32_t> order(count);
+        CullingBvh::sortByLocation(order.data(), centers.data(), count);
+        boxesCenter.resize(Culler::round(count));
+        boxesExtent.resize(Culler::round(count));
+        for (size_t i = 0; i < count; i++) {
+            boxesCenter[i] = centers[order[i]];
+            boxesExtent[i] = extents[order[i]];
+        }
+
+        frustum = Frustum{ mat4f::perspective(45.0f, 1.0f, 0.1f, 100.0f) };
+        visibles = (Culler::result_type*)utils::aligned_alloc(boxesCenter.size(), 32);
+        bvh.refit(*js, boxesCenter.data(), boxesExtent.data(), count, true);
+    }
+
+    void TearDown(benchmark::State&) override {
+        utils::aligned_free(visibles);
+        bvh.clear();
+        js->emancipate();
+        delete js;
+        js = nullptr;
+    }
+};
+
+BENCHMARK_DEFINE_F(CullingFixture, linearCulling)(benchmark::State& state) {
+    const uint32_t count = uint32_t(state.range(0));
+    {
+        PerformanceCounters pc(state);
+        for (auto _ : state) {
+            std::fill_n(visibles, count, 0);
+            // same as FView::cullRenderables()
+            auto functor = [this](uint32_t index, uint32_t c) {
+                Culler::Test::intersects(visibles + index, frustum,
+                        boxesCenter.data() + index, boxesExtent.data() + index, c);
+            };
+            auto job = jobs::parallel_for(*js, nullptr, 0, count, std::ref(functor),
+                    jobs::CountSplitter<Culler::MODULO * Culler::MIN_LOOP_COUNT_HINT, 8>());
+            js->runAndWait(job);
+        }
+        benchmark::ClobberMemory();
+        pc.stop();
+        state.SetItemsProcessed(state.iterations() * count);
+    }
+}
+
+BENCHMARK_DEFINE_F(CullingFixture, bvhCulling)(benchmark::State& state) {
+    const uint32_t count = uint32_t(state.range(0));
+    {
+        PerformanceCounters pc(state);
+        for (auto _ : state) {
+            std::fill_n(visibles, count, 0);
+            bvh.intersects(*js, visibles, frustum, boxesCenter.data(), boxesExtent.data(), 0);
+        }
+        benchmark::ClobberMemory();
+        pc.stop();
+        state.SetItemsProcessed(state.iterations() * count);
+    }
+}
+
+BENCHMARK_DEFINE_F(CullingFixture, bvhRefit)(benchmark::State& state) {
+    const uint32_t count = uint32_t(state.range(0));
+    {
+        PerformanceCounters pc(state);
+        for (auto _ : state) {
+            bvh.refit(*js, boxesCenter.data(), boxesExtent.data(), count, false);
+        }
+        benchmark::ClobberMemory();
+        pc.stop();
+        state.SetItemsProcessed(state.iterations() * count);
+    }
+}
+
+BENCHMARK_REGISTER_F(CullingFixture, linearCulling)->Arg(10000)->Arg(100000)->Arg(1000000);
+BENCHMARK_REGISTER_F(CullingFixture, bvhCulling)->Arg(10000)->Arg(100000)->Arg(1000000);
+BENCHMARK_REGISTER_F(CullingFixture, bvhRefit)->Arg(10000)->Arg(100000)->Arg(1000000);
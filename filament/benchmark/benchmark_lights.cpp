@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "PerformanceCounters.h"
+
+#include <benchmark/benchmark.h>
+
+#include <filament/Engine.h>
+#include <filament/LightManager.h>
+#include <filament/Scene.h>
+
+#include <private/filament/UibGenerator.h>
+
+#include "details/Allocators.h"
+#include "details/Camera.h"
+#include "details/Engine.h"
+#include "details/Froxelizer.h"
+#include "details/Scene.h"
+
+#include <utils/EntityManager.h>
+
+#include <vector>
+#include <random>
+
+using namespace filament;
+using namespace filament::details;
+using namespace filament::math;
+using namespace utils;
+
+// Measures the per-frame cost of the dynamic lights of a view: selecting the lights closest
+// to the camera, and assigning them to froxels. All lights are in front of the camera.
+class LightsFixture : public benchmark::Fixture {
+protected:
+    Engine* engine = nullptr;
+    Scene* scene = nullptr;
+    Froxelizer* froxelizer = nullptr;
+    LinearAllocatorArena* arena = nullptr;
+    Handle<HwUniformBuffer> lightUbh;
+    std::vector<Entity> entities;
+    CameraInfo camera = {};
+    Viewport viewport{ 0, 0, 1920, 1080 };
+
+public:
+    void SetUp(benchmark::State& state) override {
+        engine = Engine::create(Engine::Backend::NOOP);
+        scene = engine->createScene();
+
+        FEngine& e = *upcast(engine);
+        froxelizer = new Froxelizer(e);
+        arena = new LinearAllocatorArena("benchmark: per-frame allocator",
+                FEngine::CONFIG_PER_RENDER_PASS_ARENA_SIZE);
+        lightUbh = e.getDriverApi().createUniformBuffer(
+                CONFIG_MAX_LIGHT_COUNT * sizeof(LightsUib), driver::BufferUsage::DYNAMIC);
+
+        const float aspect = float(viewport.width) / float(viewport.height);
+        camera.projection = mat4f::perspective(60.0f, aspect, 0.1f, 100.0f);
+        camera.cullingProjection = camera.projection;
+        camera.zn = 0.1f;
+        camera.zf = 100.0f;
+
+        // lights spread in the view frustum, one in four is a spot light
+        std::default_random_engine gen; // NOLINT
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+        std::uniform_real_distribution<float> depths(1.0f, 100.0f);
+        std::uniform_real_distribution<float> radii(1.0f, 5.0f);
+        std::uniform_int_distribution<uint32_t> oneInFour(0, 3);
+
+        entities.resize(size_t(state.range(0)));
+        EntityManager::get().create(entities.size(), entities.data());
+        for (Entity entity : entities) {
+            const float z = depths(gen);
+            const float3 position{ unit(gen) * z * 0.5f * aspect, unit(gen) * z * 0.5f, -z };
+            const bool spot = oneInFour(gen) == 0;
+            LightManager::Builder(spot ? LightManager::Type::SPOT : LightManager::Type::POINT)
+                    .position(position)
+                    .direction({ 0, 0, -1 })
+                    .spotLightCone(0.5f, 0.8f)
+                    .falloff(radii(gen))
+                    .intensity(1000.0f)
+                    .build(*engine, entity);
+            scene->addEntity(entity);
+        }
+    }
+
+    void TearDown(benchmark::State&) override {
+        for (Entity entity : entities) {
+            engine->destroy(entity);
+        }
+        EntityManager::get().destroy(entities.size(), entities.data());
+        FEngine& e = *upcast(engine);
+        e.getDriverApi().destroyUniformBuffer(lightUbh);
+        froxelizer->terminate(e.getDriverApi());
+        delete froxelizer;
+        delete arena;
+        engine->destroy(scene);
+        Engine::destroy(&engine);
+    }
+
+    void run(benchmark::State& state) {
+        FEngine& e = *upcast(engine);
+        FScene& s = *upcast(scene);
+        {
+            PerformanceCounters pc(state);
+            for (auto _ : state) {
+                // gathering the scene's lights is not what we're measuring
+                state.PauseTiming();
+                s.prepare(mat4f{});
+                state.ResumeTiming();
+
+                filament::details::ArenaScope scope(*arena);
+                s.prepareDynamicLights(camera, scope, lightUbh);
+                froxelizer->prepare(e.getDriverApi(), scope, viewport,
+                        camera.projection, camera.zn, camera.zf);
+                froxelizer->froxelizeLights(e, camera, s.getLightData());
+
+                state.PauseTiming();
+                froxelizer->commit(e.getDriverApi());
+                e.flush();
+                state.ResumeTiming();
+            }
+            pc.stop();
+            state.SetItemsProcessed(state.iterations() * entities.size());
+        }
+        state.counters["froxels"] = froxelizer->getFroxelCount();
+    }
+};
+
+BENCHMARK_DEFINE_F(LightsFixture, fixedGrid)(benchmark::State& state) {
+    froxelizer->setAdaptiveGridEnabled(false);
+    run(state);
+}
+
+BENCHMARK_DEFINE_F(LightsFixture, adaptiveGrid)(benchmark::State& state) {
+    froxelizer->setAdaptiveGridEnabled(true);
+    run(state);
+}
+
+BENCHMARK_REGISTER_F(LightsFixture, fixedGrid)->RangeMultiplier(4)->Range(64, 16384);
+BENCHMARK_REGISTER_F(LightsFixture, adaptiveGrid)->RangeMultiplier(4)->Range(64, 16384);
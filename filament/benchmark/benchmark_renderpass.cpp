@@ -0,0 +1,227 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "PerformanceCounters.h"
+
+#include <benchmark/benchmark.h>
+
+#include <filament/Engine.h>
+#include <filament/Scene.h>
+
+#include "RenderPass.h"
+#include "details/Engine.h"
+#include "details/Material.h"
+#include "details/MaterialInstance.h"
+#include "details/Scene.h"
+
+#include <utils/JobSystem.h>
+
+#include <algorithm>
+#include <vector>
+#include <random>
+
+using namespace filament;
+using namespace filament::details;
+using namespace filament::math;
+using namespace utils;
+
+using Command = RenderPass::Command;
+
+class RenderPassFixture : public benchmark::Fixture {
+protected:
+    JobSystem* js = nullptr;
+    std::vector<Command> input;
+    std::vector<Command> commands;
+    std::vector<Command> scratch;
+
+public:
+    // Generates keys similar to what RenderPass::generateCommands() does for a depth pass,
+    // followed by a color pass, with a few blended objects.
+    void SetUp(benchmark::State& state) override {
+        js = new JobSystem();
+        js->adopt();
+
+        std::default_random_engine gen; // NOLINT
+        std::uniform_real_distribution<float> distances(0.1f, 1000.0f);
+        std::uniform_int_distribution<uint32_t> materials(0, 63);
+        std::uniform_int_distribution<uint32_t> instances(0, 255);
+        std::uniform_int_distribution<uint32_t> priorities(0, 7);
+        std::uniform_int_distribution<uint32_t> oneInSixteen(0, 15);
+
+        const size_t renderableCount = size_t(state.range(0)) / 2;
+        input.clear();
+        input.reserve(renderableCount * 2 + 1);
+        for (size_t i = 0; i < renderableCount; i++) {
+            float distance = -distances(gen);
+            const uint32_t distanceBits = reinterpret_cast<uint32_t&>(distance);
+            const uint32_t priority = priorities(gen);
+
+            Command cmdDepth;
+            cmdDepth.key = uint64_t(RenderPass::Pass::DEPTH);
+            cmdDepth.key |= RenderPass::makeField(priority,
+                    RenderPass::PRIORITY_MASK, RenderPass::PRIORITY_SHIFT);
+            cmdDepth.key |= RenderPass::makeField(distanceBits,
+                    RenderPass::DISTANCE_BITS_MASK, RenderPass::DISTANCE_BITS_SHIFT);
+            cmdDepth.primitive.index = uint16_t(i);
+            input.push_back(cmdDepth);
+
+            Command cmdColor;
+            cmdColor.key = RenderPass::makeField(priority,
+                    RenderPass::PRIORITY_MASK, RenderPass::PRIORITY_SHIFT);
+            if (oneInSixteen(gen) != 0) {
+                cmdColor.key |= uint64_t(RenderPass::Pass::COLOR);
+                cmdColor.key |= RenderPass::makeMaterialSortingKey(materials(gen), instances(gen));
+            } else {
+                cmdColor.key |= uint64_t(RenderPass::Pass::BLENDED);
+                cmdColor.key |= RenderPass::makeField(~distanceBits,
+                        RenderPass::BLEND_DISTANCE_MASK, RenderPass::BLEND_DISTANCE_SHIFT);
+            }
+            cmdColor.primitive.index = uint16_t(i);
+            input.push_back(cmdColor);
+        }
+        input.emplace_back();
+        input.back().key = uint64_t(RenderPass::Pass::SENTINEL);
+
+        commands.resize(input.size());
+        scratch.resize(input.size());
+    }
+
+    void TearDown(benchmark::State&) override {
+        js->emancipate();
+        delete js;
+        js = nullptr;
+    }
+};
+
+// Note: both benchmarks include the cost of copying the unsorted commands.
+
+BENCHMARK_DEFINE_F(RenderPassFixture, stdSort)(benchmark::State& state) {
+    {
+        PerformanceCounters pc(state);
+        for (auto _ : state) {
+            std::copy(input.begin(), input.end(), commands.begin());
+            std::sort(commands.begin(), commands.end());
+        }
+        benchmark::ClobberMemory();
+        pc.stop();
+        state.SetItemsProcessed(state.iterations() * input.size());
+    }
+}
+
+BENCHMARK_DEFINE_F(RenderPassFixture, sortCommands)(benchmark::State& state) {
+    {
+        PerformanceCounters pc(state);
+        for (auto _ : state) {
+            std::copy(input.begin(), input.end(), commands.begin());
+            RenderPass::sortCommands(*js,
+                    { commands.data(), uint32_t(commands.size()) },
+                    { scratch.data(), uint32_t(scratch.size()) });
+        }
+        benchmark::ClobberMemory();
+        pc.stop();
+        state.SetItemsProcessed(state.iterations() * input.size());
+    }
+}
+
+BENCHMARK_REGISTER_F(RenderPassFixture, stdSort)->Arg(1000)->Arg(10000)->Arg(100000);
+BENCHMARK_REGISTER_F(RenderPassFixture, sortCommands)->Arg(1000)->Arg(10000)->Arg(100000);
+
+// Records the driver commands of an already sorted command list with the noop backend, this only
+// measures the CPU side of recording.
+class RecordCommandsFixture : public benchmark::Fixture {
+protected:
+    JobSystem* js = nullptr;
+    Engine* engine = nullptr;
+    Scene* scene = nullptr;
+    std::vector<FMaterialInstance*> instances;
+    std::vector<Command> commands;
+
+public:
+    void SetUp(benchmark::State& state) override {
+        js = new JobSystem();
+        js->adopt();
+
+        engine = Engine::create(Engine::Backend::NOOP);
+        scene = engine->createScene();
+
+        FMaterial const* ma = upcast(engine)->getDefaultMaterial();
+        instances.resize(16);
+        for (auto& mi : instances) {
+            mi = ma->createInstance();
+        }
+
+        // a few commands per material instance, like a sorted color pass
+        const size_t count = size_t(state.range(0));
+        commands.resize(count + 1);
+        for (size_t i = 0; i < count; i++) {
+            Command& cmd = commands[i];
+            cmd.key = uint64_t(RenderPass::Pass::COLOR);
+            cmd.primitive.mi = instances[i * instances.size() / count];
+            cmd.primitive.rasterState = ma->getRasterState();
+            cmd.primitive.materialVariant.key = 0;
+            cmd.primitive.index = uint16_t(i);
+        }
+        commands.back().key = uint64_t(RenderPass::Pass::SENTINEL);
+    }
+
+    void TearDown(benchmark::State&) override {
+        for (auto mi : instances) {
+            engine->destroy(mi);
+        }
+        engine->destroy(scene);
+        Engine::destroy(&engine);
+        js->emancipate();
+        delete js;
+        js = nullptr;
+    }
+};
+
+BENCHMARK_DEFINE_F(RecordCommandsFixture, serial)(benchmark::State& state) {
+    FEngine& e = *upcast(engine);
+    FScene& s = *upcast(scene);
+    {
+        PerformanceCounters pc(state);
+        for (auto _ : state) {
+            RenderPass::recordDriverCommands(e.getDriverApi(), s,
+                    { commands.data(), uint32_t(commands.size()) });
+            state.PauseTiming();
+            e.flush();
+            state.ResumeTiming();
+        }
+        pc.stop();
+        state.SetItemsProcessed(state.iterations() * (commands.size() - 1));
+    }
+}
+
+BENCHMARK_DEFINE_F(RecordCommandsFixture, parallel)(benchmark::State& state) {
+    FEngine& e = *upcast(engine);
+    FScene& s = *upcast(scene);
+    {
+        PerformanceCounters pc(state);
+        for (auto _ : state) {
+            RenderPass::recordDriverCommands(*js, e.getDriverApi(), s,
+                    { commands.data(), uint32_t(commands.size()) });
+            state.PauseTiming();
+            e.flush();
+            state.ResumeTiming();
+        }
+        pc.stop();
+        state.SetItemsProcessed(state.iterations() * (commands.size() - 1));
+    }
+}
+
+BENCHMARK_REGISTER_F(RecordCommandsFixture, serial)->Arg(1000)->Arg(4000)->Arg(10000);
+BENCHMARK_REGISTER_F(RecordCommandsFixture, parallel)->Arg(1000)->Arg(4000)->Arg(10000);
@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "PerformanceCounters.h"
+
+#include <benchmark/benchmark.h>
+
+#include <filament/Engine.h>
+#include <filament/RenderableManager.h>
+#include <filament/Scene.h>
+#include <filament/TransformManager.h>
+
+#include "details/Scene.h"
+
+#include <utils/EntityManager.h>
+
+#include <vector>
+#include <random>
+
+using namespace filament;
+using namespace filament::details;
+using namespace filament::math;
+using namespace utils;
+
+
+class SceneFixture : public benchmark::Fixture {
+protected:
+    Engine* engine = nullptr;
+    Scene* scene = nullptr;
+    std::vector<Entity> entities;
+    std::vector<mat4f> transforms;
+
+public:
+    void SetUp(benchmark::State& state) override {
+        engine = Engine::create(Engine::Backend::NOOP);
+        scene = engine->createScene();
+
+        std::default_random_engine gen; // NOLINT
+        std::uniform_real_distribution<float> rand(-100.0f, 100.0f);
+
+        entities.resize(size_t(state.range(0)));
+        transforms.resize(entities.size());
+        EntityManager::get().create(entities.size(), entities.data());
+
+        TransformManager& tcm = engine->getTransformManager();
+        for (size_t i = 0, c = entities.size(); i < c; i++) {
+            Entity e = entities[i];
+            RenderableManager::Builder(0)
+                    .boundingBox({{ 0, 0, 0 }, { 1, 1, 1 }})
+                    .build(*engine, e);
+            transforms[i] = mat4f::translate(float3{ rand(gen), rand(gen), rand(gen) });
+            tcm.setTransform(tcm.getInstance(e), transforms[i]);
+            scene->addEntity(e);
+        }
+    }
+
+    void TearDown(benchmark::State&) override {
+        for (Entity e : entities) {
+            engine->destroy(e);
+        }
+        EntityManager::get().destroy(entities.size(), entities.data());
+        engine->destroy(scene);
+        Engine::destroy(&engine);
+    }
+};
+
+BENCHMARK_DEFINE_F(SceneFixture, prepareStatic)(benchmark::State& state) {
+    FScene* const s = upcast(scene);
+    {
+        PerformanceCounters pc(state);
+        for (auto _ : state) {
+            s->prepare(mat4f{});
+        }
+        benchmark::ClobberMemory();
+        pc.stop();
+        state.SetItemsProcessed(state.iterations() * entities.size());
+    }
+}
+
+BENCHMARK_DEFINE_F(SceneFixture, prepareAnimated)(benchmark::State& state) {
+    FScene* const s = upcast(scene);
+    TransformManager& tcm = engine->getTransformManager();
+    {
+        PerformanceCounters pc(state);
+        for (auto _ : state) {
+            // move every object, this is not what we're measuring
+            state.PauseTiming();
+            for (size_t i = 0, c = entities.size(); i < c; i++) {
+                transforms[i][3].y += 0.01f;
+                tcm.setTransform(tcm.getInstance(entities[i]), transforms[i]);
+            }
+            state.ResumeTiming();
+
+            s->prepare(mat4f{});
+        }
+        benchmark::ClobberMemory();
+        pc.stop();
+        state.SetItemsProcessed(state.iterations() * entities.size());
+    }
+}
+
+BENCHMARK_REGISTER_F(SceneFixture, prepareStatic)->Arg(1000)->Arg(10000)->Arg(50000);
+BENCHMARK_REGISTER_F(SceneFixture, prepareAnimated)->Arg(1000)->Arg(10000)->Arg(50000);
@@ -26,6 +26,9 @@
 #include <utils/compiler.h>
 #include <utils/EntityManager.h>
 
+#include <stddef.h>
+#include <stdint.h>
+
 namespace filament {
 
 class Camera;
@@ -144,6 +147,7 @@ class UTILS_PUBLIC Engine {
 public:
     using Platform = driver::Platform;
     using Backend = driver::Backend;
+    using BlobCache = driver::BlobCache;
 
     /**
      * Creates an instance of Engine
@@ -342,6 +346,52 @@ public:
      */
     void execute();
 
+    /**
+     * Sets the storage used to cache compiled programs across runs, so they don't need to be
+     * compiled again. The OpenGL backend stores program binaries, the Vulkan backend stores its
+     * pipeline cache.
+     *
+     * The keys identify the GPU driver as well as the shaders, so a cache can safely outlive a
+     * driver update.
+     *
+     * The Vulkan pipeline cache is loaded when the cache is set, and saved when the Engine is
+     * destroyed or when the cache is replaced. Setting the same cache again saves the pipeline
+     * cache without reloading it, e.g. when an application is paused.
+     *
+     * @param cache A pointer to an object that implements BlobCache, or nullptr to disable the
+     *              cache. Its methods are called from filament's render thread and its lifetime
+     *              must exceed the lifetime of the Engine, or until it's replaced.
+     */
+    void setBlobCache(BlobCache* cache) noexcept;
+
+    /**
+     * Statistics about the command buffer, which carries the commands from the Engine's thread
+     * to filament's render thread. They can be used to choose the size of the command buffer.
+     *
+     * @see getCommandBufferStats()
+     */
+    struct CommandBufferStats {
+        size_t bufferSize = 0;          //!< size of the command buffer in bytes
+        size_t requiredSize = 0;        //!< free space flush() waits for, in bytes
+        size_t highWatermark = 0;       //!< most space ever used in the command buffer
+        uint64_t flushCount = 0;        //!< number of times commands were submitted
+        uint64_t bytesSubmitted = 0;    //!< total size of the submitted commands
+        uint64_t blockedCount = 0;      //!< number of submissions that waited for free space
+        uint64_t blockedTime = 0;       //!< total time spent waiting for free space, in ns
+        uint64_t frameCount = 0;        //!< number of frames ended by Renderer::endFrame()
+        size_t lastFrameSize = 0;       //!< bytes submitted during the last frame
+        size_t maxFrameSize = 0;        //!< most bytes submitted during a single frame
+    };
+
+    /**
+     * Returns the command buffer statistics accumulated since the Engine was created.
+     *
+     * This must be called from the thread that owns the Engine.
+     *
+     * @return A copy of the current statistics.
+     */
+    CommandBufferStats getCommandBufferStats() const noexcept;
+
     DebugRegistry& getDebugRegistry() noexcept;
 
 protected:
@@ -210,6 +210,19 @@ public:
          * use the camera far distance.
          */
         float shadowFarHint = 100.0f;
+
+        /** Number of shadow cascades to use for directional lights, between 1 and 4.
+         * The view frustum, up to shadowFar, is split in that many ranges of distances from
+         * the camera, each of which gets its own mapSize x mapSize shadow map. Cascades give
+         * a better shadow resolution close to the camera for a given texel budget.
+         */
+        uint8_t shadowCascades = 1;
+
+        /** How the view frustum is split between cascades, between 0 and 1. 0 splits the
+         * distances uniformly, 1 splits them logarithmically (the practical split scheme).
+         * Values in between blend both schemes. Only used when shadowCascades is more than 1.
+         */
+        float cascadeSplitLambda = 0.75f;
     };
 
     //! Use Builder to construct a Light object instance
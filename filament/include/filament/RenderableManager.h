@@ -86,9 +86,51 @@ public:
         Builder& skinning(size_t boneCount, Bone const* bones) noexcept;
         Builder& skinning(size_t boneCount, filament::math::mat4f const* transforms) noexcept;
 
+        /**
+         * Draws this renderable instanceCount times, each instance with its own transform,
+         * relative to the renderable's transform. Instances are culled individually and the
+         * visible ones are drawn with instanced draw calls. Materials used with instanced
+         * renderables must not filter out the "instancing" variant.
+         *
+         * @param instanceCount Number of instances, 0 (the default) disables instancing.
+         * @param transforms    Transform of each instance, or nullptr for identity transforms.
+         *
+         * When instancing is enabled, boundingBox() is the bounding box of a single instance.
+         */
+        Builder& instances(size_t instanceCount,
+                filament::math::mat4f const* transforms = nullptr) noexcept;
+
         // Sets an ordering index for blended primitives that all live at the same Z value.
         Builder& blendOrder(size_t index, uint16_t order) noexcept; // 0 by default
 
+        /**
+         * Sets the number of levels of detail of this renderable, 1 by default, 8 max.
+         *
+         * Each level has the same number of primitives, the count given to the Builder, level 0
+         * being the most detailed. geometry(), material() and blendOrder() set the primitives of
+         * level 0, the primitives of the other levels are set with geometryAt(), materialAt()
+         * and blendOrderAt(). Primitives left without geometry are not drawn.
+         *
+         * A level is selected each frame from the size of the renderable on screen, see
+         * levelScreenSize().
+         */
+        Builder& levels(size_t levelCount) noexcept;
+
+        /**
+         * Sets the minimum size of the renderable on screen for a level to be used, as a fraction
+         * of the viewport's height. The first level whose minimum size is reached is used, and
+         * the last level is used when no minimum is reached. The size on screen is computed
+         * from the bounding sphere of the renderable's world-space bounding box.
+         *
+         * The minimum sizes must be decreasing with the level, they default to 0.
+         */
+        Builder& levelScreenSize(size_t level, float minScreenSize) noexcept;
+
+        Builder& geometryAt(size_t level, size_t index, PrimitiveType type,
+                VertexBuffer* vertices, IndexBuffer* indices, size_t offset, size_t count) noexcept;
+        Builder& materialAt(size_t level, size_t index, MaterialInstance const* materialInstance) noexcept;
+        Builder& blendOrderAt(size_t level, size_t index, uint16_t order) noexcept;
+
         /**
          * Adds the Renderable component to an entity.
          *
@@ -142,13 +184,25 @@ public:
     void setBones(Instance instance, Bone const* transforms, size_t boneCount = 1, size_t offset = 0) noexcept;
     void setBones(Instance instance, filament::math::mat4f const* transforms, size_t boneCount = 1, size_t offset = 0) noexcept;
 
+    // Updates the instance transforms in the range [offset, offset + count).
+    // The instances must be pre-allocated using Builder::instances().
+    void setInstanceTransforms(Instance instance, filament::math::mat4f const* transforms,
+            size_t count = 1, size_t offset = 0) noexcept;
+
+    // number of instances of this renderable, 0 if it's not instanced
+    size_t getInstanceCount(Instance instance) const noexcept;
+
 
     // getters...
+    // For instanced renderables, this is the bounding box of all the instances.
     const Box& getAxisAlignedBoundingBox(Instance instance) const noexcept;
 
-    // number of render primitives in this renderable
+    // number of render primitives in this renderable, per level of detail
     size_t getPrimitiveCount(Instance instance) const noexcept;
 
+    // number of levels of detail of this renderable, see Builder::levels()
+    size_t getLevelCount(Instance instance) const noexcept;
+
     // set/change the material of a given render primitive
     void setMaterialInstanceAt(Instance instance,
             size_t primitiveIndex, MaterialInstance const* materialInstance) noexcept;
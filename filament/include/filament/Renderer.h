@@ -24,6 +24,7 @@
 
 #include <utils/compiler.h>
 
+#include <stddef.h>
 #include <stdint.h>
 
 namespace filament {
@@ -65,6 +66,51 @@ class PixelBufferDescriptor;
  */
 class UTILS_PUBLIC Renderer : public FilamentAPI {
 public:
+    /**
+     * Timings of a frame, all durations are in nanoseconds.
+     *
+     * The CPU stages are measured with a steady clock on the threads doing the work, and are
+     * accumulated over all the views rendered during the frame. Stages that run on worker
+     * threads (e.g. FROXELIZATION) overlap with the other stages.
+     *
+     * @see setFrameTimingOptions(), getFrameTimings()
+     */
+    struct FrameTiming {
+        enum class Stage : uint8_t {
+            SCENE_PREPARE,      //!< gathering the scene, lights, shadows and uniforms
+            CULLING,            //!< culling renderables and computing their visibility
+            FROXELIZATION,      //!< assigning lights to froxels, on a worker thread
+            COMMAND_GENERATION, //!< generating the draw commands of all passes
+            COMMAND_SORT,       //!< sorting the draw commands of all passes
+            COMMAND_RECORDING,  //!< recording the driver commands of all passes
+            DRIVER_EXECUTION,   //!< executing the driver commands, on the driver thread
+            GPU                 //!< from the start to the end of the frame on the GPU
+        };
+        static constexpr size_t STAGE_COUNT = 8;
+
+        uint32_t frameId = 0;           //!< frame identifier, increases monotonically
+        uint64_t frameTime = 0;         //!< time between beginFrame() and endFrame()
+        uint64_t stages[STAGE_COUNT] = {};  //!< time spent in each Stage
+
+        //! CPU cycles and instructions between beginFrame() and endFrame() on the calling thread,
+        //! zero if hardware counters are disabled or unavailable.
+        uint64_t cpuCycles = 0;
+        uint64_t instructions = 0;
+
+        uint64_t operator[](Stage stage) const noexcept { return stages[size_t(stage)]; }
+    };
+
+    /**
+     * Options to control the collection of FrameTiming.
+     */
+    struct FrameTimingOptions {
+        bool enabled = false;           //!< enable or disable the collection of frame timings
+        bool hardwareCounters = false;  //!< also collect CPU performance counters (Linux only)
+    };
+
+    //! Number of FrameTiming kept by the Renderer.
+    static constexpr size_t FRAME_TIMING_HISTORY_SIZE = 32;
+
      /**
       * Get the Engine that created this Renderer.
       *
@@ -345,6 +391,39 @@ public:
      * getUserTime()
      */
     void resetUserTime();
+
+    /**
+     * Enables or disables the collection of per-frame timings.
+     *
+     * When disabled (the default), the overhead is a few branches per frame. When enabled,
+     * the overhead is a few clock reads per view and per pass.
+     *
+     * @param options Options for frame timings.
+     *
+     * @see getFrameTimings()
+     */
+    void setFrameTimingOptions(FrameTimingOptions const& options) noexcept;
+
+    /**
+     * Returns the options set with setFrameTimingOptions().
+     */
+    FrameTimingOptions const& getFrameTimingOptions() const noexcept;
+
+    /**
+     * Retrieves the timings of the most recent complete frames, most recent first.
+     *
+     * A frame is complete once it has been executed by the driver and, if it's available,
+     * once the GPU has finished it, which typically happens a few frames after endFrame().
+     * At most FRAME_TIMING_HISTORY_SIZE frames are kept.
+     *
+     * This method can be called from any thread.
+     *
+     * @param timings   Array of at least count FrameTiming to fill.
+     * @param count     Maximum number of FrameTiming to retrieve.
+     *
+     * @return The number of FrameTiming written in timings.
+     */
+    size_t getFrameTimings(FrameTiming* timings, size_t count) const noexcept;
 };
 
 } // namespace filament
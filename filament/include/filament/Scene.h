@@ -122,6 +122,26 @@ public:
      * @return The total number of Light objects in the Scene.
      */
     size_t getLightCount() const noexcept;
+
+    /**
+     * Enables or disables hierarchical culling for this Scene.
+     *
+     * When enabled, a bounding volume hierarchy of the renderables is maintained and used to
+     * reject (or accept) whole groups of renderables at once during frustum culling. This
+     * reduces the cost of culling large scenes, where most objects are outside of the
+     * camera or shadow frustum, at the expense of a small cost per frame to update the
+     * hierarchy. It's generally not worth it for small scenes.
+     *
+     * Hierarchical culling is disabled by default.
+     *
+     * @param enabled true to enable hierarchical culling, false to disable it.
+     */
+    void setHierarchicalCullingEnabled(bool enabled) noexcept;
+
+    /**
+     * @return whether hierarchical culling is enabled for this Scene.
+     */
+    bool isHierarchicalCullingEnabled() const noexcept;
 };
 
 } // namespace filament
@@ -137,6 +137,23 @@ public:
         QualityLevel hdrColorBuffer = QualityLevel::HIGH; //!< quality of the color buffer
     };
 
+    /**
+     * Options used to select the level of detail of renderables that have several levels,
+     * see RenderableManager::Builder::levels().
+     *
+     * hysteresis: a renderable only changes level once its size on screen is past the level's
+     *             minimum size by this ratio, which avoids switching back and forth between two
+     *             levels when the size is close to the minimum. 0 disables the hysteresis.
+     *             Each view keeps track of the levels it selected, so a renderable can be at
+     *             different levels in different views.
+     * shadowLevelBias: number of levels added to the level selected for the color pass, when
+     *             rendering the shadow map. Shadows are usually fine with coarser geometry.
+     */
+    struct LevelOfDetailOptions {
+        float hysteresis = 0.1f;        //!< relative margin around the minimum sizes
+        uint8_t shadowLevelBias = 1;    //!< how much coarser the shadow pass' levels are
+    };
+
     /**
      * List of available post-processing anti-aliasing techniques.
      */
@@ -149,6 +166,7 @@ public:
         DEFAULT = -1,
         DISABLED,
         ENABLED,
+        ADAPTIVE,
     };
 
     /**
@@ -164,9 +182,15 @@ public:
      *
      * The best strategy may depend on the scene and/or GPU.
      *
+     * With DepthPrepass::ADAPTIVE, the strategy is chosen every frame from an estimate of the
+     * overdraw and shading cost of the visible opaque objects, the cost of drawing them twice,
+     * and the duration of the previous frame. Only objects large enough on screen to be
+     * worthwhile occluders are drawn in the depth pre-pass.
+     *
      * @param prepass   DepthPrepass::DEFAULT uses the most appropriate strategy,
      *                  DepthPrepass::DISABLED disables the depth pre-pass,
-     *                  DepthPrepass::ENABLE enables the depth pre-pass.
+     *                  DepthPrepass::ENABLE enables the depth pre-pass,
+     *                  DepthPrepass::ADAPTIVE enables the depth pre-pass when it pays off.
      */
     void setDepthPrepass(DepthPrepass prepass) noexcept;
 
@@ -403,6 +427,20 @@ public:
      */
     RenderQuality getRenderQuality() const noexcept;
 
+    /**
+     * Sets the level of detail options for this view. Refer to LevelOfDetailOptions for more
+     * information about the different settings available.
+     *
+     * @param options The level of detail options to use on this view
+     */
+    void setLevelOfDetailOptions(LevelOfDetailOptions const& options) noexcept;
+
+    /**
+     * Returns the level of detail options used by this view.
+     * @return value set by setLevelOfDetailOptions().
+     */
+    LevelOfDetailOptions getLevelOfDetailOptions() const noexcept;
+
     /**
      * Sets options relative to dynamic lighting for this view.
      *
@@ -425,6 +463,24 @@ public:
      */
     void setDynamicLightingOptions(float zLightNear, float zLightFar) noexcept;
 
+    /**
+     * Enables or disables the adaptive froxel grid. Disabled by default.
+     *
+     * Point and spot lights are assigned to froxels, which are cells of a grid covering the
+     * view frustum. When many lights are visible, the lists of lights of all froxels may not
+     * fit in the space available, in which case lights are dropped from the farthest froxels.
+     *
+     * When the adaptive grid is enabled, the number of froxels is lowered after a frame
+     * where lights were dropped, and raised again when the light lists comfortably fit. This
+     * allows higher light densities, at the cost of a coarser grid when needed.
+     *
+     * @param enabled true enables the adaptive froxel grid, false uses a fixed grid.
+     */
+    void setAdaptiveFroxelGridEnabled(bool enabled) noexcept;
+
+    //! Returns true if the adaptive froxel grid is enabled.
+    bool isAdaptiveFroxelGridEnabled() const noexcept;
+
     /**
      * Enable or disable post processing. Enabled by default.
      *
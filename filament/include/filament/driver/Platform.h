@@ -21,6 +21,8 @@
 
 #include <utils/compiler.h>
 
+#include <stddef.h>
+
 namespace filament {
 namespace details {
 class FEngine;
@@ -30,6 +32,26 @@ class Driver;
 
 namespace driver {
 
+/**
+ * Storage implemented by the application, for data the driver can reuse across runs, such as
+ * compiled program binaries. Keys and values are opaque binary blobs.
+ *
+ * Both methods are called from filament's render thread.
+ */
+class UTILS_PUBLIC BlobCache {
+public:
+    virtual ~BlobCache() noexcept;
+
+    // Stores value for key, replacing any existing value.
+    virtual void insert(const void* key, size_t keySize,
+            const void* value, size_t valueSize) noexcept = 0;
+
+    // Returns the size of the value stored for key, or 0 if there is none. The value is copied
+    // into the value buffer only if valueSize is large enough.
+    virtual size_t retrieve(const void* key, size_t keySize,
+            void* value, size_t valueSize) noexcept = 0;
+};
+
 class UTILS_PUBLIC Platform {
 public:
     struct SwapChain {};
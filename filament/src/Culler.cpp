@@ -18,23 +18,55 @@
 
 #include <math/fast.h>
 
+#if defined(__SSE2__) || defined(_M_X64)
+#   define CULLER_HAS_SSE2 1
+#   include <immintrin.h>
+#   if (defined(__clang__) || defined(__GNUC__)) && !defined(_MSC_VER)
+        // AVX kernels are compiled with a target attribute and selected at runtime
+#       define CULLER_HAS_AVX 1
+#   endif
+#endif
+
+#if defined(__ARM_NEON)
+#   define CULLER_HAS_NEON 1
+#   include <arm_neon.h>
+#endif
+
 using namespace filament::math;
 
 namespace filament {
 namespace details {
 
-void Culler::intersects(
-        result_type* UTILS_RESTRICT results,
+/*
+ * All the kernels below must produce the same results as the reference (scalar) implementation,
+ * in particular, the dot products are evaluated in the same order.
+ *
+ * The SIMD kernels transpose the float3 / float4 arrays in registers, so they can process
+ * 4 or 8 objects at a time, one plane at a time.
+ */
+
+using BoxesKernel = void(*)(Culler::result_type* results, Frustum const& frustum,
+        float3 const* center, float3 const* extent, size_t count, size_t bit);
+
+using SpheresKernel = void(*)(Culler::result_type* results, Frustum const& frustum,
+        float4 const* b, size_t count);
+
+// ------------------------------------------------------------------------------------------------
+// Reference implementation
+// ------------------------------------------------------------------------------------------------
+
+static void intersectsSpheresScalar(
+        Culler::result_type* UTILS_RESTRICT results,
         Frustum const& UTILS_RESTRICT frustum,
         filament::math::float4 const* UTILS_RESTRICT b,
         size_t count) noexcept {
 
-    filament::math::float4 const * const UTILS_RESTRICT planes = frustum.mPlanes;
+    filament::math::float4 const * const UTILS_RESTRICT planes = frustum.getNormalizedPlanes();
 
     // we use a vectorize width of 8 because, on ARMv8 it allow the compiler to write 8
     // 8-bits results in one go. Without this it has to do 4 separate byte writes, which
     // ends-up being slower.
-    count = round(count); // capacity guaranteed to be multiple of 8
+    count = Culler::round(count); // capacity guaranteed to be multiple of 8
     #pragma clang loop vectorize_width(8)
     for (size_t i = 0; i < count; i++) {
         int visible = ~0;
@@ -50,23 +82,23 @@ void Culler::intersects(
                               planes[j].w - sphere.w;
             visible &= fast::signbit(dot);
         }
-        results[i] = result_type(visible);
+        results[i] = Culler::result_type(visible);
     }
 }
 
-void Culler::intersects(
-        result_type* UTILS_RESTRICT results,
+static void intersectsBoxesScalar(
+        Culler::result_type* UTILS_RESTRICT results,
         Frustum const& UTILS_RESTRICT frustum,
         filament::math::float3 const* UTILS_RESTRICT center,
         filament::math::float3 const* UTILS_RESTRICT extent,
         size_t count, size_t bit) noexcept {
 
-    filament::math::float4 const * UTILS_RESTRICT const planes = frustum.mPlanes;
+    filament::math::float4 const * UTILS_RESTRICT const planes = frustum.getNormalizedPlanes();
 
     // we use a vectorize width of 8 because, on ARMv8 it allows the compiler to write eight
     // 8-bits results in one go. Without this it has to do 4 separate byte writes, which
     // ends-up being slower.
-    count = round(count); // capacity guaranteed to be multiple of 8
+    count = Culler::round(count); // capacity guaranteed to be multiple of 8
     #pragma clang loop vectorize_width(8)
     for (size_t i = 0; i < count; i++) {
         int visible = ~0;
@@ -84,10 +116,351 @@ void Culler::intersects(
             visible &= fast::signbit(dot) << bit;
         }
 
-        results[i] |= result_type(visible);
+        results[i] |= Culler::result_type(visible);
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+// SSE2 (x86-64 baseline)
+// ------------------------------------------------------------------------------------------------
+
+#if CULLER_HAS_SSE2
+
+// transposes 4 packed float3 (a, b, c) into x, y, z
+static inline void transpose3(__m128 a, __m128 b, __m128 c,
+        __m128& x, __m128& y, __m128& z) noexcept {
+    // a = x0 y0 z0 x1, b = y1 z1 x2 y2, c = z2 x3 y3 z3
+    x = _mm_shuffle_ps(a,
+            _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2)), _MM_SHUFFLE(3, 1, 3, 0));
+    y = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)),
+            _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+    z = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)),
+            _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0));
+}
+
+static void intersectsBoxesSSE2(
+        Culler::result_type* UTILS_RESTRICT results,
+        Frustum const& UTILS_RESTRICT frustum,
+        float3 const* UTILS_RESTRICT center,
+        float3 const* UTILS_RESTRICT extent,
+        size_t count, size_t bit) noexcept {
+
+    float4 const* const UTILS_RESTRICT planes = frustum.getNormalizedPlanes();
+    count = Culler::round(count); // capacity guaranteed to be multiple of 8
+    for (size_t i = 0; i < count; i += 4) {
+        float const* const c = &center[i].x;
+        float const* const e = &extent[i].x;
+        __m128 cx, cy, cz, ex, ey, ez;
+        transpose3(_mm_loadu_ps(c), _mm_loadu_ps(c + 4), _mm_loadu_ps(c + 8), cx, cy, cz);
+        transpose3(_mm_loadu_ps(e), _mm_loadu_ps(e + 4), _mm_loadu_ps(e + 8), ex, ey, ez);
+
+        // the sign bit of 'visible' is set if all dot products are negative
+        __m128 visible = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (size_t j = 0; j < 6; j++) {
+            const __m128 px = _mm_set1_ps(planes[j].x);
+            const __m128 py = _mm_set1_ps(planes[j].y);
+            const __m128 pz = _mm_set1_ps(planes[j].z);
+            __m128 dot = _mm_mul_ps(px, cx);
+            dot = _mm_sub_ps(dot, _mm_mul_ps(_mm_set1_ps(std::abs(planes[j].x)), ex));
+            dot = _mm_add_ps(dot, _mm_mul_ps(py, cy));
+            dot = _mm_sub_ps(dot, _mm_mul_ps(_mm_set1_ps(std::abs(planes[j].y)), ey));
+            dot = _mm_add_ps(dot, _mm_mul_ps(pz, cz));
+            dot = _mm_sub_ps(dot, _mm_mul_ps(_mm_set1_ps(std::abs(planes[j].z)), ez));
+            dot = _mm_add_ps(dot, _mm_set1_ps(planes[j].w));
+            visible = _mm_and_ps(visible, dot);
+        }
+
+        const int mask = _mm_movemask_ps(visible);
+        for (size_t k = 0; k < 4; k++) {
+            results[i + k] |= Culler::result_type(((mask >> k) & 1) << bit);
+        }
+    }
+}
+
+static void intersectsSpheresSSE2(
+        Culler::result_type* UTILS_RESTRICT results,
+        Frustum const& UTILS_RESTRICT frustum,
+        float4 const* UTILS_RESTRICT b,
+        size_t count) noexcept {
+
+    float4 const* const UTILS_RESTRICT planes = frustum.getNormalizedPlanes();
+    count = Culler::round(count); // capacity guaranteed to be multiple of 8
+    for (size_t i = 0; i < count; i += 4) {
+        __m128 x = _mm_loadu_ps(&b[i + 0].x);
+        __m128 y = _mm_loadu_ps(&b[i + 1].x);
+        __m128 z = _mm_loadu_ps(&b[i + 2].x);
+        __m128 r = _mm_loadu_ps(&b[i + 3].x);
+        _MM_TRANSPOSE4_PS(x, y, z, r);
+
+        __m128 visible = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (size_t j = 0; j < 6; j++) {
+            __m128 dot = _mm_mul_ps(_mm_set1_ps(planes[j].x), x);
+            dot = _mm_add_ps(dot, _mm_mul_ps(_mm_set1_ps(planes[j].y), y));
+            dot = _mm_add_ps(dot, _mm_mul_ps(_mm_set1_ps(planes[j].z), z));
+            dot = _mm_add_ps(dot, _mm_set1_ps(planes[j].w));
+            dot = _mm_sub_ps(dot, r);
+            visible = _mm_and_ps(visible, dot);
+        }
+
+        const int mask = _mm_movemask_ps(visible);
+        for (size_t k = 0; k < 4; k++) {
+            results[i + k] = Culler::result_type((mask >> k) & 1);
+        }
+    }
+}
+
+#endif // CULLER_HAS_SSE2
+
+// ------------------------------------------------------------------------------------------------
+// AVX (selected at runtime)
+// ------------------------------------------------------------------------------------------------
+
+#if CULLER_HAS_AVX
+
+#define CULLER_TARGET_AVX __attribute__((target("avx")))
+
+// loads 4 floats from lo in the low lane and 4 floats from hi in the high lane
+CULLER_TARGET_AVX
+static inline __m256 loadLanes(float const* lo, float const* hi) noexcept {
+    return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(lo)), _mm_loadu_ps(hi), 1);
+}
+
+// transposes 8 packed float3 into x, y, z; the low lanes hold objects 0-3, the high lanes 4-7
+CULLER_TARGET_AVX
+static inline void transpose3(float const* p, __m256& x, __m256& y, __m256& z) noexcept {
+    const __m256 a = loadLanes(p + 0, p + 12);
+    const __m256 b = loadLanes(p + 4, p + 16);
+    const __m256 c = loadLanes(p + 8, p + 20);
+    // same as the SSE2 version, independently in each 128-bits lane
+    x = _mm256_shuffle_ps(a,
+            _mm256_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2)), _MM_SHUFFLE(3, 1, 3, 0));
+    y = _mm256_shuffle_ps(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)),
+            _mm256_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+    z = _mm256_shuffle_ps(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)),
+            _mm256_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0));
+}
+
+CULLER_TARGET_AVX
+static void intersectsBoxesAVX(
+        Culler::result_type* UTILS_RESTRICT results,
+        Frustum const& UTILS_RESTRICT frustum,
+        float3 const* UTILS_RESTRICT center,
+        float3 const* UTILS_RESTRICT extent,
+        size_t count, size_t bit) noexcept {
+
+    float4 const* const UTILS_RESTRICT planes = frustum.getNormalizedPlanes();
+    count = Culler::round(count); // capacity guaranteed to be multiple of 8
+    for (size_t i = 0; i < count; i += 8) {
+        __m256 cx, cy, cz, ex, ey, ez;
+        transpose3(&center[i].x, cx, cy, cz);
+        transpose3(&extent[i].x, ex, ey, ez);
+
+        // the sign bit of 'visible' is set if all dot products are negative
+        __m256 visible = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (size_t j = 0; j < 6; j++) {
+            const __m256 px = _mm256_set1_ps(planes[j].x);
+            const __m256 py = _mm256_set1_ps(planes[j].y);
+            const __m256 pz = _mm256_set1_ps(planes[j].z);
+            __m256 dot = _mm256_mul_ps(px, cx);
+            dot = _mm256_sub_ps(dot, _mm256_mul_ps(_mm256_set1_ps(std::abs(planes[j].x)), ex));
+            dot = _mm256_add_ps(dot, _mm256_mul_ps(py, cy));
+            dot = _mm256_sub_ps(dot, _mm256_mul_ps(_mm256_set1_ps(std::abs(planes[j].y)), ey));
+            dot = _mm256_add_ps(dot, _mm256_mul_ps(pz, cz));
+            dot = _mm256_sub_ps(dot, _mm256_mul_ps(_mm256_set1_ps(std::abs(planes[j].z)), ez));
+            dot = _mm256_add_ps(dot, _mm256_set1_ps(planes[j].w));
+            visible = _mm256_and_ps(visible, dot);
+        }
+
+        const int mask = _mm256_movemask_ps(visible);
+        for (size_t k = 0; k < 8; k++) {
+            results[i + k] |= Culler::result_type(((mask >> k) & 1) << bit);
+        }
+    }
+}
+
+CULLER_TARGET_AVX
+static void intersectsSpheresAVX(
+        Culler::result_type* UTILS_RESTRICT results,
+        Frustum const& UTILS_RESTRICT frustum,
+        float4 const* UTILS_RESTRICT b,
+        size_t count) noexcept {
+
+    float4 const* const UTILS_RESTRICT planes = frustum.getNormalizedPlanes();
+    count = Culler::round(count); // capacity guaranteed to be multiple of 8
+    for (size_t i = 0; i < count; i += 8) {
+        // the low lanes hold spheres 0-3, the high lanes 4-7
+        const __m256 r0 = loadLanes(&b[i + 0].x, &b[i + 4].x);
+        const __m256 r1 = loadLanes(&b[i + 1].x, &b[i + 5].x);
+        const __m256 r2 = loadLanes(&b[i + 2].x, &b[i + 6].x);
+        const __m256 r3 = loadLanes(&b[i + 3].x, &b[i + 7].x);
+        // 4x4 transpose in each lane
+        const __m256 t0 = _mm256_unpacklo_ps(r0, r1);
+        const __m256 t1 = _mm256_unpackhi_ps(r0, r1);
+        const __m256 t2 = _mm256_unpacklo_ps(r2, r3);
+        const __m256 t3 = _mm256_unpackhi_ps(r2, r3);
+        const __m256 x = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+        const __m256 y = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+        const __m256 z = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+        const __m256 r = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+
+        __m256 visible = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (size_t j = 0; j < 6; j++) {
+            __m256 dot = _mm256_mul_ps(_mm256_set1_ps(planes[j].x), x);
+            dot = _mm256_add_ps(dot, _mm256_mul_ps(_mm256_set1_ps(planes[j].y), y));
+            dot = _mm256_add_ps(dot, _mm256_mul_ps(_mm256_set1_ps(planes[j].z), z));
+            dot = _mm256_add_ps(dot, _mm256_set1_ps(planes[j].w));
+            dot = _mm256_sub_ps(dot, r);
+            visible = _mm256_and_ps(visible, dot);
+        }
+
+        const int mask = _mm256_movemask_ps(visible);
+        for (size_t k = 0; k < 8; k++) {
+            results[i + k] = Culler::result_type((mask >> k) & 1);
+        }
+    }
+}
+
+#endif // CULLER_HAS_AVX
+
+// ------------------------------------------------------------------------------------------------
+// NEON
+// ------------------------------------------------------------------------------------------------
+
+#if CULLER_HAS_NEON
+
+static void intersectsBoxesNEON(
+        Culler::result_type* UTILS_RESTRICT results,
+        Frustum const& UTILS_RESTRICT frustum,
+        float3 const* UTILS_RESTRICT center,
+        float3 const* UTILS_RESTRICT extent,
+        size_t count, size_t bit) noexcept {
+
+    float4 const* const UTILS_RESTRICT planes = frustum.getNormalizedPlanes();
+    count = Culler::round(count); // capacity guaranteed to be multiple of 8
+    for (size_t i = 0; i < count; i += 4) {
+        // vld3 de-interleaves the float3 for us
+        const float32x4x3_t c = vld3q_f32(&center[i].x);
+        const float32x4x3_t e = vld3q_f32(&extent[i].x);
+
+        // the sign bit of 'visible' is set if all dot products are negative
+        uint32x4_t visible = vdupq_n_u32(~0u);
+        for (size_t j = 0; j < 6; j++) {
+            // we don't use the multiply-accumulate instructions, so we get the same
+            // result as the reference implementation
+            float32x4_t dot = vmulq_n_f32(c.val[0], planes[j].x);
+            dot = vsubq_f32(dot, vmulq_n_f32(e.val[0], std::abs(planes[j].x)));
+            dot = vaddq_f32(dot, vmulq_n_f32(c.val[1], planes[j].y));
+            dot = vsubq_f32(dot, vmulq_n_f32(e.val[1], std::abs(planes[j].y)));
+            dot = vaddq_f32(dot, vmulq_n_f32(c.val[2], planes[j].z));
+            dot = vsubq_f32(dot, vmulq_n_f32(e.val[2], std::abs(planes[j].z)));
+            dot = vaddq_f32(dot, vdupq_n_f32(planes[j].w));
+            visible = vandq_u32(visible, vreinterpretq_u32_f32(dot));
+        }
+
+        visible = vshrq_n_u32(visible, 31);
+        results[i + 0] |= Culler::result_type(vgetq_lane_u32(visible, 0) << bit);
+        results[i + 1] |= Culler::result_type(vgetq_lane_u32(visible, 1) << bit);
+        results[i + 2] |= Culler::result_type(vgetq_lane_u32(visible, 2) << bit);
+        results[i + 3] |= Culler::result_type(vgetq_lane_u32(visible, 3) << bit);
     }
 }
 
+static void intersectsSpheresNEON(
+        Culler::result_type* UTILS_RESTRICT results,
+        Frustum const& UTILS_RESTRICT frustum,
+        float4 const* UTILS_RESTRICT b,
+        size_t count) noexcept {
+
+    float4 const* const UTILS_RESTRICT planes = frustum.getNormalizedPlanes();
+    count = Culler::round(count); // capacity guaranteed to be multiple of 8
+    for (size_t i = 0; i < count; i += 4) {
+        // vld4 de-interleaves the float4 for us
+        const float32x4x4_t s = vld4q_f32(&b[i].x);
+
+        uint32x4_t visible = vdupq_n_u32(~0u);
+        for (size_t j = 0; j < 6; j++) {
+            float32x4_t dot = vmulq_n_f32(s.val[0], planes[j].x);
+            dot = vaddq_f32(dot, vmulq_n_f32(s.val[1], planes[j].y));
+            dot = vaddq_f32(dot, vmulq_n_f32(s.val[2], planes[j].z));
+            dot = vaddq_f32(dot, vdupq_n_f32(planes[j].w));
+            dot = vsubq_f32(dot, s.val[3]);
+            visible = vandq_u32(visible, vreinterpretq_u32_f32(dot));
+        }
+
+        visible = vshrq_n_u32(visible, 31);
+        results[i + 0] = Culler::result_type(vgetq_lane_u32(visible, 0));
+        results[i + 1] = Culler::result_type(vgetq_lane_u32(visible, 1));
+        results[i + 2] = Culler::result_type(vgetq_lane_u32(visible, 2));
+        results[i + 3] = Culler::result_type(vgetq_lane_u32(visible, 3));
+    }
+}
+
+#endif // CULLER_HAS_NEON
+
+// ------------------------------------------------------------------------------------------------
+// Runtime dispatch
+// ------------------------------------------------------------------------------------------------
+
+#if CULLER_HAS_AVX
+static bool cpuSupportsAVX() noexcept {
+    // the CPU model is normally initialized by a static constructor, which may not have run yet
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx");
+}
+#endif
+
+static BoxesKernel selectBoxesKernel() noexcept {
+#if CULLER_HAS_AVX
+    if (cpuSupportsAVX()) {
+        return intersectsBoxesAVX;
+    }
+#endif
+#if CULLER_HAS_SSE2
+    return intersectsBoxesSSE2;
+#elif CULLER_HAS_NEON
+    return intersectsBoxesNEON;
+#else
+    return intersectsBoxesScalar;
+#endif
+}
+
+static SpheresKernel selectSpheresKernel() noexcept {
+#if CULLER_HAS_AVX
+    if (cpuSupportsAVX()) {
+        return intersectsSpheresAVX;
+    }
+#endif
+#if CULLER_HAS_SSE2
+    return intersectsSpheresSSE2;
+#elif CULLER_HAS_NEON
+    return intersectsSpheresNEON;
+#else
+    return intersectsSpheresScalar;
+#endif
+}
+
+// ------------------------------------------------------------------------------------------------
+
+void Culler::intersects(
+        result_type* UTILS_RESTRICT results,
+        Frustum const& UTILS_RESTRICT frustum,
+        filament::math::float4 const* UTILS_RESTRICT b,
+        size_t count) noexcept {
+    // the kernel is selected on first use, so culling from a static constructor works too
+    static const SpheresKernel sIntersectsSpheres = selectSpheresKernel();
+    sIntersectsSpheres(results, frustum, b, count);
+}
+
+void Culler::intersects(
+        result_type* UTILS_RESTRICT results,
+        Frustum const& UTILS_RESTRICT frustum,
+        filament::math::float3 const* UTILS_RESTRICT center,
+        filament::math::float3 const* UTILS_RESTRICT extent,
+        size_t count, size_t bit) noexcept {
+    static const BoxesKernel sIntersectsBoxes = selectBoxesKernel();
+    sIntersectsBoxes(results, frustum, center, extent, count, bit);
+}
+
 /*
  * returns whether a box intersects with the frustum
  */
@@ -135,5 +508,21 @@ void Culler::Test::intersects(
     Culler::intersects(results, frustum, b, count);
 }
 
+void Culler::Test::intersectsReference(
+        result_type* UTILS_RESTRICT results,
+        Frustum const& UTILS_RESTRICT frustum,
+        filament::math::float3 const* UTILS_RESTRICT c,
+        filament::math::float3 const* UTILS_RESTRICT e,
+        size_t count) noexcept {
+    intersectsBoxesScalar(results, frustum, c, e, count, 0);
+}
+
+void Culler::Test::intersectsReference(
+        result_type* UTILS_RESTRICT results,
+        Frustum const& UTILS_RESTRICT frustum,
+        filament::math::float4 const* UTILS_RESTRICT b, size_t count) noexcept {
+    intersectsSpheresScalar(results, frustum, b, count);
+}
+
 } // namespace details
 } // namespace filament
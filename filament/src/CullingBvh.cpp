@@ -0,0 +1,238 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "details/CullingBvh.h"
+
+#include <utils/JobSystem.h>
+#include <utils/Systrace.h>
+
+#include <math/vec4.h>
+
+#include <algorithm>
+#include <limits>
+
+using namespace filament::math;
+using namespace utils;
+
+namespace filament {
+namespace details {
+
+constexpr size_t CullingBvh::LEAF_SIZE;
+
+// spreads the 10 low bits of v, so there are 2 zeros between each bit
+static inline uint32_t expandBits(uint32_t v) noexcept {
+    v = (v * 0x00010001u) & 0xFF0000FFu;
+    v = (v * 0x00000101u) & 0x0F00F00Fu;
+    v = (v * 0x00000011u) & 0xC30C30C3u;
+    v = (v * 0x00000005u) & 0x49249249u;
+    return v;
+}
+
+void CullingBvh::sortByLocation(uint32_t* order,
+        float3 const* center, size_t count) noexcept {
+    SYSTRACE_CALL();
+
+    float3 lo{ std::numeric_limits<float>::max() };
+    float3 hi{ std::numeric_limits<float>::lowest() };
+    for (size_t i = 0; i < count; i++) {
+        lo = min(lo, center[i]);
+        hi = max(hi, center[i]);
+    }
+    const float3 d = hi - lo;
+    const float3 scale{
+            d.x > 0 ? 1023.0f / d.x : 0.0f,
+            d.y > 0 ? 1023.0f / d.y : 0.0f,
+            d.z > 0 ? 1023.0f / d.z : 0.0f };
+
+    // sort objects along a z-order (morton) curve, the index is stored in the low bits
+    std::vector<uint64_t> keys(count);
+    for (size_t i = 0; i < count; i++) {
+        const float3 p = (center[i] - lo) * scale;
+        const uint32_t code = (expandBits(uint32_t(p.x)) << 2u) |
+                              (expandBits(uint32_t(p.y)) << 1u) |
+                               expandBits(uint32_t(p.z));
+        keys[i] = (uint64_t(code) << 32u) | i;
+    }
+    std::sort(keys.begin(), keys.end());
+    for (size_t i = 0; i < count; i++) {
+        order[i] = uint32_t(keys[i]);
+    }
+}
+
+void CullingBvh::clear() noexcept {
+    mNodes.clear();
+    mCount = 0;
+    mLeafCount = 0;
+    mFirstLeaf = 0;
+    mLeafArea = 0;
+    mReferenceLeafArea = 0;
+}
+
+void CullingBvh::refit(JobSystem& js,
+        float3 const* center, float3 const* extent, size_t count, bool rebuilt) noexcept {
+    SYSTRACE_CALL();
+
+    if (UTILS_UNLIKELY(count == 0)) {
+        clear();
+        return;
+    }
+
+    const Node emptyNode{
+            float3{ std::numeric_limits<float>::max() },
+            float3{ std::numeric_limits<float>::lowest() }};
+
+    // the first leaf is the smallest power-of-two that can hold all leaves
+    mCount = count;
+    mLeafCount = (count + LEAF_SIZE - 1) / LEAF_SIZE;
+    mFirstLeaf = 1;
+    while (mFirstLeaf < mLeafCount) {
+        mFirstLeaf *= 2;
+    }
+    mNodes.resize(mFirstLeaf * 2);
+
+    // compute the leaves bounds, this runs on multiple threads
+    Node* const UTILS_RESTRICT leaves = mNodes.data() + mFirstLeaf;
+    auto work = [leaves, center, extent, count, &emptyNode](uint32_t start, uint32_t c) {
+        for (size_t j = start, e = start + c; j < e; j++) {
+            Node node = emptyNode;
+            for (size_t i = j * LEAF_SIZE, n = std::min(count, i + LEAF_SIZE); i < n; i++) {
+                node.min = min(node.min, center[i] - extent[i]);
+                node.max = max(node.max, center[i] + extent[i]);
+            }
+            leaves[j] = node;
+        }
+    };
+    auto job = jobs::parallel_for(js, nullptr, 0, (uint32_t)mLeafCount,
+            std::cref(work), jobs::CountSplitter<16, 8>());
+    js.runAndWait(job);
+
+    std::fill(leaves + mLeafCount, leaves + mFirstLeaf, emptyNode);
+
+    // the sum of the leaves' areas tells us how well the tree fits the objects
+    float area = 0;
+    for (size_t j = 0; j < mLeafCount; j++) {
+        const float3 d = leaves[j].max - leaves[j].min;
+        area += 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+    }
+    mLeafArea = area;
+    if (rebuilt || mReferenceLeafArea == 0) {
+        mReferenceLeafArea = area;
+    }
+
+    // and propagate the bounds up the tree
+    Node* const UTILS_RESTRICT nodes = mNodes.data();
+    for (size_t i = mFirstLeaf - 1; i > 0; i--) {
+        nodes[i].min = min(nodes[2 * i].min, nodes[2 * i + 1].min);
+        nodes[i].max = max(nodes[2 * i].max, nodes[2 * i + 1].max);
+    }
+}
+
+CullingBvh::Classification CullingBvh::classify(
+        float4 const* planes, Node const& node) noexcept {
+    if (UTILS_UNLIKELY(node.min.x > node.max.x)) {
+        // empty node
+        return Classification::OUTSIDE;
+    }
+    const float3 center = (node.max + node.min) * 0.5f;
+    const float3 extent = (node.max - node.min) * 0.5f;
+    Classification result = Classification::INSIDE;
+    for (size_t j = 0; j < 6; j++) {
+        const float d = dot(planes[j].xyz, center) + planes[j].w;
+        const float r = dot(abs(planes[j].xyz), extent);
+        if (d - r > 0) {
+            return Classification::OUTSIDE;
+        }
+        if (d + r > 0) {
+            result = Classification::INTERSECTS;
+        }
+    }
+    return result;
+}
+
+void CullingBvh::intersects(JobSystem& js, Culler::result_type* results,
+        Frustum const& frustum, float3 const* center, float3 const* extent,
+        size_t bit) const noexcept {
+    SYSTRACE_CALL();
+
+    if (UTILS_UNLIKELY(empty())) {
+        return;
+    }
+
+    // Walk the tree and collect the leaves that need processing, leaves entirely inside the
+    // frustum are flagged so we don't test their objects.
+    constexpr uint32_t INSIDE = 0x80000000u;
+    std::vector<uint32_t> leaves;
+    leaves.reserve(mLeafCount);
+
+    float4 const* const planes = frustum.getNormalizedPlanes();
+    Node const* const nodes = mNodes.data();
+    const uint32_t firstLeaf = uint32_t(mFirstLeaf);
+    const uint32_t leafCount = uint32_t(mLeafCount);
+
+    // the tree has at most 32 levels, so this is enough for a depth-first traversal
+    uint32_t stack[64];
+    size_t sp = 0;
+    stack[sp++] = 1;
+    while (sp) {
+        const uint32_t i = stack[--sp];
+        const Classification c = classify(planes, nodes[i]);
+        if (c == Classification::OUTSIDE) {
+            continue;
+        }
+        if (c == Classification::INSIDE) {
+            // find the range of leaves under this node
+            uint32_t first = i;
+            uint32_t last = i + 1;
+            while (first < firstLeaf) {
+                first *= 2;
+                last *= 2;
+            }
+            last = std::min(last - firstLeaf, leafCount);
+            for (uint32_t j = first - firstLeaf; j < last; j++) {
+                leaves.push_back(j | INSIDE);
+            }
+        } else if (i >= firstLeaf) {
+            leaves.push_back(i - firstLeaf);
+        } else {
+            stack[sp++] = 2 * i + 1;
+            stack[sp++] = 2 * i;
+        }
+    }
+
+    // process the collected leaves, this runs on multiple threads
+    auto work = [results, &frustum, center, extent, bit, count = mCount, leaves = leaves.data()]
+            (uint32_t start, uint32_t c) {
+        for (size_t k = start, e = start + c; k < e; k++) {
+            const size_t first = (leaves[k] & ~INSIDE) * LEAF_SIZE;
+            const size_t n = std::min(count - first, LEAF_SIZE);
+            if (leaves[k] & INSIDE) {
+                const Culler::result_type visible = Culler::result_type(1u << bit);
+                for (size_t i = first, end = first + n; i < end; i++) {
+                    results[i] |= visible;
+                }
+            } else {
+                Culler::intersects(results + first, frustum,
+                        center + first, extent + first, n, bit);
+            }
+        }
+    };
+    auto job = jobs::parallel_for(js, nullptr, 0, (uint32_t)leaves.size(),
+            std::cref(work), jobs::CountSplitter<16, 8>());
+    js.runAndWait(job);
+}
+
+} // namespace details
+} // namespace filament
@@ -49,6 +49,7 @@
 #include <math/fast.h>
 #include <math/scalar.h>
 
+#include <algorithm>
 #include <functional>
 
 #include <stdio.h>
@@ -145,6 +146,8 @@ FEngine::FEngine(Backend backend, Platform* platform, void* sharedGLContext) :
     // we're assuming we're on the main thread here.
     // (it may not be the case)
     mJobSystem.adopt();
+
+    mTransformManager.setJobSystem(&mJobSystem);
 }
 
 /*
@@ -216,7 +219,6 @@ void FEngine::init() {
             .build(*this));
 
     mPostProcessManager.init(*this);
-    mRenderTargetPool.init(*this);
     mLightManager.init(*this);
     mDFG.reset(new DFG(*this));
 
@@ -236,10 +238,17 @@ FEngine::~FEngine() noexcept {
 void FEngine::shutdown() {
 #ifndef NDEBUG
     // print out some statistics about this run
-    size_t wm = mCommandBufferQueue.getHigWatermark();
+    CommandBufferQueue::Stats const& stats = mCommandBufferQueue.getStats();
+    size_t wm = stats.highWatermark;
     size_t wmpct = wm / (CONFIG_COMMAND_BUFFERS_SIZE / 100);
     slog.d << "CircularBuffer: High watermark "
            << wm / 1024 << " KiB (" << wmpct << "%)" << io::endl;
+    slog.d << "CircularBuffer: " << stats.frameCount << " frames, max "
+           << stats.maxFrameSize / 1024 << " KiB/frame, "
+           << stats.bytesSubmitted / (1024 * std::max(stats.frameCount, uint64_t(1)))
+           << " KiB/frame average" << io::endl;
+    slog.d << "CircularBuffer: flush() blocked " << stats.blockedCount << " times out of "
+           << stats.flushCount << ", for " << stats.blockedTime / 1000000 << " ms" << io::endl;
 #endif
 
     DriverApi& driver = getDriverApi();
@@ -249,7 +258,7 @@ void FEngine::shutdown() {
      */
 
     mPostProcessManager.terminate(driver);  // free-up post-process manager resources
-    mRenderTargetPool.terminate(driver);    // free-up all offscreen render targets
+    mFrameGraphTexturePool.terminate(driver); // free-up all framegraph transient textures
     mDFG->terminate();                      // free-up the DFG
     mRenderableManager.terminate();         // free-up all renderables
     mLightManager.terminate();              // free-up all lights
@@ -722,11 +731,16 @@ void* FEngine::streamAlloc(size_t size, size_t alignment) noexcept {
 bool FEngine::execute() {
 
     // wait until we get command buffers to be executed (or thread exit requested)
-    auto buffers = mCommandBufferQueue.waitForCommands();
+    auto const& buffers = mCommandBufferQueue.waitForCommands();
     if (UTILS_UNLIKELY(buffers.empty())) {
         return false;
     }
 
+    FrameTimer& timer = mFrameTimer;
+    const bool timed = timer.isEnabled();
+    const FrameTimer::clock::time_point start = timed ?
+            FrameTimer::clock::now() : FrameTimer::clock::time_point{};
+
     // execute all command buffers
     for (auto& item : buffers) {
         if (UTILS_LIKELY(item.begin)) {
@@ -735,6 +749,10 @@ bool FEngine::execute() {
         }
     }
 
+    if (UTILS_UNLIKELY(timed)) {
+        timer.addDriverTime(FrameTimer::clock::now() - start);
+    }
+
     return true;
 }
 
@@ -892,6 +910,26 @@ void Engine::execute() {
     upcast(this)->execute();
 }
 
+void Engine::setBlobCache(BlobCache* cache) noexcept {
+    upcast(this)->getDriverApi().setBlobCache(cache);
+}
+
+Engine::CommandBufferStats Engine::getCommandBufferStats() const noexcept {
+    CommandBufferQueue::Stats const& stats = upcast(this)->getCommandBufferQueue().getStats();
+    CommandBufferStats result;
+    result.bufferSize = FEngine::CONFIG_COMMAND_BUFFERS_SIZE;
+    result.requiredSize = FEngine::CONFIG_MIN_COMMAND_BUFFERS_SIZE;
+    result.highWatermark = stats.highWatermark;
+    result.flushCount = stats.flushCount;
+    result.bytesSubmitted = stats.bytesSubmitted;
+    result.blockedCount = stats.blockedCount;
+    result.blockedTime = stats.blockedTime;
+    result.frameCount = stats.frameCount;
+    result.lastFrameSize = stats.lastFrameSize;
+    result.maxFrameSize = stats.maxFrameSize;
+    return result;
+}
+
 DebugRegistry& Engine::getDebugRegistry() noexcept {
     return upcast(this)->getDebugRegistry();
 }
@@ -24,6 +24,7 @@
 
 #include <math/scalar.h>
 
+#include <algorithm>
 #include <cmath>
 
 namespace filament {
@@ -118,12 +119,65 @@ void FrameInfoManager::finish(FrameInfo* info) noexcept {
     }
     // add a copy of the new element to the history
     history.push_back(*info);
+
+    // and report the GPU time of this frame, if it's timed
+    std::chrono::nanoseconds gpuTime = info->laps[FrameInfo::FINISH] - info->laps[FrameInfo::START];
+    setTimingStage(info->frame, Renderer::FrameTiming::Stage::GPU,
+            uint64_t(gpuTime.count()), TIMING_PENDING_GPU);
     lock.unlock();
 
     // return the item to the pool without the lock held
     mPoolArena.free(info);
 }
 
+void FrameInfoManager::addTiming(Renderer::FrameTiming const& timing) noexcept {
+    std::unique_lock<std::mutex> lock(mLock);
+    TimingRecord& record = mTimings[mTimingCount % mTimings.size()];
+    record.timing = timing;
+    // the GPU time is only reported for frames tracked by a FrameInfo
+    record.pending = uint8_t(TIMING_PENDING_DRIVER | (mCurrentFrameInfo ? TIMING_PENDING_GPU : 0));
+    mTimingCount++;
+}
+
+void FrameInfoManager::setTimingDriverTime(uint32_t frameId, uint64_t driverTime) noexcept {
+    std::unique_lock<std::mutex> lock(mLock);
+    setTimingStage(frameId, Renderer::FrameTiming::Stage::DRIVER_EXECUTION,
+            driverTime, TIMING_PENDING_DRIVER);
+}
+
+FrameInfoManager::TimingRecord* FrameInfoManager::findTiming(uint32_t frameId) noexcept {
+    // frames are timed in order, so this typically finds the frame in the first few iterations
+    for (size_t i = 0, c = std::min(mTimingCount, mTimings.size()); i < c; i++) {
+        TimingRecord& record = mTimings[(mTimingCount - 1 - i) % mTimings.size()];
+        if (record.timing.frameId == frameId) {
+            return &record;
+        }
+    }
+    return nullptr;
+}
+
+void FrameInfoManager::setTimingStage(uint32_t frameId, Renderer::FrameTiming::Stage stage,
+        uint64_t time, TimingPending completed) noexcept {
+    // mLock must be held
+    TimingRecord* const record = findTiming(frameId);
+    if (record) {
+        record->timing.stages[size_t(stage)] = time;
+        record->pending &= ~completed;
+    }
+}
+
+size_t FrameInfoManager::getTimings(Renderer::FrameTiming* timings, size_t count) const noexcept {
+    std::unique_lock<std::mutex> lock(mLock);
+    size_t n = 0;
+    for (size_t i = 0, c = std::min(mTimingCount, mTimings.size()); i < c && n < count; i++) {
+        TimingRecord const& record = mTimings[(mTimingCount - 1 - i) % mTimings.size()];
+        if (!record.pending) {
+            timings[n++] = record.timing;
+        }
+    }
+    return n;
+}
+
 // ------------------------------------------------------------------------------------------------
 
 FrameInfoManager::SyncThread::~SyncThread() {
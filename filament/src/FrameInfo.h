@@ -20,9 +20,11 @@
 #include "details/Engine.h"
 
 #include <filament/Fence.h>
+#include <filament/Renderer.h>
 
 #include <utils/Allocator.h>
 
+#include <array>
 #include <deque>
 #include <chrono>
 #include <condition_variable>
@@ -139,6 +141,17 @@ public:
         return HISTORY_COUNT;
     }
 
+    // Frame timings. A timing is added at the end of the frame, and is complete once the driver
+    // (and the GPU, if the frame is tracked) has reported its time.
+
+    // call this before endFrame()
+    void addTiming(Renderer::FrameTiming const& timing) noexcept;
+
+    // call this from the driver thread once the frame's commands are executed
+    void setTimingDriverTime(uint32_t frameId, uint64_t driverTime) noexcept;
+
+    size_t getTimings(Renderer::FrameTiming* timings, size_t count) const noexcept;
+
 private:
 
     class SyncThread {
@@ -177,6 +190,24 @@ private:
 
     mutable std::mutex mLock;
     std::vector<FrameInfo> mFrameInfoHistory;
+
+    enum TimingPending : uint8_t {
+        TIMING_PENDING_DRIVER   = 0x1,
+        TIMING_PENDING_GPU      = 0x2
+    };
+
+    struct TimingRecord {
+        Renderer::FrameTiming timing;
+        uint8_t pending = 0;
+    };
+
+    TimingRecord* findTiming(uint32_t frameId) noexcept;
+    void setTimingStage(uint32_t frameId, Renderer::FrameTiming::Stage stage,
+            uint64_t time, TimingPending completed) noexcept;
+
+    // circular buffer of frame timings, protected by mLock
+    std::array<TimingRecord, Renderer::FRAME_TIMING_HISTORY_SIZE> mTimings;
+    size_t mTimingCount = 0;
 };
 
 
@@ -134,6 +134,32 @@ void Froxelizer::setOptions(float zLightNear, float zLightFar) noexcept {
 }
 
 
+void Froxelizer::setAdaptiveGridEnabled(bool enabled) noexcept {
+    if (mAdaptiveGrid != enabled) {
+        mAdaptiveGrid = enabled;
+        if (!enabled && mFroxelBudget != FROXEL_BUFFER_ENTRY_COUNT_DEFAULT) {
+            mFroxelBudget = uint16_t(FROXEL_BUFFER_ENTRY_COUNT_DEFAULT);
+            mDirtyFlags |= VIEWPORT_CHANGED;
+        }
+    }
+}
+
+void Froxelizer::updateFroxelBudget() noexcept {
+    // When lights were dropped because the record buffer was full, use half as many froxels,
+    // which roughly halves the number of records needed. Conversely, if the record buffer
+    // would still be at most half full with twice as many froxels, use more froxels.
+    size_t budget = mFroxelBudget;
+    if (mRecordBufferOverflow) {
+        budget = std::max(budget / 2, FROXEL_BUFFER_ENTRY_COUNT_MIN);
+    } else if (mRecordBufferUsage < RECORD_BUFFER_ENTRY_COUNT / 4) {
+        budget = std::min(budget * 2, FROXEL_BUFFER_ENTRY_COUNT_MAX);
+    }
+    if (UTILS_UNLIKELY(budget != mFroxelBudget)) {
+        mFroxelBudget = uint16_t(budget);
+        mDirtyFlags |= VIEWPORT_CHANGED;
+    }
+}
+
 void Froxelizer::setViewport(filament::Viewport const& viewport) noexcept {
     if (UTILS_UNLIKELY(mViewport != viewport)) {
         mViewport = viewport;
@@ -154,6 +180,9 @@ bool Froxelizer::prepare(
         const filament::math::mat4f& projection, float projectionNear, float projectionFar) noexcept {
     setViewport(viewport);
     setProjection(projection, projectionNear, projectionFar);
+    if (mAdaptiveGrid) {
+        updateFroxelBudget();
+    }
 
     bool uniformsNeedUpdating = false;
     if (UTILS_UNLIKELY(mDirtyFlags)) {
@@ -165,10 +194,15 @@ bool Froxelizer::prepare(
      * the command stream.
      */
 
-    // froxel buffer (~32 KiB)
+    // all the buffers below are sized for the current froxel grid
+    const size_t froxelCount = getFroxelCount();
+
+    // froxel buffer (~32 KiB w/ 8192 froxels), we only upload the rows we're using
+    const size_t froxelBufferEntryCount =
+            (froxelCount + FROXEL_BUFFER_WIDTH_MASK) & ~FROXEL_BUFFER_WIDTH_MASK;
     mFroxelBufferUser = {
-            driverApi.allocatePod<FroxelEntry>(FROXEL_BUFFER_ENTRY_COUNT_MAX),
-            FROXEL_BUFFER_ENTRY_COUNT_MAX };
+            driverApi.allocatePod<FroxelEntry>(froxelBufferEntryCount),
+            froxelBufferEntryCount };
 
     // record buffer (~64 KiB)
     mRecordBufferUser = {
@@ -179,16 +213,25 @@ bool Froxelizer::prepare(
      * Temporary allocations for processing all froxel data
      */
 
-    // light records per froxel (~256 KiB)
-    mLightRecords = {
-            arena.allocate<LightRecord>(FROXEL_BUFFER_ENTRY_COUNT_MAX, CACHELINE_SIZE),
-            FROXEL_BUFFER_ENTRY_COUNT_MAX };
+    // these share the per-render pass arena with the commands buffer, see Renderer::renderJob()
+    static_assert(FROXEL_BUFFER_ENTRY_COUNT_MAX * sizeof(LightRecord) + CACHELINE_SIZE +
+            GROUP_COUNT * (FROXEL_BUFFER_ENTRY_COUNT_MAX + CACHELINE_SIZE) * sizeof(LightGroupType) +
+            CONFIG_PER_FRAME_COMMANDS_SIZE + CACHELINE_SIZE <= CONFIG_PER_RENDER_PASS_ARENA_SIZE,
+            "the per-render pass arena can't hold the largest froxel grid and the commands");
 
-    // froxel thread data (~256 KiB)
+    // light records per froxel (~256 KiB w/ 8192 froxels)
+    mLightRecords = {
+            arena.allocate<LightRecord>(froxelCount, CACHELINE_SIZE),
+            froxelCount };
+
+    // froxel thread data (~256 KiB w/ 8192 froxels), each group starts on its own cache-line
+    // so that jobs don't share them.
+    constexpr size_t GROUPS_PER_CACHELINE = CACHELINE_SIZE / sizeof(LightGroupType);
+    mFroxelThreadStride =
+            (froxelCount + 1 + GROUPS_PER_CACHELINE - 1) & ~(GROUPS_PER_CACHELINE - 1);
     mFroxelShardedData = {
-            arena.allocate<FroxelThreadData>(GROUP_COUNT, CACHELINE_SIZE),
-            uint32_t(GROUP_COUNT)
-    };
+            arena.allocate<LightGroupType>(GROUP_COUNT * mFroxelThreadStride, CACHELINE_SIZE),
+            GROUP_COUNT * mFroxelThreadStride };
 
     assert(mFroxelBufferUser.begin());
     assert(mRecordBufferUser.begin());
@@ -206,13 +249,13 @@ bool Froxelizer::prepare(
 
 void Froxelizer::computeFroxelLayout(
         uint2* dim, uint16_t* countX, uint16_t* countY, uint16_t* countZ,
-        filament::Viewport const& viewport) noexcept {
+        filament::Viewport const& viewport, size_t froxelBudget) noexcept {
 
     if (SUPPORTS_NON_SQUARE_FROXELS == false) {
-        // calculate froxel dimension from FROXEL_BUFFER_ENTRY_COUNT_MAX and viewport
+        // calculate froxel dimension from froxelBudget and viewport
         // - Start from the maximum number of froxels we can use in the x-y plane
         size_t froxelSliceCount = FEngine::CONFIG_FROXEL_SLICE_COUNT;
-        size_t froxelPlaneCount = FROXEL_BUFFER_ENTRY_COUNT_MAX / froxelSliceCount;
+        size_t froxelPlaneCount = froxelBudget / froxelSliceCount;
         // - compute the number of square froxels we need in width and height, rounded down
         //   solving: |  froxelCountX * froxelCountY == froxelPlaneCount
         //            |  froxelCountX / froxelCountY == width / height
@@ -254,7 +297,8 @@ bool Froxelizer::update() noexcept {
 
         uint2 froxelDimension;
         uint16_t froxelCountX, froxelCountY, froxelCountZ;
-        computeFroxelLayout(&froxelDimension, &froxelCountX, &froxelCountY, &froxelCountZ, viewport);
+        computeFroxelLayout(&froxelDimension, &froxelCountX, &froxelCountY, &froxelCountZ,
+                viewport, mFroxelBudget);
 
         mFroxelDimension = froxelDimension;
         mClipToFroxelX = (0.5f * viewport.width)  / froxelDimension.x;
@@ -269,7 +313,7 @@ bool Froxelizer::update() noexcept {
                << froxelDimension.x << "x" << froxelDimension.y << io::endl
                << "Froxel: " << froxelCountX << "x" << froxelCountY << "x" << froxelSliceCount
                << " = " << (froxelCountX * froxelCountY * froxelSliceCount)
-               << " (" << FROXEL_BUFFER_ENTRY_COUNT_MAX - froxelCountX * froxelCountY * froxelSliceCount << " lost)"
+               << " (" << mFroxelBudget - froxelCountX * froxelCountY * froxelSliceCount << " lost)"
                << io::endl;
 #endif
 
@@ -569,15 +613,16 @@ void Froxelizer::froxelizeLoop(FEngine& engine,
         const FScene::LightSoa& UTILS_RESTRICT lightData) noexcept {
     SYSTRACE_CALL();
 
-    Slice<FroxelThreadData> froxelThreadData = mFroxelShardedData;
-    memset(froxelThreadData.data(), 0, froxelThreadData.sizeInBytes());
+    memset(mFroxelShardedData.data(), 0, mFroxelShardedData.sizeInBytes());
+    LightGroupType* const froxelThreadData = mFroxelShardedData.data();
+    const size_t froxelThreadStride = mFroxelThreadStride;
 
     auto& lcm = engine.getLightManager();
     auto const* UTILS_RESTRICT spheres      = lightData.data<FScene::POSITION_RADIUS>();
     auto const* UTILS_RESTRICT directions   = lightData.data<FScene::DIRECTION>();
     auto const* UTILS_RESTRICT instances    = lightData.data<FScene::LIGHT_INSTANCE>();
 
-    auto process = [ this, &froxelThreadData,
+    auto process = [ this, froxelThreadData, froxelThreadStride,
                      spheres, directions, instances, &camera, &lcm ]
             (size_t count, size_t offset, size_t stride) {
 
@@ -599,7 +644,7 @@ void Froxelizer::froxelizeLoop(FEngine& engine,
             const size_t bit   = i / GROUP_COUNT;
             assert(bit < LIGHT_PER_GROUP);
 
-            FroxelThreadData& threadData = froxelThreadData[group];
+            LightGroupType* const threadData = froxelThreadData + group * froxelThreadStride;
             const bool isSpot = light.invSin != std::numeric_limits<float>::infinity();
             threadData[0] |= isSpot << bit;
             froxelizePointAndSpotLight(threadData, bit, projection, light);
@@ -628,7 +673,8 @@ void Froxelizer::froxelizeAssignRecordsCompress() noexcept {
 
     SYSTRACE_CALL();
 
-    Slice<FroxelThreadData> froxelThreadData = mFroxelShardedData;
+    LightGroupType const* const UTILS_RESTRICT froxelThreadData = mFroxelShardedData.data();
+    const size_t stride = mFroxelThreadStride;
 
     // convert froxel data from N groups of M bits to LightRecord::bitset, so we can
     // easily compare adjacent froxels, for compaction. The conversion loops below get
@@ -639,22 +685,23 @@ void Froxelizer::froxelizeAssignRecordsCompress() noexcept {
     for (size_t i = 0; i < LightRecord::bitset::WORLD_COUNT; i++) {
         using container_type = LightRecord::bitset::container_type;
         constexpr size_t r = sizeof(container_type) / sizeof(LightGroupType);
-        container_type b = froxelThreadData[i * r][0];
+        container_type b = froxelThreadData[(i * r) * stride];
         for (size_t k = 0; k < r; k++) {
-            b |= (container_type(froxelThreadData[i * r + k][0]) << (LIGHT_PER_GROUP * k));
+            b |= (container_type(froxelThreadData[(i * r + k) * stride]) << (LIGHT_PER_GROUP * k));
         }
         spotLights.getBitsAt(i) = b;
     }
 
     // this gets very well vectorized...
     utils::Slice<LightRecord> records(mLightRecords);
-    for (size_t j = 1, jc = FROXEL_BUFFER_ENTRY_COUNT_MAX; j < jc; j++) {
+    for (size_t j = 1, jc = getFroxelCount() + 1; j < jc; j++) {
         for (size_t i = 0; i < LightRecord::bitset::WORLD_COUNT; i++) {
             using container_type = LightRecord::bitset::container_type;
             constexpr size_t r = sizeof(container_type) / sizeof(LightGroupType);
-            container_type b = froxelThreadData[i * r][j];
+            container_type b = froxelThreadData[(i * r) * stride + j];
             for (size_t k = 0; k < r; k++) {
-                b |= (container_type(froxelThreadData[i * r + k][j]) << (LIGHT_PER_GROUP * k));
+                b |= (container_type(froxelThreadData[(i * r + k) * stride + j])
+                        << (LIGHT_PER_GROUP * k));
             }
             records[j - 1].lights.getBitsAt(i) = b;
         }
@@ -677,6 +724,12 @@ void Froxelizer::froxelizeAssignRecordsCompress() noexcept {
     // how many froxel record entries were reused (for debugging)
     UTILS_UNUSED size_t reused = 0;
 
+    // the froxel buffer is padded to a whole number of rows
+    for (size_t i = getFroxelCount(), c = mFroxelBufferUser.size(); i < c; i++) {
+        froxels[i].u32 = 0;
+    }
+    mRecordBufferOverflow = false;
+
     for (size_t i = 0, c = getFroxelCount(); i < c;) {
         LightRecord b = records[i];
         if (b.lights.none()) {
@@ -701,6 +754,7 @@ void Froxelizer::froxelizeAssignRecordsCompress() noexcept {
             do { // this compiles to memset() when remap() is identity
                 froxels[remap(i++)].u32 = 0;
             } while(i < c);
+            mRecordBufferOverflow = true;
             goto out_of_memory;
         }
 
@@ -748,7 +802,7 @@ void Froxelizer::froxelizeAssignRecordsCompress() noexcept {
         } while(records[i].lights == b.lights);
     }
 out_of_memory:
-    ;
+    mRecordBufferUsage = offset;
 }
 
 static inline float2 project(mat4f const& p, float3 const& v) noexcept {
@@ -774,7 +828,7 @@ static inline float2 project(mat4f const& p, float3 const& v) noexcept {
 }
 
 void Froxelizer::froxelizePointAndSpotLight(
-        FroxelThreadData& froxelThread, size_t bit,
+        LightGroupType* UTILS_RESTRICT froxelThread, size_t bit,
         mat4f const& UTILS_RESTRICT p,
         const Froxelizer::LightParams& UTILS_RESTRICT light) const noexcept {
 
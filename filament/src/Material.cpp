@@ -330,6 +330,10 @@ Handle<HwProgram> FMaterial::getProgramSlow(uint8_t variantKey) const noexcept {
         pb.addUniformBlock(BindingPoints::PER_RENDERABLE_BONES, &UibGenerator::getPerRenderableBonesUib());
     }
 
+    if (Variant(variantKey).hasInstancing()) {
+        pb.addUniformBlock(BindingPoints::PER_RENDERABLE_INSTANCES, &UibGenerator::getPerRenderableInstancesUib());
+    }
+
     auto program = mEngine.getDriverApi().createProgram(std::move(pb));
     assert(program);
 
@@ -15,7 +15,6 @@
  */
 
 #include "PostProcessManager.h"
-#include "RenderTargetPool.h"
 
 #include "details/Engine.h"
 
@@ -34,8 +33,6 @@ using namespace details;
 void PostProcessManager::init(FEngine& engine) noexcept {
     mEngine = &engine;
 
-    mCommands.reserve(8);
-
     mPostProcessUb = UniformBuffer(engine.getPerPostProcessUib());
 
     // create sampler for post-process FBO
@@ -82,110 +79,6 @@ void PostProcessManager::setSource(uint32_t viewportWidth, uint32_t viewportHeig
     driver.updateUniformBuffer(mPostProcessUbh, ub.toBufferDescriptor(driver));
 }
 
-void PostProcessManager::blit(driver::TextureFormat format) noexcept {
-    mCommands.push_back({{}, format});
-}
-
-void PostProcessManager::pass(driver::TextureFormat format, Handle<HwProgram> program) noexcept {
-    mCommands.push_back({program, format});
-}
-
-void PostProcessManager::finish(driver::TargetBufferFlags discarded,
-        Handle<HwRenderTarget> viewRenderTarget,
-        filament::Viewport const& vp,
-        RenderTargetPool::Target const* previous,
-        filament::Viewport const& svp) {
-
-    assert(viewRenderTarget);
-    assert(previous);
-
-    FEngine& engine = *mEngine;
-    DriverApi& driver = engine.getDriverApi();
-    RenderTargetPool& rtp = engine.getRenderTargetPool();
-    Handle<HwRenderPrimitive> const& fullScreenRenderPrimitive = engine.getFullScreenRenderPrimitive();
-    std::vector<Command>& commands = mCommands;
-
-    if (UTILS_UNLIKELY(commands.empty())) {
-        rtp.put(previous);
-        return;
-    }
-
-    Driver::PipelineState pipeline;
-
-    pipeline.rasterState.culling = Driver::RasterState::CullingMode::NONE;
-    pipeline.rasterState.colorWrite = true;
-    pipeline.rasterState.depthFunc = Driver::RasterState::DepthFunc::A;
-
-    RenderPassParams params = {};
-    params.flags.discardStart = TargetBufferFlags::ALL;
-    params.flags.discardEnd = TargetBufferFlags::DEPTH_AND_STENCIL;
-    params.flags.dependencies = RenderPassFlags::DEPENDENCY_BY_REGION;
-    params.viewport.left = 0;
-    params.viewport.bottom = 0;
-    params.viewport.width = svp.width;
-    params.viewport.height = svp.height;
-
-    for (size_t i = 0, c = commands.size() - 1; i < c; i++) {
-        // if the next command is a blit, it we don't need a texture
-        uint8_t flags = !commands[i + 1].program ? RenderTargetPool::Target::NO_TEXTURE : uint8_t();
-
-        // create a render target for this pass
-        RenderTargetPool::Target const* target = rtp.get(
-                TargetBufferFlags::COLOR, svp.width, svp.height, 1, commands[i].format, flags);
-
-        assert(target);
-
-        if (commands[i].program) {
-            // set the source for this pass (i.e. previous target)
-            setSource(params.viewport.width, params.viewport.height, previous->texture, previous->w, previous->h);
-
-            // draw a full screen triangle
-            pipeline.program = commands[i].program;
-            driver.beginRenderPass(target->target, params);
-            driver.draw(pipeline, fullScreenRenderPrimitive);
-            driver.endRenderPass();
-        } else {
-            driver.blit(TargetBufferFlags::COLOR,
-                    target->target, { 0, 0, svp.width, svp.height },
-                    previous->target, { 0, 0, svp.width, svp.height });
-        }
-        // return the previous target to the pool
-        rtp.put(previous);
-        previous = target;
-    }
-
-    assert(!commands.empty());
-    assert(previous);
-
-    // The last command is special, it always draw to the viewRenderTarget and uses
-    // the non scaled viewport.
-    if (commands.back().program) {
-        params.flags.discardStart = discarded;
-        params.flags.discardEnd = TargetBufferFlags::DEPTH_AND_STENCIL;
-        params.viewport.left = vp.left;
-        params.viewport.bottom = vp.bottom;
-        params.viewport.width = vp.width;
-        params.viewport.height = vp.height;
-
-        setSource(params.viewport.width, params.viewport.height, previous->texture, previous->w, previous->h);
-        pipeline.program = commands.back().program;
-        driver.beginRenderPass(viewRenderTarget, params);
-        driver.draw(pipeline, fullScreenRenderPrimitive);
-        driver.endRenderPass();
-
-    } else {
-        driver.blit(TargetBufferFlags::COLOR,
-                viewRenderTarget, { vp.left, vp.bottom, vp.width, vp.height },
-                previous->target, { 0, 0, svp.width, svp.height });
-    }
-
-    rtp.put(previous);
-
-    // clear our command buffer
-    commands.clear();
-}
-
-
 // ------------------------------------------------------------------------------------------------
 
 FrameGraphResource PostProcessManager::msaa(FrameGraph& fg,
@@ -199,7 +92,10 @@ FrameGraphResource PostProcessManager::msaa(FrameGraph& fg,
     auto& ppMSAA = fg.addPass<PostProcessMSAA>("msaa",
             [&](FrameGraph::Builder& builder, PostProcessMSAA& data) {
                 auto const* inputDesc = fg.getDescriptor(input);
-                data.input = builder.useRenderTarget(input).textures[0];
+                // the color pass and this pass use different render targets, so the
+                // multi-sampled buffer we resolve from must be an actual texture
+                data.input = builder.read(input);
+                data.input = builder.useRenderTarget(data.input).textures[0];
 
                 FrameGraphResource::Descriptor outputDesc{
                         .width = inputDesc->width,
@@ -255,14 +151,14 @@ FrameGraphResource PostProcessManager::toneMapping(FrameGraph& fg,
                 pipeline.rasterState.depthFunc = Driver::RasterState::DepthFunc::A;
                 pipeline.program = toneMappingProgram;
 
-                auto const& targetDesc = resources.getDescriptor(data.output);
+                auto const& target = resources.getRenderTarget(data.output);
                 auto const& textureDesc = resources.getDescriptor(data.input);
                 auto const& texture = resources.getTexture(data.input);
-                setSource(targetDesc.width, targetDesc.height, texture, textureDesc.width, textureDesc.height);
+                setSource(target.params.viewport.width, target.params.viewport.height,
+                        texture, textureDesc.width, textureDesc.height);
 
-                auto const& target = resources.getRenderTarget(data.output);
                 driver.beginRenderPass(target.target, target.params);
-                driver.draw(pipeline, fullScreenRenderPrimitive);
+                driver.draw(pipeline, fullScreenRenderPrimitive, 1);
                 driver.endRenderPass();
             });
 
@@ -306,14 +202,14 @@ FrameGraphResource PostProcessManager::fxaa(FrameGraph& fg,
                 pipeline.rasterState.depthFunc = Driver::RasterState::DepthFunc::A;
                 pipeline.program = antiAliasingProgram;
 
-                auto const& targetDesc = resources.getDescriptor(data.output);
+                auto const& target = resources.getRenderTarget(data.output);
                 auto const& textureDesc = resources.getDescriptor(data.input);
                 auto const& texture = resources.getTexture(data.input);
-                setSource(targetDesc.width, targetDesc.height, texture, textureDesc.width, textureDesc.height);
+                setSource(target.params.viewport.width, target.params.viewport.height,
+                        texture, textureDesc.width, textureDesc.height);
 
-                auto const& target = resources.getRenderTarget(data.output);
                 driver.beginRenderPass(target.target, target.params);
-                driver.draw(pipeline, fullScreenRenderPrimitive);
+                driver.draw(pipeline, fullScreenRenderPrimitive, 1);
                 driver.endRenderPass();
             });
 
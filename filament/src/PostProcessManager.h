@@ -17,8 +17,6 @@
 #ifndef TNT_FILAMENT_POSTPROCESS_MANAGER_H
 #define TNT_FILAMENT_POSTPROCESS_MANAGER_H
 
-#include "RenderTargetPool.h"
-
 #include "UniformBuffer.h"
 
 #include "fg/FrameGraphResource.h"
@@ -30,8 +28,6 @@
 
 #include <filament/driver/DriverEnums.h>
 
-#include <vector>
-
 namespace filament {
 
 namespace details {
@@ -46,22 +42,6 @@ public:
     void setSource(uint32_t viewportWidth, uint32_t viewportHeight, Handle <HwTexture> texture,
             uint32_t textureWidth, uint32_t textureHeight) const noexcept;
 
-    // start() is a scam, it does nothing
-    void start() noexcept { }
-
-    // a fullscreen pass, using the given format as target and writing into the specified program
-    void pass(driver::TextureFormat format, Handle<HwProgram> program) noexcept;
-
-    // a blit pass, using the given format as target
-    void blit(driver::TextureFormat format = driver::TextureFormat::RGBA8) noexcept;
-
-    void finish(driver::TargetBufferFlags discarded,
-            Handle<HwRenderTarget> viewRenderTarget,
-            Viewport const& vp,
-            RenderTargetPool::Target const* linearTarget,
-            Viewport const& svp);
-
-
     FrameGraphResource msaa(
             FrameGraph& fg, FrameGraphResource input,
             driver::TextureFormat outFormat) noexcept;
@@ -82,13 +62,6 @@ public:
 private:
     details::FEngine* mEngine = nullptr;
 
-    struct Command {
-        Handle<HwProgram> program = {};
-        driver::TextureFormat format;
-    };
-
-    std::vector<Command> mCommands;
-
     // we need only one of these
     mutable UniformBuffer mPostProcessUb;
     Handle<HwSamplerBuffer> mPostProcessSbh;
@@ -17,6 +17,7 @@
 #include "RenderPass.h"
 
 #include "details/Culler.h"
+#include "details/FrameTimer.h"
 #include "details/Material.h"
 #include "details/MaterialInstance.h"
 #include "details/RenderPrimitive.h"
@@ -31,6 +32,9 @@
 #include <utils/JobSystem.h>
 #include <utils/Systrace.h>
 
+#include <algorithm>
+#include <vector>
+
 using namespace utils;
 using namespace filament::math;
 
@@ -49,9 +53,10 @@ void RenderPass::render(
         FScene& scene, Range<uint32_t> vr,
         uint32_t commandTypeFlags, RenderFlags renderFlags,
         const CameraInfo& camera, filament::Viewport const& viewport,
-        GrowingSlice<Command>& commands) noexcept {
+        GrowingSlice<Command>& commands, Culler::result_type visibilityMask) noexcept {
 
     SYSTRACE_CONTEXT();
+    FrameTimer::Scope timing(engine.getFrameTimer(), FrameTimer::Stage::COMMAND_GENERATION);
 
     // trace the number of visible renderables
     SYSTRACE_VALUE32("visibleRenderables", vr.size());
@@ -59,7 +64,7 @@ void RenderPass::render(
     FScene::RenderableSoa const& soa = scene.getRenderableData();
 
     // up-to-date summed primitive counts needed for generateCommands()
-    updateSummedPrimitiveCounts(const_cast<FScene::RenderableSoa&>(soa), vr);
+    updateSummedPrimitiveCounts(commandTypeFlags, const_cast<FScene::RenderableSoa&>(soa), vr);
 
     // compute how much maximum storage we need for this pass
     uint32_t growBy = FScene::getPrimitiveCount(soa, vr.last);
@@ -72,10 +77,11 @@ void RenderPass::render(
     // we extract camera position/forward outside of the loop, because these are not cheap.
     const float3 cameraPosition(camera.getPosition());
     const float3 cameraForwardVector(camera.getForwardVector());
-    auto work = [commandTypeFlags, curr, &soa, renderFlags, cameraPosition, cameraForwardVector]
+    auto work = [commandTypeFlags, curr, &soa, renderFlags, visibilityMask,
+            cameraPosition, cameraForwardVector]
             (uint32_t startIndex, uint32_t indexCount) {
         RenderPass::generateCommands(commandTypeFlags, curr,
-                soa, { startIndex, startIndex + indexCount }, renderFlags,
+                soa, { startIndex, startIndex + indexCount }, renderFlags, visibilityMask,
                 cameraPosition, cameraForwardVector);
     };
 
@@ -92,17 +98,22 @@ void RenderPass::render(
     // command buffer.
     commands.grow(1)->key = uint64_t(Pass::SENTINEL);
 
+    timing.next(FrameTimer::Stage::COMMAND_SORT);
+
     { // sort all commands
         SYSTRACE_NAME("sort commands");
-        std::sort(commands.begin(), commands.end());
+        // the unused part of the command buffer is used as scratch memory by the sort
+        sortCommands(js, commands, { commands.end(), uint32_t(commands.remain()) });
     }
 
+    timing.next(FrameTimer::Stage::COMMAND_RECORDING);
+
     // Take care not to upload data within the render pass (synchronize can commit froxel data)
     driver::DriverApi& driver = engine.getDriverApi();
     beginRenderPass(driver, viewport, camera);
 
     // Now, execute all commands
-    RenderPass::recordDriverCommands(driver, scene, commands);
+    RenderPass::recordDriverCommands(js, driver, scene, commands);
 
     endRenderPass(driver, viewport);
 
@@ -112,46 +123,262 @@ void RenderPass::render(
     engine.flush();
 }
 
+UTILS_NOINLINE
+void RenderPass::sortCommands(JobSystem& js,
+        Slice<Command> commands, Slice<Command> scratch) noexcept {
+    const uint32_t count = commands.size();
+    if (count < RADIX_SORT_MIN_COMMAND_COUNT || scratch.size() < count) {
+        std::sort(commands.begin(), commands.end());
+        return;
+    }
+
+    // We sort a compact array of (key, index) instead of moving the Commands around, both
+    // ping-pong buffers fit in the scratch space.
+    SortingKey* UTILS_RESTRICT src = reinterpret_cast<SortingKey*>(scratch.data());
+    SortingKey* UTILS_RESTRICT dst = src + count;
+    Command* const UTILS_RESTRICT cmds = commands.data();
+
+    const uint32_t jobCount = uint32_t(std::min(RADIX_SORT_MAX_JOB_COUNT,
+            (count + RADIX_SORT_MIN_JOB_COMMAND_COUNT - 1) / RADIX_SORT_MIN_JOB_COMMAND_COUNT));
+    const uint32_t jobSize = (count + jobCount - 1) / jobCount;
+
+    struct alignas(CACHELINE_SIZE) JobState {
+        uint32_t histogram[RADIX_SORT_DIGIT_COUNT];
+        CommandKey keysOr;
+        CommandKey keysAnd;
+    };
+    JobState states[RADIX_SORT_MAX_JOB_COUNT];
+
+    auto forEachJob = [&js, jobCount](auto const& work) {
+        auto parent = js.createJob();
+        for (uint32_t j = 0; j < jobCount; j++) {
+            js.run(jobs::createJob(js, parent, std::cref(work), j));
+        }
+        js.runAndWait(parent);
+    };
+
+    // initialize the keys, and find which bits are actually used
+    auto init = [&states, cmds, src, count, jobSize](uint32_t j) {
+        CommandKey keysOr = 0;
+        CommandKey keysAnd = CommandKey(-1);
+        for (uint32_t i = j * jobSize, e = std::min(count, i + jobSize); i < e; i++) {
+            const CommandKey key = cmds[i].key;
+            src[i] = { key, i };
+            keysOr |= key;
+            keysAnd &= key;
+        }
+        states[j].keysOr = keysOr;
+        states[j].keysAnd = keysAnd;
+    };
+    forEachJob(init);
+
+    CommandKey keysOr = 0;
+    CommandKey keysAnd = CommandKey(-1);
+    for (uint32_t j = 0; j < jobCount; j++) {
+        keysOr |= states[j].keysOr;
+        keysAnd &= states[j].keysAnd;
+    }
+    // digits that are the same for all keys don't need to be sorted, this typically skips
+    // about half of them.
+    const CommandKey varyingBits = keysOr ^ keysAnd;
+
+    for (size_t shift = 0; shift < sizeof(CommandKey) * 8; shift += RADIX_SORT_DIGIT_BITS) {
+        if (!((varyingBits >> shift) & (RADIX_SORT_DIGIT_COUNT - 1))) {
+            continue;
+        }
+
+        auto histogram = [&states, src, count, jobSize, shift](uint32_t j) {
+            uint32_t* const UTILS_RESTRICT h = states[j].histogram;
+            std::fill_n(h, RADIX_SORT_DIGIT_COUNT, 0);
+            for (uint32_t i = j * jobSize, e = std::min(count, i + jobSize); i < e; i++) {
+                h[(src[i].key >> shift) & (RADIX_SORT_DIGIT_COUNT - 1)]++;
+            }
+        };
+        forEachJob(histogram);
+
+        // turn the histograms into offsets: each job scatters its digits after the same digits
+        // of the previous jobs, which keeps the sort stable.
+        uint32_t offset = 0;
+        for (size_t d = 0; d < RADIX_SORT_DIGIT_COUNT; d++) {
+            for (uint32_t j = 0; j < jobCount; j++) {
+                const uint32_t c = states[j].histogram[d];
+                states[j].histogram[d] = offset;
+                offset += c;
+            }
+        }
+
+        auto scatter = [&states, src, dst, count, jobSize, shift](uint32_t j) {
+            uint32_t* const UTILS_RESTRICT offsets = states[j].histogram;
+            for (uint32_t i = j * jobSize, e = std::min(count, i + jobSize); i < e; i++) {
+                dst[offsets[(src[i].key >> shift) & (RADIX_SORT_DIGIT_COUNT - 1)]++] = src[i];
+            }
+        };
+        forEachJob(scatter);
+
+        std::swap(src, dst);
+    }
+
+    // finally, move the commands in place following the cycles of the permutation
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t j = src[i].index;
+        if (j == i) {
+            continue;
+        }
+        const Command temp = cmds[i];
+        uint32_t k = i;
+        while (j != i) {
+            cmds[k] = cmds[j];
+            src[k].index = k; // mark as done
+            k = j;
+            j = src[k].index;
+        }
+        cmds[k] = temp;
+        src[k].index = k;
+    }
+}
+
+UTILS_ALWAYS_INLINE // this function exists only to make the code more readable. we want it inlined.
+inline              // and we don't need it in the compilation unit
+void RenderPass::recordCommandRange(
+        FEngine::DriverApi& UTILS_RESTRICT driver,  // using restrict here is very important
+        Handle<HwUniformBuffer> uboHandle,
+        Command const* first, Command const* last) noexcept {
+    Driver::PipelineState pipeline;
+    FMaterialInstance const* UTILS_RESTRICT mi = nullptr;
+    FMaterial const* UTILS_RESTRICT ma = nullptr;
+    for (Command const* UTILS_RESTRICT c = first; c != last; ++c) {
+        /*
+         * Be careful when changing code below, this is the hot inner-loop
+         */
+
+        // per-renderable uniform
+        const PrimitiveInfo info = c->primitive;
+        pipeline.rasterState = info.rasterState;
+        if (UTILS_UNLIKELY(mi != info.mi)) {
+            // this is always taken the first time
+            mi = info.mi;
+            pipeline.polygonOffset = mi->getPolygonOffset();
+            ma = mi->getMaterial();
+            mi->use(driver);
+        }
+
+        pipeline.program = ma->getProgram(info.materialVariant.key);
+        size_t offset = info.index * sizeof(PerRenderableUib);
+        if (info.perRenderableBones) {
+            driver.bindUniformBuffer(BindingPoints::PER_RENDERABLE_BONES, info.perRenderableBones);
+        }
+        if (UTILS_UNLIKELY(info.perRenderableInstances)) {
+            using Instances = FRenderableManager::Instances;
+            driver.bindUniformBufferRange(BindingPoints::PER_RENDERABLE_INSTANCES,
+                    info.perRenderableInstances,
+                    info.instanceBatch * Instances::BATCH_SIZE, Instances::BATCH_SIZE);
+        }
+        driver.bindUniformBufferRange(BindingPoints::PER_RENDERABLE, uboHandle, offset, sizeof(PerRenderableUib));
+        driver.draw(pipeline, info.primitiveHandle, info.instanceCount);
+    }
+}
+
+// commands are sorted, so the first SENTINEL command marks the end of the list
+static inline RenderPass::Command const* findSentinel(
+        Slice<RenderPass::Command> const& commands) noexcept {
+    return std::partition_point(commands.cbegin(), commands.cend(),
+            [](RenderPass::Command const& c) {
+        return c.key != uint64_t(RenderPass::Pass::SENTINEL);
+    });
+}
+
 UTILS_NOINLINE // no need to be inlined
 void RenderPass::recordDriverCommands(
-        FEngine::DriverApi& UTILS_RESTRICT driver,  // using restrict here is very important
+        FEngine::DriverApi& UTILS_RESTRICT driver,
         FScene& UTILS_RESTRICT scene,
         Slice<Command> const& commands) noexcept {
     SYSTRACE_CALL();
 
-    if (!commands.empty()) {
-        Driver::PipelineState pipeline;
-        Handle<HwUniformBuffer> uboHandle = scene.getRenderableUBO();
-        FMaterialInstance const* UTILS_RESTRICT mi = nullptr;
-        FMaterial const* UTILS_RESTRICT ma = nullptr;
-        Command const* UTILS_RESTRICT c;
-        for (c = commands.cbegin(); c->key != -1LLU; ++c) {
-            /*
-             * Be careful when changing code below, this is the hot inner-loop
-             */
+    Command const* const last = findSentinel(commands);
+    recordCommandRange(driver, scene.getRenderableUBO(), commands.cbegin(), last);
 
-            // per-renderable uniform
-            const PrimitiveInfo info = c->primitive;
-            pipeline.rasterState = info.rasterState;
-            if (UTILS_UNLIKELY(mi != info.mi)) {
-                // this is always taken the first time
-                mi = info.mi;
-                pipeline.polygonOffset = mi->getPolygonOffset();
-                ma = mi->getMaterial();
-                mi->use(driver);
-            }
+    SYSTRACE_VALUE32("commandCount", last - commands.cbegin());
+}
+
+UTILS_NOINLINE // no need to be inlined
+void RenderPass::recordDriverCommands(JobSystem& js,
+        FEngine::DriverApi& UTILS_RESTRICT driver,
+        FScene& UTILS_RESTRICT scene,
+        Slice<Command> const& commands) noexcept {
+    SYSTRACE_CALL();
+
+    Command const* const first = commands.cbegin();
+    Command const* const last = findSentinel(commands);
+    const size_t count = size_t(last - first);
+    const size_t chunkCount = (count + RECORD_COMMANDS_CHUNK_SIZE - 1) / RECORD_COMMANDS_CHUNK_SIZE;
+    Handle<HwUniformBuffer> uboHandle = scene.getRenderableUBO();
+
+    SYSTRACE_VALUE32("commandCount", count);
+
+    if (chunkCount < 2) {
+        recordCommandRange(driver, uboHandle, first, last);
+        return;
+    }
 
-            pipeline.program = ma->getProgram(info.materialVariant.key);
-            size_t offset = info.index * sizeof(PerRenderableUib);
-            if (info.perRenderableBones) {
-                driver.bindUniformBuffer(BindingPoints::PER_RENDERABLE_BONES, info.perRenderableBones);
+    // upper bound of what recordCommandRange() records per command, a material change
+    // records at most what FMaterialInstance::use() does.
+    constexpr size_t DRAW_SIZE =
+            CommandBase::align(sizeof(COMMAND_TYPE(bindUniformBufferRange))) +
+            CommandBase::align(sizeof(COMMAND_TYPE(draw)));
+    constexpr size_t BONES_SIZE =
+            CommandBase::align(sizeof(COMMAND_TYPE(bindUniformBuffer)));
+    constexpr size_t INSTANCES_SIZE =
+            CommandBase::align(sizeof(COMMAND_TYPE(bindUniformBufferRange)));
+    constexpr size_t MATERIAL_SIZE =
+            CommandBase::align(sizeof(COMMAND_TYPE(bindUniformBuffer))) +
+            CommandBase::align(sizeof(COMMAND_TYPE(bindSamplers))) +
+            CommandBase::align(sizeof(COMMAND_TYPE(setViewportScissor)));
+    // each chunk ends with a NoopCommand that skips its unused space
+    constexpr size_t END_SIZE = CommandBase::align(sizeof(NoopCommand));
+
+    // Compute the space needed by each chunk, so it can be reserved in the command stream
+    // before recording starts. This is also where we make sure all the programs we need exist,
+    // because creating them is not thread-safe.
+    std::vector<size_t> offsets(chunkCount + 1);
+    size_t size = 0;
+    for (size_t i = 0; i < chunkCount; i++) {
+        offsets[i] = size;
+        FMaterialInstance const* mi = nullptr;
+        Command const* const begin = first + i * RECORD_COMMANDS_CHUNK_SIZE;
+        Command const* const end = std::min(last, begin + RECORD_COMMANDS_CHUNK_SIZE);
+        for (Command const* c = begin; c != end; ++c) {
+            const PrimitiveInfo& info = c->primitive;
+            if (mi != info.mi) {
+                mi = info.mi;
+                size += MATERIAL_SIZE;
             }
-            driver.bindUniformBufferRange(BindingPoints::PER_RENDERABLE, uboHandle, offset, sizeof(PerRenderableUib));
-            driver.draw(pipeline, info.primitiveHandle);
+            mi->getMaterial()->getProgram(info.materialVariant.key);
+            size += DRAW_SIZE;
+            size += info.perRenderableBones ? BONES_SIZE : 0;
+            size += info.perRenderableInstances ? INSTANCES_SIZE : 0;
         }
+        size += END_SIZE;
+    }
+    offsets[chunkCount] = size;
+
+    char* const base = static_cast<char*>(driver.reserve(size));
+
+    auto work = [&driver, uboHandle, first, last, base, offsets = offsets.data()](size_t i) {
+        char* const end = base + offsets[i + 1];
+        CircularBuffer buffer(base + offsets[i], end - (base + offsets[i]));
+        FEngine::DriverApi stream(driver, buffer);
+        Command const* const begin = first + i * RECORD_COMMANDS_CHUNK_SIZE;
+        recordCommandRange(stream, uboHandle,
+                begin, std::min(last, begin + RECORD_COMMANDS_CHUNK_SIZE));
+        assert((char*)buffer.getHead() + END_SIZE <= end);
+        new(buffer.allocate(END_SIZE)) NoopCommand(end);
+    };
 
-        SYSTRACE_VALUE32("commandCount", c - commands.cbegin());
+    auto parent = js.createJob();
+    for (size_t i = 0; i < chunkCount; i++) {
+        js.run(jobs::createJob(js, parent, std::cref(work), i));
     }
+    js.runAndWait(parent);
 }
 
 /* static */
@@ -206,6 +433,7 @@ void RenderPass::setupColorCommand(Command& cmdDraw, bool hasDepthPass,
 UTILS_NOINLINE
 void RenderPass::generateCommands(uint32_t commandTypeFlags, Command* const commands,
         FScene::RenderableSoa const& soa, utils::Range<uint32_t> range, RenderFlags renderFlags,
+        Culler::result_type visibilityMask,
         filament::math::float3 cameraPosition, filament::math::float3 cameraForward) noexcept {
 
     // generateCommands() writes both the draw and depth commands simultaneously such that
@@ -241,15 +469,15 @@ void RenderPass::generateCommands(uint32_t commandTypeFlags, Command* const comm
         default: // squash IDE warning -- should never happen.
         case CommandTypeFlags::COLOR:
             generateCommandsImpl<CommandTypeFlags::COLOR>(commandTypeFlags, curr,
-                    soa, range, renderFlags, cameraPosition, cameraForward);
+                    soa, range, renderFlags, visibilityMask, cameraPosition, cameraForward);
             break;
         case CommandTypeFlags::DEPTH_AND_COLOR:
             generateCommandsImpl<CommandTypeFlags::DEPTH_AND_COLOR>(commandTypeFlags, curr,
-                    soa, range, renderFlags, cameraPosition, cameraForward);
+                    soa, range, renderFlags, visibilityMask, cameraPosition, cameraForward);
             break;
         case CommandTypeFlags::SHADOW:
             generateCommandsImpl<CommandTypeFlags::SHADOW>(commandTypeFlags, curr,
-                    soa, range, renderFlags, cameraPosition, cameraForward);
+                    soa, range, renderFlags, visibilityMask, cameraPosition, cameraForward);
             break;
     }
 }
@@ -260,7 +488,7 @@ UTILS_NOINLINE
 void RenderPass::generateCommandsImpl(uint32_t,
         Command* UTILS_RESTRICT curr,
         FScene::RenderableSoa const& UTILS_RESTRICT soa, utils::Range<uint32_t> range,
-        RenderFlags renderFlags,
+        RenderFlags renderFlags, Culler::result_type visibilityMask,
         float3 cameraPosition, float3 cameraForward) noexcept {
 
     // generateCommands() writes both the draw and depth commands simultaneously such that
@@ -276,9 +504,18 @@ void RenderPass::generateCommandsImpl(uint32_t,
     auto const* const UTILS_RESTRICT soaVisibility      = soa.data<FScene::VISIBILITY_STATE>();
     auto const* const UTILS_RESTRICT soaPrimitives      = soa.data<FScene::PRIMITIVES>();
     auto const* const UTILS_RESTRICT soaBonesUbh        = soa.data<FScene::BONES_UBH>();
+    auto const* const UTILS_RESTRICT soaInstances       = soa.data<FScene::INSTANCES>();
+    auto const* const UTILS_RESTRICT soaVisibleMask     = soa.data<FScene::VISIBLE_MASK>();
+
+    // the shadow pass draws the instances visible from the light, the other passes those
+    // visible from the camera
+    using Instances = FRenderableManager::Instances;
+    const Instances::Pass instancesPass = shadowPass ? Instances::SHADOW : Instances::COLOR;
 
     const bool hasShadowing = renderFlags & HAS_SHADOWING;
     const bool inverseFrontFaces = renderFlags & HAS_INVERSE_FRONT_FACES;
+    const bool occludersOnly = renderFlags & HAS_DEPTH_OCCLUDERS_ONLY;
+    constexpr Culler::result_type occluderBit = 1u << FView::VISIBLE_DEPTH_OCCLUDER_BIT;
 
     Variant materialVariant;
     materialVariant.setDirectionalLighting(renderFlags & HAS_DIRECTIONAL_LIGHT);
@@ -342,138 +579,173 @@ void RenderPass::generateCommandsImpl(uint32_t,
         cmdDepth.primitive.perRenderableBones = soaBonesUbh[i];
         cmdDepth.primitive.materialVariant.setSkinning(soaVisibility[i].skinning);
 
+        // instanced renderables issue one draw per batch of visible instances
+        FRenderableManager::VisibleInstances const* const instances = soaInstances[i];
+        const bool instancing = instances != nullptr;
+        const uint32_t firstBatch = instancing ? instances->getFirstBatch(instancesPass) : 0;
+        const uint32_t batchCount = instancing ? instances->getBatchCount(instancesPass) : 1;
+        materialVariant.setInstancing(instancing);
+        cmdDepth.primitive.materialVariant.setInstancing(instancing);
+        cmdColor.primitive.perRenderableInstances = instancing ? instances->handle : Handle<HwUniformBuffer>{};
+        cmdDepth.primitive.perRenderableInstances = cmdColor.primitive.perRenderableInstances;
+
         const bool shadowCaster = soaVisibility[i].castShadows & hasShadowing;
         const bool writeDepthForShadows = shadowPass & shadowCaster;
 
-        const Slice<FRenderPrimitive>& primitives = soaPrimitives[i];
+        // the commands of renderables that don't match the visibility mask are cancelled
+        const bool culled = (soaVisibleMask[i] & visibilityMask) != visibilityMask;
 
-        /*
-         * This is our hot loop. It's written to avoid branches.
-         * When modifying this code, always ensure it stays efficient.
-         */
-        for (auto const& primitive : primitives) {
-            FMaterialInstance const* const mi = primitive.getMaterialInstance();
-            if (colorPass) {
-                cmdColor.primitive.primitiveHandle = primitive.getHwHandle();
-                cmdColor.primitive.materialVariant = materialVariant;
-                RenderPass::setupColorCommand(cmdColor, depthPass, mi);
-                // Inverting front faces applies to all renderables and primitives in the view
-                cmdColor.primitive.rasterState.inverseFrontFaces = inverseFrontFaces;
-
-                const bool blendPass = Pass(cmdColor.key & PASS_MASK) == Pass::BLENDED;
-                if (blendPass) {
-                    // TODO: at least for transparent objects, AABB should be per primitive
-                    // blend pass:
-                    // this will sort back-to-front for blended, and honor explicit ordering
-                    // for a given Z value
-                    cmdColor.key &= ~BLEND_ORDER_MASK;
-                    cmdColor.key &= ~BLEND_DISTANCE_MASK;
-                    cmdColor.key |= makeField(~distanceBits,
-                            BLEND_DISTANCE_MASK, BLEND_DISTANCE_SHIFT);
-                    cmdColor.key |= makeField(primitive.getBlendOrder(),
-                            BLEND_ORDER_MASK, BLEND_ORDER_SHIFT);
-
-                    const TransparencyMode mode = mi->getMaterial()->getTransparencyMode();
-
-                    // handle transparent objects, two techniques:
-                    //
-                    //   - TWO_PASSES_ONE_SIDE: draw the front faces in the depth buffer then
-                    //     front faces with depth test in the color buffer.
-                    //     In this mode we actually do not change the user's culling mode
-                    //
-                    //   - TWO_PASSES_TWO_SIDES: draw back faces first,
-                    //     then front faces, both in the color buffer.
-                    //     In this mode, we override the user's culling mode.
-
-                    // TWO_PASSES_TWO_SIDES: this command will be issued 2nd, draw front faces
-                    cmdColor.primitive.rasterState.culling =
-                            (mode == TransparencyMode::TWO_PASSES_TWO_SIDES) ?
-                            CullingMode::BACK : cmdColor.primitive.rasterState.culling;
-
-                    uint64_t key = cmdColor.key;
-
-                    // draw this command AFTER THE NEXT ONE
-                    key |= makeField(1, BLEND_TWO_PASS_MASK, BLEND_TWO_PASS_SHIFT);
-
-                    // handle the case where this primitive is empty / no-op
-                    key |= select(primitive.getPrimitiveType() == PrimitiveType::NONE);
+        // renderables that are not occluders are left out of the depth pass, so their color
+        // commands must write depth themselves
+        const bool occluder = !occludersOnly || (soaVisibleMask[i] & occluderBit);
+        const bool depthPrepassed = depthPass & occluder;
 
-                    // correct for TransparencyMode::DEFAULT -- i.e. cancel the command
-                    key |= select(mode == TransparencyMode::DEFAULT);
+        const Slice<FRenderPrimitive>& primitives = soaPrimitives[i];
 
-                    *curr = cmdColor;
-                    curr->key = key;
-                    ++curr;
+        for (uint32_t batch = 0; batch < batchCount; batch++) {
+            cmdColor.primitive.instanceBatch = uint16_t(firstBatch + batch);
+            cmdColor.primitive.instanceCount = uint8_t(instancing ?
+                    instances->getBatchInstanceCount(instancesPass, batch) : 1);
+            cmdDepth.primitive.instanceBatch = cmdColor.primitive.instanceBatch;
+            cmdDepth.primitive.instanceCount = cmdColor.primitive.instanceCount;
 
-                    // TWO_PASSES_TWO_SIDES: this command will be issued first, draw back sides (i.e. cull front)
-                    cmdColor.primitive.rasterState.culling =
-                            (mode == TransparencyMode::TWO_PASSES_TWO_SIDES) ?
-                            CullingMode::FRONT : cmdColor.primitive.rasterState.culling;
-
-                    // TWO_PASSES_ONE_SIDE: this command will be issued first, draw (back side) in depth buffer only
-                    cmdColor.primitive.rasterState.depthWrite |=  select(mode == TransparencyMode::TWO_PASSES_ONE_SIDE);
-                    cmdColor.primitive.rasterState.colorWrite &= ~select(mode == TransparencyMode::TWO_PASSES_ONE_SIDE);
-                    cmdColor.primitive.rasterState.depthFunc =
-                            (mode == TransparencyMode::TWO_PASSES_ONE_SIDE) ?
-                            SamplerCompareFunc::LE : cmdColor.primitive.rasterState.depthFunc;
-                } else {
-                    // color pass, opaque objects...
-                    if (!depthPass) {
-                        // ...without depth pre-pass:
-                        // this will bucket objects by Z, front-to-back and then sort by material
-                        // in each buckets. We use the top 10 bits of the distance, which
-                        // bucketizes the depth by its log2 and in 4 linear chunks in each bucket.
-                        cmdColor.key &= ~Z_BUCKET_MASK;
-                        cmdColor.key |= makeField(distanceBits >> 22, Z_BUCKET_MASK,
-                                Z_BUCKET_SHIFT);
+            /*
+             * This is our hot loop. It's written to avoid branches.
+             * When modifying this code, always ensure it stays efficient.
+             */
+            for (auto const& primitive : primitives) {
+                FMaterialInstance const* const mi = primitive.getMaterialInstance();
+                if (colorPass) {
+                    cmdColor.primitive.primitiveHandle = primitive.getHwHandle();
+                    cmdColor.primitive.materialVariant = materialVariant;
+                    RenderPass::setupColorCommand(cmdColor, depthPrepassed, mi);
+                    // Inverting front faces applies to all renderables and primitives in the view
+                    cmdColor.primitive.rasterState.inverseFrontFaces = inverseFrontFaces;
+
+                    const bool blendPass = Pass(cmdColor.key & PASS_MASK) == Pass::BLENDED;
+                    if (blendPass) {
+                        // TODO: at least for transparent objects, AABB should be per primitive
+                        // blend pass:
+                        // this will sort back-to-front for blended, and honor explicit ordering
+                        // for a given Z value
+                        cmdColor.key &= ~BLEND_ORDER_MASK;
+                        cmdColor.key &= ~BLEND_DISTANCE_MASK;
+                        cmdColor.key |= makeField(~distanceBits,
+                                BLEND_DISTANCE_MASK, BLEND_DISTANCE_SHIFT);
+                        cmdColor.key |= makeField(primitive.getBlendOrder(),
+                                BLEND_ORDER_MASK, BLEND_ORDER_SHIFT);
+
+                        const TransparencyMode mode = mi->getMaterial()->getTransparencyMode();
+
+                        // handle transparent objects, two techniques:
+                        //
+                        //   - TWO_PASSES_ONE_SIDE: draw the front faces in the depth buffer then
+                        //     front faces with depth test in the color buffer.
+                        //     In this mode we actually do not change the user's culling mode
+                        //
+                        //   - TWO_PASSES_TWO_SIDES: draw back faces first,
+                        //     then front faces, both in the color buffer.
+                        //     In this mode, we override the user's culling mode.
+
+                        // TWO_PASSES_TWO_SIDES: this command will be issued 2nd, draw front faces
+                        cmdColor.primitive.rasterState.culling =
+                                (mode == TransparencyMode::TWO_PASSES_TWO_SIDES) ?
+                                CullingMode::BACK : cmdColor.primitive.rasterState.culling;
+
+                        uint64_t key = cmdColor.key;
+
+                        // draw this command AFTER THE NEXT ONE
+                        key |= makeField(1, BLEND_TWO_PASS_MASK, BLEND_TWO_PASS_SHIFT);
+
+                        // handle the case where this primitive is empty / no-op
+                        key |= select(primitive.getPrimitiveType() == PrimitiveType::NONE);
+
+                        // correct for TransparencyMode::DEFAULT -- i.e. cancel the command
+                        key |= select(mode == TransparencyMode::DEFAULT);
+                        key |= select(culled);
+
+                        *curr = cmdColor;
+                        curr->key = key;
+                        ++curr;
+
+                        // TWO_PASSES_TWO_SIDES: this command will be issued first, draw back sides (i.e. cull front)
+                        cmdColor.primitive.rasterState.culling =
+                                (mode == TransparencyMode::TWO_PASSES_TWO_SIDES) ?
+                                CullingMode::FRONT : cmdColor.primitive.rasterState.culling;
+
+                        // TWO_PASSES_ONE_SIDE: this command will be issued first, draw (back side) in depth buffer only
+                        cmdColor.primitive.rasterState.depthWrite |=  select(mode == TransparencyMode::TWO_PASSES_ONE_SIDE);
+                        cmdColor.primitive.rasterState.colorWrite &= ~select(mode == TransparencyMode::TWO_PASSES_ONE_SIDE);
+                        cmdColor.primitive.rasterState.depthFunc =
+                                (mode == TransparencyMode::TWO_PASSES_ONE_SIDE) ?
+                                SamplerCompareFunc::LE : cmdColor.primitive.rasterState.depthFunc;
+                    } else {
+                        // color pass, opaque objects...
+                        if (!depthPrepassed) {
+                            // ...without depth pre-pass:
+                            // this will bucket objects by Z, front-to-back and then sort by material
+                            // in each buckets. We use the top 10 bits of the distance, which
+                            // bucketizes the depth by its log2 and in 4 linear chunks in each bucket.
+                            cmdColor.key &= ~Z_BUCKET_MASK;
+                            cmdColor.key |= makeField(distanceBits >> 22, Z_BUCKET_MASK,
+                                    Z_BUCKET_SHIFT);
+                        }
+                        // ...with depth pre-pass, we just sort by materials
+                        curr->key = uint64_t(Pass::SENTINEL);
+                        ++curr;
                     }
-                    // ...with depth pre-pass, we just sort by materials
-                    curr->key = uint64_t(Pass::SENTINEL);
+
+                    *curr = cmdColor;
+                    // handle the case where this primitive is empty / no-op
+                    curr->key |= select(primitive.getPrimitiveType() == PrimitiveType::NONE);
+                    curr->key |= select(culled);
                     ++curr;
                 }
 
-                *curr = cmdColor;
-                // handle the case where this primitive is empty / no-op
-                curr->key |= select(primitive.getPrimitiveType() == PrimitiveType::NONE);
-                ++curr;
-            }
+                if (depthPass) {
+                    Driver::RasterState rs = mi->getMaterial()->getRasterState();
+
+                    // unconditionally write the command
+                    cmdDepth.primitive.primitiveHandle = primitive.getHwHandle();
+                    cmdDepth.primitive.mi = mi;
+                    cmdDepth.primitive.rasterState.culling = rs.culling;
+                    *curr = cmdDepth;
+
+                    // If we are drawing depth+draw we don't want to put commands using
+                    // alpha testing (indicated by the alpha to coverage flag) or blending in the
+                    // depth prepass. What we do want is put those commands in the shadow map
+                    // (when only drawDepth is true).
+                    // Also, depth-write could be disabled by the material,
+                    // in this case undo the command.
+                    bool issueDepth =
+                            (rs.depthWrite & !(colorPass & (rs.alphaToCoverage | rs.hasBlending())))
+                            | writeDepthForShadows;
+                    curr->key |= select(!issueDepth | !occluder | culled);
 
-            if (depthPass) {
-                Driver::RasterState rs = mi->getMaterial()->getRasterState();
-
-                // unconditionally write the command
-                cmdDepth.primitive.primitiveHandle = primitive.getHwHandle();
-                cmdDepth.primitive.mi = mi;
-                cmdDepth.primitive.rasterState.culling = rs.culling;
-                *curr = cmdDepth;
-
-                // If we are drawing depth+draw we don't want to put commands using
-                // alpha testing (indicated by the alpha to coverage flag) or blending in the
-                // depth prepass. What we do want is put those commands in the shadow map
-                // (when only drawDepth is true).
-                // Also, depth-write could be disabled by the material,
-                // in this case undo the command.
-                bool issueDepth =
-                        (rs.depthWrite & !(colorPass & (rs.alphaToCoverage | rs.hasBlending())))
-                        | writeDepthForShadows;
-                curr->key |= select(!issueDepth);
-
-                // handle the case where this primitive is empty / no-op
-                curr->key |= select(primitive.getPrimitiveType() == PrimitiveType::NONE);
-                ++curr;
+                    // handle the case where this primitive is empty / no-op
+                    curr->key |= select(primitive.getPrimitiveType() == PrimitiveType::NONE);
+                    ++curr;
+                }
             }
         }
     }
 }
 
-void RenderPass::updateSummedPrimitiveCounts(
+void RenderPass::updateSummedPrimitiveCounts(uint32_t commandTypeFlags,
         FScene::RenderableSoa& renderableData, Range<uint32_t> vr) noexcept {
+    using Instances = FRenderableManager::Instances;
     auto const* const UTILS_RESTRICT primitives = renderableData.data<FScene::PRIMITIVES>();
+    auto const* const UTILS_RESTRICT instances = renderableData.data<FScene::INSTANCES>();
     uint32_t* const UTILS_RESTRICT summedPrimitiveCount = renderableData.data<FScene::SUMMED_PRIMITIVE_COUNT>();
+    const Instances::Pass pass = (commandTypeFlags & CommandTypeFlags::SHADOW) ?
+            Instances::SHADOW : Instances::COLOR;
     uint32_t count = 0;
     for (uint32_t i : vr) {
         summedPrimitiveCount[i] = count;
-        count += primitives[i].size();
+        // instanced renderables draw each primitive once per batch of visible instances
+        const uint32_t batchCount = UTILS_UNLIKELY(instances[i]) ?
+                instances[i]->getBatchCount(pass) : 1;
+        count += primitives[i].size() * batchCount;
     }
     // we're guaranteed to have enough space at the end of vr
     summedPrimitiveCount[vr.last] = count;
@@ -555,7 +827,7 @@ void FRenderer::ColorPass::renderColorPass(FEngine& engine,
     auto vr = view.getVisibleRenderables();
 
     // populate the RenderPrimitive array with the proper LOD
-    view.updatePrimitivesLod(engine, cameraInfo, soa, vr);
+    view.updatePrimitivesLod(engine, cameraInfo, soa, vr, false);
 
     DriverApi& driver = engine.getDriverApi();
     view.prepareCamera(cameraInfo, scaledViewport);
@@ -583,6 +855,11 @@ void FRenderer::ColorPass::renderColorPass(FEngine& engine,
         case View::DepthPrepass::ENABLED:
             commandType = DEPTH_AND_COLOR;
             break;
+        case View::DepthPrepass::ADAPTIVE:
+            commandType = view.updateDepthPrepass(cameraInfo, soa, vr, scaledViewport) ?
+                    DEPTH_AND_COLOR : COLOR;
+            flags |= RenderPass::HAS_DEPTH_OCCLUDERS_ONLY;
+            break;
     }
 
     ColorPass colorPass("ColorPass", js, sync, view, rth);
@@ -595,13 +872,13 @@ void FRenderer::ColorPass::renderColorPass(FEngine& engine,
 // ------------------------------------------------------------------------------------------------
 
 FRenderer::ShadowPass::ShadowPass(const char* name,
-        ShadowMap const& shadowMap) noexcept
-        : RenderPass(name), shadowMap(shadowMap) {
+        ShadowMap const& shadowMap, size_t cascade, bool clear) noexcept
+        : RenderPass(name), shadowMap(shadowMap), cascade(cascade), clear(clear) {
 }
 
 void FRenderer::ShadowPass::beginRenderPass(driver::DriverApi& driver,
         filament::Viewport const&, const CameraInfo&) noexcept {
-    shadowMap.beginRenderPass(driver);
+    shadowMap.beginRenderPass(driver, cascade, clear);
 }
 
 void FRenderer::ShadowPass::renderShadowMap(FEngine& engine, JobSystem& js,
@@ -610,24 +887,10 @@ void FRenderer::ShadowPass::renderShadowMap(FEngine& engine, JobSystem& js,
     auto& soa = view.getScene()->getRenderableData();
     auto vr = view.getVisibleShadowCasters();
     ShadowMap const& shadowMap = view.getShadowMap();
-    filament::Viewport const& viewport = shadowMap.getViewport();
-    FCamera const& camera = shadowMap.getCamera();
-
-    CameraInfo cameraInfo = {
-            .projection         = mat4f{ camera.getProjectionMatrix() },
-            .cullingProjection  = mat4f{ camera.getCullingProjectionMatrix() },
-            .model              = camera.getModelMatrix(),
-            .view               = camera.getViewMatrix(),
-            .zn                 = camera.getNear(),
-            .zf                 = camera.getCullingFar(),
-    };
-
-    // populate the RenderPrimitive array with the proper LOD
-    view.updatePrimitivesLod(engine, cameraInfo, soa, vr);
 
-    driver::DriverApi& driver = engine.getDriverApi();
-    view.prepareCamera(cameraInfo, viewport);
-    view.commitUniforms(driver);
+    // populate the RenderPrimitive array with the proper LOD, the level is chosen from the
+    // size of the renderables in the view, not in the shadow map.
+    view.updatePrimitivesLod(engine, view.getCameraInfo(), soa, vr, true);
 
     RenderPass::RenderFlags flags = 0;
     if (view.hasShadowing())               flags |= RenderPass::HAS_SHADOWING;
@@ -635,10 +898,44 @@ void FRenderer::ShadowPass::renderShadowMap(FEngine& engine, JobSystem& js,
     if (view.hasDynamicLighting())         flags |= RenderPass::HAS_DYNAMIC_LIGHTING;
     if (view.isFrontFaceWindingInverted()) flags |= RenderPass::HAS_INVERSE_FRONT_FACES;
 
-    ShadowPass shadowPass("ShadowPass", shadowMap);
+    driver::DriverApi& driver = engine.getDriverApi();
     driver.pushGroupMarker("Shadow map Pass");
-    shadowPass.render(engine, js, *view.getScene(), vr,
-            CommandTypeFlags::SHADOW, flags, cameraInfo, viewport, commands);
+
+    // each cascade is rendered in its own viewport of the shadow map, with only its own casters.
+    // The first one rendered clears the whole shadow map.
+    bool clear = true;
+    for (size_t cascade = 0; cascade < shadowMap.getCascadeCount(); cascade++) {
+        if (!shadowMap.hasVisibleShadows(cascade)) {
+            continue;
+        }
+
+        filament::Viewport const& viewport = shadowMap.getViewport(cascade);
+        FCamera const& camera = shadowMap.getCamera(cascade);
+
+        CameraInfo cameraInfo = {
+                .projection         = mat4f{ camera.getProjectionMatrix() },
+                .cullingProjection  = mat4f{ camera.getCullingProjectionMatrix() },
+                .model              = camera.getModelMatrix(),
+                .view               = camera.getViewMatrix(),
+                .zn                 = camera.getNear(),
+                .zf                 = camera.getCullingFar(),
+        };
+
+        view.prepareCamera(cameraInfo, viewport);
+        view.commitUniforms(driver);
+
+        if (!clear) {
+            // the commands of the previous cascade have been executed
+            commands.clear();
+        }
+
+        ShadowPass shadowPass("ShadowPass", shadowMap, cascade, clear);
+        shadowPass.render(engine, js, *view.getScene(), vr,
+                CommandTypeFlags::SHADOW, flags, cameraInfo, viewport, commands,
+                Culler::result_type(1u << (FView::VISIBLE_SHADOW_CASCADE_BIT + cascade)));
+        clear = false;
+    }
+
     driver.popGroupMarker();
 }
 
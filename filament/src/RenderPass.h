@@ -30,6 +30,8 @@
 #include <utils/compiler.h>
 #include <utils/Slice.h>
 
+#include <limits>
+
 namespace utils {
 class JobSystem;
 }
@@ -172,19 +174,25 @@ public:
         return boolish ? -1llu : 0llu;
     }
 
-    struct PrimitiveInfo { // 24 bytes
+    struct PrimitiveInfo { // 32 bytes
         FMaterialInstance const* mi = nullptr;              // 8 bytes (4)
         Handle<HwRenderPrimitive> primitiveHandle;          // 4 bytes
         Handle<HwUniformBuffer> perRenderableBones;         // 4 bytes
+        Handle<HwUniformBuffer> perRenderableInstances;     // 4 bytes
         Driver::RasterState rasterState;                    // 4 bytes
         uint16_t index = 0;                                 // 2 bytes
+        uint16_t instanceBatch = 0;                         // 2 bytes
         Variant materialVariant;                            // 1 byte
-        uint8_t reserved = { };                             // 1 byte
+        uint8_t instanceCount = 1;                          // 1 byte
+        uint8_t reserved[2] = { };                          // 2 bytes
     };
 
-    struct alignas(8) Command {     // 32 bytes
+    static_assert(CONFIG_MAX_INSTANCES <= std::numeric_limits<uint8_t>::max(),
+            "PrimitiveInfo::instanceCount can't hold CONFIG_MAX_INSTANCES");
+
+    struct alignas(8) Command {     // 40 bytes
         CommandKey key = 0;         //  8 bytes
-        PrimitiveInfo primitive;    // 24 bytes
+        PrimitiveInfo primitive;    // 32 bytes
         bool operator < (Command const& rhs) const noexcept { return key < rhs.key; }
         // placement new declared as "throw" to avoid the compiler's null-check
         inline void* operator new (std::size_t size, void* ptr) {
@@ -201,18 +209,39 @@ public:
     static constexpr RenderFlags HAS_DIRECTIONAL_LIGHT   = 0x02;
     static constexpr RenderFlags HAS_DYNAMIC_LIGHTING    = 0x04;
     static constexpr RenderFlags HAS_INVERSE_FRONT_FACES = 0x08;
+    // only the renderables flagged by FView::updateDepthPrepass() are drawn in the depth pass
+    static constexpr RenderFlags HAS_DEPTH_OCCLUDERS_ONLY = 0x10;
 
     explicit RenderPass(const char* name) noexcept : mName(name) { }
 
     virtual ~RenderPass() noexcept;
 
-    // appends rendering commands for the given view
+    // Sorts commands by their key. Large command lists are sorted with a parallel LSD radix
+    // sort, which uses 'scratch' as temporary storage (it must be at least as large as
+    // 'commands'); otherwise this falls back to std::sort.
+    static void sortCommands(utils::JobSystem& js,
+            utils::Slice<Command> commands, utils::Slice<Command> scratch) noexcept;
+
+    // Records the driver commands for a sorted list of commands terminated by a SENTINEL
+    // command, on the calling thread.
+    static void recordDriverCommands(FEngine::DriverApi& driver, FScene& scene,
+            utils::Slice<Command> const& commands) noexcept;
+
+    // Same as above, but large lists are split in chunks recorded concurrently, each into its
+    // own range of the command stream reserved beforehand, so the commands end-up in order.
+    static void recordDriverCommands(utils::JobSystem& js,
+            FEngine::DriverApi& driver, FScene& scene,
+            utils::Slice<Command> const& commands) noexcept;
+
+    // appends rendering commands for the given view, if visibilityMask is not zero only the
+    // renderables with all these bits set in FScene::VISIBLE_MASK are drawn.
     void render(
             FEngine& engine, utils::JobSystem& js,
             FScene& scene, utils::Range<uint32_t> visibleRenderables,
             uint32_t commandTypeFlags, RenderFlags renderFlags,
             const CameraInfo& camera, Viewport const& viewport,
-            utils::GrowingSlice<Command>& commands) noexcept;
+            utils::GrowingSlice<Command>& commands,
+            Culler::result_type visibilityMask = 0) noexcept;
 
 private:
     // Called just before rendering, make sure all needed asynchronous tasks are finished.
@@ -228,8 +257,7 @@ private:
 private:
     friend class FRenderer;
 
-    // on 64-bits systems, we process batches of 4 (64 bytes) cache-lines, or 8 (32 bytes) commands
-    // on 32-bits systems, we process batches of 8 (32 bytes) cache-lines, or 8 (32 bytes) commands
+    // we process batches of 10 (64 bytes) cache-lines, or 16 (40 bytes) commands
     static constexpr size_t JOBS_PARALLEL_FOR_COMMANDS_COUNT = 16;
     static constexpr size_t JOBS_PARALLEL_FOR_COMMANDS_SIZE  =
             sizeof(Command) * JOBS_PARALLEL_FOR_COMMANDS_COUNT;
@@ -237,22 +265,43 @@ private:
     static_assert(JOBS_PARALLEL_FOR_COMMANDS_SIZE % utils::CACHELINE_SIZE == 0,
             "Size of Commands jobs must be multiple of a cache-line size");
 
+    // below this count, std::sort is faster than the radix sort
+    static constexpr size_t RADIX_SORT_MIN_COMMAND_COUNT = 2048;
+    // the radix sort splits the work in at most this many jobs, of at least this many commands
+    static constexpr size_t RADIX_SORT_MAX_JOB_COUNT = 16;
+    static constexpr size_t RADIX_SORT_MIN_JOB_COMMAND_COUNT = 1024;
+    // we sort 8 bits at a time
+    static constexpr size_t RADIX_SORT_DIGIT_BITS = 8;
+    static constexpr size_t RADIX_SORT_DIGIT_COUNT = 1u << RADIX_SORT_DIGIT_BITS;
+
+    // number of commands recorded by each job, below two chunks commands are recorded serially
+    static constexpr size_t RECORD_COMMANDS_CHUNK_SIZE = 1024;
+
+    // what the radix sort actually sorts, two of these must fit in a Command
+    struct SortingKey {
+        CommandKey key;
+        uint32_t index;
+    };
+    static_assert(sizeof(SortingKey) * 2 <= sizeof(Command),
+            "SortingKey must be at most half the size of a Command");
+
     static inline void generateCommands(uint32_t commandTypeFlags, Command* commands,
             FScene::RenderableSoa const& soa, utils::Range<uint32_t> range, RenderFlags renderFlags,
+            Culler::result_type visibilityMask,
             filament::math::float3 cameraPosition, filament::math::float3 cameraForward) noexcept;
 
     template<uint32_t commandTypeFlags>
     static inline void generateCommandsImpl(uint32_t, Command* commands, FScene::RenderableSoa const& soa,
-            utils::Range<uint32_t> range, RenderFlags renderFlags, filament::math::float3 cameraPosition,
-            filament::math::float3 cameraForward) noexcept;
+            utils::Range<uint32_t> range, RenderFlags renderFlags, Culler::result_type visibilityMask,
+            filament::math::float3 cameraPosition, filament::math::float3 cameraForward) noexcept;
 
     static void setupColorCommand(Command& cmdDraw, bool hasDepthPass,
             FMaterialInstance const* mi) noexcept;
 
-    static void recordDriverCommands(FEngine::DriverApi& driver, FScene& scene,
-            utils::Slice<Command> const& commands) noexcept;
+    static inline void recordCommandRange(FEngine::DriverApi& driver,
+            Handle<HwUniformBuffer> uboHandle, Command const* first, Command const* last) noexcept;
 
-    static void updateSummedPrimitiveCounts(
+    static void updateSummedPrimitiveCounts(uint32_t commandTypeFlags,
             FScene::RenderableSoa& renderableData, utils::Range<uint32_t> vr) noexcept;
 
     const char* const mName;
@@ -157,7 +157,6 @@ void FRenderer::renderJob(ArenaScope& arena, FView& view) {
     JobSystem& js = engine.getJobSystem();
     FEngine::DriverApi& driver = engine.getDriverApi();
     PostProcessManager& ppm = engine.getPostProcessManager();
-    RenderTargetPool& rtp = engine.getRenderTargetPool();
 
     // DEBUG: driver commands must all happen from the same thread. Enforce that on debug builds.
     engine.getDriverApi().debugThreading();
@@ -194,15 +193,43 @@ void FRenderer::renderJob(ArenaScope& arena, FView& view) {
     GrowingSlice<Command> commands(
             arena.allocate<Command>(commandsCount, CACHELINE_SIZE), commandsCount);
 
+    /*
+     * Frame graph
+     */
+
+    FrameGraph fg(engine.getFrameGraphTexturePool());
+
+    // FIXME: viewRenderTarget doesn't have a depth-buffer, so when skipping post-process, don't rely on it
+    const Handle<HwRenderTarget> viewRenderTarget = getRenderTarget();
+    FrameGraphResource output = fg.importResource("viewRenderTarget", { .viewport = vp },
+            viewRenderTarget, vp.width, vp.height,
+            view.getDiscardedTargetBuffers(), TargetBufferFlags::DEPTH_AND_STENCIL);
+
+    // passes are executed synchronously by fg.execute() below, these outlive them
+    FView* const pView = &view;
+    GrowingSlice<Command>* const pCommands = &commands;
+
     /*
      * Shadow pass
      */
 
     if (view.hasShadowing()) {
-        ShadowPass::renderShadowMap(engine, js, view, commands);
-        recordHighWatermark(commands); // for debugging
-        // reset the command buffer
-        commands.clear();
+        struct ShadowPassData {
+        };
+        fg.addPass<ShadowPassData>("Shadow Pass",
+                [&](FrameGraph::Builder& builder, ShadowPassData& data) {
+                    // the shadow map is owned by the view and sampled through the view's
+                    // sampler buffer, i.e. outside of the frame graph.
+                    builder.sideEffect();
+                },
+                [=](FrameGraphPassResources const& resources,
+                        ShadowPassData const& data, DriverApi& driver) {
+                    FEngine& engine = getEngine();
+                    ShadowPass::renderShadowMap(engine, engine.getJobSystem(), *pView, *pCommands);
+                    recordHighWatermark(*pCommands); // for debugging
+                    // reset the command buffer
+                    pCommands->clear();
+                });
     }
 
     /*
@@ -212,103 +239,91 @@ void FRenderer::renderJob(ArenaScope& arena, FView& view) {
     const uint8_t useMSAA = view.getSampleCount();
     const TextureFormat hdrFormat = getHdrFormat(view);
     const TextureFormat ldrFormat = getLdrFormat();
-    RenderTargetPool::Target const* colorTarget = nullptr;
 
     if (UTILS_LIKELY(hasPostProcess)) {
-        // allocate the target we need for rendering the scene
-        colorTarget = rtp.get(TargetBufferFlags::COLOR_AND_DEPTH,
-                svp.width, svp.height, useMSAA, hdrFormat);
+        // the intermediate color buffer only covers the scaled viewport
         svp.left = svp.bottom = 0;
     }
 
-    // FIXME: viewRenderTarget doesn't have a depth-buffer, so when skipping post-process, don't rely on it
-    const Handle<HwRenderTarget> viewRenderTarget = getRenderTarget();
-    ColorPass::renderColorPass(engine, js, jobFroxelize,
-            colorTarget ? colorTarget->target : viewRenderTarget, view, svp, commands);
+    struct ColorPassData {
+        FrameGraphResource color;
+        FrameGraphResource depth;
+    };
+    auto& colorPass = fg.addPass<ColorPassData>("Color Pass",
+            [&](FrameGraph::Builder& builder, ColorPassData& data) {
+                if (UTILS_LIKELY(hasPostProcess)) {
+                    // allocate the buffers we need for rendering the scene
+                    data.color = builder.createTexture("Color Buffer", {
+                            .width = svp.width, .height = svp.height,
+                            .samples = useMSAA, .format = hdrFormat });
+                    data.depth = builder.createTexture("Depth Buffer", {
+                            .width = svp.width, .height = svp.height,
+                            .samples = useMSAA, .format = TextureFormat::DEPTH24 });
+                    FrameGraphRenderTarget::Descriptor desc{
+                            .attachments.color = data.color,
+                            .attachments.depth = data.depth,
+                            .viewport = svp,
+                            .samples = useMSAA
+                    };
+                    auto rt = builder.useRenderTarget("Color Pass Target", desc);
+                    data.color = rt.textures[0];
+                    data.depth = rt.textures[1];
+                } else {
+                    data.color = builder.useRenderTarget(output).textures[0];
+                }
+            },
+            [=](FrameGraphPassResources const& resources,
+                    ColorPassData const& data, DriverApi& driver) {
+                FEngine& engine = getEngine();
+                auto const& target = resources.getRenderTarget(data.color);
+                ColorPass::renderColorPass(engine, engine.getJobSystem(), jobFroxelize,
+                        target.target, *pView, svp, *pCommands);
+            });
 
     /*
      * Post Processing...
      */
 
-
-#define USE_FRAME_GRAPH false
-
+    FrameGraphResource input = colorPass.getData().color;
     if (UTILS_LIKELY(hasPostProcess)) {
-        driver.pushGroupMarker("Post Processing");
-
-        assert(colorTarget);
-
-        if (USE_FRAME_GRAPH) {
-            FrameGraph fg;
-
-            const bool translucent = mSwapChain->isTransparent();
-
-            FrameGraphResource::Descriptor colorDesc{
-                    .width = colorTarget->w,
-                    .height= colorTarget->h,
-                    .format= colorTarget->format,
-            };
-            FrameGraphResource input = fg.importResource("colorTarget",
-                    colorDesc, colorTarget->texture);
-
-            FrameGraphResource output = fg.importResource("viewRenderTarget", { .viewport = vp },
-                    viewRenderTarget, vp.width, vp.height);
-
-            if (useMSAA > 1) {
-                input = ppm.msaa(fg, input, hdrFormat);
-            }
-            input = ppm.toneMapping(fg, input, ldrFormat, translucent);
-            if (useFXAA) {
-                input = ppm.fxaa(fg, input, ldrFormat, translucent);
-            }
-            if (scaled) {
-                input = ppm.dynamicScaling(fg, input, ldrFormat, vp);
-            }
-
-            fg.moveResource(output, input);
-            fg.present(output);
-
-            fg.compile();
-            //fg.export_graphviz(slog.d);
-            fg.execute(driver);
-
-            rtp.put(colorTarget);
-
-        } else {
-
-            ppm.start();
-
-            if (useMSAA > 1) {
-                // Note: MSAA, when used is applied before tone-mapping (which is not ideal)
-                // (tone mapping currently only works without multi-sampling)
-                // this blit does a MSAA resolve
-                ppm.blit(hdrFormat);
-            }
-
-            const bool translucent = mSwapChain->isTransparent();
-            Handle<HwProgram> toneMappingProgram = engine.getPostProcessProgram(
-                    translucent ? PostProcessStage::TONE_MAPPING_TRANSLUCENT
-                                : PostProcessStage::TONE_MAPPING_OPAQUE);
-            ppm.pass(useFXAA ? TextureFormat::RGBA8 : ldrFormat, toneMappingProgram);
-
-            if (useFXAA) {
-                Handle<HwProgram> antiAliasingProgram = engine.getPostProcessProgram(
-                        translucent ? PostProcessStage::ANTI_ALIASING_TRANSLUCENT
-                                    : PostProcessStage::ANTI_ALIASING_OPAQUE);
-                ppm.pass(ldrFormat, antiAliasingProgram);
-            }
-
-            if (scaled) {
-                // because it's the last command, the TextureFormat is not relevant
-                ppm.blit();
-            }
-            ppm.finish(view.getDiscardedTargetBuffers(), viewRenderTarget, vp, colorTarget, svp);
-
+        // passes execute in the order they're added, so these two bracket the post-processing
+        fg.addPass<std::tuple<>>("Post Processing Begin",
+                [](FrameGraph::Builder& builder, auto&) { builder.sideEffect(); },
+                [](FrameGraphPassResources const&, auto const&, DriverApi& driver) {
+                    driver.pushGroupMarker("Post Processing");
+                });
+
+        const bool translucent = mSwapChain->isTransparent();
+        if (useMSAA > 1) {
+            // Note: MSAA, when used is applied before tone-mapping (which is not ideal)
+            // (tone mapping currently only works without multi-sampling)
+            input = ppm.msaa(fg, input, hdrFormat);
+        }
+        input = ppm.toneMapping(fg, input, ldrFormat, translucent);
+        if (useFXAA) {
+            input = ppm.fxaa(fg, input, ldrFormat, translucent);
         }
+        if (scaled) {
+            input = ppm.dynamicScaling(fg, input, ldrFormat, vp);
+        }
+
+        fg.addPass<std::tuple<>>("Post Processing End",
+                [](FrameGraph::Builder& builder, auto&) { builder.sideEffect(); },
+                [](FrameGraphPassResources const&, auto const&, DriverApi& driver) {
+                    driver.popGroupMarker();
+                });
 
-        driver.popGroupMarker();
+        // the last pass renders directly into the view's render target
+        fg.moveResource(output, input);
+    } else {
+        output = input;
     }
 
+    fg.present(output);
+    fg.compile();
+    //fg.export_graphviz(slog.d);
+    fg.execute(driver);
+
     // for debugging
     recordHighWatermark(commands);
 }
@@ -374,13 +389,23 @@ bool FRenderer::beginFrame(FSwapChain* swapChain) {
         mFrameInfoManager.beginFrame(mFrameId);
     }
 
+    FEngine& engine = getEngine();
+    FrameTimer& timer = engine.getFrameTimer();
+    timer.beginFrame(mFrameTimingOptions.enabled);
+    if (UTILS_UNLIKELY(mFrameTimingOptions.enabled)) {
+        mFrameTimingStart = clock::now();
+        if (mProfiler) {
+            mProfiler->reset();
+            mProfiler->start();
+        }
+    }
+
     { // scope for frame id trace
         char buf[64];
         snprintf(buf, 64, "frame %u", mFrameId);
         SYSTRACE_NAME(buf);
     }
 
-    FEngine& engine = getEngine();
     FEngine::DriverApi& driver = engine.getDriverApi();
 
     // NOTE: this makes synchronous calls to the driver
@@ -393,6 +418,7 @@ bool FRenderer::beginFrame(FSwapChain* swapChain) {
     driver.beginFrame(monotonic_clock_ns, mFrameId);
 
     if (!mFrameSkipper.beginFrame()) {
+        timer.beginFrame(false); // skipped frames are not timed
         mFrameInfoManager.cancelFrame();
         driver.endFrame(mFrameId);
         engine.flush();
@@ -416,10 +442,14 @@ void FRenderer::endFrame() {
 
     FEngine& engine = getEngine();
     FEngine::DriverApi& driver = engine.getDriverApi();
-    RenderTargetPool& rtp = engine.getRenderTargetPool();
 
     FrameInfoManager& frameInfoManager = mFrameInfoManager;
 
+    if (UTILS_UNLIKELY(engine.getFrameTimer().isEnabled())) {
+        // this must happen before FrameInfoManager::endFrame()
+        recordFrameTiming(engine, driver);
+    }
+
     if (UTILS_HAS_THREADING) {
 
         // on debug builds this helps catching cases where we're writing to
@@ -443,8 +473,9 @@ void FRenderer::endFrame() {
 
     auto job = js.runAndRetain(jobs::createJob(js, nullptr, &FEngine::gc, &engine)); // gc all managers
 
-    rtp.gc();           // gc post-processing targets (this can generate driver commands)
+    engine.getFrameGraphTexturePool().gc(driver); // gc framegraph transient textures
     engine.flush();     // flush command stream
+    engine.getCommandBufferQueue().endFrame();
 
     // make sure we're done with the gcs
     js.waitAndRelease(job);
@@ -464,6 +495,44 @@ void FRenderer::endFrame() {
 #endif
 }
 
+void FRenderer::setFrameTimingOptions(FrameTimingOptions const& options) noexcept {
+    mFrameTimingOptions = options;
+    if (options.enabled && options.hardwareCounters) {
+        if (!mProfiler) {
+            mProfiler.reset(new Profiler(Profiler::EV_CPU_CYCLES));
+            if (!mProfiler->isValid()) {
+                // performance counters are not supported or not allowed
+                mProfiler.reset();
+            }
+        }
+    } else {
+        mProfiler.reset();
+    }
+}
+
+void FRenderer::recordFrameTiming(FEngine& engine, DriverApi& driver) noexcept {
+    FrameTiming timing;
+    timing.frameId = mFrameId;
+    timing.frameTime = uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            clock::now() - mFrameTimingStart).count());
+    engine.getFrameTimer().getStages(timing.stages);
+    if (mProfiler) {
+        mProfiler->stop();
+        Profiler::Counters counters = mProfiler->readCounters();
+        timing.cpuCycles = counters.getCpuCycles();
+        timing.instructions = counters.getInstructions();
+    }
+    mFrameInfoManager.addTiming(timing);
+
+    // the driver time is reported once this command and those before it have been executed
+    driver.queueCommand([&engine, frameInfoManager = &mFrameInfoManager, frameId = mFrameId]() {
+        engine.getFrameTimer().endDriverFrame(
+                [](void* user, uint32_t id, uint64_t driverTime) {
+                    static_cast<FrameInfoManager*>(user)->setTimingDriverTime(id, driverTime);
+                }, frameInfoManager, frameId);
+    });
+}
+
 void FRenderer::readPixels(uint32_t xoffset, uint32_t yoffset, uint32_t width, uint32_t height,
         driver::PixelBufferDescriptor&& buffer) {
 
@@ -543,4 +612,16 @@ void Renderer::resetUserTime() {
     upcast(this)->resetUserTime();
 }
 
+void Renderer::setFrameTimingOptions(FrameTimingOptions const& options) noexcept {
+    upcast(this)->setFrameTimingOptions(options);
+}
+
+Renderer::FrameTimingOptions const& Renderer::getFrameTimingOptions() const noexcept {
+    return upcast(this)->getFrameTimingOptions();
+}
+
+size_t Renderer::getFrameTimings(FrameTiming* timings, size_t count) const noexcept {
+    return upcast(this)->getFrameTimings(timings, count);
+}
+
 } // namespace filament
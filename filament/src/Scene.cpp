@@ -22,13 +22,16 @@
 #include <private/filament/UibGenerator.h>
 
 #include "details/Culler.h"
+#include "details/CullingBvh.h"
 #include "details/Engine.h"
 #include "details/IndirectLight.h"
 #include "details/Skybox.h"
 
 #include <utils/compiler.h>
 #include <utils/EntityManager.h>
+#include <utils/JobSystem.h>
 #include <utils/Range.h>
+#include <utils/Systrace.h>
 #include <utils/Zip2Iterator.h>
 
 #include <algorithm>
@@ -50,10 +53,10 @@ FScene::~FScene() noexcept = default;
 
 
 void FScene::prepare(const filament::math::mat4f& worldOriginTransform) {
-    // TODO: can we skip this in most cases? Since we rely on indices staying the same,
-    //       we could only skip, if nothing changed in the RCM.
+    SYSTRACE_CALL();
 
     FEngine& engine = mEngine;
+    JobSystem& js = engine.getJobSystem();
     EntityManager& em = engine.getEntityManager();
     FRenderableManager& rcm = engine.getRenderableManager();
     FTransformManager& tcm = engine.getTransformManager();
@@ -61,6 +64,7 @@ void FScene::prepare(const filament::math::mat4f& worldOriginTransform) {
     // go through the list of entities, and gather the data of those that are renderables
     auto& sceneData = mRenderableData;
     auto& lightData = mLightData;
+    auto& instances = mRenderableInstances;
     auto const& entities = mEntities;
 
 
@@ -78,6 +82,9 @@ void FScene::prepare(const filament::math::mat4f& worldOriginTransform) {
         sceneData.setCapacity(renderableDataCapacity);
     }
 
+    instances.clear();
+    instances.reserve(entities.size());
+
     // The light data list will always contain at least one entry for the
     // dominating directional light, even if there are no entities.
     size_t lightDataCapacity = std::max<size_t>(1, entities.size());
@@ -91,10 +98,21 @@ void FScene::prepare(const filament::math::mat4f& worldOriginTransform) {
     // the first entries are reserved for the directional lights (currently only one)
     lightData.resize(DIRECTIONAL_LIGHTS_COUNT);
 
+    // The world origin is baked into all the cached world transforms and AABBs, if it
+    // changed none of them can be reused.
+    if (UTILS_UNLIKELY(mCachedWorldOrigin != worldOriginTransform)) {
+        mCachedWorldOrigin = worldOriginTransform;
+        mRenderableCache.clear();
+    }
+    // the cache is indexed by the renderable's instance
+    mRenderableCache.resize(rcm.getComponentCount() + 1);
+
 
     // find the max intensity directional light index in our local array
     float maxIntensity = 0;
 
+    // First pass: find the renderables and lights -- this needs lookups in the component
+    // managers and can't easily be parallelized.
     for (Entity e : entities) {
         if (!em.isAlive(e))
             continue;
@@ -106,30 +124,18 @@ void FScene::prepare(const filament::math::mat4f& worldOriginTransform) {
         if (!ri & !li)
             continue;
 
-        // get the world transform
         auto ti = tcm.getInstance(e);
-        const mat4f worldTransform = worldOriginTransform * tcm.getWorldTransform(ti);
 
         // don't even draw this object if it doesn't have a transform (which shouldn't happen
         // because one is always created when creating a Renderable component).
         if (ri && ti) {
-            // compute the world AABB so we can perform culling
-            const Box worldAABB = rigidTransform(rcm.getAABB(ri), worldTransform);
-
-            // we know there is enough space in the array
-            sceneData.push_back_unsafe(
-                    ri,
-                    worldTransform,
-                    rcm.getVisibility(ri),
-                    rcm.getBonesUbh(ri),
-                    worldAABB.center,
-                    0,
-                    rcm.getLayerMask(ri),
-                    worldAABB.halfExtent,
-                    {}, {});
+            instances.push_back({ ri, ti });
         }
 
         if (li) {
+            // get the world transform
+            const mat4f worldTransform = worldOriginTransform * tcm.getWorldTransform(ti);
+
             // find the dominant directional light
             if (UTILS_UNLIKELY(lcm.isDirectionalLight(li))) {
                 // we don't store the directional lights, because we only have a single one
@@ -155,6 +161,83 @@ void FScene::prepare(const filament::math::mat4f& worldOriginTransform) {
         }
     }
 
+    // Second pass: fill the renderable data, this runs on multiple threads. World transforms
+    // and world AABBs are only recomputed for renderables whose transform or AABB changed.
+    // We know there is enough space in the array.
+    sceneData.resize(instances.size());
+
+    RenderableInstances const* source = instances.data();
+    auto work = [&rcm, &tcm, &sceneData, &worldOriginTransform,
+            &source, cache = mRenderableCache.data()]
+            (uint32_t startIndex, uint32_t count) {
+        auto* const UTILS_RESTRICT renderableInstance = sceneData.data<RENDERABLE_INSTANCE>();
+        auto* const UTILS_RESTRICT worldTransform     = sceneData.data<WORLD_TRANSFORM>();
+        auto* const UTILS_RESTRICT visibility         = sceneData.data<VISIBILITY_STATE>();
+        auto* const UTILS_RESTRICT bonesUbh           = sceneData.data<BONES_UBH>();
+        auto* const UTILS_RESTRICT instancesData      = sceneData.data<INSTANCES>();
+        auto* const UTILS_RESTRICT worldAABBCenter    = sceneData.data<WORLD_AABB_CENTER>();
+        auto* const UTILS_RESTRICT layers             = sceneData.data<LAYERS>();
+        auto* const UTILS_RESTRICT worldAABBExtent    = sceneData.data<WORLD_AABB_EXTENT>();
+
+        for (uint32_t i = startIndex, e = startIndex + count; i < e; i++) {
+            auto const ri = source[i].ri;
+            auto const ti = source[i].ti;
+
+            // each renderable appears only once in a scene, so there is no contention here
+            CachedRenderable& cached = cache[ri];
+            const uint64_t transformVersion = tcm.getWorldTransformVersion(ti);
+            const uint64_t aabbVersion = rcm.getAABBVersion(ri);
+            if (cached.transformVersion != transformVersion || cached.aabbVersion != aabbVersion) {
+                cached.transformVersion = transformVersion;
+                cached.aabbVersion = aabbVersion;
+                cached.worldTransform = worldOriginTransform * tcm.getWorldTransform(ti);
+                // compute the world AABB so we can perform culling
+                cached.worldAABB = rigidTransform(rcm.getAABB(ri), cached.worldTransform);
+            }
+
+            renderableInstance[i] = ri;
+            worldTransform[i]     = cached.worldTransform;
+            visibility[i]         = rcm.getVisibility(ri);
+            bonesUbh[i]           = rcm.getBonesUbh(ri);
+            instancesData[i]      = nullptr; // set by the view
+            worldAABBCenter[i]    = cached.worldAABB.center;
+            layers[i]             = rcm.getLayerMask(ri);
+            worldAABBExtent[i]    = cached.worldAABB.halfExtent;
+        }
+    };
+
+    auto fill = [&js, &work, count = (uint32_t)instances.size()]() {
+        auto job = jobs::parallel_for(js, nullptr, 0, count,
+                std::cref(work), jobs::CountSplitter<JOBS_PARALLEL_FOR_RENDERABLES_COUNT, 8>());
+        js.runAndWait(job);
+    };
+
+    if (mHierarchicalCullingEnabled) {
+        // The BVH needs the renderables sorted spatially, we only do that when the list of
+        // renderables changes or when they moved enough that the BVH became inefficient,
+        // the rest of the time the previous order is reused and the BVH is just refit.
+        const bool rebuild = mBvhNeedsRebuild || instances != mBvhSourceInstances;
+        if (rebuild) {
+            fill();
+            std::vector<uint32_t> order(instances.size());
+            CullingBvh::sortByLocation(order.data(),
+                    sceneData.data<WORLD_AABB_CENTER>(), instances.size());
+            mBvhInstances.resize(instances.size());
+            for (size_t i = 0, c = instances.size(); i < c; i++) {
+                mBvhInstances[i] = instances[order[i]];
+            }
+            mBvhSourceInstances = instances;
+        }
+        source = mBvhInstances.data();
+        fill();
+        mBvh.refit(js, sceneData.data<WORLD_AABB_CENTER>(), sceneData.data<WORLD_AABB_EXTENT>(),
+                sceneData.size(), rebuild);
+        mBvhNeedsRebuild = mBvh.needsRebuild();
+    } else {
+        fill();
+        mBvh.clear();
+    }
+
     // some elements past the end of the array will be accessed by SIMD code, we need to make
     // sure the data is valid enough as not to produce errors such as divide-by-zero
     // (e.g. in computeLightRanges())
@@ -163,43 +246,121 @@ void FScene::prepare(const filament::math::mat4f& worldOriginTransform) {
     }
 }
 
-void FScene::updateUBOs(utils::Range<uint32_t> visibleRenderables, Handle<HwUniformBuffer> renderableUbh) noexcept {
+void FScene::updateUBOs(utils::Range<uint32_t> visibleRenderables,
+        Handle<HwUniformBuffer> renderableUbh, utils::Slice<uint64_t> uboVersions) noexcept {
+    SYSTRACE_CALL();
+
     FEngine::DriverApi& driver = mEngine.getDriverApi();
-    const size_t size = visibleRenderables.size() * sizeof(PerRenderableUib);
+    JobSystem& js = mEngine.getJobSystem();
+    auto& sceneData = mRenderableData;
 
-    // allocate space into the command stream directly
-    void* const buffer = driver.allocate(size);
+    mRenderableViewUbh = renderableUbh;
 
-    auto& sceneData = mRenderableData;
+    /*
+     * Find the slots whose content is out of date, i.e. either the renderable occupying the
+     * slot changed, or its transform changed. Since transform versions are never reused,
+     * comparing them is enough. Dirty slots close to each other are grouped in a single range,
+     * so we don't end-up with a lot of small updates.
+     */
+
+    assert(visibleRenderables.last <= uboVersions.size());
+    std::vector<uint32_t>& slots = mDirtyUboSlots;
+    std::vector<UboRange>& ranges = mDirtyUboRanges;
+    slots.clear();
+    ranges.clear();
+
+    auto const* const UTILS_RESTRICT renderableInstance = sceneData.data<RENDERABLE_INSTANCE>();
+    CachedRenderable const* const UTILS_RESTRICT cache = mRenderableCache.data();
+    uint64_t* const UTILS_RESTRICT versions = uboVersions.data();
     for (uint32_t i : visibleRenderables) {
-        mat4f const& model = sceneData.elementAt<WORLD_TRANSFORM>(i);
-        const size_t offset = i * sizeof(PerRenderableUib);
-
-        UniformBuffer::setUniform(buffer,
-                offset + offsetof(PerRenderableUib, worldFromModelMatrix),
-                model);
-
-        // Using the inverse-transpose handles non-uniform scaling, but DOESN'T guarantee that
-        // the transformed normals will have unit-length, therefore they need to be normalized
-        // in the shader (that's already the case anyways, since normalization is needed after
-        // interpolation).
-        //
-        // We pre-scale normals by the inverse of the largest scale factor to avoid
-        // large post-transform magnitudes in the shader, especially in the fragment shader, where
-        // we use medium precision.
-        //
-        // Note: if the model matrix is known to be a rigid-transform, we could just use it directly.
-
-        mat3f m = transpose(inverse(model.upperLeft()));
-        m *= mat3f(1.0f / std::sqrt(max(float3{length2(m[0]), length2(m[1]), length2(m[2])})));
-
-        UniformBuffer::setUniform(buffer,
-                offset + offsetof(PerRenderableUib, worldFromModelNormalMatrix), m);
+        const uint64_t version = cache[renderableInstance[i]].transformVersion;
+        if (versions[i] != version) {
+            versions[i] = version;
+            addDirtyUboSlot(ranges, slots, i);
+        }
     }
 
-    // TODO: handle static objects separately
-    mRenderableViewUbh = renderableUbh;
-    driver.updateUniformBuffer(renderableUbh, { buffer, size });
+    if (slots.empty()) {
+        return;
+    }
+
+    // allocate space into the command stream directly, the dirty ranges are packed
+    const size_t size = slots.size() * sizeof(PerRenderableUib);
+    void* const buffer = driver.allocate(size);
+
+    auto work = [buffer, &sceneData, slots = slots.data()](uint32_t startIndex, uint32_t count) {
+        for (uint32_t k = startIndex, e = startIndex + count; k < e; k++) {
+            const uint32_t i = slots[k];
+            mat4f const& model = sceneData.elementAt<WORLD_TRANSFORM>(i);
+            const size_t offset = k * sizeof(PerRenderableUib);
+
+            UniformBuffer::setUniform(buffer,
+                    offset + offsetof(PerRenderableUib, worldFromModelMatrix),
+                    model);
+
+            // Using the inverse-transpose handles non-uniform scaling, but DOESN'T guarantee
+            // that the transformed normals will have unit-length, therefore they need to be
+            // normalized in the shader (that's already the case anyways, since normalization is
+            // needed after interpolation).
+            //
+            // We pre-scale normals by the inverse of the largest scale factor to avoid
+            // large post-transform magnitudes in the shader, especially in the fragment shader,
+            // where we use medium precision.
+            //
+            // Note: if the model matrix is known to be a rigid-transform, we could just use it
+            // directly.
+
+            mat3f m = transpose(inverse(model.upperLeft()));
+            m *= mat3f(1.0f / std::sqrt(max(float3{length2(m[0]), length2(m[1]), length2(m[2])})));
+
+            UniformBuffer::setUniform(buffer,
+                    offset + offsetof(PerRenderableUib, worldFromModelNormalMatrix), m);
+        }
+    };
+
+    auto job = jobs::parallel_for(js, nullptr, 0, (uint32_t)slots.size(),
+            std::cref(work), jobs::CountSplitter<JOBS_PARALLEL_FOR_RENDERABLES_COUNT, 8>());
+    js.runAndWait(job);
+
+    // and upload each range where it belongs in the UBO
+    char const* data = static_cast<char const*>(buffer);
+    for (UboRange const& range : ranges) {
+        const size_t rangeSize = range.count * sizeof(PerRenderableUib);
+        driver.updateUniformBufferRange(renderableUbh, { data, rangeSize },
+                uint32_t(range.first * sizeof(PerRenderableUib)));
+        data += rangeSize;
+    }
+}
+
+void FScene::addDirtyUboSlot(std::vector<UboRange>& ranges,
+        std::vector<uint32_t>& slots, uint32_t slot) noexcept {
+    if (!ranges.empty()) {
+        UboRange& last = ranges.back();
+        const uint32_t end = last.first + last.count;
+        assert(slot >= last.first);
+        if (slot < end) {
+            // already part of the last range
+            return;
+        }
+        if (slot - end <= UBO_UPDATE_MAX_GAP) {
+            for (uint32_t j = end; j <= slot; j++) {
+                slots.push_back(j);
+            }
+            last.count = slot + 1 - last.first;
+            return;
+        }
+    }
+    ranges.push_back({ slot, 1 });
+    slots.push_back(slot);
+}
+
+void FScene::setHierarchicalCullingEnabled(bool enabled) noexcept {
+    if (mHierarchicalCullingEnabled != enabled) {
+        mHierarchicalCullingEnabled = enabled;
+        mBvhSourceInstances.clear();
+        mBvhInstances.clear();
+        mBvhNeedsRebuild = true;
+    }
 }
 
 void FScene::terminate(FEngine& engine) {
@@ -232,11 +393,19 @@ void FScene::prepareDynamicLights(const CameraInfo& camera, ArenaScope& rootAren
 
     // skip directional light
     Zip2Iterator<FScene::LightSoa::iterator, float*> b = { lightData.begin(), distances };
-    std::sort(b + DIRECTIONAL_LIGHTS_COUNT, b + lightData.size(),
-            [](auto const& lhs, auto const& rhs) { return lhs.second < rhs.second; });
+    auto closer = [](auto const& lhs, auto const& rhs) { return lhs.second < rhs.second; };
+
+    // with many lights, first select the ones we keep, so that we only sort those
+    const size_t keptLightCount =
+            std::min(lightData.size(), CONFIG_MAX_LIGHT_COUNT + DIRECTIONAL_LIGHTS_COUNT);
+    if (UTILS_UNLIKELY(keptLightCount < lightData.size())) {
+        std::nth_element(b + DIRECTIONAL_LIGHTS_COUNT, b + keptLightCount, b + lightData.size(),
+                closer);
+    }
+    std::sort(b + DIRECTIONAL_LIGHTS_COUNT, b + keptLightCount, closer);
 
     // drop excess lights
-    lightData.resize(std::min(lightData.size(), CONFIG_MAX_LIGHT_COUNT + DIRECTIONAL_LIGHTS_COUNT));
+    lightData.resize(keptLightCount);
 
     // number of point/spot lights
     size_t positionalLightCount = lightData.size() - DIRECTIONAL_LIGHTS_COUNT;
@@ -424,4 +593,12 @@ size_t Scene::getLightCount() const noexcept {
     return upcast(this)->getLightCount();
 }
 
+void Scene::setHierarchicalCullingEnabled(bool enabled) noexcept {
+    upcast(this)->setHierarchicalCullingEnabled(enabled);
+}
+
+bool Scene::isHierarchicalCullingEnabled() const noexcept {
+    return upcast(this)->isHierarchicalCullingEnabled();
+}
+
 } // namespace filament
@@ -26,6 +26,7 @@
 
 #include <filament/driver/DriverEnums.h>
 
+#include <cmath>
 #include <limits>
 
 using namespace filament::math;
@@ -42,11 +43,24 @@ static constexpr bool USE_DEPTH_CLAMP = false;
 // currently disabled because it creates shadow acne problems at a distance
 static constexpr bool ENABLE_LISPSM = true;
 
+constexpr size_t ShadowMap::MAX_CASCADE_COUNT;
+
+// the cascades are stored in an atlas of 1x1, 2x1 or 2x2 tiles
+static inline uint32_t getAtlasColumns(size_t cascadeCount) noexcept {
+    return cascadeCount > 1 ? 2u : 1u;
+}
+
+static inline uint32_t getAtlasRows(size_t cascadeCount) noexcept {
+    return cascadeCount > 2 ? 2u : 1u;
+}
+
 ShadowMap::ShadowMap(FEngine& engine) noexcept :
         mEngine(engine),
         mClipSpaceFlipped(engine.getBackend() == Backend::VULKAN ||
                           engine.getBackend() == Backend::METAL) {
-    mCamera = mEngine.createCamera(EntityManager::get().create());
+    for (Cascade& cascade : mCascades) {
+        cascade.camera = mEngine.createCamera(EntityManager::get().create());
+    }
     mDebugCamera = mEngine.createCamera(EntityManager::get().create());
     FDebugRegistry& debugRegistry = engine.getDebugRegistry();
     debugRegistry.registerProperty("d.shadowmap.focus_shadowcasters", &engine.debug.shadowmap.focus_shadowcasters);
@@ -59,16 +73,18 @@ ShadowMap::ShadowMap(FEngine& engine) noexcept :
 }
 
 ShadowMap::~ShadowMap() {
-    mEngine.destroy(mCamera->getEntity());
+    for (Cascade& cascade : mCascades) {
+        mEngine.destroy(cascade.camera->getEntity());
+    }
     mEngine.destroy(mDebugCamera->getEntity());
 }
 
 void ShadowMap::prepare(DriverApi& driver, SamplerBuffer& sb) noexcept {
     assert(mShadowMapDimension);
 
-    uint32_t dim = mShadowMapDimension;
-    uint32_t currentDimension = mViewport.width + 2;
-    if (currentDimension == dim) {
+    const uint32_t width = mShadowMapDimension * getAtlasColumns(mCascadeCount);
+    const uint32_t height = mShadowMapDimension * getAtlasRows(mCascadeCount);
+    if (mTextureWidth == width && mTextureHeight == height) {
         // nothing to do here.
         assert(mShadowMapHandle);
         return;
@@ -83,17 +99,15 @@ void ShadowMap::prepare(DriverApi& driver, SamplerBuffer& sb) noexcept {
     }
 
     // allocate new ones...
-    // we set a viewport with a 1-texel border for when we index outside of the texture
-    // DON'T CHANGE this unless computeLightSpaceMatrix() is updated too.
-    // see: computeLightSpaceMatrix()
-    mViewport = { 1, 1, dim - 2, dim - 2 };
+    mTextureWidth = width;
+    mTextureHeight = height;
 
     mShadowMapHandle = driver.createTexture(
-            Driver::SamplerType::SAMPLER_2D, 1, Driver::TextureFormat::DEPTH16, 1, dim, dim, 1,
-            TextureUsage::DEPTH_ATTACHMENT);
+            Driver::SamplerType::SAMPLER_2D, 1, Driver::TextureFormat::DEPTH16, 1,
+            width, height, 1, TextureUsage::DEPTH_ATTACHMENT);
 
     mShadowMapRenderTarget = driver.createRenderTarget(
-            TargetBufferFlags::SHADOW, dim, dim, 1, Driver::TextureFormat::DEPTH16,
+            TargetBufferFlags::SHADOW, width, height, 1, Driver::TextureFormat::DEPTH16,
             {}, { mShadowMapHandle }, {});
 
     SamplerParams s;
@@ -114,20 +128,39 @@ void ShadowMap::terminate(DriverApi& driverApi) noexcept {
     }
 }
 
-void ShadowMap::beginRenderPass(DriverApi& driver) const noexcept {
+void ShadowMap::beginRenderPass(DriverApi& driver, size_t cascade, bool clear) const noexcept {
     RenderPassParams params = {};
-    params.flags.clear = TargetBufferFlags::SHADOW;
-    params.flags.discardStart = TargetBufferFlags::DEPTH;
+    if (clear) {
+        // the whole texture is cleared, including the borders of all cascades
+        params.flags.clear = TargetBufferFlags::SHADOW;
+        params.flags.discardStart = TargetBufferFlags::DEPTH;
+        params.clearDepth = 1.0;
+        // Disable scissor and viewport to avoid bugs in some drivers where the GPU memory is
+        // reloaded needlessly.
+        params.flags.clear |= RenderPassFlags::IGNORE_SCISSOR | RenderPassFlags::IGNORE_VIEWPORT;
+    }
     params.flags.discardEnd = TargetBufferFlags::COLOR_AND_STENCIL;
-    params.clearDepth = 1.0;
-    params.viewport.width = params.viewport.height = mShadowMapDimension;
-    // Disable scissor and viewport to avoid bugs in some drivers where the GPU memory is reloaded
-    // needlessly.
-    params.flags.clear |= RenderPassFlags::IGNORE_SCISSOR | RenderPassFlags::IGNORE_VIEWPORT;
+    params.viewport.width = mTextureWidth;
+    params.viewport.height = mTextureHeight;
     driver.beginRenderPass(mShadowMapRenderTarget, params);
 
-    driver.viewport(mViewport.left, mViewport.bottom,
-            mViewport.width, mViewport.height);
+    filament::Viewport const& viewport = mCascades[cascade].viewport;
+    driver.viewport(viewport.left, viewport.bottom, viewport.width, viewport.height);
+}
+
+void ShadowMap::computeCascadeSplits(float* splits, size_t count,
+        float near, float far, float lambda) noexcept {
+    // The "practical split scheme": the logarithmic splits keep the ratio of the shadow map
+    // resolution to the view resolution constant, but give too much resolution close to the
+    // camera, the uniform splits give too little. We use a blend of both.
+    for (size_t i = 1; i < count; i++) {
+        const float t = float(i) / float(count);
+        const float uniformSplit = near + (far - near) * t;
+        // logarithmic splits are undefined with a near plane at zero (e.g. ortho cameras)
+        const float logSplit = near > 0.0f ? near * std::pow(far / near, t) : uniformSplit;
+        splits[i - 1] = uniformSplit + (logSplit - uniformSplit) * lambda;
+    }
+    splits[count - 1] = far;
 }
 
 void ShadowMap::update(
@@ -138,73 +171,107 @@ void ShadowMap::update(
     auto& lcm = mEngine.getLightManager();
 
     FLightManager::Instance li = lightData.elementAt<FScene::LIGHT_INSTANCE>(index);
-    mShadowMapDimension = std::max(1u, lcm.getShadowMapSize(li));
+    const uint32_t dim = std::max(1u, lcm.getShadowMapSize(li));
+    mShadowMapDimension = dim;
 
     FLightManager::ShadowParams params = lcm.getShadowParams(li);
-    mat4f projection(camera.cullingProjection);
-    if (params.shadowFar > 0.0f) {
-        float n = camera.zn;
-        float f = params.shadowFar;
-        if (std::abs(projection[2].w) <= std::numeric_limits<float>::epsilon()) {
-            // perspective projection
-            projection[2].z =     (f + n) / (n - f);
-            projection[3].z = (2 * f * n) / (n - f);
-        } else {
-            // ortho projection
-            projection[2].z =    2.0f / (n - f);
-            projection[3].z = (f + n) / (n - f);
-        }
+    mCascadeCount = std::max(size_t(1), std::min(size_t(params.shadowCascades), MAX_CASCADE_COUNT));
+
+    // each cascade covers a range of distances of the view frustum, up to the shadow far plane
+    const float shadowFar = params.shadowFar > 0.0f ? params.shadowFar : camera.zf;
+    float splits[MAX_CASCADE_COUNT];
+    computeCascadeSplits(splits, mCascadeCount, camera.zn, shadowFar, params.cascadeSplitLambda);
+
+    // we set a viewport with a 1-texel border for when we index outside of a cascade
+    // DON'T CHANGE this unless getTextureCoordsMapping() is updated too.
+    const uint32_t columns = getAtlasColumns(mCascadeCount);
+    for (size_t i = 0; i < MAX_CASCADE_COUNT; i++) {
+        const uint32_t x = uint32_t(i % columns);
+        const uint32_t y = uint32_t(i / columns);
+        mCascades[i].viewport = { int32_t(x * dim + 1), int32_t(y * dim + 1), dim - 2, dim - 2 };
+        // until a cascade is computed, everything maps to its near plane, i.e. is never in shadow
+        mCascades[i].lightSpace = mat4f(mat4f::row_major_init{
+                0, 0, 0, 0.5f,
+                0, 0, 0, 0.5f,
+                0, 0, 0, 0,
+                0, 0, 0, 1
+        });
+        mCascades[i].sceneRange = 0.0f;
+        mCascades[i].texelSizeWs = 0.0f;
+        mCascades[i].hasVisibleShadows = false;
+        // the shader compares the view space z (negative in front of the camera) to the splits
+        mCascadeSplits[i] = i < mCascadeCount ? -splits[i] : std::numeric_limits<float>::lowest();
     }
 
-    CameraInfo cameraInfo = {
-            .projection = projection,
-            .model = camera.model,
-            .view = camera.view,
-            .zn = camera.zn,
-            .zf = camera.zf,
-            .dzn = std::max(0.0f, params.shadowNearHint - camera.zn),
-            .dzf = std::max(0.0f, camera.zf - params.shadowFarHint),
-            .frustum = Frustum(projection * camera.view),
-            .worldOrigin = camera.worldOrigin
-    };
-
-    // debugging...
-    const float dz = cameraInfo.zf - cameraInfo.zn;
-    float& dzn = mEngine.debug.shadowmap.dzn;
-    float& dzf = mEngine.debug.shadowmap.dzf;
-    if (dzn < 0)    dzn = cameraInfo.dzn / dz;
-    else            cameraInfo.dzn = dzn * dz;
-    if (dzf > 0)    dzf =-cameraInfo.dzf / dz;
-    else            cameraInfo.dzf =-dzf * dz;
-
-
     using Type = FLightManager::Type;
     switch (lcm.getType(li)) {
         case Type::SUN:
-        case Type::DIRECTIONAL:
-            computeShadowCameraDirectional(
-                    lightData.elementAt<FScene::DIRECTION>(index), scene, cameraInfo,
-                    visibleLayers);
+        case Type::DIRECTIONAL: {
+            // scene bounds in world space
+            Aabb wsShadowCastersVolume, wsShadowReceiversVolume;
+            scene->computeBounds(wsShadowCastersVolume, wsShadowReceiversVolume, visibleLayers);
+            if (wsShadowCastersVolume.isEmpty() || wsShadowReceiversVolume.isEmpty()) {
+                break;
+            }
+            for (size_t i = 0; i < mCascadeCount; i++) {
+                const float n = i ? splits[i - 1] : camera.zn;
+                const float f = splits[i];
+                mat4f projection(camera.cullingProjection);
+                if (std::abs(projection[2].w) <= std::numeric_limits<float>::epsilon()) {
+                    // perspective projection
+                    projection[2].z =     (f + n) / (n - f);
+                    projection[3].z = (2 * f * n) / (n - f);
+                } else {
+                    // ortho projection
+                    projection[2].z =    2.0f / (n - f);
+                    projection[3].z = (f + n) / (n - f);
+                }
+
+                CameraInfo cameraInfo = {
+                        .projection = projection,
+                        .model = camera.model,
+                        .view = camera.view,
+                        .zn = n,
+                        .zf = f,
+                        .dzn = std::max(0.0f, params.shadowNearHint - n),
+                        .dzf = std::max(0.0f, f - params.shadowFarHint),
+                        .frustum = Frustum(projection * camera.view),
+                        .worldOrigin = camera.worldOrigin
+                };
+
+                // debugging...
+                const float dz = cameraInfo.zf - cameraInfo.zn;
+                float& dzn = mEngine.debug.shadowmap.dzn;
+                float& dzf = mEngine.debug.shadowmap.dzf;
+                if (dzn < 0)    dzn = cameraInfo.dzn / dz;
+                else            cameraInfo.dzn = dzn * dz;
+                if (dzf > 0)    dzf =-cameraInfo.dzf / dz;
+                else            cameraInfo.dzf =-dzf * dz;
+
+                computeShadowCameraDirectional(lightData.elementAt<FScene::DIRECTION>(index),
+                        cameraInfo, wsShadowCastersVolume, wsShadowReceiversVolume, i);
+            }
             break;
+        }
         case Type::FOCUSED_SPOT:
         case Type::SPOT:
             break;
         case Type::POINT:
             break;
     }
+
+    mHasVisibleShadows = false;
+    for (size_t i = 0; i < mCascadeCount; i++) {
+        mHasVisibleShadows |= mCascades[i].hasVisibleShadows;
+    }
 }
 
 void ShadowMap::computeShadowCameraDirectional(
-        filament::math::float3 const& dir, FScene const* scene, CameraInfo const& camera,
-        uint8_t visibleLayers) noexcept {
-
-    // scene bounds in world space
-    Aabb wsShadowCastersVolume, wsShadowReceiversVolume;
-    scene->computeBounds(wsShadowCastersVolume, wsShadowReceiversVolume, visibleLayers);
-    if (wsShadowCastersVolume.isEmpty() || wsShadowReceiversVolume.isEmpty()) {
-        mHasVisibleShadows = false;
-        return;
-    }
+        filament::math::float3 const& dir, CameraInfo const& camera,
+        Aabb const& wsShadowCastersVolume, Aabb const& wsShadowReceiversVolume,
+        size_t cascade) noexcept {
+
+    Cascade& c = mCascades[cascade];
 
     float3 wsViewFrustumCorners[8];
     computeFrustumCorners(wsViewFrustumCorners,
@@ -215,8 +282,8 @@ void ShadowMap::computeShadowCameraDirectional(
     size_t vertexCount = intersectFrustumWithBox(mWsClippedShadowReceiverVolume,
             camera.frustum, wsViewFrustumCorners, wsShadowReceiversVolume);
 
-    mHasVisibleShadows = vertexCount >= 2;
-    if (mHasVisibleShadows) {
+    c.hasVisibleShadows = vertexCount >= 2;
+    if (c.hasVisibleShadows) {
         const bool USE_LISPSM = ENABLE_LISPSM && mEngine.debug.shadowmap.lispsm;
 
         /*
@@ -334,8 +401,7 @@ void ShadowMap::computeShadowCameraDirectional(
 
         // For directional lights, we further constraint the light frustum to the
         // intersection of the shadow casters & receivers in light-space.
-        // However, since this relies on the 1-texel shadow map border, this wouldn't directly
-        // work if we were storing several shadow maps in a single texture.
+        // This relies on the 1-texel border around each cascade of the shadow map.
         if (mEngine.debug.shadowmap.focus_shadowcasters) {
             intersectWithShadowCasters(lsLightFrustum, WLMpMv, wsShadowCastersVolume);
         }
@@ -344,7 +410,7 @@ void ShadowMap::computeShadowCameraDirectional(
                            (lsLightFrustum.min.y >= lsLightFrustum.max.y))) {
             // this could happen if the only thing visible is a perfectly horizontal or
             // vertical thin line
-            mHasVisibleShadows = false;
+            c.hasVisibleShadows = false;
             return;
         }
 
@@ -377,16 +443,18 @@ void ShadowMap::computeShadowCameraDirectional(
         // Compute shadow-map texture access transform
         const mat4f MbMt = getTextureCoordsMapping();
 
-        // Final shadowmap texture transform
+        // Final shadowmap texture transform, within the cascade
         const mat4f St = mat4f(MbMt * S);
 
-        mTexelSizeWs = texelSizeWorldSpace(St, float3{ 0.5f });
-        mLightSpace = St;
-        mSceneRange = (zfar - znear);
-        mCamera->setCustomProjection(mat4(S), znear, zfar);
+        c.texelSizeWs = texelSizeWorldSpace(St, float3{ 0.5f });
+        c.lightSpace = getAtlasMapping(cascade) * St;
+        c.sceneRange = (zfar - znear);
+        c.camera->setCustomProjection(mat4(S), znear, zfar);
 
-        // for the debug camera, we need to undo the world origin
-        mDebugCamera->setCustomProjection(mat4(S * camera.worldOrigin), znear, zfar);
+        if (cascade == 0) {
+            // for the debug camera, we need to undo the world origin
+            mDebugCamera->setCustomProjection(mat4(S * camera.worldOrigin), znear, zfar);
+        }
     }
 }
 
@@ -464,6 +532,23 @@ mat4f ShadowMap::applyLISPSM(CameraInfo const& camera, float dzn, float dzf, mat
 }
 
 
+mat4f ShadowMap::getAtlasMapping(size_t cascade) const noexcept {
+    // maps the texture coordinates of a cascade to its tile of the atlas, the viewports
+    // are flipped vertically when the clip space is flipped, and so are the tiles' rows.
+    const uint32_t columns = getAtlasColumns(mCascadeCount);
+    const uint32_t rows = getAtlasRows(mCascadeCount);
+    const float x = float(cascade % columns);
+    const float y = float(mClipSpaceFlipped ? rows - 1 - cascade / columns : cascade / columns);
+    const float sx = 1.0f / columns;
+    const float sy = 1.0f / rows;
+    return mat4f(mat4f::row_major_init{
+            sx,  0, 0, x * sx,
+             0, sy, 0, y * sy,
+             0,  0, 1, 0,
+             0,  0, 0, 1
+    });
+}
+
 mat4f ShadowMap::getTextureCoordsMapping() const noexcept {
     // Computes St the transform to use in the shader to access the shadow map texture
     // i.e. it transform a world-space vertex to a texture coordinate in the shadow-map
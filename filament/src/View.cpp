@@ -19,9 +19,11 @@
 #include "details/Engine.h"
 #include "details/Culler.h"
 #include "details/DFG.h"
+#include "details/FrameTimer.h"
 #include "details/Froxelizer.h"
 #include "details/IndirectLight.h"
 #include "details/MaterialInstance.h"
+#include "details/RenderPrimitive.h"
 #include "details/Renderer.h"
 #include "details/Scene.h"
 #include "details/Skybox.h"
@@ -39,6 +41,8 @@
 #include <math/scalar.h>
 #include <math/fast.h>
 
+#include <algorithm>
+#include <limits>
 #include <memory>
 
 using namespace filament::math;
@@ -56,6 +60,25 @@ static constexpr size_t VISIBLE_SHADOW_CASTER_BIT = 1u;
 static constexpr uint8_t VISIBLE_RENDERABLE = 1u << VISIBLE_RENDERABLE_BIT;
 static constexpr uint8_t VISIBLE_SHADOW_CASTER = 1u << VISIBLE_SHADOW_CASTER_BIT;
 static constexpr uint8_t VISIBLE_ALL = VISIBLE_RENDERABLE | VISIBLE_SHADOW_CASTER;
+// shadow casters of each shadow cascade, VISIBLE_SHADOW_CASTER is set if any of these is set
+static constexpr uint8_t VISIBLE_SHADOW_CASCADES =
+        ((1u << ShadowMap::MAX_CASCADE_COUNT) - 1u) << FView::VISIBLE_SHADOW_CASCADE_BIT;
+
+constexpr size_t FView::VISIBLE_SHADOW_CASCADE_BIT;
+constexpr size_t FView::VISIBLE_DEPTH_OCCLUDER_BIT;
+
+// Cost model of the adaptive depth prepass, costs are relative to shading an unlit fragment.
+// renderables covering less than this fraction of the viewport are not drawn in the prepass
+static constexpr float DEPTH_PREPASS_OCCLUDER_MIN_AREA = 1.0f / 64.0f;
+static constexpr float DEPTH_PREPASS_LIT_FRAGMENT_COST = 4.0f;
+static constexpr float DEPTH_PREPASS_DEPTH_FRAGMENT_COST = 0.25f;
+static constexpr float DEPTH_PREPASS_VERTEX_COST = 2.0f;
+// without a prepass, the front-to-back sorting already rejects about half the hidden fragments
+static constexpr float DEPTH_PREPASS_HIDDEN_SHADED_RATIO = 0.5f;
+// the prepass is kept off when the previous frame took less than this ratio of the frame budget
+static constexpr float DEPTH_PREPASS_GPU_BOUND_RATIO = 0.75f;
+// the estimated benefit/cost ratio must be past 1 by this margin to change the decision
+static constexpr float DEPTH_PREPASS_HYSTERESIS = 0.25f;
 
 FView::FView(FEngine& engine)
     : mFroxelizer(engine),
@@ -91,6 +114,11 @@ void FView::terminate(FEngine& engine) {
     driver.destroyUniformBuffer(mLightUbh);
     driver.destroySamplerBuffer(mPerViewSbh);
     driver.destroyUniformBuffer(mRenderableUbh);
+    for (auto const& visibleInstances : mVisibleInstances) {
+        if (visibleInstances.handle) {
+            driver.destroyUniformBuffer(visibleInstances.handle);
+        }
+    }
     mDirectionalShadowMap.terminate(driver);
     mFroxelizer.terminate(driver);
 }
@@ -147,6 +175,10 @@ void FView::setDynamicLightingOptions(float zLightNear, float zLightFar) noexcep
     mFroxelizer.setOptions(zLightNear, zLightFar);
 }
 
+void FView::setAdaptiveFroxelGridEnabled(bool enabled) noexcept {
+    mFroxelizer.setAdaptiveGridEnabled(enabled);
+}
+
 // this is to avoid a call to memmove
 template<class InputIterator, class OutputIterator>
 static inline
@@ -157,6 +189,9 @@ void move_backward(InputIterator first, InputIterator last, OutputIterator resul
 }
 
 math::float2 FView::updateScale(duration frameTime) noexcept {
+    // the adaptive depth prepass needs the frame time even without dynamic resolution
+    mLastFrameTime = frameTime;
+
     DynamicResolutionOptions const& options = mDynamicResolution;
     if (options.enabled) {
 
@@ -293,24 +328,39 @@ void FView::prepareShadowing(FEngine& engine, driver::DriverApi& driver,
         ShadowMap& shadowMap = mDirectionalShadowMap;
         shadowMap.update(lightData, 0, scene, mViewingCameraInfo, mVisibleLayers);
         if (shadowMap.hasVisibleShadows()) {
-            // Cull shadow casters
-            Frustum const& frustum = shadowMap.getCamera().getFrustum();
-            FView::prepareVisibleShadowCasters(engine.getJobSystem(), frustum, renderableData);
+            const size_t cascadeCount = shadowMap.getCascadeCount();
+            mat4f lightFromWorldMatrix[ShadowMap::MAX_CASCADE_COUNT];
+            float4 cascadeDepthScale{};
+            float4 cascadeTexelSize{};
+            for (size_t i = 0; i < ShadowMap::MAX_CASCADE_COUNT; i++) {
+                lightFromWorldMatrix[i] = shadowMap.getLightSpaceMatrix(i);
+                if (i < cascadeCount && shadowMap.hasVisibleShadows(i)) {
+                    // Cull the shadow casters of this cascade
+                    Frustum const& frustum = shadowMap.getCamera(i).getFrustum();
+                    FView::prepareVisibleShadowCasters(engine.getJobSystem(), frustum,
+                            renderableData, scene->getCullingBvh(), i);
+
+                    // the 2x bias is needed in opengl because the depth maps to -1/1. It may
+                    // not be needed with other APIs, but at least it won't worsen the acnee there.
+                    cascadeDepthScale[i] = 2.0f / shadowMap.getSceneRange(i);
+                    cascadeTexelSize[i] = shadowMap.getTexelSizeWorldSpace(i);
+                }
+            }
 
             // allocates shadowmap driver resources
             shadowMap.prepare(driver, getUs());
 
-            mat4f const& lightFromWorldMatrix = shadowMap.getLightSpaceMatrix();
-            u.setUniform(offsetof(PerViewUib, lightFromWorldMatrix), lightFromWorldMatrix);
+            u.setUniformArray(offsetof(PerViewUib, lightFromWorldMatrix),
+                    lightFromWorldMatrix, ShadowMap::MAX_CASCADE_COUNT);
+            u.setUniform(offsetof(PerViewUib, cascadeSplits), shadowMap.getCascadeSplits());
+            u.setUniform(offsetof(PerViewUib, cascadeDepthScale), cascadeDepthScale);
+            u.setUniform(offsetof(PerViewUib, cascadeTexelSize), cascadeTexelSize);
 
-            // the 2x bias is needed in opengl because the depth maps to -1/1. It may not be
-            // needed with other APIs, but at least it won't worsen the acnee there.
-            const float sceneRange = shadowMap.getSceneRange();
-            const float texelSizeWorldSpace = shadowMap.getTexelSizeWorldSpace();
+            // the biases are scaled by each cascade's depth range and texel size in the shader
             const float constantBias = lcm.getShadowConstantBias(directionalLight);
             const float normalBias = lcm.getShadowNormalBias(directionalLight);
             u.setUniform(offsetof(PerViewUib, shadowBias),
-                    float3{ 2 * constantBias / sceneRange, normalBias * texelSizeWorldSpace, 0 });
+                    float3{ constantBias, normalBias, float(cascadeCount) });
         }
     }
 }
@@ -400,6 +450,7 @@ void FView::prepareLighting(FEngine& engine, FEngine::DriverApi& driver, ArenaSc
 void FView::prepare(FEngine& engine, driver::DriverApi& driver, ArenaScope& arena,
         filament::Viewport const& viewport, filament::math::float4 const& userTime) noexcept {
     JobSystem& js = engine.getJobSystem();
+    FrameTimer::Scope timing(engine.getFrameTimer(), FrameTimer::Stage::SCENE_PREPARE);
 
     /*
      * Prepare the scene -- this is where we gather all the objects added to the scene,
@@ -477,6 +528,8 @@ void FView::prepare(FEngine& engine, driver::DriverApi& driver, ArenaScope& aren
 
     { // all the operations in this scope must happen sequentially
 
+        timing.next(FrameTimer::Stage::CULLING);
+
         Slice<Culler::result_type> cullingMask = renderableData.slice<FScene::VISIBLE_MASK>();
         std::uninitialized_fill(cullingMask.begin(), cullingMask.end(), 0);
 
@@ -485,12 +538,12 @@ void FView::prepare(FEngine& engine, driver::DriverApi& driver, ArenaScope& aren
          * (this will set the VISIBLE_RENDERABLE bit)
          */
 
-        prepareVisibleRenderables(js, mCullingFrustum, renderableData);
+        prepareVisibleRenderables(js, mCullingFrustum, renderableData, scene->getCullingBvh());
 
 
         /*
-         * Shadowing: compute the shadow camera and cull shadow casters
-         * (this will set the VISIBLE_SHADOW_CASTER bit)
+         * Shadowing: compute the shadow cameras and cull shadow casters
+         * (this will set the VISIBLE_SHADOW_CASCADES bits)
          */
 
         prepareShadowing(engine, driver, renderableData, scene->getLightData());
@@ -522,6 +575,8 @@ void FView::prepare(FEngine& engine, driver::DriverApi& driver, ArenaScope& aren
         mVisibleShadowCasters = Range{ uint32_t(beginCasters - beginRenderables), iEnd };
         merged = Range{ 0, iEnd };
 
+        timing.next(FrameTimer::Stage::SCENE_PREPARE);
+
         // update those UBOs
         const size_t size = merged.size() * sizeof(PerRenderableUib);
         if (mRenderableUBOSize < size) {
@@ -530,11 +585,22 @@ void FView::prepare(FEngine& engine, driver::DriverApi& driver, ArenaScope& aren
             mRenderableUBOSize = uint32_t(count * sizeof(PerRenderableUib));
             driver.destroyUniformBuffer(mRenderableUbh);
             mRenderableUbh = driver.createUniformBuffer(mRenderableUBOSize,
-                    driver::BufferUsage::STREAM);
+                    driver::BufferUsage::DYNAMIC);
+            // the content of the new UBO is undefined
+            mRenderableUboVersions.assign(count, 0);
         } else {
             // TODO: should we shrink the underlying UBO at some point?
         }
-        scene->updateUBOs(merged, mRenderableUbh);
+        if (UTILS_UNLIKELY(mRenderableUboWorldOrigin != worldOriginScene)) {
+            // the world origin is baked into all the world transforms stored in the UBO
+            mRenderableUboWorldOrigin = worldOriginScene;
+            std::fill(mRenderableUboVersions.begin(), mRenderableUboVersions.end(), 0);
+        }
+        scene->updateUBOs(merged, mRenderableUbh,
+                { mRenderableUboVersions.data(), mRenderableUboVersions.size() });
+
+        // cull the instances of the visible instanced renderables
+        prepareInstances(engine, renderableData, merged);
     }
 
     /*
@@ -575,10 +641,13 @@ void FView::computeVisibilityMasks(
         Culler::result_type mask = visibleMask[i];
         FRenderableManager::Visibility v = visibility[i];
         bool inVisibleLayer = layers[i] & visibleLayers;
-        bool visRenderables   = (!v.culling || (mask & VISIBLE_RENDERABLE))    && inVisibleLayer;
-        bool visShadowCasters = (!v.culling || (mask & VISIBLE_SHADOW_CASTER)) && inVisibleLayer && v.castShadows;
+        // renderables that are not culled are shadow casters in all cascades
+        Culler::result_type cascades = v.culling ? (mask & VISIBLE_SHADOW_CASCADES) : VISIBLE_SHADOW_CASCADES;
+        bool visRenderables   = (!v.culling || (mask & VISIBLE_RENDERABLE)) && inVisibleLayer;
+        bool visShadowCasters = cascades && inVisibleLayer && v.castShadows;
         visibleMask[i] = Culler::result_type(visRenderables) |
-                         Culler::result_type(visShadowCasters << 1);
+                         Culler::result_type(visShadowCasters << 1) |
+                         Culler::result_type(visShadowCasters ? cascades : 0u);
     }
 }
 
@@ -587,8 +656,9 @@ UTILS_NOINLINE
         FScene::RenderableSoa::iterator begin,
         FScene::RenderableSoa::iterator end,
         uint8_t mask) noexcept {
+    // the shadow cascades bits are ignored
     return std::partition(begin, end, [mask](auto it) {
-        return it.template get<FScene::VISIBLE_MASK>() == mask;
+        return (it.template get<FScene::VISIBLE_MASK>() & VISIBLE_ALL) == mask;
     });
 }
 
@@ -622,6 +692,7 @@ void FView::prepareCamera(const CameraInfo& camera, const filament::Viewport& vi
 
 void FView::froxelize(FEngine& engine) const noexcept {
     SYSTRACE_CALL();
+    FrameTimer::Scope timing(engine.getFrameTimer(), FrameTimer::Stage::FROXELIZATION);
 
     if (mHasDynamicLighting) {
         // froxelize lights
@@ -649,10 +720,11 @@ void FView::commitFroxels(driver::DriverApi& driverApi) const noexcept {
 
 UTILS_NOINLINE
 void FView::prepareVisibleRenderables(JobSystem& js,
-        Frustum const& frustum, FScene::RenderableSoa& renderableData) const noexcept {
+        Frustum const& frustum, FScene::RenderableSoa& renderableData,
+        CullingBvh const& bvh) const noexcept {
     SYSTRACE_CALL();
     if (UTILS_LIKELY(isFrustumCullingEnabled())) {
-        FView::cullRenderables(js, renderableData, frustum, VISIBLE_RENDERABLE_BIT);
+        FView::cullRenderables(js, renderableData, bvh, frustum, VISIBLE_RENDERABLE_BIT);
     } else {
         std::uninitialized_fill(renderableData.begin<FScene::VISIBLE_MASK>(),
                   renderableData.end<FScene::VISIBLE_MASK>(), VISIBLE_RENDERABLE);
@@ -661,18 +733,28 @@ void FView::prepareVisibleRenderables(JobSystem& js,
 
 UTILS_NOINLINE
 void FView::prepareVisibleShadowCasters(JobSystem& js,
-        Frustum const& lightFrustum, FScene::RenderableSoa& renderableData) noexcept {
+        Frustum const& lightFrustum, FScene::RenderableSoa& renderableData,
+        CullingBvh const& bvh, size_t cascade) noexcept {
     SYSTRACE_CALL();
-    FView::cullRenderables(js, renderableData, lightFrustum, VISIBLE_SHADOW_CASTER_BIT);
+    FView::cullRenderables(js, renderableData, bvh, lightFrustum,
+            VISIBLE_SHADOW_CASCADE_BIT + cascade);
 }
 
 void FView::cullRenderables(JobSystem& js,
-        FScene::RenderableSoa& renderableData, Frustum const& frustum, size_t bit) noexcept {
+        FScene::RenderableSoa& renderableData, CullingBvh const& bvh,
+        Frustum const& frustum, size_t bit) noexcept {
 
     float3 const* worldAABBCenter = renderableData.data<FScene::WORLD_AABB_CENTER>();
     float3 const* worldAABBExtent = renderableData.data<FScene::WORLD_AABB_EXTENT>();
     uint8_t     * visibleArray    = renderableData.data<FScene::VISIBLE_MASK>();
 
+    if (!bvh.empty()) {
+        // hierarchical culling, the BVH must match the renderable data
+        assert(bvh.size() == renderableData.size());
+        bvh.intersects(js, visibleArray, frustum, worldAABBCenter, worldAABBExtent, bit);
+        return;
+    }
+
     // culling job (this runs on multiple threads)
     auto functor = [&frustum, worldAABBCenter, worldAABBExtent, visibleArray, bit]
             (uint32_t index, uint32_t c) {
@@ -689,6 +771,120 @@ void FView::cullRenderables(JobSystem& js,
     js.runAndWait(job);
 }
 
+void FView::prepareInstances(FEngine& engine,
+        FScene::RenderableSoa& renderableData, Range visible) noexcept {
+    SYSTRACE_CALL();
+
+    using Instances = FRenderableManager::Instances;
+    using VisibleInstances = FRenderableManager::VisibleInstances;
+
+    FEngine::DriverApi& driver = engine.getDriverApi();
+    FRenderableManager const& rcm = engine.getRenderableManager();
+
+    // Like mRenderableLevels, this is indexed by renderable instance. The state left by a
+    // destroyed renderable is never mistaken for its replacement's, since instance
+    // versions are never reused.
+    std::vector<VisibleInstances>& visibleInstances = mVisibleInstances;
+    if (UTILS_UNLIKELY(visibleInstances.size() <= rcm.getComponentCount())) {
+        visibleInstances.resize(rcm.getComponentCount() + 1);
+    }
+
+    auto const* const UTILS_RESTRICT soaInstance = renderableData.data<FScene::RENDERABLE_INSTANCE>();
+    auto* const UTILS_RESTRICT instancesData = renderableData.data<FScene::INSTANCES>();
+    auto const* const UTILS_RESTRICT worldTransform = renderableData.data<FScene::WORLD_TRANSFORM>();
+    auto const* const UTILS_RESTRICT visibility = renderableData.data<FScene::VISIBILITY_STATE>();
+    uint8_t const* const UTILS_RESTRICT visibleMask = renderableData.data<FScene::VISIBLE_MASK>();
+
+    // the instances are shadow casters if they're visible in any shadow cascade, all cascades
+    // draw the same instances.
+    const bool shadowing = hasShadowing();
+    ShadowMap const& shadowMap = mDirectionalShadowMap;
+
+    for (uint32_t i : visible) {
+        auto ri = soaInstance[i];
+        Instances const* const instances = rcm.getInstances(ri);
+        if (UTILS_LIKELY(!instances)) {
+            continue;
+        }
+
+        // The UBO can hold all instances twice, once for the color pass and once for the
+        // shadow pass. Like for the bones, each draw binds a whole batch to satisfy the
+        // minimum uniform block size, so the UBO is rounded up to full batches.
+        VisibleInstances& state = visibleInstances[ri];
+        const uint32_t batchCount = Instances::getBatchCount(instances->transforms.size());
+        if (UTILS_UNLIKELY(state.batchCapacity < batchCount)) {
+            if (state.handle) {
+                driver.destroyUniformBuffer(state.handle);
+            }
+            state.handle = driver.createUniformBuffer(
+                    Instances::PASS_COUNT * batchCount * Instances::BATCH_SIZE,
+                    driver::BufferUsage::DYNAMIC);
+            state.batchCapacity = batchCount;
+            state.committedVersion = 0;
+        }
+        instancesData[i] = &state;
+
+        // compute the world-space bounding box of each instance, the culler processes
+        // multiples of Culler::MODULO boxes so the padding must be valid too.
+        const size_t count = instances->transforms.size();
+        const size_t roundedCount = Culler::round(count);
+        mInstanceCenters.resize(roundedCount);
+        mInstanceExtents.resize(roundedCount);
+        mInstanceVisibility.assign(roundedCount, 0);
+        float3* const UTILS_RESTRICT centers = mInstanceCenters.data();
+        float3* const UTILS_RESTRICT extents = mInstanceExtents.data();
+        Culler::result_type* const UTILS_RESTRICT results = mInstanceVisibility.data();
+        for (size_t j = 0; j < count; j++) {
+            const Box box = rigidTransform(instances->aabb,
+                    worldTransform[i] * instances->transforms[j]);
+            centers[j] = box.center;
+            extents[j] = box.halfExtent;
+        }
+        std::fill(centers + count, centers + roundedCount, float3{});
+        std::fill(extents + count, extents + roundedCount, float3{});
+
+        // visibleMask already accounts for the layers and the renderable's culling
+        const bool cull = visibility[i].culling;
+        if (visibleMask[i] & VISIBLE_RENDERABLE) {
+            if (cull && isFrustumCullingEnabled()) {
+                Culler::intersects(results, mCullingFrustum, centers, extents,
+                        roundedCount, VISIBLE_RENDERABLE_BIT);
+            } else {
+                std::fill(results, results + count, VISIBLE_RENDERABLE);
+            }
+        }
+        if ((visibleMask[i] & VISIBLE_SHADOW_CASTER) && shadowing) {
+            if (cull) {
+                for (size_t c = 0; c < shadowMap.getCascadeCount(); c++) {
+                    if (visibleMask[i] & (1u << (VISIBLE_SHADOW_CASCADE_BIT + c))) {
+                        Culler::intersects(results, shadowMap.getCamera(c).getFrustum(),
+                                centers, extents, roundedCount, VISIBLE_SHADOW_CASTER_BIT);
+                    }
+                }
+            } else {
+                for (size_t j = 0; j < count; j++) {
+                    results[j] |= VISIBLE_SHADOW_CASTER;
+                }
+            }
+        }
+
+        std::vector<uint32_t>& color = state.visible[Instances::COLOR];
+        std::vector<uint32_t>& shadow = state.visible[Instances::SHADOW];
+        color.clear();
+        shadow.clear();
+        for (uint32_t j = 0; j < count; j++) {
+            if (results[j] & VISIBLE_RENDERABLE) {
+                color.push_back(j);
+            }
+            if (results[j] & VISIBLE_SHADOW_CASTER) {
+                shadow.push_back(j);
+            }
+        }
+
+        FRenderableManager::commitInstances(driver, *instances, state, worldTransform[i]);
+    }
+}
+
 void FView::prepareVisibleLights(FLightManager const& lcm, utils::JobSystem&,
         Frustum const& frustum, FScene::LightSoa& lightData) noexcept {
     SYSTRACE_CALL();
@@ -746,14 +942,135 @@ void FView::prepareVisibleLights(FLightManager const& lcm, utils::JobSystem&,
     lightData.resize(visibleLightCount);
 }
 
-void FView::updatePrimitivesLod(FEngine& engine, const CameraInfo&,
-        FScene::RenderableSoa& renderableData, Range visible) noexcept {
+void FView::updatePrimitivesLod(FEngine& engine, const CameraInfo& camera,
+        FScene::RenderableSoa& renderableData, Range visible, bool shadowPass) noexcept {
+    SYSTRACE_CALL();
+
     FRenderableManager const& rcm = engine.getRenderableManager();
+    LevelOfDetailOptions const& options = mLevelOfDetailOptions;
+
+    // The size on screen is the diameter of the bounding sphere of the world-space AABB,
+    // divided by the height of the viewport in clip space: r * p[1][1] / w.
+    const mat4f& p = camera.projection;
+    const mat4f& v = camera.view;
+    const float4 clipW{ p[0][3], p[1][3], p[2][3], p[3][3] };
+    const float yScale = p[1][1];
+
+    auto const* const UTILS_RESTRICT soaInstance = renderableData.data<FScene::RENDERABLE_INSTANCE>();
+    auto const* const UTILS_RESTRICT soaCenter = renderableData.data<FScene::WORLD_AABB_CENTER>();
+    auto const* const UTILS_RESTRICT soaExtent = renderableData.data<FScene::WORLD_AABB_EXTENT>();
+    auto* const UTILS_RESTRICT soaPrimitives = renderableData.data<FScene::PRIMITIVES>();
+
+    // Instances are dense, so this covers all renderables. When a renderable is destroyed, its
+    // instance is reused and its replacement starts from a stale level, which only affects the
+    // hysteresis for one frame.
+    std::vector<uint8_t>& currentLevels = mRenderableLevels;
+    if (UTILS_UNLIKELY(currentLevels.size() <= rcm.getComponentCount())) {
+        currentLevels.resize(rcm.getComponentCount() + 1, 0);
+    }
+
+    for (uint32_t index : visible) {
+        auto ri = soaInstance[index];
+        FRenderableManager::Levels const* const levels = rcm.getLevels(ri);
+        uint8_t level = 0;
+        if (UTILS_UNLIKELY(levels)) {
+            const float4 center = v * float4{ soaCenter[index], 1 };
+            const float w = dot(clipW, center);
+            const float size = w > 0 ? length(soaExtent[index]) * yScale / w
+                                     : std::numeric_limits<float>::infinity();
+            level = levels->select(size);
+
+            // only change level when the size is past the threshold by the hysteresis margin
+            const uint8_t current = std::min(currentLevels[ri], uint8_t(levels->count - 1));
+            if (level > current) {
+                level = std::max(current, levels->select(size * (1.0f + options.hysteresis)));
+            } else if (level < current) {
+                level = std::min(current, levels->select(size * (1.0f - options.hysteresis)));
+            }
+
+            if (shadowPass) {
+                level = uint8_t(std::min(level + options.shadowLevelBias, levels->count - 1));
+            } else {
+                currentLevels[ri] = level;
+            }
+        }
+        soaPrimitives[index] = rcm.getRenderPrimitives(ri, level);
+    }
+}
+
+bool FView::updateDepthPrepass(const CameraInfo& camera,
+        FScene::RenderableSoa& renderableData, Range visible,
+        filament::Viewport const& viewport) noexcept {
+    SYSTRACE_CALL();
+
+    // The area on screen is the one of the projected bounding sphere of the world-space AABB,
+    // as a fraction of the viewport, which is 2x2 in clip space: pi.r^2.p[0][0].p[1][1] / 4w^2
+    const mat4f& p = camera.projection;
+    const mat4f& v = camera.view;
+    const float4 clipW{ p[0][3], p[1][3], p[2][3], p[3][3] };
+    const float areaScale = float(M_PI) * p[0][0] * p[1][1] * 0.25f;
+
+    auto const* const UTILS_RESTRICT soaCenter = renderableData.data<FScene::WORLD_AABB_CENTER>();
+    auto const* const UTILS_RESTRICT soaExtent = renderableData.data<FScene::WORLD_AABB_EXTENT>();
+    auto const* const UTILS_RESTRICT soaPrimitives = renderableData.data<FScene::PRIMITIVES>();
+    auto* const UTILS_RESTRICT soaVisibleMask = renderableData.data<FScene::VISIBLE_MASK>();
+
+    // all quantities below are in viewports, i.e. 1.0 covers the whole viewport once
+    float opaqueArea = 0;       // area of all the opaque primitives, i.e. depth complexity
+    float shadingArea = 0;      // same, weighted by the cost of their material
+    float occluderArea = 0;     // area of the primitives drawn in the prepass
+    size_t occluderIndices = 0; // number of indices drawn in the prepass
+
     for (uint32_t index : visible) {
-        uint8_t level = 0; // TODO: pick the proper level of detail
-        auto ri = renderableData.elementAt<FScene::RENDERABLE_INSTANCE>(index);
-        renderableData.elementAt<FScene::PRIMITIVES>(index) = rcm.getRenderPrimitives(ri, level);
+        const float4 center = v * float4{ soaCenter[index], 1 };
+        const float w = dot(clipW, center);
+        const float r2 = length2(soaExtent[index]);
+        const float area = w * w > r2 ? std::min(1.0f, areaScale * r2 / (w * w)) : 1.0f;
+        const bool occluder = area >= DEPTH_PREPASS_OCCLUDER_MIN_AREA;
+
+        for (auto const& primitive : soaPrimitives[index]) {
+            FMaterial const* const ma = primitive.getMaterialInstance()->getMaterial();
+            Driver::RasterState const rs = ma->getRasterState();
+            // same as the depth commands of RenderPass: these are never in the prepass
+            if (!rs.depthWrite || rs.hasBlending()) {
+                continue;
+            }
+            const float cost = ma->getShading() == Shading::UNLIT ?
+                    1.0f : DEPTH_PREPASS_LIT_FRAGMENT_COST;
+            opaqueArea += area;
+            shadingArea += area * cost;
+            if (occluder && !rs.alphaToCoverage) {
+                occluderArea += area;
+                occluderIndices += primitive.getIndexCount();
+            }
+        }
+
+        constexpr uint8_t occluderBit = 1u << VISIBLE_DEPTH_OCCLUDER_BIT;
+        soaVisibleMask[index] = occluder ?
+                uint8_t(soaVisibleMask[index] | occluderBit) :
+                uint8_t(soaVisibleMask[index] & ~occluderBit);
     }
+
+    // The prepass saves shading the hidden fragments that pass the depth test anyway, at the
+    // cost of drawing the occluders a second time.
+    const float pixelCount = float(viewport.width) * float(viewport.height);
+    const float averageCost = opaqueArea > 0 ? shadingArea / opaqueArea : 0.0f;
+    const float hiddenArea = std::max(0.0f, opaqueArea - 1.0f);
+    const float saved = hiddenArea * averageCost * DEPTH_PREPASS_HIDDEN_SHADED_RATIO * pixelCount;
+    const float cost = occluderArea * DEPTH_PREPASS_DEPTH_FRAGMENT_COST * pixelCount +
+            float(occluderIndices) * DEPTH_PREPASS_VERTEX_COST;
+
+    // Fragments are not worth saving when the GPU had time to spare on the previous frame,
+    // if the frame time is not known we only rely on the estimate.
+    const float budget = mDynamicResolution.targetFrameTimeMilli;
+    const bool gpuBound = mLastFrameTime.count() <= 0.0f ||
+            mLastFrameTime.count() >= budget * DEPTH_PREPASS_GPU_BOUND_RATIO;
+
+    const float ratio = (gpuBound && cost > 0.0f) ? saved / cost : 0.0f;
+    mAdaptiveDepthPrepass = mAdaptiveDepthPrepass ?
+            ratio > 1.0f - DEPTH_PREPASS_HYSTERESIS :
+            ratio > 1.0f + DEPTH_PREPASS_HYSTERESIS;
+    return mAdaptiveDepthPrepass;
 }
 
 } // namespace details
@@ -871,6 +1188,14 @@ View::RenderQuality View::getRenderQuality() const noexcept {
     return upcast(this)->getRenderQuality();
 }
 
+void View::setLevelOfDetailOptions(LevelOfDetailOptions const& options) noexcept {
+    upcast(this)->setLevelOfDetailOptions(options);
+}
+
+View::LevelOfDetailOptions View::getLevelOfDetailOptions() const noexcept {
+    return upcast(this)->getLevelOfDetailOptions();
+}
+
 void View::setPostProcessingEnabled(bool enabled) noexcept {
     upcast(this)->setPostProcessingEnabled(enabled);
 }
@@ -895,5 +1220,13 @@ void View::setDynamicLightingOptions(float zLightNear, float zLightFar) noexcept
     upcast(this)->setDynamicLightingOptions(zLightNear, zLightFar);
 }
 
+void View::setAdaptiveFroxelGridEnabled(bool enabled) noexcept {
+    upcast(this)->setAdaptiveFroxelGridEnabled(enabled);
+}
+
+bool View::isAdaptiveFroxelGridEnabled() const noexcept {
+    return upcast(this)->isAdaptiveFroxelGridEnabled();
+}
+
 
 } // namespace filament
@@ -173,6 +173,9 @@ void FLightManager::create(const FLightManager::Builder& builder, utils::Entity
         shadowParams.shadowFar = std::max(builder->mShadowOptions.shadowFar, 0.0f);
         shadowParams.shadowNearHint = std::max(builder->mShadowOptions.shadowNearHint, 0.0f);
         shadowParams.shadowFarHint = std::max(builder->mShadowOptions.shadowFarHint, 0.0f);
+        shadowParams.cascadeSplitLambda = clamp(builder->mShadowOptions.cascadeSplitLambda, 0.0f, 1.0f);
+        shadowParams.shadowCascades = uint8_t(clamp(builder->mShadowOptions.shadowCascades,
+                uint8_t(1), uint8_t(CONFIG_MAX_SHADOW_CASCADES)));
 
         // set default values by calling the setters
         setLocalPosition(i, builder->mPosition);
@@ -84,6 +84,8 @@ public:
         float shadowFar;
         float shadowNearHint;
         float shadowFarHint;
+        float cascadeSplitLambda;
+        uint8_t shadowCascades;
     };
 
     UTILS_NOINLINE void setLocalPosition(Instance i, const filament::math::float3& position) noexcept;
@@ -154,6 +156,10 @@ public:
         return getShadowParams(i).shadowFar;
     }
 
+    constexpr uint8_t getShadowCascades(Instance i) const noexcept {
+        return getShadowParams(i).shadowCascades;
+    }
+
     constexpr const filament::math::float3& getColor(Instance i) const noexcept {
         return mManager[i].color;
     }
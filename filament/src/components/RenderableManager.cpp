@@ -29,6 +29,11 @@
 #include <utils/Log.h>
 #include <utils/Panic.h>
 
+#include <math/mat3.h>
+
+#include <limits>
+#include <stdlib.h>
+
 using namespace filament::math;
 using namespace utils;
 
@@ -39,7 +44,9 @@ using namespace details;
 struct RenderableManager::BuilderDetails {
     using Entry = RenderableManager::Builder::Entry;
     Entry* mEntries = nullptr;
-    size_t mEntriesCount = 0;
+    size_t mEntriesCount = 0;   // per level
+    size_t mLevelCount = 1;
+    float mLevelScreenSizes[FRenderableManager::Levels::MAX_LEVEL_COUNT] = {};
     Box mAABB;
     uint8_t mLayerMask = 0x1;
     uint8_t mPriority = 0x4;
@@ -49,6 +56,8 @@ struct RenderableManager::BuilderDetails {
     size_t mSkinningBoneCount = 0;
     Bone const* mUserBones = nullptr;
     filament::math::mat4f const* mUserBoneMatrices = nullptr;
+    size_t mInstanceCount = 0;
+    filament::math::mat4f const* mInstanceTransforms = nullptr;
 
     explicit BuilderDetails(size_t count)
             : mEntriesCount(count), mCulling(true), mCastShadows(false), mReceiveShadows(true) {
@@ -99,10 +108,7 @@ RenderableManager::Builder& RenderableManager::Builder::geometry(size_t index,
 
 RenderableManager::Builder& RenderableManager::Builder::material(size_t index,
         MaterialInstance const* materialInstance) noexcept {
-    if (index < mImpl->mEntriesCount) {
-        mImpl->mEntries[index].materialInstance = materialInstance;
-    }
-    return *this;
+    return materialAt(0, index, materialInstance);
 }
 
 RenderableManager::Builder& RenderableManager::Builder::boundingBox(const Box& axisAlignedBoundingBox) noexcept {
@@ -154,9 +160,68 @@ RenderableManager::Builder& RenderableManager::Builder::skinning(
     return *this;
 }
 
+RenderableManager::Builder& RenderableManager::Builder::instances(
+        size_t instanceCount, filament::math::mat4f const* transforms) noexcept {
+    mImpl->mInstanceCount = instanceCount;
+    mImpl->mInstanceTransforms = transforms;
+    return *this;
+}
+
 RenderableManager::Builder& RenderableManager::Builder::blendOrder(size_t index, uint16_t blendOrder) noexcept {
-    if (index < mImpl->mEntriesCount) {
-        mImpl->mEntries[index].blendOrder = blendOrder;
+    return blendOrderAt(0, index, blendOrder);
+}
+
+RenderableManager::Builder& RenderableManager::Builder::levels(size_t levelCount) noexcept {
+    levelCount = std::max(size_t(1),
+            std::min(levelCount, size_t(FRenderableManager::Levels::MAX_LEVEL_COUNT)));
+    if (levelCount != mImpl->mLevelCount) {
+        // entries are stored level after level, the existing ones are kept
+        const size_t count = mImpl->mEntriesCount;
+        Entry* entries = new Entry[count * levelCount];
+        std::copy_n(mImpl->mEntries, count * std::min(levelCount, mImpl->mLevelCount), entries);
+        delete [] mImpl->mEntries;
+        mImpl->mEntries = entries;
+        mImpl->mLevelCount = levelCount;
+    }
+    return *this;
+}
+
+RenderableManager::Builder& RenderableManager::Builder::levelScreenSize(
+        size_t level, float minScreenSize) noexcept {
+    if (level < mImpl->mLevelCount) {
+        mImpl->mLevelScreenSizes[level] = minScreenSize;
+    }
+    return *this;
+}
+
+RenderableManager::Builder& RenderableManager::Builder::geometryAt(size_t level, size_t index,
+        PrimitiveType type, VertexBuffer* vertices, IndexBuffer* indices,
+        size_t offset, size_t count) noexcept {
+    if (level < mImpl->mLevelCount && index < mImpl->mEntriesCount) {
+        Entry& entry = mImpl->mEntries[level * mImpl->mEntriesCount + index];
+        entry.vertices = vertices;
+        entry.indices = indices;
+        entry.offset = offset;
+        entry.minIndex = 0;
+        entry.maxIndex = vertices->getVertexCount() - 1;
+        entry.count = count;
+        entry.type = type;
+    }
+    return *this;
+}
+
+RenderableManager::Builder& RenderableManager::Builder::materialAt(size_t level, size_t index,
+        MaterialInstance const* materialInstance) noexcept {
+    if (level < mImpl->mLevelCount && index < mImpl->mEntriesCount) {
+        mImpl->mEntries[level * mImpl->mEntriesCount + index].materialInstance = materialInstance;
+    }
+    return *this;
+}
+
+RenderableManager::Builder& RenderableManager::Builder::blendOrderAt(size_t level, size_t index,
+        uint16_t blendOrder) noexcept {
+    if (level < mImpl->mLevelCount && index < mImpl->mEntriesCount) {
+        mImpl->mEntries[level * mImpl->mEntriesCount + index].blendOrder = blendOrder;
     }
     return *this;
 }
@@ -169,7 +234,13 @@ RenderableManager::Builder::Result RenderableManager::Builder::build(Engine& eng
         return Error;
     }
 
-    for (size_t i = 0, c = mImpl->mEntriesCount; i < c; i++) {
+    if (!ASSERT_PRECONDITION_NON_FATAL(
+            mImpl->mInstanceCount <= FRenderableManager::Instances::MAX_INSTANCE_COUNT,
+            "instance count > %u", FRenderableManager::Instances::MAX_INSTANCE_COUNT)) {
+        return Error;
+    }
+
+    for (size_t i = 0, c = mImpl->mEntriesCount * mImpl->mLevelCount; i < c; i++) {
         auto& entry = mImpl->mEntries[i];
 
         // entry.materialInstance must be set to something even if indices/vertices are null
@@ -262,22 +333,50 @@ void FRenderableManager::create(
     assert(ci);
 
     if (ci) {
-        // create and initialize all needed RenderPrimitives
+        // create and initialize all needed RenderPrimitives, for all levels
         using size_type = Slice<FRenderPrimitive>::size_type;
         Builder::Entry const * const entries = builder->mEntries;
-        FRenderPrimitive* rp = new FRenderPrimitive[builder->mEntriesCount];
-        for (size_t i = 0, c = builder->mEntriesCount; i < c; ++i) {
+        const size_t levelCount = builder->mLevelCount;
+        const size_t primitiveCount = builder->mEntriesCount * levelCount;
+        FRenderPrimitive* rp = new FRenderPrimitive[primitiveCount];
+        for (size_t i = 0, c = primitiveCount; i < c; ++i) {
             rp[i].init(driver, entries[i]);
         }
-        setPrimitives(ci, { rp, size_type(builder->mEntriesCount) });
+        setPrimitives(ci, { rp, size_type(primitiveCount) });
+
+        if (UTILS_UNLIKELY(levelCount > 1)) {
+            std::unique_ptr<Levels>& levels = manager[ci].levels;
+            levels = std::unique_ptr<Levels>(new Levels{});
+            levels->count = uint8_t(levelCount);
+            levels->primitiveCount = builder->mEntriesCount;
+            std::copy_n(builder->mLevelScreenSizes, levelCount, levels->minScreenSizes);
+        }
 
-        setAxisAlignedBoundingBox(ci, builder->mAABB);
         setLayerMask(ci, builder->mLayerMask);
         setPriority(ci, builder->mPriority);
         setCastShadows(ci, builder->mCastShadows);
         setReceiveShadows(ci, builder->mReceiveShadows);
         setCulling(ci, builder->mCulling);
         setSkinning(ci, false);
+        setInstancing(ci, false);
+
+        const size_t instanceCount = builder->mInstanceCount;
+        if (UTILS_UNLIKELY(instanceCount)) {
+            std::unique_ptr<Instances>& instances = manager[ci].instances;
+            instances = std::unique_ptr<Instances>(new Instances{});
+            // the version is never reused, so the views' UBOs can't mistake this renderable
+            // for a destroyed one that had the same instance
+            instances->version = ++mVersion;
+            instances->transforms.resize(instanceCount);
+            if (builder->mInstanceTransforms) {
+                std::copy_n(builder->mInstanceTransforms, instanceCount,
+                        instances->transforms.begin());
+            }
+            setInstancing(ci, true);
+        }
+
+        // this must be set after the instances are created, because the AABB depends on them
+        setAxisAlignedBoundingBox(ci, builder->mAABB);
 
         const size_t count = builder->mSkinningBoneCount;
         if (UTILS_UNLIKELY(count)) {
@@ -387,10 +486,24 @@ void FRenderableManager::prepare(
     }
 }
 
+Slice<FRenderPrimitive> FRenderableManager::getRenderPrimitives(
+        Instance instance, uint8_t level) const noexcept {
+    // the primitives of all levels are stored contiguously, level after level
+    Slice<FRenderPrimitive> const& primitives = mManager[instance].primitives;
+    std::unique_ptr<Levels> const& levels = mManager[instance].levels;
+    if (UTILS_LIKELY(!levels)) {
+        return primitives;
+    }
+    assert(level < levels->count);
+    using size_type = Slice<FRenderPrimitive>::size_type;
+    return { const_cast<FRenderPrimitive*>(primitives.data()) + level * levels->primitiveCount,
+             size_type(levels->primitiveCount) };
+}
+
 void FRenderableManager::setMaterialInstanceAt(Instance instance, uint8_t level,
         size_t primitiveIndex, FMaterialInstance const* mi) noexcept {
     if (instance) {
-        Slice<FRenderPrimitive>& primitives = getRenderPrimitives(instance, level);
+        Slice<FRenderPrimitive> primitives = getRenderPrimitives(instance, level);
         if (primitiveIndex < primitives.size()) {
             primitives[primitiveIndex].setMaterialInstance(upcast(mi));
 #ifndef NDEBUG
@@ -409,7 +522,7 @@ void FRenderableManager::setMaterialInstanceAt(Instance instance, uint8_t level,
 MaterialInstance* FRenderableManager::getMaterialInstanceAt(
         Instance instance, uint8_t level, size_t primitiveIndex) const noexcept {
     if (instance) {
-        const Slice<FRenderPrimitive>& primitives = getRenderPrimitives(instance, level);
+        const Slice<FRenderPrimitive> primitives = getRenderPrimitives(instance, level);
         if (primitiveIndex < primitives.size()) {
             // We store the material instance as const because we don't want to change it internally
             // but when the user queries it, we want to allow them to call setParameter()
@@ -422,7 +535,7 @@ MaterialInstance* FRenderableManager::getMaterialInstanceAt(
 void FRenderableManager::setBlendOrderAt(Instance instance, uint8_t level,
         size_t primitiveIndex, uint16_t order) noexcept {
     if (instance) {
-        Slice<FRenderPrimitive>& primitives = getRenderPrimitives(instance, level);
+        Slice<FRenderPrimitive> primitives = getRenderPrimitives(instance, level);
         if (primitiveIndex < primitives.size()) {
             primitives[primitiveIndex].setBlendOrder(order);
         }
@@ -432,7 +545,7 @@ void FRenderableManager::setBlendOrderAt(Instance instance, uint8_t level,
 AttributeBitset FRenderableManager::getEnabledAttributesAt(
         Instance instance, uint8_t level, size_t primitiveIndex) const noexcept {
     if (instance) {
-        Slice<FRenderPrimitive> const& primitives = getRenderPrimitives(instance, level);
+        Slice<FRenderPrimitive> const primitives = getRenderPrimitives(instance, level);
         if (primitiveIndex < primitives.size()) {
             return primitives[primitiveIndex].getEnabledAttributes();
         }
@@ -444,7 +557,7 @@ void FRenderableManager::setGeometryAt(Instance instance, uint8_t level, size_t
         PrimitiveType type, FVertexBuffer* vertices, FIndexBuffer* indices,
         size_t offset, size_t count) noexcept {
     if (instance) {
-        Slice<FRenderPrimitive>& primitives = getRenderPrimitives(instance, level);
+        Slice<FRenderPrimitive> primitives = getRenderPrimitives(instance, level);
         if (primitiveIndex < primitives.size()) {
             primitives[primitiveIndex].set(mEngine, type, vertices, indices, offset,
                     0, vertices->getVertexCount() - 1, count);
@@ -455,7 +568,7 @@ void FRenderableManager::setGeometryAt(Instance instance, uint8_t level, size_t
 void FRenderableManager::setGeometryAt(Instance instance, uint8_t level, size_t primitiveIndex,
         PrimitiveType type, size_t offset, size_t count) noexcept {
     if (instance) {
-        Slice<FRenderPrimitive>& primitives = getRenderPrimitives(instance, level);
+        Slice<FRenderPrimitive> primitives = getRenderPrimitives(instance, level);
         if (primitiveIndex < primitives.size()) {
             primitives[primitiveIndex].set(mEngine, type, offset, 0, 0, count);
         }
@@ -498,6 +611,80 @@ void FRenderableManager::setBones(Instance ci,
     }
 }
 
+void FRenderableManager::setInstanceTransforms(Instance ci,
+        filament::math::mat4f const* UTILS_RESTRICT transforms, size_t count, size_t offset) noexcept {
+    if (ci) {
+        std::unique_ptr<Instances> const& instances = mManager[ci].instances;
+        assert(instances && offset + count <= instances->transforms.size());
+        if (instances) {
+            count = std::min(count, instances->transforms.size() - offset);
+            std::copy_n(transforms, count, instances->transforms.begin() + offset);
+            instances->version = ++mVersion;
+            updateInstancesAABB(ci);
+        }
+    }
+}
+
+void FRenderableManager::updateInstancesAABB(Instance ci) noexcept {
+    std::unique_ptr<Instances> const& data = mManager[ci].instances;
+    Instances const& instances = *data;
+    float3 lo{ std::numeric_limits<float>::max() };
+    float3 hi{ std::numeric_limits<float>::lowest() };
+    for (mat4f const& transform : instances.transforms) {
+        const Box box = rigidTransform(instances.aabb, transform);
+        lo = min(lo, box.getMin());
+        hi = max(hi, box.getMax());
+    }
+    mManager[ci].aabb = Box().set(lo, hi);
+    mManager[ci].aabbVersion = ++mVersion;
+}
+
+void FRenderableManager::commitInstances(driver::DriverApi& driver, Instances const& instances,
+        VisibleInstances& state, mat4f const& worldTransform) noexcept {
+    // nothing to do if the same instances are visible and didn't move
+    bool unchanged = state.committedVersion == instances.version &&
+            state.committedWorldTransform == worldTransform;
+    for (size_t pass = 0; pass < Instances::PASS_COUNT; pass++) {
+        unchanged = unchanged && state.committed[pass] == state.visible[pass];
+    }
+    if (unchanged) {
+        return;
+    }
+
+    state.committedVersion = instances.version;
+    state.committedWorldTransform = worldTransform;
+
+    for (size_t pass = 0; pass < Instances::PASS_COUNT; pass++) {
+        std::vector<uint32_t> const& visible = state.visible[pass];
+        state.committed[pass] = visible;
+        if (visible.empty()) {
+            continue;
+        }
+
+        // the visible instances can be much larger than what the command stream can hold,
+        // so they're uploaded from the heap and freed by the driver once consumed.
+        const size_t size = visible.size() * sizeof(PerRenderableUibInstance);
+        PerRenderableUibInstance* const UTILS_RESTRICT out =
+                static_cast<PerRenderableUibInstance*>(::malloc(size));
+        for (size_t i = 0, c = visible.size(); i < c; i++) {
+            const mat4f model = worldTransform * instances.transforms[visible[i]];
+            out[i].worldFromModelMatrix = model;
+
+            // same normal transform as the non-instanced case, see FScene::updateUBOs()
+            mat3f m = transpose(inverse(model.upperLeft()));
+            m *= mat3f(1.0f / std::sqrt(max(float3{length2(m[0]), length2(m[1]), length2(m[2])})));
+            out[i].worldFromModelNormalMatrix[0] = float4{ m[0], 0 };
+            out[i].worldFromModelNormalMatrix[1] = float4{ m[1], 0 };
+            out[i].worldFromModelNormalMatrix[2] = float4{ m[2], 0 };
+        }
+
+        const Instances::Pass p = Instances::Pass(pass);
+        driver.updateUniformBufferRange(state.handle,
+                { out, size, [](void* buffer, size_t, void*) { ::free(buffer); } },
+                uint32_t(state.getFirstBatch(p) * Instances::BATCH_SIZE));
+    }
+}
+
 void FRenderableManager::makeBone(PerRenderableUibBone* UTILS_RESTRICT out, filament::math::mat4f const& t) noexcept {
     mat4f m(t);
 
@@ -579,6 +766,10 @@ size_t RenderableManager::getPrimitiveCount(Instance instance) const noexcept {
     return upcast(this)->getPrimitiveCount(instance, 0);
 }
 
+size_t RenderableManager::getLevelCount(Instance instance) const noexcept {
+    return upcast(this)->getLevelCount(instance);
+}
+
 void RenderableManager::setMaterialInstanceAt(Instance instance,
         size_t primitiveIndex, MaterialInstance const* materialInstance) noexcept {
     upcast(this)->setMaterialInstanceAt(instance, 0, primitiveIndex, upcast(materialInstance));
@@ -619,4 +810,13 @@ void RenderableManager::setBones(Instance instance,
     upcast(this)->setBones(instance, transforms, boneCount, offset);
 }
 
+void RenderableManager::setInstanceTransforms(Instance instance,
+        mat4f const* transforms, size_t count, size_t offset) noexcept {
+    upcast(this)->setInstanceTransforms(instance, transforms, count, offset);
+}
+
+size_t RenderableManager::getInstanceCount(Instance instance) const noexcept {
+    return upcast(this)->getInstanceCount(instance);
+}
+
 } // namespace filament
@@ -25,6 +25,7 @@
 #include "driver/Handle.h"
 
 #include <filament/Box.h>
+#include <filament/EngineEnums.h>
 #include <filament/RenderableManager.h>
 
 #include <private/filament/UibGenerator.h>
@@ -34,6 +35,10 @@
 #include <utils/Slice.h>
 #include <utils/Range.h>
 
+#include <algorithm>
+#include <memory>
+#include <vector>
+
 // for gtest
 class FilamentTest_Bones_Test;
 
@@ -53,6 +58,86 @@ public:
         bool receiveShadows : 1;
         bool culling        : 1;
         bool skinning       : 1;
+        bool instancing     : 1;
+    };
+
+    /*
+     * Instancing data of a renderable.
+     *
+     * Each frame, FView::prepareInstances() culls the instances and gathers the visible ones
+     * in a UBO owned by the view, see VisibleInstances.
+     */
+    struct Instances {
+        enum Pass : uint8_t { COLOR, SHADOW, PASS_COUNT };
+
+        // size of a batch in the UBO, this is also the size of the range bound for each draw
+        static constexpr size_t BATCH_SIZE = CONFIG_MAX_INSTANCES * sizeof(PerRenderableUibInstance);
+
+        // batches are indexed with 16 bits, see RenderPass::PrimitiveInfo
+        static constexpr size_t MAX_INSTANCE_COUNT = CONFIG_MAX_INSTANCES * 0x8000 / PASS_COUNT;
+
+        std::vector<filament::math::mat4f> transforms;  // transform of each instance
+        Box aabb;                                       // bounding box of a single instance
+        uint64_t version = 0;                           // never reused, changes with transforms
+
+        static uint32_t getBatchCount(size_t instanceCount) noexcept {
+            return uint32_t((instanceCount + CONFIG_MAX_INSTANCES - 1) / CONFIG_MAX_INSTANCES);
+        }
+    };
+
+    /*
+     * Instances of a renderable visible in a view, owned by that view.
+     *
+     * The visible instances are gathered in the view's UBO in batches of CONFIG_MAX_INSTANCES
+     * (one batch is one instanced draw call). The batches visible from the camera come first,
+     * followed by those visible from the shadow map, so each pass draws a contiguous range
+     * of batches.
+     */
+    struct VisibleInstances {
+        using Pass = Instances::Pass;
+        static constexpr size_t PASS_COUNT = Instances::PASS_COUNT;
+
+        filament::Handle<HwUniformBuffer> handle;
+        uint32_t batchCapacity = 0;                     // batches per pass the UBO can hold
+
+        // visible instances of the current frame, for each pass
+        std::vector<uint32_t> visible[PASS_COUNT];
+
+        // what's currently stored in the UBO, so we can skip the upload when nothing changed
+        std::vector<uint32_t> committed[PASS_COUNT];
+        filament::math::mat4f committedWorldTransform;
+        uint64_t committedVersion = 0;                  // 0 if the UBO content is undefined
+
+        uint32_t getBatchCount(Pass pass) const noexcept {
+            return Instances::getBatchCount(visible[pass].size());
+        }
+
+        uint32_t getFirstBatch(Pass pass) const noexcept {
+            return pass == Instances::COLOR ? 0 : getBatchCount(Instances::COLOR);
+        }
+
+        // number of instances in the given batch of a pass
+        uint32_t getBatchInstanceCount(Pass pass, uint32_t batch) const noexcept {
+            return uint32_t(std::min(visible[pass].size() - batch * CONFIG_MAX_INSTANCES,
+                    CONFIG_MAX_INSTANCES));
+        }
+    };
+
+    struct Levels {
+        static constexpr size_t MAX_LEVEL_COUNT = 8;
+
+        float minScreenSizes[MAX_LEVEL_COUNT] = {};     // see Builder::levelScreenSize()
+        size_t primitiveCount = 0;                      // number of primitives per level
+        uint8_t count = 0;                              // number of levels
+
+        // index of the first level whose minimum screen size is reached, or the last level
+        uint8_t select(float screenSize) const noexcept {
+            uint8_t level = 0;
+            while (level < count - 1 && screenSize < minScreenSizes[level]) {
+                level++;
+            }
+            return level;
+        }
     };
 
     explicit FRenderableManager(FEngine& engine) noexcept;
@@ -77,6 +162,10 @@ public:
 
     void destroy(utils::Entity e) noexcept;
 
+    size_t getComponentCount() const noexcept {
+        return mManager.getComponentCount();
+    }
+
     // - instances is a list of Instance (typically the list from a given scene)
     // - list is a list of index in 'instances' (typically the visible ones)
     void prepare(driver::DriverApi& driver,
@@ -100,9 +189,11 @@ public:
     inline void setReceiveShadows(Instance instance, bool enable) noexcept;
     inline void setCulling(Instance instance, bool enable) noexcept;
     inline void setSkinning(Instance instance, bool enable) noexcept;
+    inline void setInstancing(Instance instance, bool enable) noexcept;
     inline void setPrimitives(Instance instance, utils::Slice<FRenderPrimitive> const& primitives) noexcept;
     inline void setBones(Instance instance, Bone const* transforms, size_t boneCount, size_t offset = 0) noexcept;
     inline void setBones(Instance instance, filament::math::mat4f const* transforms, size_t boneCount, size_t offset = 0) noexcept;
+    void setInstanceTransforms(Instance instance, filament::math::mat4f const* transforms, size_t count, size_t offset = 0) noexcept;
 
 
     inline bool isShadowCaster(Instance instance) const noexcept;
@@ -110,15 +201,24 @@ public:
     inline bool isCullingEnabled(Instance instance) const noexcept;
 
     inline Box const& getAABB(Instance instance) const noexcept;
+    // changes each time the AABB of this instance is set, versions are never reused
+    inline uint64_t getAABBVersion(Instance instance) const noexcept;
     inline Box const& getAxisAlignedBoundingBox(Instance instance) const noexcept { return getAABB(instance); }
     inline Visibility getVisibility(Instance instance) const noexcept;
     inline uint8_t getLayerMask(Instance instance) const noexcept;
     inline uint8_t getPriority(Instance instance) const noexcept;
 
     inline Handle<HwUniformBuffer> getBonesUbh(Instance instance) const noexcept;
+    inline Instances* getInstances(Instance instance) const noexcept;
+    inline size_t getInstanceCount(Instance instance) const noexcept;
+
+    // uploads the visible instances of a renderable to the view's UBO, if they changed
+    static void commitInstances(driver::DriverApi& driver, Instances const& instances,
+            VisibleInstances& state, filament::math::mat4f const& worldTransform) noexcept;
 
 
-    inline size_t getLevelCount(Instance instance) const noexcept { return 1; }
+    inline Levels* getLevels(Instance instance) const noexcept;
+    inline size_t getLevelCount(Instance instance) const noexcept;
     inline size_t getPrimitiveCount(Instance instance, uint8_t level) const noexcept;
     void setMaterialInstanceAt(Instance instance, uint8_t level,
             size_t primitiveIndex, FMaterialInstance const* materialInstance) noexcept;
@@ -130,8 +230,7 @@ public:
             PrimitiveType type, size_t offset, size_t count) noexcept;
     void setBlendOrderAt(Instance instance, uint8_t level, size_t primitiveIndex, uint16_t blendOrder) noexcept;
     AttributeBitset getEnabledAttributesAt(Instance instance, uint8_t level, size_t primitiveIndex) const noexcept;
-    inline utils::Slice<FRenderPrimitive> const& getRenderPrimitives(Instance instance, uint8_t level) const noexcept;
-    inline utils::Slice<FRenderPrimitive>& getRenderPrimitives(Instance instance, uint8_t level) noexcept;
+    utils::Slice<FRenderPrimitive> getRenderPrimitives(Instance instance, uint8_t level) const noexcept;
 
 private:
     void destroyComponent(Instance ci) noexcept;
@@ -148,12 +247,18 @@ private:
 
     static void makeBone(PerRenderableUibBone* out, filament::math::mat4f const& transforms) noexcept;
 
+    // updates the renderable's AABB so it contains all instances
+    void updateInstancesAABB(Instance instance) noexcept;
+
     enum {
         AABB,               // user data
         LAYERS,             // user data
         VISIBILITY,         // user data
         PRIMITIVES,         // user data
         BONES,              // filament data, UBO storing a pointer to the bones information
+        AABB_VERSION,       // filament data, version of the AABB
+        INSTANCES,          // filament data, instancing information, null if not instanced
+        LEVELS,             // filament data, levels of detail, null if there is only one level
     };
 
     using Base = utils::SingleInstanceComponentManager<
@@ -161,7 +266,10 @@ private:
             uint8_t,
             Visibility,
             utils::Slice<FRenderPrimitive>,
-            std::unique_ptr<Bones>
+            std::unique_ptr<Bones>,
+            uint64_t,
+            std::unique_ptr<Instances>,
+            std::unique_ptr<Levels>
     >;
 
     struct Sim : public Base {
@@ -181,6 +289,9 @@ private:
                 Field<VISIBILITY>   visibility;
                 Field<PRIMITIVES>   primitives;
                 Field<BONES>        bones;
+                Field<AABB_VERSION> aabbVersion;
+                Field<INSTANCES>    instances;
+                Field<LEVELS>       levels;
             };
         };
 
@@ -194,13 +305,21 @@ private:
 
     Sim mManager;
     FEngine& mEngine;
+    uint64_t mVersion = 0;  // last version handed out to an AABB or instance transforms
 };
 
 FILAMENT_UPCAST(RenderableManager)
 
 void FRenderableManager::setAxisAlignedBoundingBox(Instance instance, const Box& aabb) noexcept {
     if (instance) {
+        std::unique_ptr<Instances> const& instances = mManager[instance].instances;
+        if (UTILS_UNLIKELY(instances)) {
+            instances->aabb = aabb;
+            updateInstancesAABB(instance);
+            return;
+        }
         mManager[instance].aabb = aabb;
+        mManager[instance].aabbVersion = ++mVersion;
     }
 }
 
@@ -253,6 +372,13 @@ void FRenderableManager::setSkinning(Instance instance, bool enable) noexcept {
     }
 }
 
+void FRenderableManager::setInstancing(Instance instance, bool enable) noexcept {
+    if (instance) {
+        Visibility& visibility = mManager[instance].visibility;
+        visibility.instancing = enable;
+    }
+}
+
 void FRenderableManager::setPrimitives(Instance instance,
         utils::Slice<FRenderPrimitive> const& primitives) noexcept {
     if (instance) {
@@ -289,19 +415,33 @@ Box const& FRenderableManager::getAABB(Instance instance) const noexcept {
     return mManager[instance].aabb;
 }
 
+uint64_t FRenderableManager::getAABBVersion(Instance instance) const noexcept {
+    return mManager[instance].aabbVersion;
+}
+
 Handle<HwUniformBuffer> FRenderableManager::getBonesUbh(Instance instance) const noexcept {
     std::unique_ptr<Bones> const& bones = mManager[instance].bones;
     return bones ? bones->handle : Handle<HwUniformBuffer>{};
 }
 
-utils::Slice<FRenderPrimitive> const& FRenderableManager::getRenderPrimitives(
-        Instance instance, uint8_t level) const noexcept {
-    return mManager[instance].primitives;
+FRenderableManager::Instances* FRenderableManager::getInstances(Instance instance) const noexcept {
+    std::unique_ptr<Instances> const& instances = mManager[instance].instances;
+    return instances.get();
+}
+
+size_t FRenderableManager::getInstanceCount(Instance instance) const noexcept {
+    std::unique_ptr<Instances> const& instances = mManager[instance].instances;
+    return instances ? instances->transforms.size() : 0;
+}
+
+FRenderableManager::Levels* FRenderableManager::getLevels(Instance instance) const noexcept {
+    std::unique_ptr<Levels> const& levels = mManager[instance].levels;
+    return levels.get();
 }
 
-utils::Slice<FRenderPrimitive>& FRenderableManager::getRenderPrimitives(
-        Instance instance, uint8_t level) noexcept {
-    return mManager[instance].primitives;
+size_t FRenderableManager::getLevelCount(Instance instance) const noexcept {
+    std::unique_ptr<Levels> const& levels = mManager[instance].levels;
+    return levels ? levels->count : 1;
 }
 
 size_t FRenderableManager::getPrimitiveCount(Instance instance, uint8_t level) const noexcept {
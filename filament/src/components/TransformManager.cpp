@@ -16,6 +16,12 @@
 
 #include "components/TransformManager.h"
 
+#include <utils/JobSystem.h>
+#include <utils/Systrace.h>
+
+#include <algorithm>
+#include <vector>
+
 using namespace utils;
 using namespace filament::math;
 
@@ -50,8 +56,12 @@ void FTransformManager::create(Entity entity, Instance parent, const mat4f& loca
         manager[i].next = 0;
         manager[i].prev = 0;
         manager[i].firstChild = 0;
+        manager[i].dirty = false;
         insertNode(i, parent);
         setTransform(i, localTransform);
+        // the slot may have been used by a destroyed component, make sure its version is new
+        // even if setTransform() was deferred by a transaction
+        manager[i].version = ++mVersion;
     }
 }
 
@@ -82,6 +92,7 @@ void FTransformManager::destroy(Entity e) noexcept {
         Instance child = manager[i].firstChild;
         while (child) {
             manager[child].parent = 0;
+            manager[child].dirty = mLocalTransformTransactionOpen;
             child = manager[child].next;
         }
 
@@ -111,15 +122,9 @@ void FTransformManager::updateNodeTransform(Instance i) noexcept {
     assert(i);
 
     if (UTILS_UNLIKELY(mLocalTransformTransactionOpen)) {
-        // don't update the world transform until commitLocalTransformTransaction() is called
-        Instance ci = manager[i].firstChild;
-        while (ci) {
-            Instance child = manager[ci].firstChild;
-            ci = manager[ci].next;
-            if (child) {
-                updateNodeTransform(child);
-            }
-        }
+        // don't update the world transform until commitLocalTransformTransaction() is called,
+        // just remember that this node and its descendants need updating.
+        manager[i].dirty = true;
         return;
     }
 
@@ -130,11 +135,12 @@ void FTransformManager::updateNodeTransform(Instance i) noexcept {
 
     // compute our world transform
     manager[i].world = pt * static_cast<mat4f const&>(manager[i].local);
+    manager[i].version = ++mVersion;
 
     // update our children's world transforms
     Instance child = manager[i].firstChild;
     if (UTILS_UNLIKELY(child)) { // assume we don't have a hierarchy in the common case
-        transformChildren(manager, child);
+        transformChildren(manager, child, mVersion);
     }
 }
 
@@ -143,25 +149,92 @@ void FTransformManager::openLocalTransformTransaction() noexcept {
 }
 
 void FTransformManager::commitLocalTransformTransaction() noexcept {
-    if (mLocalTransformTransactionOpen) {
-        mLocalTransformTransactionOpen = false;
-        auto& manager = mManager;
+    if (!mLocalTransformTransactionOpen) {
+        return;
+    }
+
+    SYSTRACE_CALL();
 
-        // swapNode() below needs some temporary storage which we provide here
-        auto& soa = manager.getSoA();
-        soa.ensureCapacity(soa.size() + 1);
+    mLocalTransformTransactionOpen = false;
+    auto& manager = mManager;
 
-        mat4f const* const UTILS_RESTRICT world = manager.raw_array<WORLD>();
-        for (Instance i = manager.begin(), e = manager.end(); i != e; ++i) {
-            // Ensure that children are always sorted after their parent.
-            if (UTILS_UNLIKELY(Instance(manager[i].parent) > i)) {
-                swapNode(i, manager[i].parent);
+    // swapNode() below needs some temporary storage which we provide here
+    auto& soa = manager.getSoA();
+    soa.ensureCapacity(soa.size() + 1);
+
+    // Ensure that children are always sorted after their parent, and find the level of each
+    // node that needs updating, i.e. that is dirty or has a dirty ancestor. level[i] is 0 for
+    // nodes that don't need updating, which includes the null instance.
+    std::vector<uint32_t> level(soa.size());
+    std::vector<uint32_t> levelSizes(1);
+    for (Instance i = manager.begin(), e = manager.end(); i != e; ++i) {
+        while (UTILS_UNLIKELY(Instance(manager[i].parent) > i)) {
+            swapNode(i, manager[i].parent);
+        }
+        Instance parent = manager[i].parent;
+        assert(parent < i);
+        if (manager[i].dirty || level[parent]) {
+            manager[i].dirty = false;
+            const uint32_t l = level[parent] + 1;
+            if (UTILS_UNLIKELY(l == levelSizes.size())) {
+                levelSizes.push_back(0);
             }
-            Instance parent = manager[i].parent;
-            assert(parent < i);
-            manager[i].world = world[parent] * static_cast<mat4f const&>(manager[i].local);
+            level[i] = l;
+            levelSizes[l]++;
+        }
+    }
+
+    // bucket the nodes to update by level, parents are always in a previous level
+    std::vector<uint32_t> levelStarts(levelSizes.size() + 1);
+    for (size_t l = 1; l < levelSizes.size(); l++) {
+        levelStarts[l + 1] = levelStarts[l] + levelSizes[l];
+    }
+    const uint32_t count = levelStarts.back();
+    if (count == 0) {
+        return;
+    }
+    std::vector<Instance> order(count);
+    for (Instance i = manager.begin(), e = manager.end(); i != e; ++i) {
+        if (level[i]) {
+            order[levelStarts[level[i]]++] = i;
+        }
+    }
+
+    // The nodes of a level are independent from each other, so a level can be updated on
+    // multiple threads. Versions are handed out by position in order, which keeps them unique.
+    // We only bump the version of the transforms that actually changed, so that clients
+    // tracking them don't have to redo their work for untouched nodes.
+    mat4f* const UTILS_RESTRICT world = soa.data<WORLD>();
+    mat4f const* const UTILS_RESTRICT local = soa.data<LOCAL>();
+    Instance const* const UTILS_RESTRICT parents = soa.data<PARENT>();
+    uint64_t* const UTILS_RESTRICT versions = soa.data<VERSION>();
+    Instance const* const UTILS_RESTRICT nodes = order.data();
+    const uint64_t baseVersion = mVersion;
+    auto work = [=](uint32_t start, uint32_t c) {
+        for (size_t k = start, end = start + c; k < end; k++) {
+            const Instance i = nodes[k];
+            const mat4f m = world[parents[i]] * local[i];
+            if (m != world[i]) {
+                world[i] = m;
+                versions[i] = baseVersion + k + 1;
+            }
+        }
+    };
+
+    uint32_t start = 0;
+    for (size_t l = 1; l < levelSizes.size(); l++) {
+        const uint32_t size = levelSizes[l];
+        if (mJobSystem && size >= 1024) {
+            JobSystem& js = *mJobSystem;
+            auto job = jobs::parallel_for(js, nullptr, start, size,
+                    std::cref(work), jobs::CountSplitter<256, 8>());
+            js.runAndWait(job);
+        } else {
+            work(start, size);
         }
+        start += size;
     }
+    mVersion += count;
 }
 
 // Inserts a parentless node in the hierarchy
@@ -197,6 +270,8 @@ void FTransformManager::swapNode(Instance i, Instance j) noexcept {
     // swap the content of the nodes directly
     std::swap(manager.elementAt<LOCAL>(i), manager.elementAt<LOCAL>(j));
     std::swap(manager.elementAt<WORLD>(i), manager.elementAt<WORLD>(j));
+    std::swap(manager.elementAt<VERSION>(i), manager.elementAt<VERSION>(j));
+    std::swap(manager.elementAt<DIRTY>(i), manager.elementAt<DIRTY>(j));
     manager.swap(i, j); // this swaps the data relative to SingleInstanceComponentManager
 
     // now swap the linked-list references, to do that correctly we must use a temporary
@@ -283,18 +358,19 @@ void FTransformManager::updateNode(Instance i) noexcept {
     validateNode(next);
 }
 
-void FTransformManager::transformChildren(Sim& manager, Instance ci) noexcept {
+void FTransformManager::transformChildren(Sim& manager, Instance ci, uint64_t& version) noexcept {
     while (ci) {
         // update child's world transform
         Instance parent = manager[ci].parent;
         mat4f const& pt = manager[parent].world;
         mat4f const& local = manager[ci].local;
         manager[ci].world = pt * local;
+        manager[ci].version = ++version;
 
         // assume we don't have a deep hierarchy
         Instance child = manager[ci].firstChild;
         if (UTILS_UNLIKELY(child)) {
-            transformChildren(manager, child);
+            transformChildren(manager, child, version);
         }
 
         // process our next child
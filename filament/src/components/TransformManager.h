@@ -28,6 +28,10 @@
 
 #include <math/mat4.h>
 
+namespace utils {
+class JobSystem;
+} // namespace utils
+
 namespace filament {
 namespace details {
 
@@ -41,6 +45,12 @@ public:
     // free-up all resources
     void terminate() noexcept;
 
+    // When set, large transactions are committed on multiple threads. The thread calling
+    // commitLocalTransformTransaction() must be adopted by this JobSystem.
+    void setJobSystem(utils::JobSystem* js) noexcept {
+        mJobSystem = js;
+    }
+
 
     /*
     * Component Manager APIs
@@ -82,6 +92,13 @@ public:
         return mManager[ci].world;
     }
 
+    // Returns a number that changes each time the world transform of this instance is updated.
+    // Versions are never reused, so comparing them is enough to detect a change, even if
+    // the instance has since been moved or reassigned to another entity.
+    uint64_t getWorldTransformVersion(Instance ci) const noexcept {
+        return mManager[ci].version;
+    }
+
 private:
     struct Sim;
 
@@ -91,7 +108,7 @@ private:
     void updateNodeTransform(Instance i) noexcept;
     void insertNode(Instance i, Instance p) noexcept;
     void swapNode(Instance i, Instance j) noexcept;
-    static void transformChildren(Sim& manager, Instance firstChild) noexcept;
+    static void transformChildren(Sim& manager, Instance firstChild, uint64_t& version) noexcept;
 
 
     enum {
@@ -101,6 +118,8 @@ private:
         FIRST_CHILD,    // instance to our first child
         NEXT,           // instance to our next sibling
         PREV,           // instance to our previous sibling
+        VERSION,        // version of the world transform
+        DIRTY,          // local transform or parent changed during the current transaction
     };
 
     using Base = utils::SingleInstanceComponentManager<
@@ -109,7 +128,9 @@ private:
             Instance,
             Instance,
             Instance,
-            Instance
+            Instance,
+            uint64_t,
+            bool
     >;
 
     struct Sim : public Base {
@@ -132,6 +153,8 @@ private:
                 Field<FIRST_CHILD>  firstChild;
                 Field<NEXT>         next;
                 Field<PREV>         prev;
+                Field<VERSION>      version;
+                Field<DIRTY>        dirty;
             };
         };
 
@@ -144,6 +167,8 @@ private:
     };
 
     Sim mManager;
+    utils::JobSystem* mJobSystem = nullptr;
+    uint64_t mVersion = 0;  // last version handed out to a world transform
     bool mLocalTransformTransactionOpen = false;
 };
 
@@ -33,6 +33,9 @@ namespace details {
  *
  * The implementation assumes 'count' below is multiple of 8
  *
+ * SSE2, AVX and NEON implementations are provided, the best one for the CPU is selected
+ * at runtime.
+ *
  */
 
 class Culler {
@@ -92,6 +95,18 @@ public:
                 Frustum const& frustum,
                 filament::math::float4 const* b,
                 size_t count) noexcept;
+
+        // scalar implementations, the SIMD ones must produce the same results
+        static void intersectsReference(result_type* results,
+                Frustum const& frustum,
+                filament::math::float3 const* c,
+                filament::math::float3 const* e,
+                size_t count) noexcept;
+
+        static void intersectsReference(result_type* results,
+                Frustum const& frustum,
+                filament::math::float4 const* b,
+                size_t count) noexcept;
     };
 };
 
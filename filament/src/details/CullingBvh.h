@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_DETAILS_CULLINGBVH_H
+#define TNT_FILAMENT_DETAILS_CULLINGBVH_H
+
+#include "details/Culler.h"
+
+#include <filament/Frustum.h>
+
+#include <utils/compiler.h>
+
+#include <math/vec3.h>
+
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace utils {
+class JobSystem;
+} // namespace utils
+
+namespace filament {
+namespace details {
+
+/*
+ * A bounding volume hierarchy used to cull large arrays of AABBs.
+ *
+ * The objects are never reordered by the BVH itself: leaves are fixed-size batches of
+ * consecutive objects and the tree above them is a complete binary tree stored implicitly.
+ * This means the tree is only efficient if consecutive objects are spatially close to each
+ * other, which is what sortByLocation() is for.
+ *
+ * Because the topology never changes, updating the BVH after objects moved is just a matter
+ * of recomputing the bounds of each node (refit), which is cheap compared to a rebuild.
+ * needsRebuild() tells when the objects have moved enough that the tree became inefficient.
+ */
+class CullingBvh {
+public:
+    // number of objects per leaf, leaves are culled with Culler
+    static constexpr size_t LEAF_SIZE = Culler::MODULO * Culler::MIN_LOOP_COUNT_HINT;
+
+    // the BVH needs a rebuild when its leaves are this much bigger than right after a rebuild
+    static constexpr float REBUILD_AREA_RATIO = 2.0f;
+
+    /*
+     * Computes an order of the objects, such that objects close to each other in space are
+     * close to each other in the array.
+     * order must have room for count entries.
+     */
+    static void sortByLocation(uint32_t* order,
+            filament::math::float3 const* center, size_t count) noexcept;
+
+    /*
+     * Recomputes the bounds of all the nodes of the tree.
+     * rebuilt must be set if the objects have been reordered since the last call.
+     */
+    void refit(utils::JobSystem& js,
+            filament::math::float3 const* center,
+            filament::math::float3 const* extent,
+            size_t count, bool rebuilt) noexcept;
+
+    /*
+     * Same as Culler::intersects() for all the objects, but whole subtrees entirely inside or
+     * outside the frustum are processed without testing their objects.
+     * results must be cleared.
+     */
+    void intersects(utils::JobSystem& js, Culler::result_type* results,
+            Frustum const& frustum,
+            filament::math::float3 const* center,
+            filament::math::float3 const* extent,
+            size_t bit) const noexcept;
+
+    bool needsRebuild() const noexcept {
+        return mLeafArea > REBUILD_AREA_RATIO * mReferenceLeafArea;
+    }
+
+    void clear() noexcept;
+
+    bool empty() const noexcept { return mCount == 0; }
+
+    size_t size() const noexcept { return mCount; }
+
+private:
+    struct Node {
+        filament::math::float3 min;
+        filament::math::float3 max;
+    };
+
+    enum class Classification : uint8_t {
+        OUTSIDE, INTERSECTS, INSIDE
+    };
+
+    static Classification classify(
+            filament::math::float4 const* planes, Node const& node) noexcept;
+
+    // nodes[1] is the root, children of node i are 2i and 2i+1, leaves start at mFirstLeaf
+    std::vector<Node> mNodes;
+    size_t mCount = 0;
+    size_t mLeafCount = 0;
+    size_t mFirstLeaf = 0;
+    float mLeafArea = 0;
+    float mReferenceLeafArea = 0;
+};
+
+} // namespace details
+} // namespace filament
+
+#endif // TNT_FILAMENT_DETAILS_CULLINGBVH_H
@@ -19,7 +19,8 @@
 
 #include "upcast.h"
 #include "PostProcessManager.h"
-#include "RenderTargetPool.h"
+
+#include "fg/FrameGraphTexturePool.h"
 
 #include "components/CameraManager.h"
 #include "components/LightManager.h"
@@ -29,6 +30,7 @@
 #include "details/Allocators.h"
 #include "details/Camera.h"
 #include "details/DebugRegistry.h"
+#include "details/FrameTimer.h"
 #include "details/ResourceList.h"
 #include "details/Skybox.h"
 
@@ -115,6 +117,8 @@ public:
 
     Driver& getDriver() const noexcept { return *mDriver; }
     DriverApi& getDriverApi() noexcept { return mCommandStream; }
+    CommandBufferQueue& getCommandBufferQueue() noexcept { return mCommandBufferQueue; }
+    CommandBufferQueue const& getCommandBufferQueue() const noexcept { return mCommandBufferQueue; }
     DFG* getDFG() const noexcept { return mDFG.get(); }
 
 
@@ -167,12 +171,12 @@ public:
         return mPostProcessManager;
     }
 
-    RenderTargetPool const& getRenderTargetPool() const noexcept {
-        return mRenderTargetPool;
+    FrameTimer& getFrameTimer() noexcept {
+        return mFrameTimer;
     }
 
-    RenderTargetPool& getRenderTargetPool() noexcept {
-        return mRenderTargetPool;
+    FrameGraphTexturePool& getFrameGraphTexturePool() noexcept {
+        return mFrameGraphTexturePool;
     }
 
     FRenderableManager& getRenderableManager() noexcept {
@@ -300,7 +304,8 @@ private:
     FIndexBuffer* mFullScreenTriangleIb = nullptr;
 
     PostProcessManager mPostProcessManager;
-    RenderTargetPool mRenderTargetPool;
+    FrameGraphTexturePool mFrameGraphTexturePool;
+    FrameTimer mFrameTimer;
 
     utils::EntityManager& mEntityManager;
     FRenderableManager mRenderableManager;
@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_DETAILS_FRAMETIMER_H
+#define TNT_FILAMENT_DETAILS_FRAMETIMER_H
+
+#include <filament/Renderer.h>
+
+#include <utils/compiler.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace filament {
+namespace details {
+
+/*
+ * Accumulates the time spent in each stage of the current frame.
+ *
+ * Stages can be timed from any thread, their time is simply added to the stage. When the timer
+ * is disabled, timing a stage costs a single relaxed load.
+ *
+ * The driver thread accumulates its own execution time, which is handed over to a callback
+ * after the commands of a frame have been executed (see endDriverFrame()).
+ */
+class FrameTimer {
+public:
+    using Stage = Renderer::FrameTiming::Stage;
+    using clock = std::chrono::steady_clock;
+    static constexpr size_t STAGE_COUNT = Renderer::FrameTiming::STAGE_COUNT;
+
+    // called with the driver execution time of a frame, on the driver thread
+    using DriverFrameCallback = void(*)(void* user, uint32_t frameId, uint64_t driverTime);
+
+    /*
+     * Times a stage until destruction. The time can be split across several stages with next().
+     */
+    class Scope {
+    public:
+        Scope(FrameTimer& timer, Stage stage) noexcept
+                : mTimer(timer.isEnabled() ? &timer : nullptr), mStage(stage) {
+            if (UTILS_UNLIKELY(mTimer)) {
+                mStart = clock::now();
+            }
+        }
+
+        ~Scope() noexcept {
+            if (UTILS_UNLIKELY(mTimer)) {
+                mTimer->add(mStage, clock::now() - mStart);
+            }
+        }
+
+        // the time so far is attributed to the current stage, and the scope moves on to stage
+        void next(Stage stage) noexcept {
+            if (UTILS_UNLIKELY(mTimer)) {
+                const clock::time_point now = clock::now();
+                mTimer->add(mStage, now - mStart);
+                mStart = now;
+            }
+            mStage = stage;
+        }
+
+        Scope(Scope const& rhs) = delete;
+        Scope& operator=(Scope const& rhs) = delete;
+
+    private:
+        FrameTimer* const mTimer;
+        Stage mStage;
+        clock::time_point mStart;
+    };
+
+    bool isEnabled() const noexcept {
+        return mEnabled.load(std::memory_order_relaxed);
+    }
+
+    // starts a new frame, stages are reset
+    void beginFrame(bool enabled) noexcept {
+        for (auto& stage : mStages) {
+            stage.store(0, std::memory_order_relaxed);
+        }
+        mEnabled.store(enabled, std::memory_order_relaxed);
+    }
+
+    // copies the time of each stage in stages, the caller must make sure no stage is in progress
+    void getStages(uint64_t* stages) const noexcept {
+        for (size_t i = 0; i < STAGE_COUNT; i++) {
+            stages[i] = mStages[i].load(std::memory_order_relaxed);
+        }
+    }
+
+    void add(Stage stage, clock::duration d) noexcept {
+        mStages[size_t(stage)].fetch_add(uint64_t(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(d).count()),
+                std::memory_order_relaxed);
+    }
+
+    // --------------------------------------------------------------------------------------------
+    // driver thread only
+
+    // call from a driver command, callback is called at the end of the current addDriverTime()
+    void endDriverFrame(DriverFrameCallback callback, void* user, uint32_t frameId) noexcept {
+        mDriverFrameCallback = callback;
+        mDriverFrameUser = user;
+        mDriverFrameId = frameId;
+    }
+
+    // call after executing commands
+    void addDriverTime(clock::duration d) noexcept {
+        mDriverTime += uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(d).count());
+        if (mDriverFrameCallback) {
+            mDriverFrameCallback(mDriverFrameUser, mDriverFrameId, mDriverTime);
+            mDriverFrameCallback = nullptr;
+            mDriverTime = 0;
+        }
+    }
+
+private:
+    std::array<std::atomic<uint64_t>, STAGE_COUNT> mStages = {};
+    std::atomic<bool> mEnabled = { false };
+
+    // driver thread state
+    uint64_t mDriverTime = 0;
+    DriverFrameCallback mDriverFrameCallback = nullptr;
+    void* mDriverFrameUser = nullptr;
+    uint32_t mDriverFrameId = 0;
+};
+
+} // namespace details
+} // namespace filament
+
+#endif // TNT_FILAMENT_DETAILS_FRAMETIMER_H
@@ -84,7 +84,12 @@ public:
 // the light indices per froxel. The record buffer is limited to 65536 entries, so with
 // 8192 froxels, we can store 8 lights per froxels assuming they're all used. In practice, some
 // froxels are not used, so we can store more.
-static constexpr size_t FROXEL_BUFFER_ENTRY_COUNT_MAX = 8192;
+// The default grid uses FROXEL_BUFFER_ENTRY_COUNT_DEFAULT froxels, the adaptive grid uses between
+// FROXEL_BUFFER_ENTRY_COUNT_MIN and FROXEL_BUFFER_ENTRY_COUNT_MAX froxels depending on how much
+// of the record buffer is used.
+static constexpr size_t FROXEL_BUFFER_ENTRY_COUNT_MAX = 16384;
+static constexpr size_t FROXEL_BUFFER_ENTRY_COUNT_DEFAULT = 8192;
+static constexpr size_t FROXEL_BUFFER_ENTRY_COUNT_MIN = 2048;
 
 class Froxelizer {
 public:
@@ -101,6 +106,12 @@ public:
 
     void setOptions(float zLightNear, float zLightFar) noexcept;
 
+    // When enabled, the number of froxels is adjusted each frame: it's lowered when lights
+    // didn't fit in the record buffer during the previous frame, and raised when they
+    // comfortably did.
+    void setAdaptiveGridEnabled(bool enabled) noexcept;
+    bool isAdaptiveGridEnabled() const noexcept { return mAdaptiveGrid; }
+
     /*
      * Allocate per-frame data structures for froxelization.
      *
@@ -195,11 +206,9 @@ private:
         uint16_t reserved;
     };
 
-    // The first entry always encodes the type of light, i.e. point/spot
-    using FroxelThreadData = std::array<LightGroupType, FROXEL_BUFFER_ENTRY_COUNT_MAX + 1>;
-
     void setViewport(Viewport const& viewport) noexcept;
     void setProjection(const filament::math::mat4f& projection, float near, float far) noexcept;
+    void updateFroxelBudget() noexcept;
     bool update() noexcept;
 
     void froxelizeLoop(FEngine& engine,
@@ -207,7 +216,7 @@ private:
 
     void froxelizeAssignRecordsCompress() noexcept;
 
-    void froxelizePointAndSpotLight(FroxelThreadData& froxelThread, size_t bit,
+    void froxelizePointAndSpotLight(LightGroupType* froxelThread, size_t bit,
             filament::math::mat4f const& projection, const LightParams& light) const noexcept;
 
     static void computeLightTree(LightTreeNode* lightTree,
@@ -224,7 +233,7 @@ private:
 
     static void computeFroxelLayout(
             filament::math::uint2* dim, uint16_t* countX, uint16_t* countY, uint16_t* countZ,
-            Viewport const& viewport) noexcept;
+            Viewport const& viewport, size_t froxelBudget) noexcept;
 
     // internal state dependant on the viewport and needed for froxelizing
     LinearAllocatorArena mArena;                    // ~256 KiB
@@ -234,12 +243,15 @@ private:
     filament::math::float4* mPlanesY = nullptr;
     filament::math::float4* mBoundingSpheres = nullptr;
 
-    utils::Slice<FroxelThreadData> mFroxelShardedData;  // 256 KiB w/  256 lights
+    // GROUP_COUNT arrays of mFroxelThreadStride entries, the first entry of each array encodes
+    // the type of light, i.e. point/spot
+    utils::Slice<LightGroupType> mFroxelShardedData;    // 256 KiB w/ 256 lights, 8192 froxels
     utils::Slice<FroxelEntry> mFroxelBufferUser;        //  32 KiB w/ 8192 froxels
+    size_t mFroxelThreadStride = 0;
 
     // max 32 KiB  (actual: resolution dependant)
     utils::Slice<RecordBufferType> mRecordBufferUser;   //  64 KiB
-    utils::Slice<LightRecord> mLightRecords;            // 256 KiB w/ 256 lights
+    utils::Slice<LightRecord> mLightRecords;            // 256 KiB w/ 256 lights, 8192 froxels
 
     uint16_t mFroxelCountX = 0;
     uint16_t mFroxelCountY = 0;
@@ -264,6 +276,14 @@ private:
     float mZLightFar = FEngine::CONFIG_Z_LIGHT_FAR;
     float mZLightNear = FEngine::CONFIG_Z_LIGHT_NEAR;  // light near (first slice)
 
+    // number of froxels we're allowed to use
+    uint16_t mFroxelBudget = uint16_t(FROXEL_BUFFER_ENTRY_COUNT_DEFAULT);
+    bool mAdaptiveGrid = false;
+
+    // record buffer usage of the last froxelization, needed by the adaptive grid
+    bool mRecordBufferOverflow = false;
+    size_t mRecordBufferUsage = 0;
+
     // track if we need to update our internal state before froxelizing
     uint8_t mDirtyFlags = 0;
     enum {
@@ -54,6 +54,7 @@ public:
     driver::PrimitiveType getPrimitiveType() const noexcept { return mPrimitiveType; }
     AttributeBitset getEnabledAttributes() const noexcept { return mEnabledAttributes; }
     uint16_t getBlendOrder() const noexcept { return mBlendOrder; }
+    uint32_t getIndexCount() const noexcept { return mIndexCount; }
 
     void setMaterialInstance(FMaterialInstance const* mi) noexcept { mMaterialInstance = mi; }
     void setBlendOrder(uint16_t order) noexcept {
@@ -66,6 +67,7 @@ private:
     driver::PrimitiveType mPrimitiveType = driver::PrimitiveType::NONE;
     AttributeBitset mEnabledAttributes;
     uint16_t mBlendOrder = 0;
+    uint32_t mIndexCount = 0;
 };
 
 } // namespace details
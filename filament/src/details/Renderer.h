@@ -35,8 +35,11 @@
 #include <utils/compiler.h>
 #include <utils/Allocator.h>
 #include <utils/JobSystem.h>
+#include <utils/Profiler.h>
 #include <utils/Slice.h>
 
+#include <memory>
+
 namespace filament {
 
 class Driver;
@@ -74,6 +77,16 @@ public:
 
     void resetUserTime();
 
+    void setFrameTimingOptions(FrameTimingOptions const& options) noexcept;
+
+    FrameTimingOptions const& getFrameTimingOptions() const noexcept {
+        return mFrameTimingOptions;
+    }
+
+    size_t getFrameTimings(FrameTiming* timings, size_t count) const noexcept {
+        return mFrameInfoManager.getTimings(timings, count);
+    }
+
     void readPixels(uint32_t xoffset, uint32_t yoffset, uint32_t width, uint32_t height,
             driver::PixelBufferDescriptor&& buffer);
 
@@ -107,10 +120,12 @@ private:
     class ShadowPass final : public RenderPass {
         using DriverApi = driver::DriverApi;
         ShadowMap const& shadowMap;
+        const size_t cascade;
+        const bool clear;
         void beginRenderPass(driver::DriverApi& driver, Viewport const& viewport, const CameraInfo& camera) noexcept override;
         void endRenderPass(DriverApi& driver, Viewport const& viewport) noexcept override;
     public:
-        ShadowPass(const char* name, ShadowMap const& shadowMap) noexcept;
+        ShadowPass(const char* name, ShadowMap const& shadowMap, size_t cascade, bool clear) noexcept;
         static void renderShadowMap(FEngine& engine, utils::JobSystem& js,
                 FView& view, utils::GrowingSlice<Command>& commands) noexcept;
     };
@@ -127,6 +142,8 @@ private:
         return mCommandsHighWatermark * sizeof(RenderPass::Command);
     }
 
+    void recordFrameTiming(FEngine& engine, driver::DriverApi& driver) noexcept;
+
     driver::TextureFormat getHdrFormat(const View& view) const noexcept;
     driver::TextureFormat getLdrFormat() const noexcept;
 
@@ -155,6 +172,11 @@ private:
     // per-frame arena for this Renderer
     LinearAllocatorArena& mPerRenderPassArena;
 
+    // frame timings
+    FrameTimingOptions mFrameTimingOptions;
+    Epoch mFrameTimingStart;
+    std::unique_ptr<utils::Profiler> mProfiler;
+
 #if EXTRA_TIMING_INFO
     Series<float> mRendering;
     Series<float> mPostProcess;
@@ -23,6 +23,7 @@
 #include "components/TransformManager.h"
 
 #include "details/Culler.h"
+#include "details/CullingBvh.h"
 
 #include "Allocators.h"
 
@@ -36,8 +37,13 @@
 #include <utils/Range.h>
 
 #include <cstddef>
+#include <vector>
+
 #include <tsl/robin_set.h>
 
+// for gtest
+class FilamentTest_UboRanges_Test;
+
 namespace filament {
 namespace details {
 
@@ -68,6 +74,9 @@ public:
     size_t getRenderableCount() const noexcept;
     size_t getLightCount() const noexcept;
 
+    void setHierarchicalCullingEnabled(bool enabled) noexcept;
+    bool isHierarchicalCullingEnabled() const noexcept { return mHierarchicalCullingEnabled; }
+
 public:
     /*
      * Filaments-scope Public API
@@ -99,6 +108,7 @@ public:
         WORLD_TRANSFORM,        // 16 instance of the Transform component
         VISIBILITY_STATE,       //  1 visibility data of the component
         BONES_UBH,              //  4 bones uniform buffer handle
+        INSTANCES,              //  8 instances visible in the view, see FView::prepareInstances()
         WORLD_AABB_CENTER,      // 12 world-space bounding box center of the renderable
         VISIBLE_MASK,           //  1 each bit represents a visibility in a pass
 
@@ -116,6 +126,7 @@ public:
             filament::math::mat4f,
             FRenderableManager::Visibility,
             Handle<HwUniformBuffer>,
+            FRenderableManager::VisibleInstances*,
             filament::math::float3,
             Culler::result_type,
             uint8_t,
@@ -127,6 +138,10 @@ public:
     RenderableSoa const& getRenderableData() const noexcept { return mRenderableData; }
     RenderableSoa& getRenderableData() noexcept { return mRenderableData; }
 
+    // BVH of the RenderableSoa's world AABBs, empty if hierarchical culling is disabled.
+    // This is only valid until the RenderableSoa is reordered.
+    CullingBvh const& getCullingBvh() const noexcept { return mBvh; }
+
     static inline uint32_t getPrimitiveCount(RenderableSoa const& soa,
             uint32_t first, uint32_t last) noexcept {
         // the caller must guarantee that last is dereferenceable
@@ -162,7 +177,14 @@ public:
     LightSoa const& getLightData() const noexcept { return mLightData; }
     LightSoa& getLightData() noexcept { return mLightData; }
 
-    void updateUBOs(utils::Range<uint32_t> visibleRenderables, Handle<HwUniformBuffer> renderableUbh) noexcept;
+    /*
+     * Updates the per-renderable UBO of the visible renderables. renderableUbh is persistent
+     * and uboVersions holds, for each of its slots, the version of the world transform it
+     * currently contains (0 meaning the slot is undefined). Only the slots whose renderable's
+     * transform changed are rewritten and uploaded.
+     */
+    void updateUBOs(utils::Range<uint32_t> visibleRenderables,
+            Handle<HwUniformBuffer> renderableUbh, utils::Slice<uint64_t> uboVersions) noexcept;
 
 private:
     static inline void computeLightRanges(filament::math::float2* zrange,
@@ -171,6 +193,45 @@ private:
     static inline void computeLightCameraPlaneDistances(float* distances,
             const CameraInfo& camera, const filament::math::float4* spheres, size_t count) noexcept;
 
+    // number of renderables processed by each job in prepare() and updateUBOs()
+    static constexpr size_t JOBS_PARALLEL_FOR_RENDERABLES_COUNT = 128;
+
+    // unchanged UBO slots between two dirty ones are re-uploaded (rather than issuing a new
+    // update) if there are at most this many of them.
+    static constexpr uint32_t UBO_UPDATE_MAX_GAP = 4;
+
+    // a range of slots of the per-renderable UBO to upload
+    struct UboRange {
+        uint32_t first;
+        uint32_t count;
+    };
+
+    friend class ::FilamentTest_UboRanges_Test;
+
+    // adds a dirty slot to the ranges to upload, slots must be added in increasing order.
+    // The slot is merged into the last range if it's already covered or close enough to it.
+    static void addDirtyUboSlot(std::vector<UboRange>& ranges,
+            std::vector<uint32_t>& slots, uint32_t slot) noexcept;
+
+    struct RenderableInstances {
+        FRenderableManager::Instance ri;
+        FTransformManager::Instance ti;
+        bool operator==(RenderableInstances const& rhs) const noexcept {
+            return ri == rhs.ri && ti == rhs.ti;
+        }
+        bool operator!=(RenderableInstances const& rhs) const noexcept {
+            return !operator==(rhs);
+        }
+    };
+
+    // world-space data of a renderable, valid as long as its transform and AABB don't change
+    struct CachedRenderable {
+        uint64_t transformVersion = 0;
+        uint64_t aabbVersion = 0;
+        filament::math::mat4f worldTransform;
+        Box worldAABB;
+    };
+
     FEngine& mEngine;
     FSkybox const* mSkybox = nullptr;
     FIndirectLight const* mIndirectLight = nullptr;
@@ -192,6 +253,30 @@ private:
     RenderableSoa mRenderableData;
     LightSoa mLightData;
     Handle<HwUniformBuffer> mRenderableViewUbh; // This is actually owned by the view.
+
+    /*
+     * Persistent data used by prepare() to skip the work for renderables that didn't change
+     * since the last frame. mRenderableCache is indexed by the renderable's instance, and is
+     * invalidated entirely when the world origin changes.
+     */
+    std::vector<RenderableInstances> mRenderableInstances;
+    std::vector<CachedRenderable> mRenderableCache;
+    filament::math::mat4f mCachedWorldOrigin;
+
+    /*
+     * Hierarchical culling. When enabled, the renderables are stored in the RenderableSoa in
+     * the order given by mBvhInstances (spatially sorted), instead of the scene's order
+     * (mBvhSourceInstances is the scene's order at the time of the last sort).
+     */
+    bool mHierarchicalCullingEnabled = false;
+    bool mBvhNeedsRebuild = true;
+    std::vector<RenderableInstances> mBvhSourceInstances;
+    std::vector<RenderableInstances> mBvhInstances;
+    CullingBvh mBvh;
+
+    // scratch storage for updateUBOs(), kept around to avoid reallocating it each frame
+    std::vector<uint32_t> mDirtyUboSlots;
+    std::vector<UboRange> mDirtyUboRanges;
 };
 
 FILAMENT_UPCAST(Scene)
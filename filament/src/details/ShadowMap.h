@@ -27,53 +27,90 @@
 
 #include <filament/Viewport.h>
 
+#include <filament/EngineEnums.h>
+
 #include <math/mat4.h>
 #include <math/vec4.h>
 
+#include <array>
+
 namespace filament {
 namespace details {
 
+/*
+ * The shadow map of the directional light.
+ *
+ * The view frustum is split in up to CONFIG_MAX_SHADOW_CASCADES cascades, each with its own
+ * light camera fitted to its part of the view frustum. All cascades are stored in a single
+ * texture (an atlas of up to 2x2 tiles of the size of the light's shadow map).
+ */
 class ShadowMap {
 public:
+    static constexpr size_t MAX_CASCADE_COUNT = CONFIG_MAX_SHADOW_CASCADES;
+
     explicit ShadowMap(FEngine& engine) noexcept;
     ~ShadowMap();
 
     void terminate(driver::DriverApi& driverApi) noexcept;
 
     // Call once per frame if the light, scene (or visible layers) or camera changes.
-    // This computes the light's camera.
+    // This computes the light's camera of each cascade.
     void update(
             const FScene::LightSoa& lightData, size_t index, FScene const* scene,
             details::CameraInfo const& camera, uint8_t visibleLayers) noexcept;
 
-    // Do we have visible shadows. Valid after calling update().
+    // Do we have visible shadows in any cascade. Valid after calling update().
     bool hasVisibleShadows() const noexcept { return mHasVisibleShadows; }
 
+    // Number of cascades. Valid after calling update().
+    size_t getCascadeCount() const noexcept { return mCascadeCount; }
+
+    // Does this cascade have visible shadows. Valid after calling update().
+    bool hasVisibleShadows(size_t cascade) const noexcept {
+        return mCascades[cascade].hasVisibleShadows;
+    }
+
     // Allocates shadow texture based on user parameters (e.g. dimensions)
     void prepare(driver::DriverApi& driver, SamplerBuffer& buffer) noexcept;
 
-    // Returns the shadow map's viewport. Valid after prepare().
-    Viewport const& getViewport() const noexcept { return mViewport; }
+    // Returns the viewport of a cascade in the shadow map. Valid after calling update().
+    Viewport const& getViewport(size_t cascade) const noexcept {
+        return mCascades[cascade].viewport;
+    }
 
     // Computes the transform to use in the shader to access the shadow map.
     // Valid after calling update().
-    filament::math::mat4f const& getLightSpaceMatrix() const noexcept { return mLightSpace; }
+    filament::math::mat4f const& getLightSpaceMatrix(size_t cascade) const noexcept {
+        return mCascades[cascade].lightSpace;
+    }
 
     // return the size of a texel in world space (pre-warping)
-    float getTexelSizeWorldSpace() const noexcept { return mTexelSizeWs; }
+    float getTexelSizeWorldSpace(size_t cascade) const noexcept {
+        return mCascades[cascade].texelSizeWs;
+    }
 
-    // Returns the shadow map's depth range. Valid after init().
-    float getSceneRange() const noexcept { return mSceneRange; }
+    // Returns the shadow map's depth range. Valid after calling update().
+    float getSceneRange(size_t cascade) const noexcept { return mCascades[cascade].sceneRange; }
 
     // Returns the light's projection. Valid after calling update().
-    FCamera const& getCamera() const noexcept { return *mCamera; }
+    FCamera const& getCamera(size_t cascade) const noexcept { return *mCascades[cascade].camera; }
+
+    // Returns the view space z of the far plane of each cascade, unused cascades are set to
+    // the lowest float. Valid after calling update().
+    filament::math::float4 const& getCascadeSplits() const noexcept { return mCascadeSplits; }
 
-    // Set-up the render target, call before rendering the shadow map.
-    void beginRenderPass(driver::DriverApi& driverApi) const noexcept;
+    // Set-up the render target, call before rendering a cascade. The first cascade rendered in
+    // a frame must clear the whole texture.
+    void beginRenderPass(driver::DriverApi& driverApi, size_t cascade, bool clear) const noexcept;
 
-    // use only for debugging
+    // use only for debugging, this is the camera of the first cascade
     FCamera const& getDebugCamera() const noexcept { return *mDebugCamera; }
 
+    // Computes the distances from the camera of the far plane of each of the count cascades
+    // splitting [near, far]. lambda blends between uniform (0) and logarithmic (1) splits.
+    static void computeCascadeSplits(float* splits, size_t count,
+            float near, float far, float lambda) noexcept;
+
 private:
     struct CameraInfo {
         filament::math::mat4f projection;
@@ -104,9 +141,19 @@ private:
     // 8 corners, 12 segments w/ 2 intersection max -- all of this twice (8 + 12 * 2) * 2 (768 bytes)
     using FrustumBoxIntersection = std::array<filament::math::float3, 64>;
 
+    struct Cascade {
+        FCamera* camera = nullptr;
+        filament::math::mat4f lightSpace;
+        float sceneRange = 0.0f;
+        float texelSizeWs = 0.0f;
+        Viewport viewport;
+        bool hasVisibleShadows = false;
+    };
+
     void computeShadowCameraDirectional(
-            filament::math::float3 const& direction, FScene const* scene, CameraInfo const& camera,
-            uint8_t visibleLayers) noexcept;
+            filament::math::float3 const& direction, CameraInfo const& camera,
+            Aabb const& wsShadowCastersVolume, Aabb const& wsShadowReceiversVolume,
+            size_t cascade) noexcept;
 
     static filament::math::mat4f applyLISPSM(
             CameraInfo const& camera, float dzn, float dzf, const filament::math::mat4f& LMpMv,
@@ -149,6 +196,7 @@ private:
     static filament::math::mat4f warpFrustum(float n, float f) noexcept;
 
     filament::math::mat4f getTextureCoordsMapping() const noexcept;
+    filament::math::mat4f getAtlasMapping(size_t cascade) const noexcept;
 
     float texelSizeWorldSpace(const filament::math::mat4f& lightSpaceMatrix) const noexcept;
     float texelSizeWorldSpace(const filament::math::mat4f& lightSpaceMatrix, filament::math::float3 const& str) const noexcept;
@@ -167,19 +215,19 @@ private:
             { 2, 6, 7, 3 },  // top
     };
 
-    FCamera* mCamera = nullptr;
+    std::array<Cascade, MAX_CASCADE_COUNT> mCascades;
     FCamera* mDebugCamera = nullptr;
-    filament::math::mat4f mLightSpace;
-    float mSceneRange = 0.0f;
-    float mTexelSizeWs = 0.0f;
 
     // set-up in prepare()
-    Viewport mViewport;
+    uint32_t mTextureWidth = 0;
+    uint32_t mTextureHeight = 0;
     Handle<HwTexture> mShadowMapHandle;
     Handle<HwRenderTarget> mShadowMapRenderTarget;
 
     // set-up in update()
     uint32_t mShadowMapDimension = 0;
+    size_t mCascadeCount = 1;
+    filament::math::float4 mCascadeSplits;
     bool mHasVisibleShadows = false;
 
     // use a member here (instead of stack) because we don't want to pay the
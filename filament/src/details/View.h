@@ -38,7 +38,9 @@
 #include <utils/Slice.h>
 #include <utils/Range.h>
 
+#include <algorithm>
 #include <array>
+#include <vector>
 
 namespace utils {
 class JobSystem;
@@ -56,6 +58,14 @@ class FView : public View {
 public:
     using Range = utils::Range<uint32_t>;
 
+    // FScene::VISIBLE_MASK bit of the shadow casters of the first shadow cascade, the
+    // following cascades use the following bits.
+    static constexpr size_t VISIBLE_SHADOW_CASCADE_BIT = 2u;
+
+    // FScene::VISIBLE_MASK bit of the renderables drawn in an adaptive depth prepass, it's
+    // only valid after updateDepthPrepass().
+    static constexpr size_t VISIBLE_DEPTH_OCCLUDER_BIT = 6u;
+
     explicit FView(FEngine& engine);
     ~FView() noexcept;
 
@@ -130,9 +140,26 @@ public:
     bool hasDynamicLighting() const noexcept { return mHasDynamicLighting; }
     bool hasShadowing() const noexcept { return mHasShadowing & mDirectionalShadowMap.hasVisibleShadows(); }
 
+    // instances of the given renderable visible in this view, null if it never was
+    FRenderableManager::VisibleInstances const* getVisibleInstances(
+            FRenderableManager::Instance ri) const noexcept {
+        return size_t(ri) < mVisibleInstances.size() ? &mVisibleInstances[ri] : nullptr;
+    }
+
+    // Selects the level of detail of each renderable in visible from its size on screen,
+    // as seen from camera. The hysteresis is applied against the levels this view selected
+    // in its last color pass, which the color pass updates. The shadow pass uses coarser
+    // levels and must be given the view's camera.
     void updatePrimitivesLod(
             FEngine& engine, const CameraInfo& camera,
-            FScene::RenderableSoa& renderableData, Range visible) noexcept;
+            FScene::RenderableSoa& renderableData, Range visible, bool shadowPass) noexcept;
+
+    // With DepthPrepass::ADAPTIVE, decides whether the color pass of this frame uses a depth
+    // prepass, and flags the renderables in visible that are drawn in it. This must be called
+    // after updatePrimitivesLod(). Returns whether the depth prepass is used.
+    bool updateDepthPrepass(const CameraInfo& camera,
+            FScene::RenderableSoa& renderableData, Range visible,
+            Viewport const& viewport) noexcept;
 
     void setShadowsEnabled(bool enabled) noexcept { mShadowingEnabled = enabled; }
 
@@ -186,13 +213,28 @@ public:
 
     void setDynamicLightingOptions(float zLightNear, float zLightFar) noexcept;
 
+    void setAdaptiveFroxelGridEnabled(bool enabled) noexcept;
+
+    bool isAdaptiveFroxelGridEnabled() const noexcept {
+        return mFroxelizer.isAdaptiveGridEnabled();
+    }
+
+    void setLevelOfDetailOptions(LevelOfDetailOptions const& options) noexcept {
+        mLevelOfDetailOptions = options;
+        mLevelOfDetailOptions.hysteresis = std::max(0.0f, options.hysteresis);
+    }
+
+    LevelOfDetailOptions getLevelOfDetailOptions() const noexcept {
+        return mLevelOfDetailOptions;
+    }
+
     void setPostProcessingEnabled(bool enabled) noexcept {
         mHasPostProcessPass = enabled;
     }
 
     void setDepthPrepass(DepthPrepass prepass) noexcept {
 #ifdef __EMSCRIPTEN__
-        if (prepass == View::DepthPrepass::ENABLED) {
+        if (prepass == View::DepthPrepass::ENABLED || prepass == View::DepthPrepass::ADAPTIVE) {
             utils::slog.w << "WARNING: " <<
                 "Depth prepass cannot be enabled on web due to invariance requirements." <<
                 utils::io::endl;
@@ -221,17 +263,26 @@ private:
     static constexpr size_t MAX_FRAMETIME_HISTORY = 32u;
 
     void prepareVisibleRenderables(utils::JobSystem& js,
-            Frustum const& frustum, FScene::RenderableSoa& renderableData) const noexcept;
+            Frustum const& frustum, FScene::RenderableSoa& renderableData,
+            CullingBvh const& bvh) const noexcept;
 
     static void prepareVisibleShadowCasters(utils::JobSystem& js,
-            Frustum const& lightFrustum, FScene::RenderableSoa& renderableData) noexcept;
+            Frustum const& lightFrustum, FScene::RenderableSoa& renderableData,
+            CullingBvh const& bvh, size_t cascade) noexcept;
 
     static void prepareVisibleLights(
             FLightManager const& lcm, utils::JobSystem& js, Frustum const& frustum,
             FScene::LightSoa& lightData) noexcept;
 
     static void cullRenderables(utils::JobSystem& js,
-            FScene::RenderableSoa& renderableData, Frustum const& frustum, size_t bit) noexcept;
+            FScene::RenderableSoa& renderableData, CullingBvh const& bvh,
+            Frustum const& frustum, size_t bit) noexcept;
+
+    // culls the instances of the visible instanced renderables for the color and shadow passes,
+    // and uploads the visible ones to this view's UBOs. This sets the INSTANCES of the
+    // renderables in visible, the other ones are null.
+    void prepareInstances(FEngine& engine,
+            FScene::RenderableSoa& renderableData, Range visible) noexcept;
 
     void computeVisibilityMasks(
             uint8_t visibleLayers, uint8_t const* layers,
@@ -282,17 +333,20 @@ private:
     bool mShadowingEnabled = true;
     bool mHasPostProcessPass = true;
     DepthPrepass mDepthPrepass = DepthPrepass::DEFAULT;
+    bool mAdaptiveDepthPrepass = false;     // decision of the last updateDepthPrepass()
 
     using duration = std::chrono::duration<float, std::milli>;
     DynamicResolutionOptions mDynamicResolution;
     std::array<duration, MAX_FRAMETIME_HISTORY> mFrameTimeHistory;
     size_t mFrameTimeHistorySize = 0;
+    duration mLastFrameTime{};
 
     filament::math::float2 mScale = 1.0f;
     float mDynamicWorkloadScale = 1.0f;
     bool mIsDynamicResolutionSupported = false;
 
     RenderQuality mRenderQuality;
+    LevelOfDetailOptions mLevelOfDetailOptions;
 
     mutable UniformBuffer mPerViewUb;
     mutable SamplerBuffer mPerViewSb;
@@ -306,10 +360,24 @@ private:
     Range mVisibleRenderables;
     Range mVisibleShadowCasters;
     uint32_t mRenderableUBOSize = 0;
+    // version of the world transform stored in each slot of mRenderableUbh, 0 if undefined
+    std::vector<uint64_t> mRenderableUboVersions;
+    filament::math::mat4f mRenderableUboWorldOrigin;
     mutable bool mHasDirectionalLight = false;
     mutable bool mHasDynamicLighting = false;
     mutable bool mHasShadowing = false;
     mutable ShadowMap mDirectionalShadowMap;
+
+    // level selected by the last color pass for each renderable, indexed by its instance
+    std::vector<uint8_t> mRenderableLevels;
+
+    // instances visible in this view for each instanced renderable, indexed by its instance
+    std::vector<FRenderableManager::VisibleInstances> mVisibleInstances;
+
+    // scratch storage for prepareInstances()
+    std::vector<filament::math::float3> mInstanceCenters;
+    std::vector<filament::math::float3> mInstanceExtents;
+    std::vector<Culler::result_type> mInstanceVisibility;
 };
 
 FILAMENT_UPCAST(View)
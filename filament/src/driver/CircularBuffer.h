@@ -37,6 +37,11 @@ public:
     //      to set it to 3*requiredSize to avoid blocking the render thread (usually the UI thread).
     explicit CircularBuffer(size_t bufferSize);
 
+    // Creates a linear (non-circular) buffer writing into 'size' bytes of memory it doesn't own.
+    // This is used to record commands concurrently into a range reserved in another buffer,
+    // circularize() must not be called on such a buffer.
+    CircularBuffer(void* data, size_t size) noexcept;
+
     // can't be moved or copy-constructed
     CircularBuffer(CircularBuffer const& rhs) = delete;
     CircularBuffer(CircularBuffer&& rhs) noexcept = delete;
@@ -72,6 +77,7 @@ private:
     // pointer to the beginning of the circular buffer (constant)
     void* mData = nullptr;
     int mUsesAshmem = -1;
+    bool mOwnsData = true;
 
     // size of the circular buffer (constant)
     size_t mSize = 0;
@@ -23,10 +23,15 @@
 
 #include "driver/CommandStream.h"
 
+#include <algorithm>
+#include <chrono>
+
 using namespace utils;
 
 namespace filament {
 
+constexpr size_t CommandBufferQueue::SLICE_COUNT;
+
 CommandBufferQueue::CommandBufferQueue(size_t requiredSize, size_t bufferSize)
         : mRequiredSize((requiredSize + CircularBuffer::BLOCK_MASK) & ~CircularBuffer::BLOCK_MASK),
           mCircularBuffer(bufferSize),
@@ -35,13 +40,32 @@ CommandBufferQueue::CommandBufferQueue(size_t requiredSize, size_t bufferSize)
 }
 
 CommandBufferQueue::~CommandBufferQueue() {
-    assert(mCommandBuffersToExecute.empty());
+    assert(mSliceHead.load() == mSliceTail.load());
 }
 
-void CommandBufferQueue::requestExit() {
+template<typename Predicate>
+void CommandBufferQueue::wait(Predicate predicate) const noexcept {
+    // The waiter count is incremented before checking the predicate, and the state is changed
+    // before checking the waiter count in wakeUp() (all sequentially consistent), so either
+    // we see the new state, or wakeUp() sees us and notifies under the lock.
     std::unique_lock<utils::Mutex> lock(mLock);
-    mExitRequested = true;
-    mCondition.notify_one();
+    mWaiterCount.fetch_add(1);
+    mCondition.wait(lock, predicate);
+    mWaiterCount.fetch_sub(1);
+}
+
+void CommandBufferQueue::wakeUp() const noexcept {
+    if (UTILS_UNLIKELY(mWaiterCount.load())) {
+        // taking the lock guarantees the waiter is either not checking its predicate yet or
+        // already sleeping, so it can't miss the notification.
+        { std::lock_guard<utils::Mutex> lock(mLock); }
+        mCondition.notify_all();
+    }
+}
+
+void CommandBufferQueue::requestExit() {
+    mExitRequested.store(true);
+    wakeUp();
 }
 
 void CommandBufferQueue::flush() noexcept {
@@ -67,56 +91,88 @@ void CommandBufferQueue::flush() noexcept {
 
     circularBuffer.circularize();
 
-    std::unique_lock<utils::Mutex> lock(mLock);
-    mCommandBuffersToExecute.push_back({ tail, head });
-
     // circular buffer is too small, we corrupted the stream
-    assert(used <= mFreeSpace);
+    assert(used <= mFreeSpace.load());
+
+    using clock = std::chrono::steady_clock;
+    clock::time_point blockedStart{};
+    bool blocked = false;
+
+    // we're the only producer, so only the consumer can change mSliceTail under us
+    const uint32_t index = mSliceHead.load(std::memory_order_relaxed);
+    if (UTILS_UNLIKELY(index - mSliceTail.load() == SLICE_COUNT)) {
+        // all slices are in flight, this only happens if we're very far ahead of the consumer
+        SYSTRACE_NAME("waiting: CommandBufferQueue::flush() slices");
+        blocked = true;
+        blockedStart = clock::now();
+        wait([this, index]() { return index - mSliceTail.load() < SLICE_COUNT; });
+    }
 
-    // wait until there is enough space in the buffer
-    mFreeSpace -= used;
     const size_t requiredSize = mRequiredSize;
+    const size_t freeSpace = mFreeSpace.fetch_sub(used) - used;
+
+    // publish the slice
+    mSlices[index & SLICE_MASK] = { tail, head };
+    mSliceHead.store(index + 1);
+    wakeUp();
+
+    Stats& stats = mStats;
+    const size_t totalUsed = circularBuffer.size() - freeSpace;
+    stats.flushCount++;
+    stats.bytesSubmitted += used;
+    stats.highWatermark = std::max(stats.highWatermark, totalUsed);
 
 #ifndef NDEBUG
-    size_t totalUsed = circularBuffer.size() - mFreeSpace;
-    mHighWatermark = std::max(mHighWatermark, totalUsed);
     if (UTILS_UNLIKELY(totalUsed > requiredSize)) {
         slog.d << "CommandStream used too much space: " << totalUsed
             << ", out of " << requiredSize << " (will block)" << io::endl;
     }
 #endif
 
-    if (UTILS_LIKELY(mFreeSpace >= requiredSize)) {
-        // ideally (and usually) we don't have to wait, this is the common case, so special case
-        // the unlock-before-notify, optimization.
-        lock.unlock();
-        mCondition.notify_one();
-    } else {
+    if (UTILS_UNLIKELY(freeSpace < requiredSize)) {
         // unfortunately, there is not enough space left, we'll have to wait.
-        mCondition.notify_one(); // too bad there isn't a notify-and-wait
         SYSTRACE_NAME("waiting: CircularBuffer::flush()");
-        mCondition.wait(lock, [this, requiredSize]() -> bool {
-            return mFreeSpace >= requiredSize;
-        });
+        if (!blocked) {
+            blocked = true;
+            blockedStart = clock::now();
+        }
+        wait([this, requiredSize]() { return mFreeSpace.load() >= requiredSize; });
     }
-}
 
-std::vector<CommandBufferQueue::Slice> CommandBufferQueue::waitForCommands() const {
-    if (!UTILS_HAS_THREADING) {
-        return std::move(mCommandBuffersToExecute);
+    if (UTILS_UNLIKELY(blocked)) {
+        std::chrono::nanoseconds duration = clock::now() - blockedStart;
+        stats.blockedCount++;
+        stats.blockedTime += duration.count();
     }
-    std::unique_lock<utils::Mutex> lock(mLock);
-    while (mCommandBuffersToExecute.empty() && !mExitRequested) {
-        mCondition.wait(lock);
+}
+
+void CommandBufferQueue::endFrame() noexcept {
+    Stats& stats = mStats;
+    const size_t frameSize = size_t(stats.bytesSubmitted - mFrameStartBytes);
+    mFrameStartBytes = stats.bytesSubmitted;
+    stats.frameCount++;
+    stats.lastFrameSize = frameSize;
+    stats.maxFrameSize = std::max(stats.maxFrameSize, frameSize);
+}
+
+utils::Slice<CommandBufferQueue::Slice> CommandBufferQueue::waitForCommands() const {
+    // we're the only consumer, so only the producer can change mSliceHead under us
+    const uint32_t tail = mSliceTail.load(std::memory_order_relaxed);
+    if (UTILS_HAS_THREADING && mSliceHead.load() == tail) {
+        wait([this, tail]() { return mSliceHead.load() != tail || mExitRequested.load(); });
     }
-    return std::move(mCommandBuffersToExecute);
+    // return the slices up to the end of the ring, the others will be returned by the next call
+    const uint32_t head = mSliceHead.load();
+    const uint32_t first = tail & SLICE_MASK;
+    const uint32_t count = std::min(head - tail, uint32_t(SLICE_COUNT - first));
+    return { mSlices.data() + first, count };
 }
 
 void CommandBufferQueue::releaseBuffer(CommandBufferQueue::Slice const& buffer) {
-    std::unique_lock<utils::Mutex> lock(mLock);
-    mFreeSpace += uintptr_t(buffer.end) - uintptr_t(buffer.begin);
-    lock.unlock();
-    mCondition.notify_one();
+    assert(&buffer == &mSlices[mSliceTail.load(std::memory_order_relaxed) & SLICE_MASK]);
+    mFreeSpace.fetch_add(uintptr_t(buffer.end) - uintptr_t(buffer.begin));
+    mSliceTail.fetch_add(1);
+    wakeUp();
 }
 
 } // namespace filament
@@ -22,44 +22,59 @@
 #include <utils/compiler.h>
 #include <utils/Condition.h>
 #include <utils/Mutex.h>
+#include <utils/Slice.h>
 
-#include <vector>
+#include <array>
+#include <atomic>
+
+#include <stddef.h>
+#include <stdint.h>
 
 namespace filament {
 
 /*
- * A producer-consumer command queue that uses a CircularBuffer as main storage
+ * A producer-consumer command queue that uses a CircularBuffer as main storage.
+ *
+ * There is a single producer (the thread calling flush()) and a single consumer (the driver
+ * thread). Slices are passed through a fixed-size lock-free ring, so in the common case neither
+ * side takes a lock or allocates memory. A thread only sleeps on the condition when it can't
+ * make progress: the consumer when there are no commands, the producer when the circular
+ * buffer (or the ring) is full.
  */
 class CommandBufferQueue {
+public:
     struct Slice {
         void* begin;
         void* end;
     };
 
-    const size_t mRequiredSize;
-
-    CircularBuffer mCircularBuffer;
-
-    // space available in the circular buffer
+    // statistics used to size the circular buffer, only updated by the producer thread.
+    struct Stats {
+        uint64_t flushCount = 0;        // number of slices submitted by flush()
+        uint64_t bytesSubmitted = 0;    // total size of these slices
+        uint64_t blockedCount = 0;      // number of flush() that had to wait for the consumer
+        uint64_t blockedTime = 0;       // total time spent waiting in flush(), in nanoseconds
+        size_t highWatermark = 0;       // max space used in the circular buffer
+        uint64_t frameCount = 0;        // number of endFrame() calls
+        size_t lastFrameSize = 0;       // bytes submitted during the last frame
+        size_t maxFrameSize = 0;        // max bytes submitted during a frame
+    };
 
-    mutable utils::Mutex mLock;
-    mutable utils::Condition mCondition;
-    mutable std::vector<Slice> mCommandBuffersToExecute;
-    size_t mFreeSpace = 0;
-    size_t mHighWatermark = 0;
-    bool mExitRequested = false;
+    // max number of slices in flight, flush() blocks when they're all used
+    static constexpr size_t SLICE_COUNT = 256;
 
-public:
     // requiredSize: guaranteed available space after flush()
     CommandBufferQueue(size_t requiredSize, size_t bufferSize);
     ~CommandBufferQueue();
 
     CircularBuffer& getCircularBuffer() { return mCircularBuffer; }
 
-    size_t getHigWatermark() noexcept { return mHighWatermark; }
+    Stats const& getStats() const noexcept { return mStats; }
 
-    // wait for commands to be available and returns an array containing these commands
-    std::vector<Slice> waitForCommands() const;
+    // wait for commands to be available and returns an array containing these commands.
+    // The slices remain valid until they're released, the returned array is empty only
+    // if exit was requested.
+    utils::Slice<Slice> waitForCommands() const;
 
     // return the memory used by this command buffer to the circular buffer
     // WARNING: releaseBuffer() must be called in sequence of the Slices returned by
@@ -70,8 +85,44 @@ public:
     // call blocks until the CircularBuffer has at least mRequiredSize bytes available.
     void flush() noexcept;
 
+    // marks the end of a frame, for statistics.
+    void endFrame() noexcept;
+
     // returns from waitForCommands() immediately.
     void requestExit();
+
+private:
+    static constexpr uint32_t SLICE_MASK = SLICE_COUNT - 1;
+    static_assert((SLICE_COUNT & SLICE_MASK) == 0, "SLICE_COUNT must be a power of two");
+
+    // blocks the calling thread until predicate() is true
+    template<typename Predicate>
+    void wait(Predicate predicate) const noexcept;
+
+    // wakes up the other thread if it's blocked in wait()
+    void wakeUp() const noexcept;
+
+    const size_t mRequiredSize;
+
+    CircularBuffer mCircularBuffer;
+
+    // slices are written at mSliceHead by the producer and read at mSliceTail by the consumer
+    mutable std::array<Slice, SLICE_COUNT> mSlices;
+    std::atomic<uint32_t> mSliceHead = { 0 };
+    std::atomic<uint32_t> mSliceTail = { 0 };
+
+    // space available in the circular buffer
+    std::atomic<size_t> mFreeSpace = { 0 };
+
+    std::atomic<bool> mExitRequested = { false };
+
+    // only used by threads that need to sleep
+    mutable utils::Mutex mLock;
+    mutable utils::Condition mCondition;
+    mutable std::atomic<uint32_t> mWaiterCount = { 0 };
+
+    Stats mStats;
+    uint64_t mFrameStartBytes = 0;
 };
 
 } // namespace filament
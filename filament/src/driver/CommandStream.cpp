@@ -61,6 +61,16 @@ CommandStream::CommandStream(Driver& driver, CircularBuffer& buffer) noexcept
 {
 }
 
+CommandStream::CommandStream(CommandStream const& primary, CircularBuffer& buffer) noexcept
+        : mDispatcher(primary.mDispatcher),
+          mDriver(primary.mDriver),
+          mCurrentBuffer(&buffer)
+#ifndef NDEBUG
+          , mThreadId(std::this_thread::get_id())
+#endif
+{
+}
+
 void CommandStream::execute(void* buffer) {
     SYSTRACE_CALL();
 
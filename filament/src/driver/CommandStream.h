@@ -228,6 +228,11 @@ public:
     CommandStream() noexcept = default;
     CommandStream(Driver& driver, CircularBuffer& buffer) noexcept;
 
+    // Creates a secondary stream, recording commands for the same Driver as 'primary' into
+    // 'buffer'. This is typically used with a buffer covering space obtained with reserve(),
+    // so that several threads can record commands at once.
+    CommandStream(CommandStream const& primary, CircularBuffer& buffer) noexcept;
+
     // This is for debugging only. Currently CircularBuffer can only be written from a
     // single thread. In debug builds we assert this condition.
     // Call this first in the render loop.
@@ -252,6 +257,17 @@ public:
      */
     inline void* allocate(size_t size, size_t alignment = 8) noexcept;
 
+    /*
+     * Reserves 'size' bytes of commands in this stream, to be recorded later by a secondary
+     * CommandStream, possibly on another thread. The reserved space must be entirely filled
+     * with commands before this stream is flushed, and 'size' must be aligned with
+     * CommandBase::align().
+     */
+    inline void* reserve(size_t size) noexcept {
+        assert(size == CommandBase::align(size));
+        return allocateCommand(size);
+    }
+
     /*
      * Helper to allocate an array of trivially destructible objects
      */
@@ -122,7 +122,10 @@ void GPUBuffer::terminate(driver::DriverApi& driverApi) noexcept {
 void GPUBuffer::commitSlow(driver::DriverApi& driverApi, void const* begin, void const* end) noexcept {
     const uintptr_t sizeInBytes = uintptr_t(end) - uintptr_t(begin);
     assert(sizeInBytes <= mRowSizeInBytes * mHeight);
-    driverApi.update2DImage(mTexture, 0, 0, 0, mWidth, mHeight,
+    // only the rows covered by the data are updated
+    const uint32_t height = uint32_t(sizeInBytes / mRowSizeInBytes);
+    assert(height * mRowSizeInBytes == sizeInBytes);
+    driverApi.update2DImage(mTexture, 0, 0, 0, mWidth, height,
             { begin, sizeInBytes, mFormat, mType });
 }
 
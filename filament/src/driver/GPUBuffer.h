@@ -60,7 +60,8 @@ public:
 
     size_t getSize() const noexcept { return mSize; }
 
-    // source data isn't copied and must stay valid until the command-buffer is executed
+    // source data isn't copied and must stay valid until the command-buffer is executed.
+    // The data must be a whole number of rows, only these rows are updated.
     void commit(driver::DriverApi& driverApi, void const* begin, void const* end) noexcept {
         commitSlow(driverApi, begin, end);
     }
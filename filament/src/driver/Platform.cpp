@@ -71,6 +71,8 @@ namespace filament {
 namespace driver {
 
 // this generates the vtable in this translation unit
+BlobCache::~BlobCache() noexcept = default;
+
 Platform::~Platform() noexcept = default;
 
 OpenGLPlatform::~OpenGLPlatform() noexcept = default;
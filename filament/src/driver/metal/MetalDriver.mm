@@ -119,6 +119,10 @@ void MetalDriver::setPresentationTime(int64_t monotonic_clock_ns) {
 
 }
 
+void MetalDriver::setBlobCache(driver::BlobCache* cache) {
+
+}
+
 void MetalDriver::endFrame(uint32_t frameId) {
     // Release resources created during frame execution- like commandBuffer and currentDrawable.
     [pImpl->mFramePool drain];
@@ -424,7 +428,14 @@ bool MetalDriver::canGenerateMipmaps() {
 void MetalDriver::updateUniformBuffer(Driver::UniformBufferHandle ubh,
         Driver::BufferDescriptor&& data) {
     auto buffer = handle_cast<MetalUniformBuffer>(mHandleMap, ubh);
-    buffer->copyIntoBuffer(data.buffer, data.size);
+    buffer->copyIntoBuffer(data.buffer, 0, data.size);
+    scheduleDestroy(std::move(data));
+}
+
+void MetalDriver::updateUniformBufferRange(Driver::UniformBufferHandle ubh,
+        Driver::BufferDescriptor&& data, uint32_t byteOffset) {
+    auto buffer = handle_cast<MetalUniformBuffer>(mHandleMap, ubh);
+    buffer->copyIntoBuffer(data.buffer, byteOffset, data.size);
     scheduleDestroy(std::move(data));
 }
 
@@ -633,7 +644,8 @@ void MetalDriver::blit(Driver::TargetBufferFlags buffers,
         Driver::RenderTargetHandle src, driver::Viewport srcRect) {
 }
 
-void MetalDriver::draw(Driver::PipelineState ps, Driver::RenderPrimitiveHandle rph) {
+void MetalDriver::draw(Driver::PipelineState ps, Driver::RenderPrimitiveHandle rph,
+        uint32_t instanceCount) {
     ASSERT_PRECONDITION(pImpl->mCurrentCommandEncoder != nullptr,
             "Attempted to draw without a valid command encoder.");
     auto primitive = handle_cast<MetalRenderPrimitive>(mHandleMap, rph);
@@ -788,7 +800,8 @@ void MetalDriver::draw(Driver::PipelineState ps, Driver::RenderPrimitiveHandle r
                                               indexCount:primitive->count
                                                indexType:getIndexType(indexBuffer->elementSize)
                                              indexBuffer:indexBuffer->buffer
-                                       indexBufferOffset:primitive->offset];
+                                       indexBufferOffset:primitive->offset
+                                           instanceCount:instanceCount];
 }
 
 void MetalDriver::enumerateSamplerBuffers(const MetalProgram *program,
@@ -65,7 +65,7 @@ struct MetalUniformBuffer : public HwUniformBuffer {
     MetalUniformBuffer(id<MTLDevice> device, size_t size);
     ~MetalUniformBuffer();
 
-    void copyIntoBuffer(void* src, size_t size);
+    void copyIntoBuffer(void* src, size_t offset, size_t size);
 
     size_t size = 0;
 
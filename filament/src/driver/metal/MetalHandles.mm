@@ -139,13 +139,14 @@ MetalUniformBuffer::~MetalUniformBuffer() {
     }
 }
 
-void MetalUniformBuffer::copyIntoBuffer(void* src, size_t size) {
+void MetalUniformBuffer::copyIntoBuffer(void* src, size_t offset, size_t size) {
+    assert(offset + size <= this->size);
     // Either copy into the Metal buffer or into our cpu buffer.
     if (buffer) {
-        memcpy(buffer.contents, src, size);
+        memcpy(static_cast<uint8_t*>(buffer.contents) + offset, src, size);
     } else {
         assert(cpuBuffer);
-        memcpy(cpuBuffer, src, size);
+        memcpy(static_cast<uint8_t*>(cpuBuffer) + offset, src, size);
     }
 }
 
@@ -17,6 +17,7 @@
 #include "driver/opengl/OpenGLDriver.h"
 
 #include <set>
+#include <string>
 
 #include <utils/compiler.h>
 #include <utils/Log.h>
@@ -189,6 +190,20 @@ OpenGLDriver::OpenGLDriver(OpenGLPlatform* platform) noexcept
     };
     mShaderModel = shaderModel;
 
+#if !defined(__EMSCRIPTEN__)
+    // program binaries are only useful if the driver supports at least one format
+    GLint programBinaryFormatCount = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &programBinaryFormatCount);
+    features.program_binary = programBinaryFormatCount > 0;
+#endif
+
+    // a program binary can only be used with the same GL implementation
+    std::string programBinaryKeyPrefix;
+    programBinaryKeyPrefix.append(vendor).append(1, '\0');
+    programBinaryKeyPrefix.append(renderer).append(1, '\0');
+    programBinaryKeyPrefix.append(version).append(1, '\0');
+    mProgramBinaryKeyPrefix = CString(programBinaryKeyPrefix.data(), programBinaryKeyPrefix.size());
+
     /*
      * Set our default state
      */
@@ -1654,6 +1669,24 @@ void OpenGLDriver::updateUniformBuffer(Driver::UniformBufferHandle ubh, BufferDe
     scheduleDestroy(std::move(p));
 }
 
+void OpenGLDriver::updateUniformBufferRange(Driver::UniformBufferHandle ubh,
+        BufferDescriptor&& p, uint32_t byteOffset) {
+    DEBUG_MARKER()
+
+    GLUniformBuffer* ub = handle_cast<GLUniformBuffer *>(ubh);
+    assert(ub);
+    assert(ub->gl.ubo.usage != driver::BufferUsage::STREAM);
+    assert(byteOffset + p.size <= ub->gl.ubo.capacity);
+
+    if (p.size > 0) {
+        bindBuffer(GL_UNIFORM_BUFFER, ub->gl.ubo.id);
+        glBufferSubData(GL_UNIFORM_BUFFER, byteOffset, p.size, p.buffer);
+        ub->gl.ubo.size = std::max(ub->gl.ubo.size, uint32_t(byteOffset + p.size));
+        CHECK_GL_ERROR(utils::slog.e)
+    }
+    scheduleDestroy(std::move(p));
+}
+
 void OpenGLDriver::updateBuffer(GLenum target,
         GLBuffer* buffer, BufferDescriptor const& p, uint32_t alignment) noexcept {
     assert(buffer->capacity >= p.size);
@@ -2627,6 +2660,10 @@ void OpenGLDriver::setPresentationTime(int64_t monotonic_clock_ns) {
     mPlatform.setPresentationTime(monotonic_clock_ns);
 }
 
+void OpenGLDriver::setBlobCache(driver::BlobCache* cache) {
+    mBlobCache = cache;
+}
+
 void OpenGLDriver::endFrame(uint32_t frameId) {
     //SYSTRACE_NAME("glFinish");
     //glFinish();
@@ -2775,7 +2812,8 @@ void OpenGLDriver::blit(TargetBufferFlags buffers,
 
 void OpenGLDriver::draw(
         Driver::PipelineState state,
-        Driver::RenderPrimitiveHandle rph) {
+        Driver::RenderPrimitiveHandle rph,
+        uint32_t instanceCount) {
     DEBUG_MARKER()
 
     OpenGLProgram* p = handle_cast<OpenGLProgram*>(state.program);
@@ -2788,8 +2826,14 @@ void OpenGLDriver::draw(
 
     polygonOffset(state.polygonOffset.slope, state.polygonOffset.constant);
 
-    glDrawRangeElements(GLenum(rp->type), rp->minIndex, rp->maxIndex, rp->count,
-            rp->gl.indicesType, reinterpret_cast<const void*>(rp->offset));
+    if (UTILS_LIKELY(instanceCount <= 1)) {
+        glDrawRangeElements(GLenum(rp->type), rp->minIndex, rp->maxIndex, rp->count,
+                rp->gl.indicesType, reinterpret_cast<const void*>(rp->offset));
+    } else {
+        glDrawElementsInstanced(GLenum(rp->type), rp->count,
+                rp->gl.indicesType, reinterpret_cast<const void*>(rp->offset),
+                GLsizei(instanceCount));
+    }
 
     CHECK_GL_ERROR(utils::slog.e)
 }
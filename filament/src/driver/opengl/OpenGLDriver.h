@@ -184,6 +184,16 @@ public:
 
     void useProgram(GLuint program) noexcept;
 
+    // storage for program binaries, null if there is none or if they're not supported
+    driver::BlobCache* getProgramBinaryCache() const noexcept {
+        return features.program_binary ? mBlobCache : nullptr;
+    }
+
+    // identifies this GL implementation in the program binaries keys
+    utils::CString const& getProgramBinaryKeyPrefix() const noexcept {
+        return mProgramBinaryKeyPrefix;
+    }
+
     OpenGLDriver(OpenGLDriver const&) = delete;
     OpenGLDriver& operator=(OpenGLDriver const&) = delete;
 
@@ -522,6 +532,7 @@ private:
     // features supported by this version of GL or GLES
     struct {
         bool multisample_texture = false;
+        bool program_binary = false;
     } features;
 
     // supported extensions detected at runtime
@@ -567,6 +578,9 @@ private:
 
     driver::OpenGLPlatform& mPlatform;
 
+    driver::BlobCache* mBlobCache = nullptr;
+    utils::CString mProgramBinaryKeyPrefix;
+
     OpenGLBlitter* mOpenGLBlitter = nullptr;
     void updateStream(GLTexture* t, driver::DriverApi* driver) noexcept;
     void updateBuffer(GLenum target, GLBuffer* buffer, BufferDescriptor const& p, uint32_t alignment = 16) noexcept;
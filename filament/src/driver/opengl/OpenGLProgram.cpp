@@ -18,12 +18,16 @@
 
 #include <cctype>
 #include <sstream>
+#include <vector>
+
+#include <string.h>
 
 #include <utils/Log.h>
 #include <utils/compiler.h>
 #include <utils/Panic.h>
 
 #include "driver/opengl/OpenGLDriver.h"
+#include "driver/opengl/OpenGLProgramBinary.h"
 
 namespace filament {
 
@@ -41,6 +45,41 @@ static char* copy_n(char const* s, size_t n, char* d) noexcept {
     return d;
 }
 
+// Returns a linked program created from a binary, or 0 if the binary is rejected.
+static GLuint loadProgramBinary(uint32_t format, void const* binary, size_t size) noexcept {
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, format, binary, GLsizei(size));
+
+    // this fails if the driver changed since the binary was stored, we just recompile then
+    GLint status;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if (UTILS_UNLIKELY(status != GL_TRUE)) {
+        glDeleteProgram(program);
+        // make sure we don't leave an error behind, e.g.: the format isn't supported anymore
+        while (glGetError() != GL_NO_ERROR) { }
+        return 0;
+    }
+    return program;
+}
+
+static bool saveProgramBinary(GLuint program,
+        uint32_t* format, std::vector<uint8_t>* binary) noexcept {
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return false;
+    }
+    GLenum binaryFormat = 0;
+    binary->resize(size_t(length));
+    glGetProgramBinary(program, length, &length, &binaryFormat, binary->data());
+    if (length <= 0) {
+        return false;
+    }
+    binary->resize(size_t(length));
+    *format = binaryFormat;
+    return true;
+}
+
 OpenGLProgram::OpenGLProgram(OpenGLDriver* gl, const Program& programBuilder) noexcept
         :  HwProgram(programBuilder.getName()), mIsValid(false) {
 
@@ -48,61 +87,84 @@ OpenGLProgram::OpenGLProgram(OpenGLDriver* gl, const Program& programBuilder) no
 
     const auto& shadersSource = programBuilder.getShadersSource();
 
-    // build all shaders
-    #pragma nounroll
-    for (size_t i = 0; i < Program::NUM_SHADER_TYPES; i++) {
-        GLenum glShaderType;
-        Shader type = (Shader)i;
-        switch (type) {
-            case Shader::VERTEX:
-                glShaderType = GL_VERTEX_SHADER;
-                break;
-            case Shader::FRAGMENT:
-                glShaderType = GL_FRAGMENT_SHADER;
-                break;
-        }
+    // the program is created from its cached binary if there is one, from source otherwise
+    driver::BlobCache* const cache = gl->getProgramBinaryCache();
+    bool failed = false;
 
-        if (shadersSource[i].length()) {
-            GLint status;
-            char const* const source = shadersSource[i].c_str();
+    auto compile = [&]() -> GLuint {
+        // build all shaders
+        #pragma nounroll
+        for (size_t i = 0; i < Program::NUM_SHADER_TYPES; i++) {
+            GLenum glShaderType;
+            Shader type = (Shader)i;
+            switch (type) {
+                case Shader::VERTEX:
+                    glShaderType = GL_VERTEX_SHADER;
+                    break;
+                case Shader::FRAGMENT:
+                    glShaderType = GL_FRAGMENT_SHADER;
+                    break;
+            }
 
-            GLuint shaderId = glCreateShader(glShaderType);
-            glShaderSource(shaderId, 1, &source, nullptr);
-            glCompileShader(shaderId);
+            if (shadersSource[i].length()) {
+                GLint status;
+                char const* const source = shadersSource[i].c_str();
 
-            glGetShaderiv(shaderId, GL_COMPILE_STATUS, &status);
-            if (UTILS_UNLIKELY(status != GL_TRUE)) {
-                logCompilationError(slog.e, shaderId, source);
-                glDeleteShader(shaderId);
-                return;
+                GLuint shaderId = glCreateShader(glShaderType);
+                glShaderSource(shaderId, 1, &source, nullptr);
+                glCompileShader(shaderId);
+
+                glGetShaderiv(shaderId, GL_COMPILE_STATUS, &status);
+                if (UTILS_UNLIKELY(status != GL_TRUE)) {
+                    logCompilationError(slog.e, shaderId, source);
+                    glDeleteShader(shaderId);
+                    failed = true;
+                    return 0;
+                }
+                this->gl.shaders[i] = shaderId;
+                mValidShaderSet |= 1U << i;
             }
-            this->gl.shaders[i] = shaderId;
-            mValidShaderSet |= 1U << i;
         }
-    }
 
-    // we need at least a vertex and fragment program
-    const uint8_t validShaderSet = mValidShaderSet;
-    const uint8_t mask = VERTEX_SHADER_BIT | FRAGMENT_SHADER_BIT;
-    if (UTILS_LIKELY((mValidShaderSet & mask) == mask)) {
-        GLint status;
-        GLuint program = glCreateProgram();
-        for (size_t i = 0; i < Program::NUM_SHADER_TYPES; i++) {
-            if (validShaderSet & (1U << i)) {
-                glAttachShader(program, this->gl.shaders[i]);
+        // we need at least a vertex and fragment program
+        GLuint program = 0;
+        const uint8_t validShaderSet = mValidShaderSet;
+        const uint8_t mask = VERTEX_SHADER_BIT | FRAGMENT_SHADER_BIT;
+        if (UTILS_LIKELY((mValidShaderSet & mask) == mask)) {
+            GLint status;
+            program = glCreateProgram();
+            for (size_t i = 0; i < Program::NUM_SHADER_TYPES; i++) {
+                if (validShaderSet & (1U << i)) {
+                    glAttachShader(program, this->gl.shaders[i]);
+                }
             }
-        }
-        glLinkProgram(program);
+            if (cache) {
+                glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+            }
+            glLinkProgram(program);
 
-        glGetProgramiv(program, GL_LINK_STATUS, &status);
-        if (UTILS_UNLIKELY(status != GL_TRUE)) {
-            char error[512];
-            glGetProgramInfoLog(program, sizeof(error), nullptr, error);
+            glGetProgramiv(program, GL_LINK_STATUS, &status);
+            if (UTILS_UNLIKELY(status != GL_TRUE)) {
+                char error[512];
+                glGetProgramInfoLog(program, sizeof(error), nullptr, error);
 
-            slog.e << "LINKING: " << error << io::endl;
-            glDeleteProgram(program);
-            return;
+                slog.e << "LINKING: " << error << io::endl;
+                glDeleteProgram(program);
+                failed = true;
+                return 0;
+            }
         }
+        return program;
+    };
+
+    GLuint program = OpenGLProgramBinary::createProgram(cache,
+            gl->getProgramBinaryKeyPrefix(), shadersSource,
+            loadProgramBinary, compile, saveProgramBinary);
+    if (UTILS_UNLIKELY(failed)) {
+        return;
+    }
+
+    if (UTILS_LIKELY(program)) {
         this->gl.program = program;
 
         // Associate each UniformBlock in the program to a known binding.
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "driver/opengl/OpenGLProgramBinary.h"
+
+#include <string.h>
+
+namespace filament {
+namespace OpenGLProgramBinary {
+
+// 64-bits FNV-1a
+static uint64_t hash(uint64_t h, void const* data, size_t size) noexcept {
+    uint8_t const* p = static_cast<uint8_t const*>(data);
+    for (size_t i = 0; i < size; i++) {
+        h = (h ^ p[i]) * 0x100000001b3ull;
+    }
+    return h;
+}
+
+static constexpr uint64_t HASH_SEED = 0xcbf29ce484222325ull;
+
+// The blob is this header followed by the binary. The hash of the key guards against a cache
+// returning the value of another key.
+struct Header {
+    uint64_t keyHash;
+    uint32_t format;
+    uint32_t size;
+};
+
+std::vector<uint8_t> makeKey(utils::CString const& prefix,
+        ShadersSource const& shadersSource) noexcept {
+    // a hash of all the sources, the sizes are part of the key as well
+    uint64_t h = HASH_SEED;
+    uint32_t sizes[Program::NUM_SHADER_TYPES];
+    for (size_t i = 0; i < Program::NUM_SHADER_TYPES; i++) {
+        sizes[i] = shadersSource[i].size();
+        h = hash(h, shadersSource[i].c_str(), shadersSource[i].size());
+    }
+    std::vector<uint8_t> key(prefix.size() + sizeof(h) + sizeof(sizes));
+    memcpy(key.data(), prefix.c_str(), prefix.size());
+    memcpy(key.data() + prefix.size(), &h, sizeof(h));
+    memcpy(key.data() + prefix.size() + sizeof(h), sizes, sizeof(sizes));
+    return key;
+}
+
+bool retrieve(driver::BlobCache& cache, std::vector<uint8_t> const& key,
+        uint32_t* format, std::vector<uint8_t>* binary) noexcept {
+    size_t size = cache.retrieve(key.data(), key.size(), nullptr, 0);
+    if (size <= sizeof(Header)) {
+        return false;
+    }
+    std::vector<uint8_t> blob(size);
+    if (cache.retrieve(key.data(), key.size(), blob.data(), blob.size()) != size) {
+        return false;
+    }
+    Header header;
+    memcpy(&header, blob.data(), sizeof(header));
+    if (header.keyHash != hash(HASH_SEED, key.data(), key.size()) ||
+        header.size != size - sizeof(header)) {
+        return false;
+    }
+    *format = header.format;
+    binary->assign(blob.begin() + sizeof(header), blob.end());
+    return true;
+}
+
+void store(driver::BlobCache& cache, std::vector<uint8_t> const& key,
+        uint32_t format, void const* binary, size_t size) noexcept {
+    if (size == 0 || size > UINT32_MAX) {
+        return;
+    }
+    Header header{ hash(HASH_SEED, key.data(), key.size()), format, uint32_t(size) };
+    std::vector<uint8_t> blob(sizeof(header) + size);
+    memcpy(blob.data(), &header, sizeof(header));
+    memcpy(blob.data() + sizeof(header), binary, size);
+    cache.insert(key.data(), key.size(), blob.data(), blob.size());
+}
+
+} // namespace OpenGLProgramBinary
+} // namespace filament
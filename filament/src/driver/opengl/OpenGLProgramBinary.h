@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_DRIVER_OPENGLPROGRAMBINARY_H
+#define TNT_FILAMENT_DRIVER_OPENGLPROGRAMBINARY_H
+
+#include <filament/driver/Platform.h>
+
+#include <utils/CString.h>
+
+#include "driver/Program.h"
+
+#include <array>
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace filament {
+
+/*
+ * Program binaries stored in the application's driver::BlobCache by OpenGLProgram.
+ * Nothing here calls GL, creating a program from a binary or from source is left to the caller.
+ */
+namespace OpenGLProgramBinary {
+
+using ShadersSource = std::array<utils::CString, Program::NUM_SHADER_TYPES>;
+
+// The key identifies the GL implementation with prefix, and the program with its sources,
+// which already depend on the material and the variant.
+std::vector<uint8_t> makeKey(utils::CString const& prefix,
+        ShadersSource const& shadersSource) noexcept;
+
+// Retrieves the binary stored for key with store(). Returns false if there is none, or if the
+// cache returned something truncated or stored for another key.
+bool retrieve(driver::BlobCache& cache, std::vector<uint8_t> const& key,
+        uint32_t* format, std::vector<uint8_t>* binary) noexcept;
+
+void store(driver::BlobCache& cache, std::vector<uint8_t> const& key,
+        uint32_t format, void const* binary, size_t size) noexcept;
+
+/*
+ * Returns the program created from the binary stored in cache, or if there is no usable binary,
+ * the program compiled from source, whose binary is then stored in cache.
+ *
+ *  load(uint32_t format, void const* binary, size_t size) returns a program, or 0 if the
+ *      binary is rejected, for instance because the driver changed since it was stored.
+ *  compile() returns a program compiled from source, or 0.
+ *  save(uint32_t program, uint32_t* format, std::vector<uint8_t>* binary) returns false if the
+ *      program has no binary.
+ */
+template<typename Load, typename Compile, typename Save>
+uint32_t createProgram(driver::BlobCache* cache, utils::CString const& prefix,
+        ShadersSource const& shadersSource, Load load, Compile compile, Save save) {
+    std::vector<uint8_t> key;
+    uint32_t format = 0;
+    std::vector<uint8_t> binary;
+    uint32_t program = 0;
+    if (cache) {
+        key = makeKey(prefix, shadersSource);
+        if (retrieve(*cache, key, &format, &binary)) {
+            program = load(format, binary.data(), binary.size());
+        }
+    }
+    if (!program) {
+        program = compile();
+        if (program && cache && save(program, &format, &binary)) {
+            store(*cache, key, format, binary.data(), binary.size());
+        }
+    }
+    return program;
+}
+
+} // namespace OpenGLProgramBinary
+} // namespace filament
+
+#endif // TNT_FILAMENT_DRIVER_OPENGLPROGRAMBINARY_H
@@ -114,6 +114,9 @@ public:
     ~VulkanBinder();
     void setDevice(VkDevice device) { mDevice = device; }
 
+    // Pipelines are created through this cache, which is owned by the client. It can be null.
+    void setPipelineCache(VkPipelineCache cache) { mPipelineCache = cache; }
+
     // Clients should initialize their copy of the raster state using this method. They can then
     // mutate their copy and pass it back through bindRasterState().
     const RasterState& getDefaultRasterState() const { return mDefaultRasterState; }
@@ -242,6 +245,7 @@ private:
     void evictDescriptors(std::function<bool(const DescriptorKey&)> filter) noexcept;
 
     VkDevice mDevice = nullptr;
+    VkPipelineCache mPipelineCache = VK_NULL_HANDLE;
     const RasterState mDefaultRasterState;
 
     // Info structs used only in a transient way but they are stored for convenience.
@@ -157,6 +157,17 @@ VulkanDriver::VulkanDriver(VulkanPlatform* platform,
     createVirtualDevice(mContext);
     mBinder.setDevice(mContext.device);
 
+    // All pipelines go through a pipeline cache, which makes creating them again much cheaper,
+    // it's initially empty and populated by setBlobCache().
+    VkPipelineCacheCreateInfo pipelineCacheInfo = {};
+    pipelineCacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    result = vkCreatePipelineCache(mContext.device, &pipelineCacheInfo, VKALLOC, &mPipelineCache);
+    if (result != VK_SUCCESS) {
+        utils::slog.w << "Unable to create Vulkan pipeline cache." << utils::io::endl;
+        mPipelineCache = VK_NULL_HANDLE;
+    }
+    mBinder.setPipelineCache(mPipelineCache);
+
     // Choose a depth format that meets our requirements. Take care not to include stencil formats
     // just yet, since that would require a corollary change to the "aspect" flags for the VkImage.
     mContext.depthFormat = findSupportedFormat(mContext,
@@ -188,6 +199,11 @@ void VulkanDriver::terminate() {
     }
     waitForIdle(mContext);
     mBinder.destroyCache();
+    savePipelineCache();
+    if (mPipelineCache) {
+        vkDestroyPipelineCache(mContext.device, mPipelineCache, VKALLOC);
+        mPipelineCache = VK_NULL_HANDLE;
+    }
     mStagePool.reset();
     mFramebufferCache.reset();
     mSamplerCache.reset();
@@ -240,6 +256,80 @@ void VulkanDriver::beginFrame(int64_t monotonic_clock_ns, uint32_t frameId) {
 void VulkanDriver::setPresentationTime(int64_t monotonic_clock_ns) {
 }
 
+void VulkanDriver::setBlobCache(driver::BlobCache* cache) {
+    // the pipelines created so far are saved to the previous cache, calling this again with the
+    // same cache is therefore a way to save the pipeline cache.
+    savePipelineCache();
+    if (cache != mBlobCache) {
+        mBlobCache = cache;
+        loadPipelineCache();
+    }
+}
+
+std::vector<uint8_t> VulkanDriver::getPipelineCacheKey() const noexcept {
+    // The pipeline cache data has a header that identifies the device and driver, and which is
+    // checked by vkCreatePipelineCache(). The key only needs to tell apart the devices.
+    static constexpr char PREFIX[] = "filament-vulkan-pipeline-cache";
+    const VkPhysicalDeviceProperties& properties = mContext.physicalDeviceProperties;
+    std::vector<uint8_t> key(sizeof(PREFIX) + sizeof(properties.pipelineCacheUUID) + 2 * 4);
+    uint8_t* p = key.data();
+    memcpy(p, PREFIX, sizeof(PREFIX));
+    p += sizeof(PREFIX);
+    memcpy(p, properties.pipelineCacheUUID, sizeof(properties.pipelineCacheUUID));
+    p += sizeof(properties.pipelineCacheUUID);
+    memcpy(p, &properties.vendorID, 4);
+    memcpy(p + 4, &properties.deviceID, 4);
+    return key;
+}
+
+void VulkanDriver::loadPipelineCache() noexcept {
+    if (!mBlobCache || !mPipelineCache) {
+        return;
+    }
+    const std::vector<uint8_t> key = getPipelineCacheKey();
+    size_t size = mBlobCache->retrieve(key.data(), key.size(), nullptr, 0);
+    if (size == 0) {
+        return;
+    }
+    std::vector<uint8_t> data(size);
+    if (mBlobCache->retrieve(key.data(), key.size(), data.data(), data.size()) != size) {
+        return;
+    }
+
+    // Data written by another driver or device is ignored by vkCreatePipelineCache(), the
+    // resulting cache is simply empty. It's merged into ours, which may already be in use.
+    VkPipelineCacheCreateInfo pipelineCacheInfo = {};
+    pipelineCacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    pipelineCacheInfo.initialDataSize = size;
+    pipelineCacheInfo.pInitialData = data.data();
+    VkPipelineCache loaded;
+    VkResult result = vkCreatePipelineCache(mContext.device, &pipelineCacheInfo, VKALLOC,
+            &loaded);
+    if (result != VK_SUCCESS) {
+        return;
+    }
+    vkMergePipelineCaches(mContext.device, mPipelineCache, 1, &loaded);
+    vkDestroyPipelineCache(mContext.device, loaded, VKALLOC);
+}
+
+void VulkanDriver::savePipelineCache() noexcept {
+    if (!mBlobCache || !mPipelineCache) {
+        return;
+    }
+    size_t size = 0;
+    VkResult result = vkGetPipelineCacheData(mContext.device, mPipelineCache, &size, nullptr);
+    if (result != VK_SUCCESS || size == 0) {
+        return;
+    }
+    std::vector<uint8_t> data(size);
+    result = vkGetPipelineCacheData(mContext.device, mPipelineCache, &size, data.data());
+    if (result != VK_SUCCESS) {
+        return;
+    }
+    const std::vector<uint8_t> key = getPipelineCacheKey();
+    mBlobCache->insert(key.data(), key.size(), data.data(), size);
+}
+
 void VulkanDriver::endFrame(uint32_t frameId) {
     // Do nothing here; see commit().
 }
@@ -565,7 +655,16 @@ bool VulkanDriver::canGenerateMipmaps() {
 void VulkanDriver::updateUniformBuffer(Driver::UniformBufferHandle ubh, BufferDescriptor&& data) {
     if (data.size > 0) {
         auto* buffer = handle_cast<VulkanUniformBuffer>(mHandleMap, ubh);
-        buffer->loadFromCpu(data.buffer, (uint32_t) data.size);
+        buffer->loadFromCpu(data.buffer, 0, (uint32_t) data.size);
+        scheduleDestroy(std::move(data));
+    }
+}
+
+void VulkanDriver::updateUniformBufferRange(Driver::UniformBufferHandle ubh,
+        BufferDescriptor&& data, uint32_t byteOffset) {
+    if (data.size > 0) {
+        auto* buffer = handle_cast<VulkanUniformBuffer>(mHandleMap, ubh);
+        buffer->loadFromCpu(data.buffer, byteOffset, (uint32_t) data.size);
         scheduleDestroy(std::move(data));
     }
 }
@@ -882,7 +981,8 @@ void VulkanDriver::blit(TargetBufferFlags buffers,
     }
 }
 
-void VulkanDriver::draw(Driver::PipelineState pipelineState, Driver::RenderPrimitiveHandle rph) {
+void VulkanDriver::draw(Driver::PipelineState pipelineState, Driver::RenderPrimitiveHandle rph,
+        uint32_t instanceCount) {
     VkCommandBuffer cmdbuffer = mContext.cmdbuffer;
     ASSERT_POSTCONDITION(cmdbuffer, "Draw calls can occur only within a beginFrame / endFrame.");
     const VulkanRenderPrimitive& prim = *handle_cast<VulkanRenderPrimitive>(mHandleMap, rph);
@@ -1005,10 +1105,10 @@ void VulkanDriver::draw(Driver::PipelineState pipelineState, Driver::RenderPrimi
 
     // Finally, make the actual draw call. TODO: support subranges
     const uint32_t indexCount = prim.count;
-    const uint32_t instanceCount = 1;
     const uint32_t firstIndex = prim.offset / prim.indexBuffer->elementSize;
     const int32_t vertexOffset = 0;
-    const uint32_t firstInstId = 1;
+    // gl_InstanceIndex includes the first instance, instanced shaders expect it to start at 0
+    const uint32_t firstInstId = 0;
     vkCmdDrawIndexed(cmdbuffer, indexCount, instanceCount, firstIndex, vertexOffset, firstInstId);
 }
 
@@ -1016,6 +1116,7 @@ void VulkanDriver::draw(Driver::PipelineState pipelineState, Driver::RenderPrimi
 void VulkanDriver::debugCommand(const char* methodName) {
     static const std::set<utils::StaticString> OUTSIDE_COMMANDS = {
         "updateUniformBuffer",
+        "updateUniformBufferRange",
         "updateVertexBuffer",
         "updateIndexBuffer",
         "update2DImage",
@@ -146,6 +146,13 @@ private:
     VulkanRenderTarget* mCurrentRenderTarget = nullptr;
     VulkanSamplerBuffer* mSamplerBindings[VulkanBinder::NUM_SAMPLER_BINDINGS] = {};
     VkDebugReportCallbackEXT mDebugCallback = VK_NULL_HANDLE;
+
+    // The pipeline cache is loaded from, and saved to, the blob cache set by the client.
+    void loadPipelineCache() noexcept;
+    void savePipelineCache() noexcept;
+    std::vector<uint8_t> getPipelineCacheKey() const noexcept;
+    VkPipelineCache mPipelineCache = VK_NULL_HANDLE;
+    BlobCache* mBlobCache = nullptr;
 };
 
 } // namespace driver
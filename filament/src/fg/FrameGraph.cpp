@@ -17,6 +17,7 @@
 #include "FrameGraph.h"
 
 #include "FrameGraphPassResources.h"
+#include "FrameGraphTexturePool.h"
 
 #include "driver/Driver.h"
 #include "driver/Handle.h"
@@ -79,6 +80,12 @@ struct Resource final : public VirtualResource { // 72
     void create(FrameGraph& fg, DriverApi& driver) noexcept override;
     void destroy(FrameGraph& fg, DriverApi& driver) noexcept override;
 
+    // what identifies a compatible texture in FrameGraphTexturePool
+    FrameGraphTexturePool::Key getTextureKey() const noexcept {
+        return { desc.type, desc.levels, desc.format, desc.samples,
+                 desc.width, desc.height, desc.depth, usage };
+    }
+
     // constants
     const char* const name;
     const uint16_t id;            // for debugging and graphing
@@ -438,23 +445,32 @@ Resource::~Resource() noexcept {
     }
 }
 
-void Resource::create(FrameGraph&, DriverApi& driver) noexcept {
+void Resource::create(FrameGraph& fg, DriverApi& driver) noexcept {
     // some sanity check
     if (!imported) {
         if (needsTexture) {
             assert(usage);
             // (it means it's only used as an attachment for a rendertarget)
-            texture = driver.createTexture(desc.type, desc.levels, desc.format, 1,
-                    desc.width, desc.height, desc.depth, usage);
+            if (fg.mTexturePool) {
+                texture = fg.mTexturePool->get(driver, getTextureKey());
+            } else {
+                texture = driver.createTexture(desc.type, desc.levels, desc.format, desc.samples,
+                        desc.width, desc.height, desc.depth, usage);
+            }
         }
     }
 }
 
-void Resource::destroy(FrameGraph&, DriverApi& driver) noexcept {
+void Resource::destroy(FrameGraph& fg, DriverApi& driver) noexcept {
     // we don't own the handles of imported resources
     if (!imported) {
         if (texture) {
-            driver.destroyTexture(texture);
+            if (fg.mTexturePool) {
+                // this makes the texture available to the passes executed after this one
+                fg.mTexturePool->put(texture, getTextureKey());
+            } else {
+                driver.destroyTexture(texture);
+            }
             texture.clear(); // needed because of noop driver
         }
     }
@@ -523,9 +539,11 @@ FrameGraph::Builder::Attachments FrameGraph::Builder::useRenderTarget(
     ResourceNode& resourceNode = mFrameGraph.getResource(texture);
     Resource* pResource = resourceNode.resource;
     assert(pResource);
+    // the viewport covers the resource as declared, i.e. before its size is rounded up
     FrameGraphRenderTarget::Descriptor desc {
         .attachments.color = texture,
-        .samples = 1
+        .viewport = { 0, 0, pResource->desc.width, pResource->desc.height },
+        .samples = pResource->desc.samples
     };
     return useRenderTarget(pResource->name, desc, clearFlags);
 }
@@ -621,6 +639,11 @@ FrameGraphResource::Descriptor const& FrameGraphPassResources::getDescriptor(
 
 // ------------------------------------------------------------------------------------------------
 
+FrameGraph::FrameGraph(FrameGraphTexturePool& texturePool)
+        : FrameGraph() {
+    mTexturePool = &texturePool;
+}
+
 FrameGraph::FrameGraph()
         : mArena("FrameGraph Arena", 16384), // TODO: the Area will eventually come from outside
           mPassNodes(mArena),
@@ -753,6 +776,8 @@ FrameGraphResource FrameGraph::importResource(const char* name,
     RenderTargetResource* pRenderTargetResource = mArena.make<RenderTargetResource>(descriptor, true,
             TargetBufferFlags::COLOR, width, height, TextureFormat{});
     pRenderTargetResource->targetInfo.target = target;
+    pRenderTargetResource->targetInfo.params.flags.discardStart = discardStart;
+    pRenderTargetResource->targetInfo.params.flags.discardEnd = discardEnd;
     mRenderTargetCache.emplace_back(pRenderTargetResource, *this);
 
     // NOTE: we don't even need to create a fg::RenderTarget, all is needed is a cache entry
@@ -809,13 +834,14 @@ uint8_t FrameGraph::computeDiscardFlags(DiscardPhase phase,
         discardFlags |= (renderTarget.userTargetFlags.clear & TargetBufferFlags::ALL);
     }
 
-    if (renderTarget.imported) {
-        // we never discard more than the user flags
+    if (renderTarget.cache->imported) {
+        // we never discard more than the user flags (set in importResource())
+        auto const& userFlags = renderTarget.cache->targetInfo.params.flags;
         if (phase == DiscardPhase::START) {
-            discardFlags &= renderTarget.userTargetFlags.discardStart;
+            discardFlags &= userFlags.discardStart;
         }
         if (phase == DiscardPhase::END) {
-            discardFlags &= renderTarget.userTargetFlags.discardEnd;
+            discardFlags &= userFlags.discardEnd;
         }
     }
 
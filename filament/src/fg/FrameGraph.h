@@ -52,6 +52,7 @@ struct Alias;
 } // namespace fg
 
 class FrameGraphPassResources;
+class FrameGraphTexturePool;
 
 class FrameGraph {
 public:
@@ -106,6 +107,11 @@ public:
     };
 
     FrameGraph();
+
+    // Transient textures are obtained from, and returned to, texturePool instead of being
+    // created and destroyed every time. texturePool must outlive this FrameGraph.
+    explicit FrameGraph(FrameGraphTexturePool& texturePool);
+
     FrameGraph(FrameGraph const&) = delete;
     FrameGraph& operator = (FrameGraph const&) = delete;
     ~FrameGraph();
@@ -177,6 +183,7 @@ public:
 
 private:
     friend class FrameGraphPassResources;
+    friend struct fg::Resource;
     friend struct fg::PassNode;
     friend struct fg::RenderTarget;
     friend struct fg::RenderTargetResource;
@@ -209,6 +216,7 @@ private:
     bool equals(FrameGraphRenderTarget::Descriptor const& lhs,
             FrameGraphRenderTarget::Descriptor const& rhs) const noexcept;
 
+    FrameGraphTexturePool* mTexturePool = nullptr;
     details::LinearAllocatorArena mArena;
     Vector<fg::PassNode> mPassNodes;                    // list of frame graph passes
     Vector<fg::ResourceNode> mResourceNodes;            // list of resource nodes
@@ -63,6 +63,7 @@ public:
         uint32_t height = 1;    // height of resource in pixel
         uint32_t depth = 1;     // # of images for 3D textures
         uint8_t levels = 1;     // # of levels for textures
+        uint8_t samples = 1;    // # of samples, for multi-sampled attachments
         driver::SamplerType type = driver::SamplerType::SAMPLER_2D;     // texture target type
         driver::TextureFormat format = driver::TextureFormat::RGBA8;    // resource internal format
         bool relaxed = false; // dimensions can be slightly adjusted
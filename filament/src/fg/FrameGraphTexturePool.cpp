@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "FrameGraphTexturePool.h"
+
+#include "details/Texture.h"
+
+#include "driver/CommandStream.h"
+
+#include <algorithm>
+
+namespace filament {
+
+using namespace driver;
+using namespace details;
+
+FrameGraphTexturePool::FrameGraphTexturePool() noexcept {
+    mPool.reserve(16);
+}
+
+FrameGraphTexturePool::~FrameGraphTexturePool() noexcept {
+    assert(mPool.empty());
+}
+
+void FrameGraphTexturePool::terminate(DriverApi& driver) noexcept {
+    for (Entry const& entry : mPool) {
+        destroyEntry(driver, entry);
+    }
+    mPool.clear();
+}
+
+Handle<HwTexture> FrameGraphTexturePool::get(DriverApi& driver, Key const& key) noexcept {
+    // look for the most recently released texture that matches, so that textures used
+    // every frame stay at the front of the line and older ones can age out.
+    auto pos = std::find_if(mPool.rbegin(), mPool.rend(),
+            [&key](Entry const& entry) { return entry.key == key; });
+
+    if (pos != mPool.rend()) {
+        Handle<HwTexture> texture = pos->texture;
+        mStats.hits++;
+        mStats.aliased += (pos->age == mCacheAge) ? 1 : 0;
+        mStats.bytesSaved += pos->size;
+        mStats.size -= pos->size;
+        mStats.count--;
+        mPool.erase(std::next(pos).base());
+        return texture;
+    }
+
+    mStats.misses++;
+    return driver.createTexture(key.type, key.levels, key.format, key.samples,
+            key.width, key.height, key.depth, key.usage);
+}
+
+void FrameGraphTexturePool::put(Handle<HwTexture> texture, Key const& key) noexcept {
+    assert(texture);
+    const size_t size = getSize(key);
+    mPool.push_back({ key, texture, mCacheAge, size });
+    mStats.size += size;
+    mStats.count++;
+}
+
+void FrameGraphTexturePool::gc(DriverApi& driver) noexcept {
+    // the pool is in release order, so the oldest entries are at the front
+    const uint32_t age = mCacheAge - POOL_ENTRY_MAX_AGE;
+    auto first = mPool.begin();
+    auto last = first;
+    while (last != mPool.end() &&
+            (int32_t(last->age - age) <= 0 || mStats.size > POOL_MAX_SIZE)) {
+        destroyEntry(driver, *last);
+        mStats.evictions++;
+        ++last;
+    }
+    mPool.erase(first, last);
+
+    // all cache entries get older
+    mCacheAge++;
+}
+
+void FrameGraphTexturePool::destroyEntry(DriverApi& driver, Entry const& entry) noexcept {
+    driver.destroyTexture(entry.texture);
+    mStats.size -= entry.size;
+    mStats.count--;
+}
+
+size_t FrameGraphTexturePool::getSize(Key const& key) noexcept {
+    size_t size = FTexture::getFormatSize(key.format) *
+            key.samples * key.width * key.height * key.depth;
+    if (key.levels > 1) {
+        // account for the mip-chain
+        size += size / 3;
+    }
+    return size;
+}
+
+} // namespace filament
@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_FRAMEGRAPHTEXTUREPOOL_H
+#define TNT_FILAMENT_FRAMEGRAPHTEXTUREPOOL_H
+
+#include "driver/DriverApiForward.h"
+#include "driver/Handle.h"
+
+#include <filament/driver/DriverEnums.h>
+
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace filament {
+
+/*
+ * A cache of the transient textures used by FrameGraph, which outlives the FrameGraph itself.
+ *
+ * FrameGraph returns its textures to the pool as soon as the last pass using them has executed,
+ * so a later pass of the same frame can reuse the same texture if their lifetimes don't overlap
+ * (aliasing), and so can the next frames.
+ * Textures unused for a while are destroyed by gc(), which must be called once per frame.
+ */
+class FrameGraphTexturePool {
+public:
+    // entries unused for this many frames are purged
+    static constexpr uint32_t POOL_ENTRY_MAX_AGE = 30;
+
+    // the pool never keeps more than this many bytes of unused textures
+    static constexpr size_t POOL_MAX_SIZE = 64 * 1024 * 1024;
+
+    struct Key {
+        driver::SamplerType type = driver::SamplerType::SAMPLER_2D;
+        uint8_t levels = 1;
+        driver::TextureFormat format = driver::TextureFormat::RGBA8;
+        uint8_t samples = 1;
+        uint32_t width = 1;
+        uint32_t height = 1;
+        uint32_t depth = 1;
+        driver::TextureUsage usage = driver::TextureUsage::DEFAULT;
+
+        bool operator==(Key const& rhs) const noexcept {
+            return type == rhs.type && levels == rhs.levels && format == rhs.format &&
+                   samples == rhs.samples && width == rhs.width && height == rhs.height &&
+                   depth == rhs.depth && usage == rhs.usage;
+        }
+    };
+
+    struct Stats {
+        size_t hits = 0;        // textures served from the pool
+        size_t aliased = 0;     // hits on a texture released during the same frame
+        size_t misses = 0;      // textures created
+        size_t evictions = 0;   // textures destroyed by gc()
+        size_t bytesSaved = 0;  // total size of the textures served from the pool
+        size_t size = 0;        // current size of the unused textures in the pool
+        size_t count = 0;       // current number of unused textures in the pool
+    };
+
+    FrameGraphTexturePool() noexcept;
+    FrameGraphTexturePool(FrameGraphTexturePool const&) = delete;
+    FrameGraphTexturePool& operator=(FrameGraphTexturePool const&) = delete;
+    ~FrameGraphTexturePool() noexcept;
+
+    // destroys all the textures in the pool, textures in use must have been returned
+    void terminate(driver::DriverApi& driver) noexcept;
+
+    // returns a texture matching key, which is created if needed
+    Handle<HwTexture> get(driver::DriverApi& driver, Key const& key) noexcept;
+
+    // returns a texture obtained with get() to the pool
+    void put(Handle<HwTexture> texture, Key const& key) noexcept;
+
+    // removes older textures from the pool. call this once per frame.
+    void gc(driver::DriverApi& driver) noexcept;
+
+    Stats const& getStats() const noexcept { return mStats; }
+
+    static size_t getSize(Key const& key) noexcept;
+
+private:
+    struct Entry {
+        Key key;
+        Handle<HwTexture> texture;
+        uint32_t age;
+        size_t size;
+    };
+
+    void destroyEntry(driver::DriverApi& driver, Entry const& entry) noexcept;
+
+    std::vector<Entry> mPool;
+    Stats mStats;
+    uint32_t mCacheAge = 0;
+};
+
+} // namespace filament
+
+#endif // TNT_FILAMENT_FRAMEGRAPHTEXTUREPOOL_H
@@ -18,6 +18,7 @@
 
 #include "fg/FrameGraph.h"
 #include "fg/FrameGraphPassResources.h"
+#include "fg/FrameGraphTexturePool.h"
 
 #include "driver/CommandStream.h"
 #include "driver/noop/NoopDriver.h"
@@ -338,3 +339,200 @@ TEST(FrameGraphTest, RenderTargetLifetime) {
     EXPECT_TRUE(renderPassExecuted1);
     EXPECT_TRUE(renderPassExecuted2);
 }
+
+// A chain of post-process-like passes, each sampling the output of the previous one.
+static void addPostProcessChain(FrameGraph& fg, size_t count) {
+    struct PostProcessPassData {
+        FrameGraphResource input;
+        FrameGraphResource output;
+    };
+
+    FrameGraphResource::Descriptor desc{ .width = 64, .height = 64 };
+    FrameGraphResource input;
+    for (size_t i = 0; i < count; i++) {
+        auto& pass = fg.addPass<PostProcessPassData>("PostProcess",
+                [&](FrameGraph::Builder& builder, PostProcessPassData& data) {
+                    if (input.isValid()) {
+                        data.input = builder.read(input);
+                    }
+                    data.output = builder.createTexture("output", desc);
+                    data.output = builder.useRenderTarget(data.output).textures[0];
+                },
+                [=](FrameGraphPassResources const& resources,
+                        PostProcessPassData const& data, DriverApi& driver) {
+                    if (data.input.isValid()) {
+                        EXPECT_TRUE(resources.getTexture(data.input));
+                    }
+                });
+        input = pass.getData().output;
+    }
+
+    struct FinalPassData {
+        FrameGraphResource input;
+    };
+    fg.addPass<FinalPassData>("Final",
+            [&](FrameGraph::Builder& builder, FinalPassData& data) {
+                data.input = builder.read(input);
+                builder.sideEffect();
+            },
+            [=](FrameGraphPassResources const& resources,
+                    FinalPassData const& data, DriverApi& driver) {
+                EXPECT_TRUE(resources.getTexture(data.input));
+            });
+}
+
+TEST(FrameGraphTest, TexturePool) {
+
+    FrameGraphTexturePool pool;
+    const size_t textureSize = FrameGraphTexturePool::getSize({
+            .format = TextureFormat::RGBA8, .width = 64, .height = 64 });
+
+    {
+        // Each texture is live from the pass writing it to the pass reading it, so two
+        // textures are enough for the whole chain, the others are aliased.
+        FrameGraph fg(pool);
+        addPostProcessChain(fg, 5);
+        fg.compile();
+        fg.execute(driverApi);
+
+        auto const& stats = pool.getStats();
+        EXPECT_EQ(2u, stats.misses);
+        EXPECT_EQ(3u, stats.hits);
+        EXPECT_EQ(3u, stats.aliased);
+        EXPECT_EQ(3 * textureSize, stats.bytesSaved);
+        EXPECT_EQ(2u, stats.count);
+        EXPECT_EQ(2 * textureSize, stats.size);
+    }
+
+    pool.gc(driverApi);
+
+    {
+        // the next frame doesn't create any texture
+        FrameGraph fg(pool);
+        addPostProcessChain(fg, 5);
+        fg.compile();
+        fg.execute(driverApi);
+
+        auto const& stats = pool.getStats();
+        EXPECT_EQ(2u, stats.misses);
+        EXPECT_EQ(8u, stats.hits);
+        EXPECT_EQ(6u, stats.aliased);
+        EXPECT_EQ(8 * textureSize, stats.bytesSaved);
+        EXPECT_EQ(2u, stats.count);
+    }
+
+    // unused textures are eventually evicted
+    for (size_t i = 0; i <= FrameGraphTexturePool::POOL_ENTRY_MAX_AGE; i++) {
+        pool.gc(driverApi);
+    }
+    EXPECT_EQ(2u, pool.getStats().evictions);
+    EXPECT_EQ(0u, pool.getStats().count);
+    EXPECT_EQ(0u, pool.getStats().size);
+
+    pool.terminate(driverApi);
+}
+
+TEST(FrameGraphTest, ImportedRenderTarget) {
+
+    FrameGraphTexturePool pool;
+    FrameGraph fg(pool);
+
+    // this is how Renderer uses the FrameGraph: the scene is rendered in an intermediate buffer
+    // and the last post-process pass renders directly into the view's render target.
+    Handle<HwRenderTarget> viewRenderTarget{ 42 };
+    FrameGraphResource output = fg.importResource("viewRenderTarget",
+            { .viewport = { 0, 0, 640, 480 } }, viewRenderTarget, 640, 480,
+            TargetBufferFlags::COLOR, TargetBufferFlags::DEPTH_AND_STENCIL);
+
+    bool colorPassExecuted = false;
+    bool postProcessPassExecuted = false;
+    bool culledPassExecuted = false;
+
+    struct ColorPassData {
+        FrameGraphResource color;
+        FrameGraphResource depth;
+    };
+
+    auto& colorPass = fg.addPass<ColorPassData>("color pass",
+            [&](FrameGraph::Builder& builder, ColorPassData& data) {
+                data.color = builder.createTexture("color buffer", {
+                        .width = 640, .height = 480, .format = TextureFormat::RGBA16F });
+                data.depth = builder.createTexture("depth buffer", {
+                        .width = 640, .height = 480, .format = TextureFormat::DEPTH24 });
+                FrameGraphRenderTarget::Descriptor desc{
+                        .attachments.color = data.color,
+                        .attachments.depth = data.depth
+                };
+                auto rt = builder.useRenderTarget("color pass target", desc);
+                data.color = rt.textures[0];
+                data.depth = rt.textures[1];
+            },
+            [=, &colorPassExecuted](FrameGraphPassResources const& resources,
+                    ColorPassData const& data, DriverApi& driver) {
+                colorPassExecuted = true;
+                auto const& rt = resources.getRenderTarget(data.color);
+                EXPECT_TRUE(rt.target);
+                EXPECT_NE(viewRenderTarget.getId(), rt.target.getId());
+            });
+
+    struct PostProcessPassData {
+        FrameGraphResource input;
+        FrameGraphResource output;
+    };
+
+    auto& postProcessPass = fg.addPass<PostProcessPassData>("post-process pass",
+            [&](FrameGraph::Builder& builder, PostProcessPassData& data) {
+                data.input = builder.read(colorPass.getData().color);
+                data.output = builder.createTexture("post-process output", {
+                        .width = 640, .height = 480 });
+                data.output = builder.useRenderTarget(data.output).textures[0];
+            },
+            [=, &postProcessPassExecuted](FrameGraphPassResources const& resources,
+                    PostProcessPassData const& data, DriverApi& driver) {
+                postProcessPassExecuted = true;
+                EXPECT_TRUE(resources.getTexture(data.input));
+                // we're rendering into the imported target, with the user's discard flags
+                auto const& rt = resources.getRenderTarget(data.output);
+                EXPECT_EQ(viewRenderTarget.getId(), rt.target.getId());
+                EXPECT_EQ(TargetBufferFlags::COLOR, rt.params.flags.discardStart);
+                EXPECT_EQ(TargetBufferFlags::DEPTH_AND_STENCIL, rt.params.flags.discardEnd);
+                EXPECT_EQ(640u, rt.params.viewport.width);
+                EXPECT_EQ(480u, rt.params.viewport.height);
+            });
+
+    struct CulledPassData {
+        FrameGraphResource input;
+        FrameGraphResource output;
+    };
+
+    fg.addPass<CulledPassData>("culled pass",
+            [&](FrameGraph::Builder& builder, CulledPassData& data) {
+                data.input = builder.read(colorPass.getData().color);
+                data.output = builder.createTexture("unused output", {
+                        .width = 640, .height = 480 });
+                data.output = builder.useRenderTarget(data.output).textures[0];
+            },
+            [=, &culledPassExecuted](FrameGraphPassResources const& resources,
+                    CulledPassData const& data, DriverApi& driver) {
+                culledPassExecuted = true;
+            });
+
+    fg.moveResource(output, postProcessPass.getData().output);
+    fg.present(output);
+
+    fg.compile();
+    fg.execute(driverApi);
+
+    EXPECT_TRUE(colorPassExecuted);
+    EXPECT_TRUE(postProcessPassExecuted);
+    EXPECT_FALSE(culledPassExecuted);
+
+    // only the color buffer needs a texture: the depth buffer is only an attachment, the
+    // post-process output is the imported target and the culled pass' output is never created.
+    auto const& stats = pool.getStats();
+    EXPECT_EQ(1u, stats.misses);
+    EXPECT_EQ(0u, stats.hits);
+    EXPECT_EQ(1u, stats.count);
+
+    pool.terminate(driverApi);
+}
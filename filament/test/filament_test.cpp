@@ -14,8 +14,12 @@
  * limitations under the License.
  */
 
+#include <atomic>
 #include <iostream>
+#include <map>
 #include <random>
+#include <thread>
+#include <vector>
 
 #include <gtest/gtest.h>
 
@@ -28,6 +32,11 @@
 #include <filament/Frustum.h>
 #include <filament/Material.h>
 #include <filament/Engine.h>
+#include <filament/IndexBuffer.h>
+#include <filament/Renderer.h>
+#include <filament/Scene.h>
+#include <filament/VertexBuffer.h>
+#include <filament/View.h>
 
 #include <private/filament/UniformInterfaceBlock.h>
 #include <private/filament/UibGenerator.h>
@@ -35,12 +44,23 @@
 #include "details/Allocators.h"
 #include "details/Material.h"
 #include "details/Camera.h"
+#include "details/Culler.h"
+#include "details/CullingBvh.h"
 #include "details/Froxelizer.h"
 #include "details/Engine.h"
+#include "details/RenderPrimitive.h"
+#include "details/Scene.h"
+#include "details/ShadowMap.h"
+#include "details/View.h"
 #include "components/RenderableManager.h"
 #include "components/TransformManager.h"
+#include "RenderPass.h"
+#include "driver/CommandBufferQueue.h"
+#include "driver/opengl/OpenGLProgramBinary.h"
 #include "UniformBuffer.h"
 
+#include <utils/JobSystem.h>
+
 using namespace filament;
 using namespace filament::math;
 using namespace utils;
@@ -146,6 +166,121 @@ TEST(FilamentTest, TransformManager) {
     EXPECT_EQ(tcm.getWorldTransform(child), mat4f{ float4{ 8 }});
 }
 
+TEST(FilamentTest, TransformManagerVersion) {
+    filament::details::FTransformManager tcm;
+    EntityManager& em = EntityManager::get();
+    std::array<Entity, 3> entities;
+    em.create(entities.size(), entities.data());
+
+    tcm.create(entities[0]);
+    TransformManager::Instance parent = tcm.getInstance(entities[0]);
+    tcm.create(entities[1], parent, mat4f{});
+    TransformManager::Instance child = tcm.getInstance(entities[1]);
+    tcm.create(entities[2]);
+    TransformManager::Instance other = tcm.getInstance(entities[2]);
+
+    // versions are never reused
+    EXPECT_NE(tcm.getWorldTransformVersion(parent), tcm.getWorldTransformVersion(child));
+    EXPECT_NE(tcm.getWorldTransformVersion(parent), tcm.getWorldTransformVersion(other));
+
+    // setting a transform changes the version of the node and its children only
+    uint64_t parentVersion = tcm.getWorldTransformVersion(parent);
+    uint64_t childVersion = tcm.getWorldTransformVersion(child);
+    uint64_t otherVersion = tcm.getWorldTransformVersion(other);
+    tcm.setTransform(parent, mat4f{ float4{ 2 }});
+    EXPECT_NE(tcm.getWorldTransformVersion(parent), parentVersion);
+    EXPECT_NE(tcm.getWorldTransformVersion(child), childVersion);
+    EXPECT_EQ(tcm.getWorldTransformVersion(other), otherVersion);
+
+    // a transaction only changes the version of the world transforms that changed
+    parentVersion = tcm.getWorldTransformVersion(parent);
+    childVersion = tcm.getWorldTransformVersion(child);
+    tcm.openLocalTransformTransaction();
+    tcm.setTransform(other, mat4f{ float4{ 4 }});
+    tcm.commitLocalTransformTransaction();
+    parent = tcm.getInstance(entities[0]);
+    child = tcm.getInstance(entities[1]);
+    other = tcm.getInstance(entities[2]);
+    EXPECT_EQ(tcm.getWorldTransformVersion(parent), parentVersion);
+    EXPECT_EQ(tcm.getWorldTransformVersion(child), childVersion);
+    EXPECT_NE(tcm.getWorldTransformVersion(other), otherVersion);
+}
+
+TEST(FilamentTest, TransformManagerParallelCommit) {
+    JobSystem js;
+    js.adopt();
+
+    filament::details::FTransformManager tcm;
+    tcm.setJobSystem(&js);
+    EntityManager& em = EntityManager::get();
+
+    // a wide hierarchy with 3 levels, created children first so the commit has to reorder it
+    const size_t rootCount = 4;
+    const size_t childCount = 2048;
+    std::vector<Entity> children(childCount);
+    std::vector<Entity> grandChildren(childCount);
+    std::vector<Entity> roots(rootCount);
+    em.create(children.size(), children.data());
+    em.create(grandChildren.size(), grandChildren.data());
+    em.create(roots.size(), roots.data());
+    for (size_t i = 0; i < childCount; i++) {
+        tcm.create(children[i]);
+        tcm.create(grandChildren[i], tcm.getInstance(children[i]), mat4f{});
+    }
+    for (size_t i = 0; i < rootCount; i++) {
+        tcm.create(roots[i]);
+    }
+
+    tcm.openLocalTransformTransaction();
+    for (size_t i = 0; i < childCount; i++) {
+        const auto ci = tcm.getInstance(children[i]);
+        const auto gi = tcm.getInstance(grandChildren[i]);
+        tcm.setParent(ci, tcm.getInstance(roots[i % rootCount]));
+        tcm.setTransform(ci, mat4f::translate(float3{ float(i), 0, 0 }));
+        tcm.setTransform(gi, mat4f::translate(float3{ 0, float(i), 0 }));
+    }
+    for (size_t i = 0; i < rootCount; i++) {
+        tcm.setTransform(tcm.getInstance(roots[i]), mat4f::translate(float3{ 0, 0, float(i) }));
+    }
+    tcm.commitLocalTransformTransaction();
+
+    for (size_t i = 0; i < childCount; i++) {
+        const auto ci = tcm.getInstance(children[i]);
+        const auto gi = tcm.getInstance(grandChildren[i]);
+        const float r = float(i % rootCount);
+        EXPECT_EQ(tcm.getWorldTransform(ci), mat4f::translate(float3{ float(i), 0, r }));
+        EXPECT_EQ(tcm.getWorldTransform(gi), mat4f::translate(float3{ float(i), float(i), r }));
+    }
+
+    // only the subtree of the root that changed is updated
+    std::vector<uint64_t> versions(childCount);
+    for (size_t i = 0; i < childCount; i++) {
+        versions[i] = tcm.getWorldTransformVersion(tcm.getInstance(grandChildren[i]));
+    }
+    tcm.openLocalTransformTransaction();
+    tcm.setTransform(tcm.getInstance(roots[1]), mat4f::translate(float3{ 0, 0, 8 }));
+    tcm.commitLocalTransformTransaction();
+    for (size_t i = 0; i < childCount; i++) {
+        const auto gi = tcm.getInstance(grandChildren[i]);
+        if (i % rootCount == 1) {
+            EXPECT_NE(tcm.getWorldTransformVersion(gi), versions[i]);
+            EXPECT_EQ(tcm.getWorldTransform(gi),
+                    mat4f::translate(float3{ float(i), float(i), 8 }));
+        } else {
+            EXPECT_EQ(tcm.getWorldTransformVersion(gi), versions[i]);
+        }
+    }
+
+    for (Entity e : roots) tcm.destroy(e);
+    for (Entity e : children) tcm.destroy(e);
+    for (Entity e : grandChildren) tcm.destroy(e);
+    em.destroy(roots.size(), roots.data());
+    em.destroy(children.size(), children.data());
+    em.destroy(grandChildren.size(), grandChildren.data());
+
+    js.emancipate();
+}
+
 TEST(FilamentTest, UniformInterfaceBlock) {
 
     UniformInterfaceBlock::Builder b;
@@ -560,6 +695,81 @@ TEST(FilamentTest, FroxelData) {
     delete engine;
 }
 
+TEST(FilamentTest, FroxelAdaptiveGrid) {
+    using namespace filament;
+    using namespace filament::details;
+
+    FEngine* engine = FEngine::create();
+
+    LinearAllocatorArena arena("FRenderer: per-frame allocator", FEngine::CONFIG_PER_RENDER_PASS_ARENA_SIZE);
+
+    Viewport vp(0, 0, 1280, 640);
+    mat4f p = mat4f::perspective(90, 1.0f, 0.1, 100, mat4f::Fov::HORIZONTAL);
+
+    Froxelizer froxelData(*engine);
+    froxelData.setOptions(5, 100);
+    auto prepare = [&]() {
+        // each frame gets its own per-frame allocations
+        utils::ArenaScope<LinearAllocatorArena> scope(arena);
+        froxelData.prepare(engine->getDriverApi(), scope, vp, p, 0.1, 100);
+    };
+
+    prepare();
+    const size_t defaultCount = froxelData.getFroxelCount();
+    EXPECT_LE(defaultCount, FROXEL_BUFFER_ENTRY_COUNT_DEFAULT);
+
+    // nothing was dropped, so the adaptive grid uses more froxels
+    froxelData.setAdaptiveGridEnabled(true);
+    prepare();
+    EXPECT_GT(froxelData.getFroxelCount(), defaultCount);
+    EXPECT_LE(froxelData.getFroxelCount(), FROXEL_BUFFER_ENTRY_COUNT_MAX);
+    EXPECT_GE(froxelData.getFroxelBufferUser().size(), froxelData.getFroxelCount());
+
+    // and goes back to the default grid when disabled
+    froxelData.setAdaptiveGridEnabled(false);
+    prepare();
+    EXPECT_EQ(froxelData.getFroxelCount(), defaultCount);
+
+    froxelData.terminate(engine->getDriverApi());
+    engine->shutdown();
+    delete engine;
+}
+
+TEST(FilamentTest, FroxelAdaptiveGridArena) {
+    using namespace filament;
+    using namespace filament::details;
+
+    FEngine* engine = FEngine::create();
+
+    LinearAllocatorArena arena("FRenderer: per-frame allocator", FEngine::CONFIG_PER_RENDER_PASS_ARENA_SIZE);
+
+    // a square viewport uses the whole froxel budget
+    Viewport vp(0, 0, 1024, 1024);
+    mat4f p = mat4f::perspective(90, 1.0f, 0.1, 100, mat4f::Fov::HORIZONTAL);
+
+    Froxelizer froxelData(*engine);
+    froxelData.setOptions(5, 100);
+    froxelData.setAdaptiveGridEnabled(true);
+
+    // the froxelizer and the commands buffer share the per-render pass arena,
+    // see FRenderer::renderJob()
+    for (size_t i = 0; i < 2; i++) {
+        utils::ArenaScope<LinearAllocatorArena> scope(arena);
+        froxelData.prepare(engine->getDriverApi(), scope, vp, p, 0.1, 100);
+        EXPECT_NE(nullptr, froxelData.getFroxelBufferUser().data());
+
+        const size_t commandsCount = FEngine::CONFIG_PER_FRAME_COMMANDS_SIZE / sizeof(RenderPass::Command);
+        RenderPass::Command* commands =
+                scope.allocate<RenderPass::Command>(commandsCount, CACHELINE_SIZE);
+        EXPECT_NE(nullptr, commands);
+    }
+    EXPECT_EQ(FROXEL_BUFFER_ENTRY_COUNT_MAX, froxelData.getFroxelCount());
+
+    froxelData.terminate(engine->getDriverApi());
+    engine->shutdown();
+    delete engine;
+}
+
 TEST(FilamentTest, Bones) {
     using namespace ::filament::details;
 
@@ -694,6 +904,1126 @@ TEST(FilamentTest, Bones) {
     }
 }
 
+TEST(FilamentTest, RenderPassSortCommands) {
+    using filament::details::RenderPass;
+    using Command = RenderPass::Command;
+
+    JobSystem js;
+    js.adopt();
+
+    std::default_random_engine generator(82828);
+    std::uniform_int_distribution<uint32_t> materials(0, 63);
+    std::uniform_int_distribution<uint32_t> instances(0, 255);
+
+    // large enough to take the radix sort path, with plenty of duplicate keys
+    std::vector<Command> commands(10000);
+    for (size_t i = 0; i < commands.size(); i++) {
+        commands[i].key = uint64_t(RenderPass::Pass::COLOR) |
+                RenderPass::makeMaterialSortingKey(materials(generator), instances(generator));
+        commands[i].primitive.index = uint16_t(i);
+    }
+
+    std::vector<Command> expected(commands);
+    std::stable_sort(expected.begin(), expected.end());
+
+    std::vector<Command> scratch(commands.size());
+    RenderPass::sortCommands(js,
+            { commands.data(), uint32_t(commands.size()) },
+            { scratch.data(), uint32_t(scratch.size()) });
+
+    for (size_t i = 0; i < commands.size(); i++) {
+        EXPECT_EQ(expected[i].key, commands[i].key);
+        EXPECT_EQ(expected[i].primitive.index, commands[i].primitive.index);
+    }
+
+    js.emancipate();
+}
+
+TEST(FilamentTest, CommandStreamReserve) {
+    using namespace filament::details;
+
+    constexpr size_t CHUNK_COUNT = 16;
+    constexpr size_t COMMAND_COUNT = 100;
+    constexpr size_t CHUNK_SIZE = COMMAND_COUNT * CustomCommand::align(sizeof(CustomCommand)) +
+            CommandBase::align(sizeof(NoopCommand));
+
+    JobSystem js;
+    js.adopt();
+
+    Engine* engine = Engine::create(Engine::Backend::NOOP);
+    FEngine::DriverApi& driver = upcast(engine)->getDriverApi();
+
+    // commands are executed serially on the driver thread
+    std::vector<size_t> order;
+    driver.queueCommand([&order]() { order.push_back(0); });
+    char* const base = static_cast<char*>(driver.reserve(CHUNK_COUNT * CHUNK_SIZE));
+    driver.queueCommand([&order]() { order.push_back(CHUNK_COUNT * COMMAND_COUNT + 1); });
+
+    auto work = [&driver, &order, base](size_t i) {
+        char* const end = base + (i + 1) * CHUNK_SIZE;
+        CircularBuffer buffer(base + i * CHUNK_SIZE, CHUNK_SIZE);
+        FEngine::DriverApi stream(driver, buffer);
+        for (size_t j = 0; j < COMMAND_COUNT; j++) {
+            const size_t value = 1 + i * COMMAND_COUNT + j;
+            stream.queueCommand([&order, value]() { order.push_back(value); });
+        }
+        new(buffer.allocate(CommandBase::align(sizeof(NoopCommand)))) NoopCommand(end);
+        EXPECT_EQ(end, buffer.getHead());
+    };
+
+    // the chunks are recorded concurrently, in any order
+    auto parent = js.createJob();
+    for (size_t i = 0; i < CHUNK_COUNT; i++) {
+        js.run(jobs::createJob(js, parent, std::cref(work), CHUNK_COUNT - 1 - i));
+    }
+    js.runAndWait(parent);
+
+    upcast(engine)->flush();
+    Engine::destroy(&engine);
+
+    ASSERT_EQ(CHUNK_COUNT * COMMAND_COUNT + 2, order.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        EXPECT_EQ(i, order[i]);
+    }
+
+    js.emancipate();
+}
+
+TEST(FilamentTest, CommandBufferQueue) {
+    constexpr size_t REQUIRED_SIZE = CircularBuffer::BLOCK_SIZE;
+    constexpr size_t FLUSH_COUNT = CommandBufferQueue::SLICE_COUNT * 4;
+
+    CommandBufferQueue queue(REQUIRED_SIZE, REQUIRED_SIZE * 4);
+    CircularBuffer& buffer = queue.getCircularBuffer();
+
+    // the consumer receives all the slices in order, even when the ring wraps around
+    std::vector<uint32_t> received;
+    std::atomic<size_t> receivedCount = { 0 };
+    std::thread consumer([&queue, &received, &receivedCount]() {
+        for (;;) {
+            auto const& slices = queue.waitForCommands();
+            if (slices.empty()) {
+                break;
+            }
+            for (auto& slice : slices) {
+                received.push_back(*static_cast<uint32_t*>(slice.begin));
+                queue.releaseBuffer(slice);
+                receivedCount.fetch_add(1);
+            }
+        }
+    });
+
+    size_t bytes = 0;
+    for (uint32_t i = 0; i < FLUSH_COUNT; i++) {
+        const size_t size = 64 + (i % 7) * 256;
+        *static_cast<uint32_t*>(buffer.allocate(size)) = i;
+        queue.flush();
+        bytes += size;
+        if (i % 16 == 15) {
+            queue.endFrame();
+        }
+    }
+
+    // flush() guarantees the space is available, but not that the consumer is done
+    while (receivedCount.load() != FLUSH_COUNT) {
+        std::this_thread::yield();
+    }
+    queue.requestExit();
+    consumer.join();
+
+    ASSERT_EQ(FLUSH_COUNT, received.size());
+    for (uint32_t i = 0; i < FLUSH_COUNT; i++) {
+        EXPECT_EQ(i, received[i]);
+    }
+
+    CommandBufferQueue::Stats const& stats = queue.getStats();
+    EXPECT_EQ(FLUSH_COUNT, stats.flushCount);
+    EXPECT_LE(bytes, stats.bytesSubmitted);
+    EXPECT_EQ(FLUSH_COUNT / 16, stats.frameCount);
+    EXPECT_LE(stats.lastFrameSize, stats.maxFrameSize);
+    EXPECT_LE(stats.highWatermark, buffer.size());
+}
+
+TEST(FilamentTest, RendererFrameTiming) {
+    using Stage = Renderer::FrameTiming::Stage;
+
+    Engine* engine = Engine::create(Engine::Backend::NOOP);
+    SwapChain* swapChain = engine->createSwapChain(nullptr);
+    Renderer* renderer = engine->createRenderer();
+    Scene* scene = engine->createScene();
+    Camera* camera = engine->createCamera();
+    View* view = engine->createView();
+    view->setScene(scene);
+    view->setCamera(camera);
+    view->setViewport({ 0, 0, 640, 480 });
+
+    auto renderFrame = [&]() {
+        // frames can be skipped while the noop driver catches up
+        while (!renderer->beginFrame(swapChain)) {
+        }
+        renderer->render(view);
+        renderer->endFrame();
+    };
+
+    Renderer::FrameTiming timings[Renderer::FRAME_TIMING_HISTORY_SIZE];
+
+    // nothing is collected by default
+    renderFrame();
+    EXPECT_EQ(0u, renderer->getFrameTimings(timings, Renderer::FRAME_TIMING_HISTORY_SIZE));
+
+    renderer->setFrameTimingOptions({ .enabled = true });
+    EXPECT_TRUE(renderer->getFrameTimingOptions().enabled);
+
+    // frames complete asynchronously, once the driver thread and the GPU are done with them
+    size_t count = 0;
+    for (size_t i = 0; i < 1000 && count < 4; i++) {
+        renderFrame();
+        count = renderer->getFrameTimings(timings, 4);
+    }
+    ASSERT_EQ(4u, count);
+
+    for (size_t i = 0; i < count; i++) {
+        Renderer::FrameTiming const& t = timings[i];
+        if (i > 0) {
+            // most recent first
+            EXPECT_LT(t.frameId, timings[i - 1].frameId);
+        }
+        // these stages run sequentially on the calling thread
+        const uint64_t sequential = t[Stage::SCENE_PREPARE] + t[Stage::CULLING] +
+                t[Stage::COMMAND_GENERATION] + t[Stage::COMMAND_SORT] +
+                t[Stage::COMMAND_RECORDING];
+        EXPECT_GT(t[Stage::SCENE_PREPARE], 0u);
+        EXPECT_GT(t[Stage::COMMAND_RECORDING], 0u);
+        EXPECT_GT(t[Stage::DRIVER_EXECUTION], 0u);
+        EXPECT_LE(sequential, t.frameTime);
+        EXPECT_EQ(0u, t.cpuCycles);
+    }
+
+    renderer->setFrameTimingOptions({ .enabled = false });
+
+    engine->destroy(view);
+    engine->destroy(camera);
+    engine->destroy(scene);
+    engine->destroy(renderer);
+    engine->destroy(swapChain);
+    Engine::destroy(&engine);
+}
+
+TEST(FilamentTest, EngineCommandBufferStats) {
+    Engine* engine = Engine::create(Engine::Backend::NOOP);
+    SwapChain* swapChain = engine->createSwapChain(nullptr);
+    Renderer* renderer = engine->createRenderer();
+    Scene* scene = engine->createScene();
+    Camera* camera = engine->createCamera();
+    View* view = engine->createView();
+    view->setScene(scene);
+    view->setCamera(camera);
+    view->setViewport({ 0, 0, 640, 480 });
+
+    const Engine::CommandBufferStats initial = engine->getCommandBufferStats();
+    EXPECT_GT(initial.bufferSize, 0u);
+    EXPECT_GT(initial.requiredSize, 0u);
+    EXPECT_LE(initial.requiredSize, initial.bufferSize);
+
+    const size_t frameCount = 4;
+    for (size_t i = 0; i < frameCount; i++) {
+        // frames can be skipped while the noop driver catches up
+        while (!renderer->beginFrame(swapChain)) {
+        }
+        renderer->render(view);
+        renderer->endFrame();
+    }
+
+    const Engine::CommandBufferStats stats = engine->getCommandBufferStats();
+    EXPECT_EQ(initial.bufferSize, stats.bufferSize);
+    EXPECT_EQ(initial.frameCount + frameCount, stats.frameCount);
+    EXPECT_GE(stats.flushCount, initial.flushCount + frameCount);
+    EXPECT_GT(stats.bytesSubmitted, initial.bytesSubmitted);
+    EXPECT_GT(stats.lastFrameSize, 0u);
+    EXPECT_GE(stats.maxFrameSize, stats.lastFrameSize);
+    EXPECT_GT(stats.highWatermark, 0u);
+    EXPECT_LE(stats.highWatermark, stats.bufferSize);
+    EXPECT_LE(stats.blockedCount, stats.flushCount);
+
+    engine->destroy(view);
+    engine->destroy(camera);
+    engine->destroy(scene);
+    engine->destroy(renderer);
+    engine->destroy(swapChain);
+    Engine::destroy(&engine);
+}
+
+namespace {
+// A BlobCache that can also return corrupt values, or the value of another key.
+class TestBlobCache : public driver::BlobCache {
+public:
+    enum class Mode { NORMAL, TRUNCATED, ANY_KEY, CHANGING };
+    Mode mode = Mode::NORMAL;
+    size_t insertCount = 0;
+    std::map<std::vector<uint8_t>, std::vector<uint8_t>> blobs;
+
+    void insert(const void* key, size_t keySize,
+            const void* value, size_t valueSize) noexcept override {
+        auto k = static_cast<uint8_t const*>(key);
+        auto v = static_cast<uint8_t const*>(value);
+        blobs[{ k, k + keySize }].assign(v, v + valueSize);
+        insertCount++;
+    }
+
+    size_t retrieve(const void* key, size_t keySize,
+            void* value, size_t valueSize) noexcept override {
+        auto k = static_cast<uint8_t const*>(key);
+        auto pos = blobs.find({ k, k + keySize });
+        if (mode == Mode::ANY_KEY && !blobs.empty()) {
+            pos = blobs.begin();
+        }
+        if (pos == blobs.end()) {
+            return 0;
+        }
+        size_t size = pos->second.size();
+        if (mode == Mode::TRUNCATED) {
+            size /= 2;
+        } else if (mode == Mode::CHANGING && value) {
+            size -= 1;
+        }
+        if (value && valueSize >= size) {
+            memcpy(value, pos->second.data(), size);
+        }
+        return size;
+    }
+};
+} // anonymous namespace
+
+TEST(FilamentTest, ProgramBinaryKey) {
+    using namespace OpenGLProgramBinary;
+
+    CString prefix("vendor renderer version");
+    ShadersSource sources = {
+            CString("void main() { gl_Position = vec4(0.0); }"),
+            CString("void main() { fragColor = vec4(1.0); }") };
+
+    // the same sources always give the same key
+    ShadersSource same = { CString(sources[0].c_str()), CString(sources[1].c_str()) };
+    EXPECT_EQ(makeKey(prefix, sources), makeKey(prefix, same));
+
+    // but another GL implementation doesn't
+    EXPECT_NE(makeKey(prefix, sources), makeKey(CString("vendor renderer version2"), sources));
+
+    // any change to a source changes the key, even when its size doesn't change
+    ShadersSource other = sources;
+    other[1] = CString("void main() { fragColor = vec4(0.5); }");
+    ASSERT_EQ(sources[1].size(), other[1].size());
+    EXPECT_NE(makeKey(prefix, sources), makeKey(prefix, other));
+
+    // variants are different sources of the same material
+    ShadersSource variant = sources;
+    variant[0] = CString("#define HAS_SKINNING\nvoid main() { gl_Position = vec4(0.0); }");
+    EXPECT_NE(makeKey(prefix, sources), makeKey(prefix, variant));
+
+    // the same code split differently between the stages
+    ShadersSource split = {
+            CString("void main() { gl_Position = vec4(0.0); }void"),
+            CString(" main() { fragColor = vec4(1.0); }") };
+    EXPECT_NE(makeKey(prefix, sources), makeKey(prefix, split));
+}
+
+TEST(FilamentTest, ProgramBinaryCacheFallback) {
+    using namespace OpenGLProgramBinary;
+
+    const uint32_t BINARY_PROGRAM = 1;
+    const uint32_t COMPILED_PROGRAM = 2;
+    const uint32_t FORMAT = 0x1234;
+    const std::vector<uint8_t> BINARY = { 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+
+    CString prefix("vendor renderer version");
+    ShadersSource sources = { CString("vertex"), CString("fragment") };
+    ShadersSource others = { CString("other vertex"), CString("other fragment") };
+
+    size_t loadCount = 0;
+    size_t compileCount = 0;
+    bool acceptBinary = true;
+    auto create = [&](driver::BlobCache* cache, ShadersSource const& shadersSource) {
+        return createProgram(cache, prefix, shadersSource,
+                [&](uint32_t format, void const* binary, size_t size) -> uint32_t {
+                    loadCount++;
+                    EXPECT_EQ(FORMAT, format);
+                    EXPECT_EQ(BINARY, std::vector<uint8_t>((uint8_t const*)binary,
+                            (uint8_t const*)binary + size));
+                    return acceptBinary ? BINARY_PROGRAM : 0;
+                },
+                [&]() -> uint32_t {
+                    compileCount++;
+                    return COMPILED_PROGRAM;
+                },
+                [&](uint32_t program, uint32_t* format, std::vector<uint8_t>* binary) {
+                    EXPECT_EQ(COMPILED_PROGRAM, program);
+                    *format = FORMAT;
+                    *binary = BINARY;
+                    return true;
+                });
+    };
+
+    // without a cache, the program is always compiled
+    EXPECT_EQ(COMPILED_PROGRAM, create(nullptr, sources));
+    EXPECT_EQ(1u, compileCount);
+
+    // the first time the program is compiled and its binary stored, then the binary is used
+    TestBlobCache cache;
+    EXPECT_EQ(COMPILED_PROGRAM, create(&cache, sources));
+    EXPECT_EQ(1u, cache.insertCount);
+    EXPECT_EQ(BINARY_PROGRAM, create(&cache, sources));
+    EXPECT_EQ(2u, compileCount);
+    EXPECT_EQ(1u, loadCount);
+
+    // corrupt values are never handed to the driver, the program is compiled from source
+    for (auto mode : { TestBlobCache::Mode::TRUNCATED, TestBlobCache::Mode::CHANGING }) {
+        cache.mode = mode;
+        EXPECT_EQ(COMPILED_PROGRAM, create(&cache, sources));
+        EXPECT_EQ(1u, loadCount);
+    }
+    EXPECT_EQ(4u, compileCount);
+
+    // neither is the binary of another program
+    cache.mode = TestBlobCache::Mode::ANY_KEY;
+    ASSERT_EQ(1u, cache.blobs.size());
+    EXPECT_EQ(COMPILED_PROGRAM, create(&cache, others));
+    EXPECT_EQ(1u, loadCount);
+    EXPECT_EQ(5u, compileCount);
+
+    // a binary the driver rejects, e.g. after a driver update, is replaced by a new one
+    cache.mode = TestBlobCache::Mode::NORMAL;
+    cache.blobs.clear();
+    EXPECT_EQ(COMPILED_PROGRAM, create(&cache, sources));
+    acceptBinary = false;
+    size_t insertCount = cache.insertCount;
+    EXPECT_EQ(COMPILED_PROGRAM, create(&cache, sources));
+    EXPECT_EQ(2u, loadCount);
+    EXPECT_EQ(7u, compileCount);
+    EXPECT_EQ(insertCount + 1, cache.insertCount);
+}
+
+TEST(FilamentTest, RendererFrameGraph) {
+    using namespace filament::details;
+
+    Engine* engine = Engine::create(Engine::Backend::NOOP);
+    SwapChain* swapChain = engine->createSwapChain(nullptr);
+    Renderer* renderer = engine->createRenderer();
+    Scene* scene = engine->createScene();
+    Camera* camera = engine->createCamera();
+    View* view = engine->createView();
+    view->setScene(scene);
+    view->setCamera(camera);
+    view->setViewport({ 0, 0, 640, 480 });
+
+    auto renderFrame = [&]() {
+        // frames can be skipped while the noop driver catches up
+        while (!renderer->beginFrame(swapChain)) {
+        }
+        renderer->render(view);
+        renderer->endFrame();
+    };
+
+    FrameGraphTexturePool const& pool = upcast(engine)->getFrameGraphTexturePool();
+
+    // color buffer and tone-mapping output, FXAA renders into the view's render target
+    view->setAntiAliasing(View::AntiAliasing::FXAA);
+    renderFrame();
+    EXPECT_EQ(2u, pool.getStats().misses);
+    EXPECT_EQ(0u, pool.getStats().hits);
+
+    // without FXAA, tone-mapping renders into the view's render target
+    view->setAntiAliasing(View::AntiAliasing::NONE);
+    renderFrame();
+    EXPECT_EQ(2u, pool.getStats().misses);
+    EXPECT_EQ(1u, pool.getStats().hits);
+
+    // a new multi-sampled color buffer, the MSAA resolve reuses last frame's color buffer
+    view->setSampleCount(4);
+    renderFrame();
+    EXPECT_EQ(3u, pool.getStats().misses);
+    EXPECT_EQ(2u, pool.getStats().hits);
+
+    // without post-processing, the scene renders directly into the view's render target
+    view->setPostProcessingEnabled(false);
+    renderFrame();
+    EXPECT_EQ(3u, pool.getStats().misses);
+    EXPECT_EQ(2u, pool.getStats().hits);
+    EXPECT_EQ(3u, pool.getStats().count);
+
+    engine->destroy(view);
+    engine->destroy(camera);
+    engine->destroy(scene);
+    engine->destroy(renderer);
+    engine->destroy(swapChain);
+    Engine::destroy(&engine);
+}
+
+TEST(FilamentTest, CullerSimd) {
+    using filament::details::Culler;
+
+    std::default_random_engine generator(82828);
+    std::uniform_real_distribution<float> position(-150.0f, 150.0f);
+    std::uniform_real_distribution<float> size(0.1f, 10.0f);
+
+    const Frustum frustum(mat4f::frustum(-1, 1, -1, 1, 1, 100));
+    float4 const* planes = frustum.getNormalizedPlanes();
+
+    // The SIMD and scalar paths may round differently (e.g. when the compiler contracts the
+    // scalar code into FMAs), so no bound is allowed within kEpsilon of a frustum plane, where
+    // the two could legitimately disagree. Distances are computed in double precision.
+    constexpr double kEpsilon = 0.01;
+    auto isNearPlane = [planes](float3 const& c, float3 const& e, float r) {
+        for (size_t j = 0; j < 6; j++) {
+            const double3 p(planes[j].xyz);
+            const double d = dot(p, double3(c)) + planes[j].w
+                    - dot(abs(p), double3(e)) - r;
+            if (std::abs(d) < kEpsilon) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    const size_t count = 1024;
+    std::vector<float3> centers(count);
+    std::vector<float3> extents(count);
+    std::vector<float4> spheres(count);
+    for (size_t i = 0; i < count; i++) {
+        do {
+            centers[i] = { position(generator), position(generator), position(generator) };
+            extents[i] = { size(generator), size(generator), size(generator) };
+            spheres[i] = { centers[i], size(generator) };
+        } while (isNearPlane(centers[i], extents[i], 0) ||
+                 isNearPlane(spheres[i].xyz, {}, spheres[i].w));
+    }
+
+    std::vector<Culler::result_type> expected(count);
+    std::vector<Culler::result_type> results(count);
+
+    // boxes
+    std::fill(expected.begin(), expected.end(), 0);
+    std::fill(results.begin(), results.end(), 0);
+    Culler::Test::intersectsReference(expected.data(), frustum,
+            centers.data(), extents.data(), count);
+    Culler::Test::intersects(results.data(), frustum, centers.data(), extents.data(), count);
+    size_t visibleCount = 0;
+    for (size_t i = 0; i < count; i++) {
+        EXPECT_EQ(expected[i], results[i]);
+        visibleCount += expected[i];
+    }
+    EXPECT_GT(visibleCount, 0);
+    EXPECT_LT(visibleCount, count);
+
+    // spheres
+    std::fill(expected.begin(), expected.end(), 0);
+    std::fill(results.begin(), results.end(), 0);
+    Culler::Test::intersectsReference(expected.data(), frustum, spheres.data(), count);
+    Culler::Test::intersects(results.data(), frustum, spheres.data(), count);
+    visibleCount = 0;
+    for (size_t i = 0; i < count; i++) {
+        EXPECT_EQ(expected[i], results[i]);
+        visibleCount += expected[i];
+    }
+    EXPECT_GT(visibleCount, 0);
+    EXPECT_LT(visibleCount, count);
+}
+
+TEST(FilamentTest, CullingBvh) {
+    using filament::details::Culler;
+    using filament::details::CullingBvh;
+
+    JobSystem js;
+    js.adopt();
+
+    std::default_random_engine generator(82828);
+    std::uniform_real_distribution<float> position(-200.0f, 200.0f);
+    std::uniform_real_distribution<float> extent(0.1f, 10.0f);
+
+    const size_t count = 5000; // not a multiple of CullingBvh::LEAF_SIZE
+    std::vector<float3> centers(count);
+    std::vector<float3> extents(count);
+    for (size_t i = 0; i < count; i++) {
+        centers[i] = { position(generator), position(generator), position(generator) };
+        extents[i] = { extent(generator), extent(generator), extent(generator) };
+    }
+
+    std::vector<uint32_t> order(count);
+    CullingBvh::sortByLocation(order.data(), centers.data(), count);
+    std::sort(order.begin(), order.end());
+    for (size_t i = 0; i < count; i++) {
+        EXPECT_EQ(i, order[i]);
+    }
+    CullingBvh::sortByLocation(order.data(), centers.data(), count);
+    std::vector<float3> c(Culler::round(count));
+    std::vector<float3> e(Culler::round(count));
+    for (size_t i = 0; i < count; i++) {
+        c[i] = centers[order[i]];
+        e[i] = extents[order[i]];
+    }
+
+    CullingBvh bvh;
+    bvh.refit(js, c.data(), e.data(), count, true);
+    EXPECT_EQ(count, bvh.size());
+    EXPECT_FALSE(bvh.needsRebuild());
+
+    // the results must be the same as when culling each object individually
+    const Frustum frustum(mat4f::frustum(-1, 1, -1, 1, 1, 150));
+    std::vector<Culler::result_type> expected(c.size(), 0);
+    std::vector<Culler::result_type> results(c.size(), 0);
+    Culler::Test::intersects(expected.data(), frustum, c.data(), e.data(), count);
+    bvh.intersects(js, results.data(), frustum, c.data(), e.data(), 1);
+    size_t visibleCount = 0;
+    for (size_t i = 0; i < count; i++) {
+        EXPECT_EQ(expected[i] << 1, results[i]);
+        visibleCount += expected[i];
+    }
+    EXPECT_GT(visibleCount, 0);
+    EXPECT_LT(visibleCount, count);
+
+    // moving everything far apart makes the BVH degenerate
+    for (size_t i = 0; i < count; i++) {
+        c[i] *= 4.0f;
+    }
+    bvh.refit(js, c.data(), e.data(), count, false);
+    EXPECT_TRUE(bvh.needsRebuild());
+
+    js.emancipate();
+}
+
+TEST(FilamentTest, UboRanges) {
+    using filament::details::FScene;
+
+    // dirty slots are visited in increasing order, a slot can be dirtied more than once
+    const uint32_t dirty[] = { 0, 0, 1, 2, 7, 13, 13, 14, 18, 30 };
+    std::vector<FScene::UboRange> ranges;
+    std::vector<uint32_t> slots;
+    for (uint32_t slot : dirty) {
+        FScene::addDirtyUboSlot(ranges, slots, slot);
+    }
+
+    // 0-2 are adjacent, 3-6 are a small enough gap, 8-12 is not, 15-17 is, 19-29 is not
+    ASSERT_EQ(3, ranges.size());
+    EXPECT_EQ(0, ranges[0].first);
+    EXPECT_EQ(8, ranges[0].count);
+    EXPECT_EQ(13, ranges[1].first);
+    EXPECT_EQ(6, ranges[1].count);
+    EXPECT_EQ(30, ranges[2].first);
+    EXPECT_EQ(1, ranges[2].count);
+
+    // the uploaded data is the ranges packed back-to-back, each slot written exactly once
+    std::vector<uint32_t> expected;
+    for (auto const& range : ranges) {
+        for (uint32_t i = range.first; i < range.first + range.count; i++) {
+            expected.push_back(i);
+        }
+    }
+    EXPECT_EQ(expected, slots);
+}
+
+TEST(FilamentTest, InstancedRenderable) {
+    using namespace filament::details;
+
+    Engine* engine = Engine::create(Engine::Backend::NOOP);
+    EntityManager& em = EntityManager::get();
+    RenderableManager& rcm = engine->getRenderableManager();
+
+    const mat4f transforms[3] = {
+            mat4f::translate(float3{ -10, 0, 0 }),
+            mat4f::translate(float3{ 0, 0, 0 }),
+            mat4f::translate(float3{ 10, 0, 0 }) };
+
+    Entity e = em.create();
+    RenderableManager::Builder(1)
+            .boundingBox({{ 0, 0, 0 }, { 1, 1, 1 }})
+            .instances(3, transforms)
+            .build(*engine, e);
+
+    RenderableManager::Instance ri = rcm.getInstance(e);
+    EXPECT_EQ(3u, rcm.getInstanceCount(ri));
+
+    // the bounding box is the union of all instances
+    Box aabb = rcm.getAxisAlignedBoundingBox(ri);
+    EXPECT_FLOAT_EQ(-11.0f, aabb.getMin().x);
+    EXPECT_FLOAT_EQ(11.0f, aabb.getMax().x);
+    EXPECT_FLOAT_EQ(-1.0f, aabb.getMin().y);
+    EXPECT_FLOAT_EQ(1.0f, aabb.getMax().y);
+
+    const mat4f moved = mat4f::translate(float3{ 0, 20, 0 });
+    rcm.setInstanceTransforms(ri, &moved, 1, 2);
+    aabb = rcm.getAxisAlignedBoundingBox(ri);
+    EXPECT_FLOAT_EQ(1.0f, aabb.getMax().x);
+    EXPECT_FLOAT_EQ(21.0f, aabb.getMax().y);
+
+    // batches of visible instances
+    FRenderableManager::VisibleInstances instances;
+    instances.visible[FRenderableManager::Instances::COLOR].resize(CONFIG_MAX_INSTANCES + 1);
+    instances.visible[FRenderableManager::Instances::SHADOW].resize(CONFIG_MAX_INSTANCES);
+    EXPECT_EQ(2u, instances.getBatchCount(FRenderableManager::Instances::COLOR));
+    EXPECT_EQ(1u, instances.getBatchCount(FRenderableManager::Instances::SHADOW));
+    EXPECT_EQ(0u, instances.getFirstBatch(FRenderableManager::Instances::COLOR));
+    EXPECT_EQ(2u, instances.getFirstBatch(FRenderableManager::Instances::SHADOW));
+    EXPECT_EQ(CONFIG_MAX_INSTANCES,
+            instances.getBatchInstanceCount(FRenderableManager::Instances::COLOR, 0));
+    EXPECT_EQ(1u, instances.getBatchInstanceCount(FRenderableManager::Instances::COLOR, 1));
+    EXPECT_EQ(CONFIG_MAX_INSTANCES,
+            instances.getBatchInstanceCount(FRenderableManager::Instances::SHADOW, 0));
+
+    // a renderable without instances
+    Entity f = em.create();
+    RenderableManager::Builder(1)
+            .boundingBox({{ 0, 0, 0 }, { 1, 1, 1 }})
+            .build(*engine, f);
+    EXPECT_EQ(0u, rcm.getInstanceCount(rcm.getInstance(f)));
+
+    rcm.destroy(e);
+    rcm.destroy(f);
+    em.destroy(e);
+    em.destroy(f);
+    Engine::destroy(&engine);
+}
+
+TEST(FilamentTest, InstancedRenderableCulling) {
+    using namespace filament::details;
+    using Instances = FRenderableManager::Instances;
+    using VisibleInstances = FRenderableManager::VisibleInstances;
+
+    Engine* engine = Engine::create(Engine::Backend::NOOP);
+    EntityManager& em = EntityManager::get();
+    FRenderableManager& rcm = upcast(engine)->getRenderableManager();
+    SwapChain* swapChain = engine->createSwapChain(nullptr);
+    Renderer* renderer = engine->createRenderer();
+    Scene* scene = engine->createScene();
+    Camera* camera = engine->createCamera();
+    View* view = engine->createView();
+    view->setScene(scene);
+    view->setCamera(camera);
+    view->setViewport({ 0, 0, 640, 480 });
+    view->setShadowsEnabled(false);
+    camera->setProjection(90, 640.0 / 480.0, 0.1, 100);
+
+    VertexBuffer* vb = VertexBuffer::Builder()
+            .vertexCount(8)
+            .bufferCount(1)
+            .attribute(VertexAttribute::POSITION, 0, VertexBuffer::AttributeType::FLOAT3)
+            .build(*engine);
+    IndexBuffer* ib = IndexBuffer::Builder()
+            .indexCount(36)
+            .bufferType(IndexBuffer::IndexType::USHORT)
+            .build(*engine);
+    MaterialInstance const* mi = upcast(engine)->getDefaultMaterial()->getDefaultInstance();
+
+    // a 100x100 grid in front of the camera and the same grid behind it, the per-instance data
+    // of all these is much larger than what the command stream can hold in one frame.
+    const size_t gridSize = 100;
+    const size_t count = gridSize * gridSize * 2;
+    std::vector<mat4f> transforms(count);
+    for (size_t i = 0; i < count; i++) {
+        const size_t j = i % (gridSize * gridSize);
+        const float x = -10.0f + 20.0f * float(j % gridSize) / gridSize;
+        const float y = -10.0f + 20.0f * float(j / gridSize) / gridSize;
+        transforms[i] = mat4f::translate(float3{ x, y, i < count / 2 ? -20.0f : 20.0f });
+    }
+
+    Entity e = em.create();
+    RenderableManager::Builder(1)
+            .boundingBox({{ 0, 0, 0 }, { 0.05f, 0.05f, 0.05f }})
+            .geometry(0, RenderableManager::PrimitiveType::TRIANGLES, vb, ib)
+            .material(0, mi)
+            .instances(count, transforms.data())
+            .build(*engine, e);
+    scene->addEntity(e);
+
+    auto renderFrame = [&]() {
+        // frames can be skipped while the noop driver catches up
+        while (!renderer->beginFrame(swapChain)) {
+        }
+        renderer->render(view);
+        renderer->endFrame();
+    };
+
+    Instances const* instances = rcm.getInstances(rcm.getInstance(e));
+    ASSERT_NE(nullptr, instances);
+
+    // only the instances in front of the camera are visible, and they're uploaded
+    renderFrame();
+    VisibleInstances const* state = upcast(view)->getVisibleInstances(rcm.getInstance(e));
+    ASSERT_NE(nullptr, state);
+    EXPECT_EQ(count / 2, state->visible[Instances::COLOR].size());
+    EXPECT_TRUE(state->visible[Instances::SHADOW].empty());
+    EXPECT_EQ(state->visible[Instances::COLOR], state->committed[Instances::COLOR]);
+    EXPECT_EQ(0u, state->visible[Instances::COLOR].front());
+    EXPECT_EQ(count / 2 - 1, state->visible[Instances::COLOR].back());
+
+    // move the instances behind the camera in front of it, now they're all visible
+    std::vector<mat4f> moved(transforms.begin(), transforms.begin() + count / 2);
+    rcm.setInstanceTransforms(rcm.getInstance(e), moved.data(), moved.size(), count / 2);
+    renderFrame();
+    EXPECT_EQ(count, state->visible[Instances::COLOR].size());
+    EXPECT_EQ(state->visible[Instances::COLOR], state->committed[Instances::COLOR]);
+    EXPECT_EQ(instances->version, state->committedVersion);
+
+    // nothing changed, what's in the UBO is still current
+    renderFrame();
+    EXPECT_EQ(count, state->committed[Instances::COLOR].size());
+
+    engine->destroy(e);
+    em.destroy(e);
+    engine->destroy(ib);
+    engine->destroy(vb);
+    engine->destroy(view);
+    engine->destroy(camera);
+    engine->destroy(scene);
+    engine->destroy(renderer);
+    engine->destroy(swapChain);
+    Engine::destroy(&engine);
+}
+
+TEST(FilamentTest, InstancedRenderableTwoViews) {
+    using namespace filament::details;
+    using Instances = FRenderableManager::Instances;
+    using VisibleInstances = FRenderableManager::VisibleInstances;
+
+    Engine* engine = Engine::create(Engine::Backend::NOOP);
+    EntityManager& em = EntityManager::get();
+    FRenderableManager& rcm = upcast(engine)->getRenderableManager();
+    SwapChain* swapChain = engine->createSwapChain(nullptr);
+    Renderer* renderer = engine->createRenderer();
+    Scene* scene = engine->createScene();
+
+    // one view looks down -z, the other one down +z
+    Camera* cameras[2] = { engine->createCamera(), engine->createCamera() };
+    View* views[2] = { engine->createView(), engine->createView() };
+    cameras[1]->lookAt({ 0, 0, 0 }, { 0, 0, 1 }, { 0, 1, 0 });
+    for (size_t v = 0; v < 2; v++) {
+        cameras[v]->setProjection(90, 640.0 / 480.0, 0.1, 100);
+        views[v]->setScene(scene);
+        views[v]->setCamera(cameras[v]);
+        views[v]->setViewport({ 0, 0, 640, 480 });
+        views[v]->setShadowsEnabled(false);
+    }
+
+    VertexBuffer* vb = VertexBuffer::Builder()
+            .vertexCount(8)
+            .bufferCount(1)
+            .attribute(VertexAttribute::POSITION, 0, VertexBuffer::AttributeType::FLOAT3)
+            .build(*engine);
+    IndexBuffer* ib = IndexBuffer::Builder()
+            .indexCount(36)
+            .bufferType(IndexBuffer::IndexType::USHORT)
+            .build(*engine);
+    MaterialInstance const* mi = upcast(engine)->getDefaultMaterial()->getDefaultInstance();
+
+    // a 10x10 grid in front of the first view, and the same grid in front of the second one
+    const size_t gridSize = 10;
+    const size_t count = gridSize * gridSize * 2;
+    std::vector<mat4f> transforms(count);
+    for (size_t i = 0; i < count; i++) {
+        const size_t j = i % (gridSize * gridSize);
+        const float x = -10.0f + 20.0f * float(j % gridSize) / gridSize;
+        const float y = -10.0f + 20.0f * float(j / gridSize) / gridSize;
+        transforms[i] = mat4f::translate(float3{ x, y, i < count / 2 ? -20.0f : 20.0f });
+    }
+
+    Entity e = em.create();
+    RenderableManager::Builder(1)
+            .boundingBox({{ 0, 0, 0 }, { 0.05f, 0.05f, 0.05f }})
+            .geometry(0, RenderableManager::PrimitiveType::TRIANGLES, vb, ib)
+            .material(0, mi)
+            .instances(count, transforms.data())
+            .build(*engine, e);
+    scene->addEntity(e);
+    auto ri = rcm.getInstance(e);
+    Instances const* instances = rcm.getInstances(ri);
+
+    auto renderFrame = [&]() {
+        // frames can be skipped while the noop driver catches up
+        while (!renderer->beginFrame(swapChain)) {
+        }
+        renderer->render(views[0]);
+        renderer->render(views[1]);
+        renderer->endFrame();
+    };
+
+    // each view has its own visible instances in its own UBO, and rendering one view
+    // doesn't invalidate what the other one uploaded
+    for (size_t frame = 0; frame < 2; frame++) {
+        renderFrame();
+        VisibleInstances const* front = upcast(views[0])->getVisibleInstances(ri);
+        VisibleInstances const* back = upcast(views[1])->getVisibleInstances(ri);
+        ASSERT_NE(nullptr, front);
+        ASSERT_NE(nullptr, back);
+        EXPECT_NE(front->handle.getId(), back->handle.getId());
+
+        ASSERT_EQ(count / 2, front->visible[Instances::COLOR].size());
+        EXPECT_EQ(0u, front->visible[Instances::COLOR].front());
+        EXPECT_EQ(count / 2 - 1, front->visible[Instances::COLOR].back());
+        ASSERT_EQ(count / 2, back->visible[Instances::COLOR].size());
+        EXPECT_EQ(count / 2, back->visible[Instances::COLOR].front());
+        EXPECT_EQ(count - 1, back->visible[Instances::COLOR].back());
+
+        for (VisibleInstances const* state : { front, back }) {
+            EXPECT_EQ(state->visible[Instances::COLOR], state->committed[Instances::COLOR]);
+            EXPECT_EQ(instances->version, state->committedVersion);
+        }
+    }
+
+    engine->destroy(e);
+    em.destroy(e);
+    engine->destroy(ib);
+    engine->destroy(vb);
+    for (size_t v = 0; v < 2; v++) {
+        engine->destroy(views[v]);
+        engine->destroy(cameras[v]);
+    }
+    engine->destroy(scene);
+    engine->destroy(renderer);
+    engine->destroy(swapChain);
+    Engine::destroy(&engine);
+}
+
+TEST(FilamentTest, RenderableLevels) {
+    using namespace filament::details;
+
+    Engine* engine = Engine::create(Engine::Backend::NOOP);
+    EntityManager& em = EntityManager::get();
+    FRenderableManager& rcm = upcast(engine)->getRenderableManager();
+
+    Entity e = em.create();
+    RenderableManager::Builder(2)
+            .boundingBox({{ 0, 0, 0 }, { 1, 1, 1 }})
+            .levels(3)
+            .levelScreenSize(0, 0.5f)
+            .levelScreenSize(1, 0.1f)
+            .build(*engine, e);
+
+    RenderableManager::Instance ri = rcm.getInstance(e);
+    EXPECT_EQ(3u, rcm.getLevelCount(ri));
+    EXPECT_EQ(2u, rcm.getPrimitiveCount(ri, 0));
+    EXPECT_EQ(2u, rcm.getPrimitiveCount(ri, 2));
+    EXPECT_EQ(rcm.getRenderPrimitives(ri, 0).data() + 2, rcm.getRenderPrimitives(ri, 1).data());
+    EXPECT_EQ(rcm.getRenderPrimitives(ri, 1).data() + 2, rcm.getRenderPrimitives(ri, 2).data());
+
+    // the first level whose minimum size is reached, or the last one
+    FRenderableManager::Levels const* levels = rcm.getLevels(ri);
+    ASSERT_NE(nullptr, levels);
+    EXPECT_EQ(0u, levels->select(1.0f));
+    EXPECT_EQ(0u, levels->select(0.5f));
+    EXPECT_EQ(1u, levels->select(0.2f));
+    EXPECT_EQ(2u, levels->select(0.05f));
+    EXPECT_EQ(2u, levels->select(0.0f));
+
+    // a renderable with a single level
+    Entity f = em.create();
+    RenderableManager::Builder(1)
+            .boundingBox({{ 0, 0, 0 }, { 1, 1, 1 }})
+            .build(*engine, f);
+    EXPECT_EQ(1u, rcm.getLevelCount(rcm.getInstance(f)));
+    EXPECT_EQ(nullptr, rcm.getLevels(rcm.getInstance(f)));
+
+    rcm.destroy(e);
+    rcm.destroy(f);
+    em.destroy(e);
+    em.destroy(f);
+    Engine::destroy(&engine);
+}
+
+TEST(FilamentTest, RenderableLevelsSelection) {
+    using namespace filament::details;
+
+    Engine* engine = Engine::create(Engine::Backend::NOOP);
+    EntityManager& em = EntityManager::get();
+    FRenderableManager& rcm = upcast(engine)->getRenderableManager();
+    FView& view0 = *upcast(engine->createView());
+    FView& view1 = *upcast(engine->createView());
+
+    Entity e = em.create();
+    RenderableManager::Builder(2)
+            .boundingBox({{ 0, 0, 0 }, { 1, 1, 1 }})
+            .levels(3)
+            .levelScreenSize(0, 0.5f)
+            .levelScreenSize(1, 0.1f)
+            .build(*engine, e);
+    RenderableManager::Instance ri = rcm.getInstance(e);
+
+    // with this projection and an identity view, the size on screen of a renderable whose
+    // AABB's extent has unit length is 1 / distance
+    CameraInfo camera{};
+    camera.projection = mat4f::frustum(-1, 1, -1, 1, 1, 1000);
+
+    FScene::RenderableSoa soa;
+    soa.resize(1);
+    soa.elementAt<FScene::RENDERABLE_INSTANCE>(0) = ri;
+    soa.elementAt<FScene::WORLD_AABB_EXTENT>(0) = { 1, 0, 0 };
+
+    auto selectLevel = [&](FView& view, float size, bool shadowPass) {
+        soa.elementAt<FScene::WORLD_AABB_CENTER>(0) = { 0, 0, -1.0f / size };
+        view.updatePrimitivesLod(*upcast(engine), camera, soa, FView::Range{ 0, 1 }, shadowPass);
+        FRenderPrimitive const* primitives = soa.elementAt<FScene::PRIMITIVES>(0).data();
+        return size_t(primitives - rcm.getRenderPrimitives(ri, 0).data()) / 2;
+    };
+
+    View::LevelOfDetailOptions options;
+    options.hysteresis = 0.1f;
+    options.shadowLevelBias = 1;
+    view0.setLevelOfDetailOptions(options);
+    view1.setLevelOfDetailOptions(options);
+
+    // the level only changes once the size is 10% past the threshold, in either direction
+    EXPECT_EQ(0u, selectLevel(view0, 1.0f, false));
+    EXPECT_EQ(0u, selectLevel(view0, 0.48f, false));
+    EXPECT_EQ(1u, selectLevel(view0, 0.4f, false));
+    EXPECT_EQ(1u, selectLevel(view0, 0.52f, false));
+    EXPECT_EQ(0u, selectLevel(view0, 0.6f, false));
+    EXPECT_EQ(2u, selectLevel(view0, 0.01f, false));
+
+    // the shadow pass is biased towards coarser levels and doesn't affect the color pass
+    EXPECT_EQ(1u, selectLevel(view0, 1.0f, true));
+    EXPECT_EQ(2u, selectLevel(view0, 0.105f, false));
+    EXPECT_EQ(0u, selectLevel(view0, 1.0f, false));
+
+    // each view applies the hysteresis to the levels it selected
+    EXPECT_EQ(1u, selectLevel(view0, 0.4f, false));
+    EXPECT_EQ(0u, selectLevel(view1, 1.0f, false));
+    EXPECT_EQ(1u, selectLevel(view0, 0.52f, false));
+    EXPECT_EQ(0u, selectLevel(view1, 0.48f, false));
+
+    // without hysteresis, the level follows the thresholds
+    options.hysteresis = 0.0f;
+    view0.setLevelOfDetailOptions(options);
+    EXPECT_EQ(0u, selectLevel(view0, 0.52f, false));
+    EXPECT_EQ(1u, selectLevel(view0, 0.48f, false));
+
+    rcm.destroy(e);
+    em.destroy(e);
+    engine->destroy(&view0);
+    engine->destroy(&view1);
+    Engine::destroy(&engine);
+}
+
+TEST(FilamentTest, AdaptiveDepthPrepass) {
+    using namespace filament::details;
+
+    Engine* engine = Engine::create(Engine::Backend::NOOP);
+    EntityManager& em = EntityManager::get();
+    FScene* scene = upcast(engine->createScene());
+    FView* view = upcast(engine->createView());
+
+    VertexBuffer* vb = VertexBuffer::Builder()
+            .vertexCount(8)
+            .bufferCount(1)
+            .attribute(VertexAttribute::POSITION, 0, VertexBuffer::AttributeType::FLOAT3)
+            .build(*engine);
+    IndexBuffer* ib = IndexBuffer::Builder()
+            .indexCount(36)
+            .bufferType(IndexBuffer::IndexType::USHORT)
+            .build(*engine);
+    MaterialInstance const* mi = upcast(engine)->getDefaultMaterial()->getDefaultInstance();
+
+    auto createBox = [&](Box const& box) {
+        Entity e = em.create();
+        RenderableManager::Builder(1)
+                .boundingBox(box)
+                .geometry(0, RenderableManager::PrimitiveType::TRIANGLES, vb, ib)
+                .material(0, mi)
+                .build(*engine, e);
+        scene->addEntity(e);
+        return e;
+    };
+
+    // a stack of boxes filling most of the screen, and a tiny box far away
+    std::vector<Entity> occluders(8);
+    for (Entity& e : occluders) {
+        e = createBox({{ 0, 0, -10 }, { 5, 5, 5 }});
+    }
+    Entity tiny = createBox({{ 0, 0, -50 }, { 0.1f, 0.1f, 0.1f }});
+
+    CameraInfo camera;
+    camera.projection = mat4f::perspective(90, 1.0f, 0.1, 100, mat4f::Fov::HORIZONTAL);
+    Viewport vp(0, 0, 1024, 1024);
+
+    auto update = [&]() {
+        scene->prepare(mat4f{});
+        auto& soa = scene->getRenderableData();
+        return view->updateDepthPrepass(camera, soa, { 0, uint32_t(soa.size()) }, vp);
+    };
+
+    auto isOccluder = [&](Entity e) {
+        auto const& soa = scene->getRenderableData();
+        auto const* instances = soa.data<FScene::RENDERABLE_INSTANCE>();
+        auto const* masks = soa.data<FScene::VISIBLE_MASK>();
+        auto ri = upcast(engine)->getRenderableManager().getInstance(e);
+        for (size_t i = 0; i < soa.size(); i++) {
+            if (instances[i] == ri) {
+                return bool(masks[i] & (1u << FView::VISIBLE_DEPTH_OCCLUDER_BIT));
+            }
+        }
+        return false;
+    };
+
+    // lots of overdraw, the prepass pays off but only the large boxes are drawn in it
+    EXPECT_TRUE(update());
+    EXPECT_TRUE(isOccluder(occluders[0]));
+    EXPECT_FALSE(isOccluder(tiny));
+
+    // without overdraw it doesn't
+    for (size_t i = 1; i < occluders.size(); i++) {
+        scene->remove(occluders[i]);
+    }
+    EXPECT_FALSE(update());
+
+    for (Entity e : occluders) {
+        engine->destroy(e);
+    }
+    engine->destroy(tiny);
+    em.destroy(occluders.size(), occluders.data());
+    em.destroy(tiny);
+    engine->destroy(ib);
+    engine->destroy(vb);
+    engine->destroy(view);
+    engine->destroy(scene);
+    Engine::destroy(&engine);
+}
+
+TEST(FilamentTest, ShadowCascadeSplits) {
+    using namespace filament::details;
+
+    float splits[ShadowMap::MAX_CASCADE_COUNT];
+
+    // a single cascade covers the whole range
+    ShadowMap::computeCascadeSplits(splits, 1, 0.1f, 100.0f, 0.5f);
+    EXPECT_FLOAT_EQ(100.0f, splits[0]);
+
+    // uniform splits
+    ShadowMap::computeCascadeSplits(splits, 4, 1.0f, 101.0f, 0.0f);
+    EXPECT_FLOAT_EQ(26.0f, splits[0]);
+    EXPECT_FLOAT_EQ(51.0f, splits[1]);
+    EXPECT_FLOAT_EQ(76.0f, splits[2]);
+    EXPECT_FLOAT_EQ(101.0f, splits[3]);
+
+    // logarithmic splits
+    ShadowMap::computeCascadeSplits(splits, 3, 1.0f, 1000.0f, 1.0f);
+    EXPECT_NEAR(10.0f, splits[0], 1e-4f);
+    EXPECT_NEAR(100.0f, splits[1], 1e-3f);
+    EXPECT_FLOAT_EQ(1000.0f, splits[2]);
+
+    // blended splits are between both, and increasing
+    ShadowMap::computeCascadeSplits(splits, 4, 0.1f, 100.0f, 0.75f);
+    float uniformSplits[ShadowMap::MAX_CASCADE_COUNT];
+    float logSplits[ShadowMap::MAX_CASCADE_COUNT];
+    ShadowMap::computeCascadeSplits(uniformSplits, 4, 0.1f, 100.0f, 0.0f);
+    ShadowMap::computeCascadeSplits(logSplits, 4, 0.1f, 100.0f, 1.0f);
+    for (size_t i = 0; i < 3; i++) {
+        EXPECT_LT(splits[i], splits[i + 1]);
+        EXPECT_LT(logSplits[i], splits[i]);
+        EXPECT_LT(splits[i], uniformSplits[i]);
+    }
+
+    // a near plane at zero (e.g. ortho camera) falls back to uniform splits
+    ShadowMap::computeCascadeSplits(splits, 2, 0.0f, 10.0f, 1.0f);
+    EXPECT_FLOAT_EQ(5.0f, splits[0]);
+    EXPECT_FLOAT_EQ(10.0f, splits[1]);
+}
+
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -17,6 +17,7 @@
 #ifndef TNT_FILABRIDGE_UIBGENERATOR_H
 #define TNT_FILABRIDGE_UIBGENERATOR_H
 
+#include <filament/EngineEnums.h>
 
 #include <math/mat4.h>
 #include <math/vec4.h>
@@ -32,6 +33,7 @@ public:
     static UniformInterfaceBlock const& getLightsUib() noexcept;
     static UniformInterfaceBlock const& getPostProcessingUib() noexcept;
     static UniformInterfaceBlock const& getPerRenderableBonesUib() noexcept;
+    static UniformInterfaceBlock const& getPerRenderableInstancesUib() noexcept;
 };
 
 /*
@@ -50,7 +52,7 @@ struct PerViewUib { // NOLINT(cppcoreguidelines-pro-type-member-init)
     filament::math::mat4f viewFromClipMatrix;
     filament::math::mat4f clipFromWorldMatrix;
     filament::math::mat4f worldFromClipMatrix;
-    filament::math::mat4f lightFromWorldMatrix;
+    filament::math::mat4f lightFromWorldMatrix[CONFIG_MAX_SHADOW_CASCADES]; // one per cascade
 
     filament::math::float4 resolution; // viewport width, height, 1/width, 1/height
 
@@ -64,7 +66,7 @@ struct PerViewUib { // NOLINT(cppcoreguidelines-pro-type-member-init)
     filament::math::float3 lightDirection;
     uint32_t fParamsX; // stride-x
 
-    filament::math::float3 shadowBias; // constant bias, normal bias, unused
+    filament::math::float3 shadowBias; // constant bias, normal bias, cascade count
     float oneOverFroxelDimensionY;
 
     filament::math::float4 zParams; // froxel Z parameters
@@ -80,6 +82,11 @@ struct PerViewUib { // NOLINT(cppcoreguidelines-pro-type-member-init)
     alignas(16) filament::math::float4 iblSH[9]; // actually float3 entries (std140 requires float4 alignment)
 
     filament::math::float4 userTime;  // time(s), (double)time - (float)time, 0, 0
+
+    // per shadow cascade
+    filament::math::float4 cascadeSplits;     // view space z of the far plane
+    filament::math::float4 cascadeDepthScale; // 2 / light space depth range
+    filament::math::float4 cascadeTexelSize;  // texel size in world space
 };
 
 
@@ -116,6 +123,12 @@ struct PerRenderableUibBone {
     filament::math::float4 ns = { 1, 1, 1, 0 };
 };
 
+// This is not the UBO proper, but just an element of an instance array.
+struct PerRenderableUibInstance {
+    filament::math::mat4f worldFromModelMatrix;
+    filament::math::float4 worldFromModelNormalMatrix[3]; // mat3 columns, std140 layout
+};
+
 } // namespace filament
 
 #endif // TNT_FILABRIDGE_UIBGENERATOR_H
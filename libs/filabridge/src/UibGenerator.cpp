@@ -31,6 +31,13 @@ static_assert(sizeof(PerRenderableUib) % 256 == 0,
 static_assert(CONFIG_MAX_BONE_COUNT * sizeof(PerRenderableUibBone) <= 16384,
         "Bones exceed max UBO size");
 
+static_assert(CONFIG_MAX_INSTANCES * sizeof(PerRenderableUibInstance) <= 16384,
+        "Instances exceed max UBO size");
+
+// instanced draws bind a range of the instances UBO, which must be suitably aligned
+static_assert((CONFIG_MAX_INSTANCES * sizeof(PerRenderableUibInstance)) % 256 == 0,
+        "Instances UBO size should be a multiple of 256");
+
 
 UniformInterfaceBlock const& UibGenerator::getPerViewUib() noexcept  {
     // IMPORTANT NOTE: Respect std140 layout, don't update without updating Engine::PerViewUib
@@ -43,7 +50,7 @@ UniformInterfaceBlock const& UibGenerator::getPerViewUib() noexcept  {
             .add("viewFromClipMatrix",      1, UniformInterfaceBlock::Type::MAT4, Precision::HIGH)
             .add("clipFromWorldMatrix",     1, UniformInterfaceBlock::Type::MAT4, Precision::HIGH)
             .add("worldFromClipMatrix",     1, UniformInterfaceBlock::Type::MAT4, Precision::HIGH)
-            .add("lightFromWorldMatrix",    1, UniformInterfaceBlock::Type::MAT4, Precision::HIGH)
+            .add("lightFromWorldMatrix",    CONFIG_MAX_SHADOW_CASCADES, UniformInterfaceBlock::Type::MAT4, Precision::HIGH)
             // view
             .add("resolution",              1, UniformInterfaceBlock::Type::FLOAT4, Precision::HIGH)
             // camera
@@ -73,6 +80,10 @@ UniformInterfaceBlock const& UibGenerator::getPerViewUib() noexcept  {
             .add("iblSH",                   9, UniformInterfaceBlock::Type::FLOAT3)
             // user time
             .add("userTime",                1, UniformInterfaceBlock::Type::FLOAT4)
+            // shadow cascades
+            .add("cascadeSplits",           1, UniformInterfaceBlock::Type::FLOAT4, Precision::HIGH)
+            .add("cascadeDepthScale",       1, UniformInterfaceBlock::Type::FLOAT4, Precision::HIGH)
+            .add("cascadeTexelSize",        1, UniformInterfaceBlock::Type::FLOAT4, Precision::HIGH)
             .build();
     return uib;
 }
@@ -112,4 +123,13 @@ UniformInterfaceBlock const& UibGenerator::getPerRenderableBonesUib() noexcept {
     return uib;
 }
 
+UniformInterfaceBlock const& UibGenerator::getPerRenderableInstancesUib() noexcept {
+    // each instance is a mat4 followed by the 3 columns of a mat3, see PerRenderableUibInstance
+    static UniformInterfaceBlock uib = UniformInterfaceBlock::Builder()
+            .name("InstancesUniforms")
+            .add("instances", CONFIG_MAX_INSTANCES * 7, UniformInterfaceBlock::Type::FLOAT4, Precision::HIGH)
+            .build();
+    return uib;
+}
+
 } // namespace filament
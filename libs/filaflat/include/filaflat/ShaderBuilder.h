@@ -38,6 +38,10 @@ public:
     // Append a data blob to the shader. Returns true if successful.
     void appendPart(const char* data, size_t size) noexcept;
 
+    // Appends size uninitialized bytes to the shader and returns a pointer to them, so the data
+    // can be written in place. The pointer is valid until the next api call.
+    char* appendPart(size_t size) noexcept;
+
     // returns a copy of the shader string
     utils::CString getShader() const { return { mShader, mCursor }; }
 
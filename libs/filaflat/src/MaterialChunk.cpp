@@ -16,6 +16,8 @@
 
 #include "MaterialChunk.h"
 
+#include "SpirvDictionaryReader.h"
+
 #include <utils/Log.h>
 #include <private/filament/Variant.h>
 
@@ -151,12 +153,14 @@ bool MaterialChunk::getSpirvShader(Unflattener unflattener, BlobDictionary& dict
     }
 
     size_t index = pos->second;
-    size_t shaderSize;
-    const char* shaderContent = dictionary.getBlob(index, &shaderSize);
-    builder.reset();
-    builder.announce(shaderSize);
-    builder.appendPart(shaderContent, shaderSize);
-    return true;
+    if (index >= dictionary.getBlobCount()) {
+        return false;
+    }
+
+    // the blobs are decoded on demand, only the variants actually used pay for it
+    size_t compressedSize;
+    const char* compressed = dictionary.getBlob(index, &compressedSize);
+    return SpirvDictionaryReader::decode(compressed, compressedSize, builder);
 }
 
 }
@@ -50,4 +50,12 @@ void ShaderBuilder::appendPart(const char* data, size_t size) noexcept {
     mCursor += size;
 }
 
+char* ShaderBuilder::appendPart(size_t size) noexcept {
+    size_t available = mCapacity - mCursor;
+    assert(size <= available);
+    char* part = mShader + mCursor;
+    mCursor += size;
+    return part;
+}
+
 }
@@ -46,23 +46,28 @@ bool SpirvDictionaryReader::unflatten(Unflattener& f, BlobDictionary& dictionary
         if (!f.read(&compressed, &compressedSize)) {
             return false;
         }
+        dictionary.addBlob(compressed, compressedSize);
+    }
+    return true;
+}
 
+bool SpirvDictionaryReader::decode(const char* compressed, size_t compressedSize,
+        ShaderBuilder& builder) {
+    builder.reset();
 #if defined (FILAMENT_DRIVER_SUPPORTS_VULKAN)
-        size_t spirvSize = smolv::GetDecodedBufferSize(compressed, compressedSize);
-        if (spirvSize == 0) {
-            return false;
-        }
-        BlobDictionary::Blob spirv(spirvSize);
-        if (!smolv::Decode(compressed, compressedSize, spirv.data(), spirvSize)) {
-            return false;
-        }
-        dictionary.addBlob(std::move(spirv));
-#else
+    size_t spirvSize = smolv::GetDecodedBufferSize(compressed, compressedSize);
+    if (spirvSize == 0) {
+        return false;
+    }
+    builder.announce(spirvSize);
+    if (!smolv::Decode(compressed, compressedSize, builder.appendPart(spirvSize), spirvSize)) {
+        builder.reset();
         return false;
-#endif
-
     }
     return true;
+#else
+    return false;
+#endif
 }
 
 } // namespace filaflat
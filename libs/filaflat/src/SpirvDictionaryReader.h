@@ -19,15 +19,21 @@
 
 #include <filaflat/ChunkContainer.h>
 #include <filaflat/FilaflatDefs.h>
+#include <filaflat/ShaderBuilder.h>
 #include <filaflat/Unflattener.h>
 
 #include "BlobDictionary.h"
 
 namespace filaflat {
 
+// The dictionary holds the compressed SPIR-V blobs, they are decoded with decode() only when
+// a shader is requested, so the cost of loading a material doesn't depend on its variant count.
 struct SpirvDictionaryReader {
     bool unflatten(Unflattener& unflattener, BlobDictionary& dictionary);
 
+    // decodes a blob of the dictionary into builder, which is reset first
+    static bool decode(const char* compressed, size_t compressedSize, ShaderBuilder& builder);
+
     static bool unflatten(ChunkContainer const& container, BlobDictionary& blobDictionary) {
         Unflattener dictionaryUnflattener(container, filamat::ChunkType::DictionarySpirv);
         SpirvDictionaryReader dictionary;
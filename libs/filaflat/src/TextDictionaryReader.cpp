@@ -33,7 +33,7 @@ bool TextDictionaryReader::unflatten(Unflattener& f, BlobDictionary& dictionary)
             return false;
         }
         // BlobDictionary hold binary chunks and does not care if the data holds text, it is
-        // therefore crucial to include the trailing null.
+        // therefore crucial to include the trailing null, which is part of the material data.
         dictionary.addBlob(str, strlen(str) + 1);
     }
     return true;
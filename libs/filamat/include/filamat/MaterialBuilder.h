@@ -33,6 +33,10 @@
 #include <utils/compiler.h>
 #include <utils/CString.h>
 
+namespace utils {
+class JobSystem;
+}
+
 namespace filamat {
 
 struct MaterialInfo;
@@ -203,6 +207,11 @@ public:
     // build the material
     Package build() noexcept;
 
+    // build the material, the shader variants are generated and compiled in parallel using
+    // jobSystem. The calling thread must be adopted by jobSystem. The resulting package is
+    // identical to the one produced by build().
+    Package build(utils::JobSystem& jobSystem) noexcept;
+
 public:
     // The methods and types below are for internal use
     struct Parameter {
@@ -249,6 +258,8 @@ public:
     uint8_t getVariantFilter() const { return mVariantFilter; }
 
 private:
+    Package buildPackage(utils::JobSystem* jobSystem) noexcept;
+
     void prepareToBuild(MaterialInfo& info) noexcept;
 
     // Return true if:
@@ -18,6 +18,7 @@
 
 #include <vector>
 
+#include <utils/JobSystem.h>
 #include <utils/Panic.h>
 #include <utils/Log.h>
 
@@ -335,6 +336,17 @@ bool MaterialBuilder::runStaticCodeAnalysis() noexcept {
     return result;
 }
 
+// A shader to generate, and the result of its generation.
+struct ShaderJob {
+    size_t permutation;     // index in mCodeGenPermutations
+    uint8_t variant;
+    filament::driver::ShaderType stage;
+    bool ok;
+    std::string shader;     // GLSL or, in case of error, the generated code
+    std::vector<uint32_t> spirv;
+    std::string msl;
+};
+
 static void showErrorMessage(const char* materialName, uint8_t variant,
         MaterialBuilder::TargetApi targetApi, filament::driver::ShaderType shaderType,
         const std::string& shaderCode) {
@@ -352,6 +364,14 @@ static void showErrorMessage(const char* materialName, uint8_t variant,
 }
 
 Package MaterialBuilder::build() noexcept {
+    return buildPackage(nullptr);
+}
+
+Package MaterialBuilder::build(JobSystem& jobSystem) noexcept {
+    return buildPackage(&jobSystem);
+}
+
+Package MaterialBuilder::buildPackage(JobSystem* jobSystem) noexcept {
     GLSLTools::init();
 
     if (!runStaticCodeAnalysis()) {
@@ -366,9 +386,6 @@ Package MaterialBuilder::build() noexcept {
     MaterialInfo info;
     prepareToBuild(info);
 
-    // Create a postprocessor to optimize / compile to Spir-V if necessary.
-    GLSLPostProcessor postProcessor(mOptimization, mPrintShaders);
-
     // Create chunk tree.
     ChunkContainer container;
 
@@ -460,8 +477,6 @@ Package MaterialBuilder::build() noexcept {
     LineDictionary glslDictionary;
     BlobDictionary spirvDictionary;
     LineDictionary metalDictionary;
-    std::vector<uint32_t> spirv;
-    std::string msl;
 
     ShaderGenerator sg(mProperties, mVariables,
             mMaterialCode, mMaterialLineOffset, mMaterialVertexCode, mMaterialVertexLineOffset);
@@ -472,148 +487,134 @@ Package MaterialBuilder::build() noexcept {
     SimpleFieldChunk<bool> hasCustomDepth(ChunkType::MaterialHasCustomDepthShader, customDepth);
     container.addChild(&hasCustomDepth);
 
-    for (const auto& params : mCodeGenPermutations) {
-        const ShaderModel shaderModel = ShaderModel(params.shaderModel);
-        const TargetApi targetApi = params.targetApi;
-        const TargetApi codeGenTargetApi = params.codeGenTargetApi;
-
+    // List all the shaders to generate, in the order they're stored in the package.
+    std::vector<MaterialInfo> permutationInfos;
+    permutationInfos.reserve(mCodeGenPermutations.size());
+    std::vector<ShaderJob> jobs;
+    for (size_t i = 0; i < mCodeGenPermutations.size(); i++) {
         // Re-populate the set of sampler bindings for this API.
         filament::SamplerBindingMap map;
-        auto backend = static_cast<filament::driver::Backend>(params.targetApi);
+        auto backend = static_cast<filament::driver::Backend>(mCodeGenPermutations[i].targetApi);
         uint8_t offset = filament::getSamplerBindingsStart(backend);
         map.populate(offset, &info.sib, mMaterialName.c_str());
-        info.samplerBindings = std::move(map);
-
-        // Metal Shading Language is cross-compiled from Vulkan.
-        const bool targetApiNeedsSpirv =
-                (targetApi == TargetApi::VULKAN || targetApi == TargetApi::METAL);
-        const bool targetApiNeedsMsl = targetApi == TargetApi::METAL;
-        std::vector<uint32_t>* pSpirv = targetApiNeedsSpirv ? &spirv : nullptr;
-        std::string* pMsl = targetApiNeedsMsl ? &msl : nullptr;
-
-        TextEntry glslEntry{0};
-        SpirvEntry spirvEntry{0};
-        TextEntry metalEntry{0};
-
-        glslEntry.shaderModel = static_cast<uint8_t>(params.shaderModel);
-        spirvEntry.shaderModel = static_cast<uint8_t>(params.shaderModel);
-        metalEntry.shaderModel = static_cast<uint8_t>(params.shaderModel);
+        permutationInfos.push_back(info);
+        permutationInfos.back().samplerBindings = std::move(map);
 
         // apply custom variants filters
         uint8_t variantMask = ~mVariantFilter;
 
         for (uint8_t k = 0; k < filament::VARIANT_COUNT; k++) {
-
             if (filament::Variant::isReserved(k)) {
                 continue;
             }
 
-            glslEntry.variant = k;
-            spirvEntry.variant = k;
-            metalEntry.variant = k;
-
             // Remove variants for unlit materials
             uint8_t v = filament::Variant::filterVariant(
                     k & variantMask, isLit() || mShadowMultiplier);
 
             if (filament::Variant::filterVariantVertex(v) == k) {
-                // Vertex Shader
-                std::string vs = sg.createVertexProgram(
-                        shaderModel, targetApi, codeGenTargetApi, info, k,
-                        mInterpolation, mVertexDomain);
-                bool ok = postProcessor.process(vs, filament::driver::ShaderType::VERTEX,
-                        shaderModel, &vs, pSpirv, pMsl);
-                if (!ok) {
-                    showErrorMessage(mMaterialName.c_str_safe(), k, targetApi,
-                            filament::driver::ShaderType::VERTEX, vs);
-                    errorOccured = true;
-                    break;
-                }
-
-                if (targetApi == TargetApi::OPENGL) {
-                    if (codeGenTargetApi == TargetApi::VULKAN) {
-                        sg.fixupExternalSamplers(shaderModel, vs, info);
-                    }
-
-                    glslEntry.stage = filament::driver::ShaderType::VERTEX;
-                    glslEntry.shaderSize = vs.size();
-                    glslEntry.shader = (char*) malloc(glslEntry.shaderSize + 1);
-                    strcpy(glslEntry.shader, vs.c_str());
-                    glslDictionary.addText(glslEntry.shader);
-                    glslEntries.push_back(glslEntry);
-                }
-
-                if (targetApi == TargetApi::VULKAN) {
-                    assert(!spirv.empty());
-                    spirvEntry.stage = filament::driver::ShaderType::VERTEX;
-                    spirvEntry.dictionaryIndex = spirvDictionary.addBlob(spirv);
-                    spirv.clear();
-                    spirvEntries.push_back(spirvEntry);
-                }
-                if (targetApi == TargetApi::METAL) {
-                    assert(spirv.size() > 0);
-                    assert(msl.length() > 0);
-                    metalEntry.stage = filament::driver::ShaderType::VERTEX;
-                    metalEntry.shaderSize = msl.length();
-                    metalEntry.shader = (char*)malloc(metalEntry.shaderSize + 1);
-                    strcpy(metalEntry.shader, msl.c_str());
-                    spirv.clear();
-                    msl.clear();
-                    metalDictionary.addText(metalEntry.shader);
-                    metalEntries.push_back(metalEntry);
-                }
+                jobs.push_back({ i, k, filament::driver::ShaderType::VERTEX });
             }
-
             if (filament::Variant::filterVariantFragment(v) == k) {
-                // Fragment Shader
-                std::string fs = sg.createFragmentProgram(
-                        shaderModel, targetApi, codeGenTargetApi, info, k, mInterpolation);
-
-                bool ok = postProcessor.process(fs, filament::driver::ShaderType::FRAGMENT,
-                        shaderModel, &fs, pSpirv, pMsl);
-                if (!ok) {
-                    showErrorMessage(mMaterialName.c_str_safe(), k, targetApi,
-                            filament::driver::ShaderType::FRAGMENT, fs);
-                    errorOccured = true;
-                    break;
-                }
-
-                if (targetApi == TargetApi::OPENGL) {
-                    if (codeGenTargetApi == TargetApi::VULKAN) {
-                        sg.fixupExternalSamplers(shaderModel, fs, info);
-                    }
-
-                    glslEntry.stage = filament::driver::ShaderType::FRAGMENT;
-                    glslEntry.shaderSize = fs.size();
-                    glslEntry.shader = (char*) malloc(glslEntry.shaderSize + 1);
-                    strcpy(glslEntry.shader, fs.c_str());
-                    glslDictionary.addText(glslEntry.shader);
-                    glslEntries.push_back(glslEntry);
-                }
-
-                if (targetApi == TargetApi::VULKAN) {
-                    assert(!spirv.empty());
-                    spirvEntry.stage = filament::driver::ShaderType::FRAGMENT;
-                    spirvEntry.dictionaryIndex = spirvDictionary.addBlob(spirv);
-                    spirv.clear();
-                    spirvEntries.push_back(spirvEntry);
-                }
-                if (targetApi == TargetApi::METAL) {
-                    assert(spirv.size() > 0);
-                    assert(msl.length() > 0);
-                    metalEntry.stage = filament::driver::ShaderType::FRAGMENT;
-                    metalEntry.shaderSize = msl.length();
-                    metalEntry.shader = (char*)malloc(metalEntry.shaderSize + 1);
-                    strcpy(metalEntry.shader, msl.c_str());
-                    spirv.clear();
-                    msl.clear();
-                    metalDictionary.addText(metalEntry.shader);
-                    metalEntries.push_back(metalEntry);
-                }
+                jobs.push_back({ i, k, filament::driver::ShaderType::FRAGMENT });
             }
         }
     }
 
+    // Generate and compile the shaders, this is where most of the time is spent.
+    auto generate = [this, &sg, &jobs, &permutationInfos](uint32_t start, uint32_t count) {
+        for (uint32_t j = start, end = start + count; j < end; j++) {
+            ShaderJob& job = jobs[j];
+            const CodeGenParams& params = mCodeGenPermutations[job.permutation];
+            const MaterialInfo& permutationInfo = permutationInfos[job.permutation];
+            const ShaderModel shaderModel = ShaderModel(params.shaderModel);
+            const TargetApi targetApi = params.targetApi;
+            const TargetApi codeGenTargetApi = params.codeGenTargetApi;
+
+            // Metal Shading Language is cross-compiled from Vulkan.
+            const bool targetApiNeedsSpirv =
+                    (targetApi == TargetApi::VULKAN || targetApi == TargetApi::METAL);
+            const bool targetApiNeedsMsl = targetApi == TargetApi::METAL;
+
+            job.shader = job.stage == filament::driver::ShaderType::VERTEX ?
+                    sg.createVertexProgram(shaderModel, targetApi, codeGenTargetApi,
+                            permutationInfo, job.variant, mInterpolation, mVertexDomain) :
+                    sg.createFragmentProgram(shaderModel, targetApi, codeGenTargetApi,
+                            permutationInfo, job.variant, mInterpolation);
+
+            // Create a postprocessor to optimize / compile to Spir-V if necessary.
+            GLSLPostProcessor postProcessor(mOptimization, mPrintShaders);
+            job.ok = postProcessor.process(job.shader, job.stage, shaderModel, &job.shader,
+                    targetApiNeedsSpirv ? &job.spirv : nullptr,
+                    targetApiNeedsMsl ? &job.msl : nullptr);
+
+            if (job.ok && targetApi == TargetApi::OPENGL &&
+                    codeGenTargetApi == TargetApi::VULKAN) {
+                sg.fixupExternalSamplers(shaderModel, job.shader, permutationInfo);
+            }
+        }
+    };
+
+    // The printed shaders would be interleaved, so we don't use the job system to print them.
+    if (jobSystem && !mPrintShaders) {
+        auto job = jobs::parallel_for(*jobSystem, nullptr, 0, uint32_t(jobs.size()),
+                std::cref(generate), jobs::CountSplitter<1, 16>());
+        jobSystem->runAndWait(job);
+    } else {
+        generate(0, uint32_t(jobs.size()));
+    }
+
+    // Add the shaders to the dictionaries in the order they were listed, this is what makes
+    // the package identical regardless of how the shaders were generated.
+    for (ShaderJob& job : jobs) {
+        const CodeGenParams& params = mCodeGenPermutations[job.permutation];
+        const TargetApi targetApi = params.targetApi;
+
+        if (!job.ok) {
+            showErrorMessage(mMaterialName.c_str_safe(), job.variant, targetApi, job.stage,
+                    job.shader);
+            errorOccured = true;
+            continue;
+        }
+
+        if (targetApi == TargetApi::OPENGL) {
+            TextEntry glslEntry{0};
+            glslEntry.shaderModel = static_cast<uint8_t>(params.shaderModel);
+            glslEntry.variant = job.variant;
+            glslEntry.stage = job.stage;
+            glslEntry.shaderSize = job.shader.size();
+            glslEntry.shader = (char*) malloc(glslEntry.shaderSize + 1);
+            strcpy(glslEntry.shader, job.shader.c_str());
+            glslDictionary.addText(glslEntry.shader);
+            glslEntries.push_back(glslEntry);
+        }
+        if (targetApi == TargetApi::VULKAN) {
+            assert(!job.spirv.empty());
+            SpirvEntry spirvEntry{0};
+            spirvEntry.shaderModel = static_cast<uint8_t>(params.shaderModel);
+            spirvEntry.variant = job.variant;
+            spirvEntry.stage = job.stage;
+            spirvEntry.dictionaryIndex = spirvDictionary.addBlob(job.spirv);
+            spirvEntries.push_back(spirvEntry);
+        }
+        if (targetApi == TargetApi::METAL) {
+            assert(job.spirv.size() > 0);
+            assert(job.msl.length() > 0);
+            TextEntry metalEntry{0};
+            metalEntry.shaderModel = static_cast<uint8_t>(params.shaderModel);
+            metalEntry.variant = job.variant;
+            metalEntry.stage = job.stage;
+            metalEntry.shaderSize = job.msl.length();
+            metalEntry.shader = (char*)malloc(metalEntry.shaderSize + 1);
+            strcpy(metalEntry.shader, job.msl.c_str());
+            metalDictionary.addText(metalEntry.shader);
+            metalEntries.push_back(metalEntry);
+        }
+
+        // the dictionaries keep their own copy
+        job = {};
+    }
+
     // Emit GLSL chunks (TextDictionaryReader and MaterialTextChunk).
     filamat::DictionaryTextChunk dicGlslChunk(glslDictionary, ChunkType::DictionaryGlsl);
     MaterialTextChunk glslChunk(glslEntries, glslDictionary, ChunkType::MaterialGlsl);
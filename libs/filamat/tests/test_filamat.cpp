@@ -20,6 +20,18 @@
 
 #include <filamat/Enums.h>
 
+#include <filaflat/ChunkContainer.h>
+#include <filaflat/MaterialParser.h>
+#include <filaflat/ShaderBuilder.h>
+#include <filaflat/Unflattener.h>
+
+#include <utils/JobSystem.h>
+
+#include <smolv.h>
+
+#include <memory>
+#include <vector>
+
 using namespace ASTUtils;
 
 static ::testing::AssertionResult PropertyListsMatch(const MaterialBuilder::PropertyList& expected,
@@ -518,6 +530,120 @@ TEST_F(MaterialCompiler, Uv0AndUv1) {
     EXPECT_TRUE(result.isValid());
 }
 
+TEST_F(MaterialCompiler, ParallelBuildMatchesSerialBuild) {
+    std::string shaderCode(R"(
+        void material(inout MaterialInputs material) {
+            prepareMaterial(material);
+            material.baseColor = vec4(1.0);
+        }
+    )");
+
+    filamat::MaterialBuilder builder = makeBuilder(shaderCode);
+    builder.targetApi(filamat::MaterialBuilder::TargetApi::ALL);
+    filamat::Package serial = builder.build();
+    ASSERT_TRUE(serial.isValid());
+
+    utils::JobSystem js;
+    js.adopt();
+    filamat::Package parallel = builder.build(js);
+    js.emancipate();
+    ASSERT_TRUE(parallel.isValid());
+
+    // the shaders must be stored in the same order regardless of how they were compiled
+    ASSERT_EQ(serial.getSize(), parallel.getSize());
+    EXPECT_EQ(0, memcmp(serial.getData(), parallel.getData(), serial.getSize()));
+}
+
+#if defined(FILAMENT_DRIVER_SUPPORTS_VULKAN)
+TEST_F(MaterialCompiler, SpirvOnDemandDecodeMatchesEagerDecode) {
+    using namespace filament::driver;
+
+    std::string shaderCode(R"(
+        void material(inout MaterialInputs material) {
+            prepareMaterial(material);
+            material.baseColor = vec4(1.0);
+        }
+    )");
+
+    filamat::MaterialBuilder builder = makeBuilder(shaderCode);
+    builder.targetApi(filamat::MaterialBuilder::TargetApi::VULKAN);
+    filamat::Package package = builder.build();
+    ASSERT_TRUE(package.isValid());
+
+    // the parser reads from its own copy of the material, so the caller's buffer can go away
+    // before any shader is decoded
+    std::unique_ptr<uint8_t[]> source(new uint8_t[package.getSize()]);
+    memcpy(source.get(), package.getData(), package.getSize());
+    std::unique_ptr<filaflat::MaterialParser> parser(new filaflat::MaterialParser(
+            Backend::VULKAN, source.get(), package.getSize()));
+    memset(source.get(), 0, package.getSize());
+    source.reset();
+    ASSERT_TRUE(parser->parse());
+
+    // decode every blob of the dictionary upfront, straight from the package
+    filaflat::ChunkContainer container(package.getData(), package.getSize());
+    ASSERT_TRUE(container.parse());
+    std::vector<std::vector<char>> eager;
+    {
+        filaflat::Unflattener f(container, filamat::ChunkType::DictionarySpirv);
+        uint32_t compressionScheme = 0;
+        uint32_t blobCount = 0;
+        ASSERT_TRUE(f.read(&compressionScheme));
+        ASSERT_EQ(1u, compressionScheme);
+        ASSERT_TRUE(f.read(&blobCount));
+        ASSERT_GT(blobCount, 0u);
+        for (uint32_t i = 0; i < blobCount; i++) {
+            const char* compressed;
+            size_t compressedSize;
+            ASSERT_TRUE(f.read(&compressed, &compressedSize));
+            std::vector<char> spirv(smolv::GetDecodedBufferSize(compressed, compressedSize));
+            ASSERT_FALSE(spirv.empty());
+            ASSERT_TRUE(smolv::Decode(compressed, compressedSize, spirv.data(), spirv.size()));
+            eager.push_back(std::move(spirv));
+        }
+    }
+
+    // each shader of the index is decoded on demand from the blob it references
+    struct Entry {
+        uint8_t shaderModel;
+        uint8_t variant;
+        uint8_t stage;
+        uint32_t blobIndex;
+    };
+    std::vector<Entry> entries;
+    {
+        filaflat::Unflattener f(container, filamat::ChunkType::MaterialSpirv);
+        uint64_t shaderCount = 0;
+        ASSERT_TRUE(f.read(&shaderCount));
+        ASSERT_GT(shaderCount, 0u);
+        for (uint64_t i = 0; i < shaderCount; i++) {
+            Entry entry{};
+            ASSERT_TRUE(f.read(&entry.shaderModel));
+            ASSERT_TRUE(f.read(&entry.variant));
+            ASSERT_TRUE(f.read(&entry.stage));
+            ASSERT_TRUE(f.read(&entry.blobIndex));
+            ASSERT_LT(entry.blobIndex, eager.size());
+            entries.push_back(entry);
+        }
+    }
+
+    std::vector<std::unique_ptr<filaflat::ShaderBuilder>> lazy;
+    for (Entry const& entry : entries) {
+        lazy.emplace_back(new filaflat::ShaderBuilder());
+        ASSERT_TRUE(parser->getShader(ShaderModel(entry.shaderModel), entry.variant,
+                ShaderType(entry.stage), *lazy.back()));
+    }
+
+    // the decoded shaders are owned by the builders and outlive the parser and its dictionary
+    parser.reset();
+    for (size_t i = 0; i < entries.size(); i++) {
+        std::vector<char> const& expected = eager[entries[i].blobIndex];
+        ASSERT_EQ(expected.size(), lazy[i]->size());
+        EXPECT_EQ(0, memcmp(expected.data(), lazy[i]->c_str(), expected.size()));
+    }
+}
+#endif
+
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -23,6 +23,10 @@
 #include <map>
 #include <string>
 
+namespace utils {
+    class JobSystem;
+}
+
 namespace filament {
     class Engine;
     class VertexBuffer;
@@ -54,11 +58,25 @@ public:
      * file cannot be matched to a material in the registry, a default material is
      * used instead. The default material can be overridden by adding a material
      * named "DefaultMaterial" to the registry.
+     *
+     * The file is memory-mapped and its content is handed directly to the vertex and index
+     * buffers, it is unmapped once they've been uploaded. This call doesn't wait for the GPU.
      */
     static Mesh loadMeshFromFile(filament::Engine* engine,
             const utils::Path& path,
             MaterialRegistry& materials);
 
+    /**
+     * Loads count filamesh renderables from the specified files into meshes, as
+     * loadMeshFromFile() does. The files are mapped and decompressed concurrently on the
+     * specified job system, which the calling thread must have adopted. The buffers and
+     * renderables are then created on the calling thread, which must be the engine's thread.
+     * A file that can't be loaded results in an empty Mesh.
+     */
+    static void loadMeshesFromFiles(filament::Engine* engine, utils::JobSystem& js,
+            const utils::Path* paths, size_t count,
+            MaterialRegistry& materials, Mesh* meshes);
+
     /**
      * Loads a filamesh renderable from an in-memory buffer. The material registry
      * can be used to provide named materials. If a material found in the filamesh
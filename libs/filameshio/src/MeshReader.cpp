@@ -19,7 +19,6 @@
 
 #include <filament/Box.h>
 #include <filament/Engine.h>
-#include <filament/Fence.h>
 #include <filament/Material.h>
 #include <filament/MaterialInstance.h>
 #include <filament/RenderableManager.h>
@@ -27,9 +26,13 @@
 #include <meshoptimizer.h>
 
 #include <utils/EntityManager.h>
+#include <utils/JobSystem.h>
 #include <utils/Log.h>
 #include <utils/Path.h>
 
+#include <atomic>
+#include <cstring>
+#include <limits>
 #include <string>
 #include <vector>
 
@@ -40,6 +43,13 @@
 #    include <io.h>
 #endif
 
+#if !defined(WIN32) && !defined(__EMSCRIPTEN__)
+#    include <sys/mman.h>
+#    define HAS_MMAP 1
+#else
+#    define HAS_MMAP 0
+#endif
+
 using namespace filament;
 using namespace filamesh;
 using namespace filament::math;
@@ -53,109 +63,315 @@ static size_t fileSize(int fd) {
     return filesize;
 }
 
-namespace filamesh {
+namespace {
+
+// The content of a filamesh file, memory-mapped when possible. The file is reference counted:
+// the loader holds one reference, and each buffer descriptor pointing into the file holds
+// another one, which is released by the descriptor's callback once the data has been consumed.
+class MeshFile {
+public:
+    static MeshFile* open(const utils::Path& path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return nullptr;
+        }
+        const size_t size = fileSize(fd);
+        void* data = nullptr;
+#if HAS_MMAP
+        data = size ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+        data = data == MAP_FAILED ? nullptr : data;
+#else
+        data = malloc(size);
+        if (data && size_t(read(fd, data, size)) != size) {
+            free(data);
+            data = nullptr;
+        }
+#endif
+        close(fd);
+        return data ? new MeshFile(data, size) : nullptr;
+    }
 
-MeshReader::Mesh MeshReader::loadMeshFromFile(filament::Engine* engine, const utils::Path& path,
-        MaterialRegistry& materials) {
+    void const* data() const noexcept { return mData; }
+    size_t size() const noexcept { return mSize; }
 
-    Mesh mesh;
+    void acquire() noexcept {
+        mRefCount.fetch_add(1, std::memory_order_relaxed);
+    }
 
-    int fd = open(path.c_str(), O_RDONLY);
+    void release() noexcept {
+        if (mRefCount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            delete this;
+        }
+    }
 
-    size_t size = fileSize(fd);
-    char* data = (char*) malloc(size);
-    read(fd, data, size);
+    // a MeshReader::Callback, user is the MeshFile
+    static void release(void*, size_t, void* user) {
+        static_cast<MeshFile*>(user)->release();
+    }
 
-    if (data) {
-        char *p = data;
-        char *magic = p;
-        p += sizeof(MAGICID);
+private:
+    MeshFile(void* data, size_t size) noexcept : mData(data), mSize(size) { }
 
-        if (!strncmp(MAGICID, magic, 8)) {
-            mesh = loadMeshFromBuffer(engine, data, nullptr, nullptr, materials);
-        }
+    ~MeshFile() noexcept {
+#if HAS_MMAP
+        munmap(mData, mSize);
+#else
+        free(mData);
+#endif
+    }
 
-        Fence::waitAndDestroy(engine->createFence());
-        free(data);
+    void* mData;
+    size_t mSize;
+    std::atomic<uint32_t> mRefCount = { 1 };
+};
+
+// A parsed filamesh, with its compressed buffers decoded. Parsing and decoding only touch the
+// CPU and can happen on any thread, the buffers and renderable are created later by buildMesh().
+struct DecodedMesh {
+    Header const* header = nullptr;
+    Part const* parts = nullptr;
+    std::vector<std::string> partsMaterial;
+
+    // the vertices and indices in the source data
+    void const* vertexData = nullptr;
+    void const* indexData = nullptr;
+
+    // the decoded vertices and indices if the source data is compressed, allocated with malloc()
+    void* vertices = nullptr;
+    size_t verticesSize = 0;
+    void* indices = nullptr;
+    size_t indicesSize = 0;
+
+    DecodedMesh() noexcept = default;
+    DecodedMesh(DecodedMesh const&) = delete;
+    DecodedMesh& operator=(DecodedMesh const&) = delete;
+
+    ~DecodedMesh() noexcept {
+        free(vertices);
+        free(indices);
     }
-    close(fd);
+};
 
-    return mesh;
-}
+// Parses the given filamesh data and decodes its buffers if they're compressed. Every offset
+// and size read from the data is checked against size, which is SIZE_MAX if it's unknown.
+// Returns false if the data is malformed.
+bool decodeMesh(void const* data, size_t size, DecodedMesh& mesh) {
+    const uint8_t* p = (const uint8_t*) data;
+    size_t remaining = size;
 
-MeshReader::Mesh MeshReader::loadMeshFromBuffer(filament::Engine* engine,
-        void const* data, Callback destructor, void* user,
-        MaterialInstance* defaultMaterial) {
-    MaterialRegistry reg;
-    reg[DEFAULT_MATERIAL] = defaultMaterial;
-    return loadMeshFromBuffer(engine, data, destructor, user, reg);
-}
+    // advances p by n bytes, returns false if there aren't that many left
+    auto skip = [&p, &remaining](uint64_t n) {
+        if (n > remaining) {
+            return false;
+        }
+        p += n;
+        remaining -= size_t(n);
+        return true;
+    };
+
+    auto readUint32 = [&p, &skip](uint32_t* value) {
+        uint8_t const* src = p;
+        if (!skip(sizeof(uint32_t))) {
+            return false;
+        }
+        memcpy(value, src, sizeof(uint32_t));
+        return true;
+    };
 
-MeshReader::Mesh MeshReader::loadMeshFromBuffer(filament::Engine* engine,
-        void const* data, Callback destructor, void* user,
-        MaterialRegistry& materials) {
-    const uint8_t* p = (const uint8_t*) data;
-    if (strncmp(MAGICID, (const char *) p, 8)) {
+    auto truncated = []() {
+        utils::slog.e << "Mesh data is truncated or corrupt." << utils::io::endl;
+        return false;
+    };
+
+    if (remaining < 8 || strncmp(MAGICID, (const char *) p, 8)) {
         utils::slog.e << "Magic string not found." << utils::io::endl;
-        return {};
+        return false;
     }
     p += 8;
+    remaining -= 8;
 
-    Header* header = (Header*) p;
-    p += sizeof(Header);
+    Header const* header = (Header const*) p;
+    if (!skip(sizeof(Header))) {
+        return truncated();
+    }
 
     uint8_t const* vertexData = p;
-    p += header->vertexSize;
+    if (!skip(header->vertexSize)) {
+        return truncated();
+    }
 
     uint8_t const* indices = p;
-    p += header->indexSize;
+    if (!skip(header->indexSize)) {
+        return truncated();
+    }
 
-    Part* parts = (Part*) p;
-    p += header->parts * sizeof(Part);
+    Part const* parts = (Part const*) p;
+    if (!skip(uint64_t(header->parts) * sizeof(Part))) {
+        return truncated();
+    }
 
-    uint32_t materialCount = (uint32_t) *p;
-    p += sizeof(uint32_t);
+    uint32_t materialCount = 0;
+    if (!readUint32(&materialCount)) {
+        return truncated();
+    }
 
-    std::vector<std::string> partsMaterial(materialCount);
     for (size_t i = 0; i < materialCount; i++) {
-        uint32_t nameLength = (uint32_t) *p;
-        p += sizeof(uint32_t);
-        partsMaterial[i] = (const char*) p;
-        p += nameLength + 1; // null terminated
+        uint32_t nameLength = 0;
+        if (!readUint32(&nameLength)) {
+            return truncated();
+        }
+        const char* name = (const char*) p;
+        if (!skip(uint64_t(nameLength) + 1) || name[nameLength] != 0) { // null terminated
+            return truncated();
+        }
+        mesh.partsMaterial.emplace_back(name, nameLength);
     }
 
-    Mesh mesh;
+    // the vertex attributes must be within the vertex data, or the decoded vertices
+    constexpr uint32_t uintmax = std::numeric_limits<uint32_t>::max();
+    const bool hasUV1 = header->offsetUV1 != uintmax && header->strideUV1 != uintmax;
+    const size_t decodedVertexSize = sizeof(half4) + sizeof(short4) + sizeof(ubyte4) +
+            sizeof(ushort2) + (hasUV1 ? sizeof(ushort2) : 0);
+    const uint64_t verticesSize = (header->flags & COMPRESSION) ?
+            uint64_t(decodedVertexSize) * header->vertexCount : header->vertexSize;
+    if (header->vertexCount) {
+        auto fits = [header, verticesSize](uint32_t offset, uint32_t stride, size_t attributeSize) {
+            const uint64_t last = uint64_t(header->vertexCount - 1) * stride + offset;
+            return last + attributeSize <= verticesSize;
+        };
+        if (!fits(header->offsetPosition, header->stridePosition, sizeof(half4)) ||
+            !fits(header->offsetTangents, header->strideTangents, sizeof(short4)) ||
+            !fits(header->offsetColor, header->strideColor, sizeof(ubyte4)) ||
+            !fits(header->offsetUV0, header->strideUV0, sizeof(ushort2)) ||
+            (hasUV1 && !fits(header->offsetUV1, header->strideUV1, sizeof(ushort2)))) {
+            return truncated();
+        }
+    }
 
-    mesh.indexBuffer = IndexBuffer::Builder()
-            .indexCount(header->indexCount)
-            .bufferType(header->indexType == UI16 ? IndexBuffer::IndexType::USHORT
-                    : IndexBuffer::IndexType::UINT)
-            .build(*engine);
+    // the indices must be within the index data, and the parts' within the indices
+    const size_t indexSize = header->indexType == UI16 ? sizeof(uint16_t) : sizeof(uint32_t);
+    if (!(header->flags & COMPRESSION) &&
+            uint64_t(header->indexCount) * indexSize > header->indexSize) {
+        return truncated();
+    }
+    for (size_t i = 0; i < header->parts; i++) {
+        if (uint64_t(parts[i].offset) + parts[i].indexCount > header->indexCount) {
+            return truncated();
+        }
+    }
+
+    mesh.header = header;
+    mesh.parts = parts;
+    mesh.vertexData = vertexData;
+    mesh.indexData = indices;
+
+    if (!(header->flags & COMPRESSION)) {
+        return true;
+    }
 
     // If the index buffer is compressed, then decode the indices into a temporary buffer.
-    // The user callback can be called immediately afterwards because the source data does not get
-    // passed to the GPU.
     const size_t indicesSize = header->indexSize;
-    if (header->flags & COMPRESSION) {
-        size_t indexSize = header->indexType == UI16 ? sizeof(uint16_t) : sizeof(uint32_t);
+    {
         size_t indexCount = header->indexCount;
-        size_t uncompressedSize = indexSize * indexCount;
-        void* uncompressed = malloc(uncompressedSize);
-        int err = meshopt_decodeIndexBuffer(uncompressed, indexCount, indexSize, indices,
+        mesh.indicesSize = indexSize * indexCount;
+        mesh.indices = malloc(mesh.indicesSize);
+        if (!mesh.indices) {
+            return truncated();
+        }
+        int err = meshopt_decodeIndexBuffer(mesh.indices, indexCount, indexSize, indices,
                 indicesSize);
         if (err) {
             utils::slog.e << "Unable to decode index buffer." << utils::io::endl;
-            return {};
+            return false;
         }
+    }
+
+    // If the vertex buffer is compressed, then decode the vertices into a temporary buffer.
+    {
+        if (header->vertexSize < sizeof(CompressionHeader)) {
+            return truncated();
+        }
+        const size_t compressedSize = header->vertexSize - sizeof(CompressionHeader);
+        size_t vertexSize = decodedVertexSize;
+        size_t vertexCount = header->vertexCount;
+        mesh.verticesSize = vertexSize * vertexCount;
+        mesh.vertices = malloc(mesh.verticesSize);
+        if (!mesh.vertices) {
+            return truncated();
+        }
+        const uint8_t* srcdata = vertexData + sizeof(CompressionHeader);
+        int err = 0;
+        if (header->flags & INTERLEAVED) {
+            err |= meshopt_decodeVertexBuffer(mesh.vertices, vertexCount, vertexSize, srcdata,
+                    compressedSize);
+        } else {
+            const CompressionHeader* sizes = (CompressionHeader*) vertexData;
+            if (uint64_t(sizes->positions) + sizes->tangents + sizes->colors + sizes->uv0 +
+                    sizes->uv1 > compressedSize) {
+                return truncated();
+            }
+            uint8_t* dstdata = (uint8_t*) mesh.vertices;
+            auto decode = meshopt_decodeVertexBuffer;
+
+            err |= decode(dstdata, vertexCount, sizeof(half4), srcdata, sizes->positions);
+            srcdata += sizes->positions;
+            dstdata += sizeof(half4) * vertexCount;
+
+            err |= decode(dstdata, vertexCount, sizeof(short4), srcdata, sizes->tangents);
+            srcdata += sizes->tangents;
+            dstdata += sizeof(short4) * vertexCount;
+
+            err |= decode(dstdata, vertexCount, sizeof(ubyte4), srcdata, sizes->colors);
+            srcdata += sizes->colors;
+            dstdata += sizeof(ubyte4) * vertexCount;
+
+            err |= decode(dstdata, vertexCount, sizeof(ushort2), srcdata, sizes->uv0);
+
+            if (sizes->uv1) {
+                srcdata += sizes->uv0;
+                dstdata += sizeof(ushort2) * vertexCount;
+                err |= decode(dstdata, vertexCount, sizeof(ushort2), srcdata, sizes->uv1);
+            }
+        }
+        if (err) {
+            utils::slog.e << "Unable to decode vertex buffer." << utils::io::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Creates the buffers and renderable of a decoded mesh, this must be called from the engine's
+// thread. The destructor is called once for the source index data, and once for the source
+// vertex data when they're no longer needed.
+MeshReader::Mesh buildMesh(filament::Engine* engine, DecodedMesh& decoded,
+        MeshReader::Callback destructor, void* user,
+        MeshReader::MaterialRegistry& materials) {
+    Header const* header = decoded.header;
+    Part const* parts = decoded.parts;
+
+    MeshReader::Mesh mesh;
+
+    mesh.indexBuffer = IndexBuffer::Builder()
+            .indexCount(header->indexCount)
+            .bufferType(header->indexType == UI16 ? IndexBuffer::IndexType::USHORT
+                    : IndexBuffer::IndexType::UINT)
+            .build(*engine);
+
+    // The user callback can be called immediately for compressed indices because the source
+    // data does not get passed to the GPU.
+    auto freecb = [](void* buffer, size_t size, void* user) { free(buffer); };
+    const size_t indicesSize = header->indexSize;
+    if (decoded.indices) {
         if (destructor) {
-            destructor((void*) indices, indicesSize, user);
+            destructor((void*) decoded.indexData, indicesSize, user);
         }
-        auto freecb = [](void* buffer, size_t size, void* user) { free(buffer); };
-        mesh.indexBuffer->setBuffer(*engine,
-                IndexBuffer::BufferDescriptor(uncompressed, uncompressedSize, freecb, nullptr));
+        mesh.indexBuffer->setBuffer(*engine, IndexBuffer::BufferDescriptor(
+                decoded.indices, decoded.indicesSize, freecb, nullptr));
+        decoded.indices = nullptr;
     } else {
         mesh.indexBuffer->setBuffer(*engine,
-                IndexBuffer::BufferDescriptor(indices, indicesSize, destructor, user));
+                IndexBuffer::BufferDescriptor(decoded.indexData, indicesSize, destructor, user));
     }
 
     VertexBuffer::Builder vbb;
@@ -190,59 +406,18 @@ MeshReader::Mesh MeshReader::loadMeshFromBuffer(filament::Engine* engine,
 
     mesh.vertexBuffer = vbb.build(*engine);
 
-    // If the vertex buffer is compressed, then decode the vertices into a temporary buffer.
-    // The user callback can be called immediately afterwards because the source data does not get
-    // passed to the GPU.
+    // Same as above for compressed vertices.
     const size_t verticesSize = header->vertexSize;
-    if (header->flags & COMPRESSION) {
-        size_t vertexSize = sizeof(half4) + sizeof(short4) + sizeof(ubyte4) + sizeof(ushort2) +
-                (hasUV1 ? sizeof(ushort2) : 0);
-        size_t vertexCount = header->vertexCount;
-        size_t uncompressedSize = vertexSize * vertexCount;
-        void* uncompressed = malloc(uncompressedSize);
-        const uint8_t* srcdata = vertexData + sizeof(CompressionHeader);
-        int err = 0;
-        if (header->flags & INTERLEAVED) {
-            err |= meshopt_decodeVertexBuffer(uncompressed, vertexCount, vertexSize, srcdata,
-                    vertexSize);
-        } else {
-            const CompressionHeader* sizes = (CompressionHeader*) vertexData;
-            uint8_t* dstdata = (uint8_t*) uncompressed;
-            auto decode = meshopt_decodeVertexBuffer;
-
-            err |= decode(dstdata, vertexCount, sizeof(half4), srcdata, sizes->positions);
-            srcdata += sizes->positions;
-            dstdata += sizeof(half4) * vertexCount;
-
-            err |= decode(dstdata, vertexCount, sizeof(short4), srcdata, sizes->tangents);
-            srcdata += sizes->tangents;
-            dstdata += sizeof(short4) * vertexCount;
-
-            err |= decode(dstdata, vertexCount, sizeof(ubyte4), srcdata, sizes->colors);
-            srcdata += sizes->colors;
-            dstdata += sizeof(ubyte4) * vertexCount;
-
-            err |= decode(dstdata, vertexCount, sizeof(ushort2), srcdata, sizes->uv0);
-
-            if (sizes->uv1) {
-                srcdata += sizes->uv0;
-                dstdata += sizeof(ushort2) * vertexCount;
-                err |= decode(dstdata, vertexCount, sizeof(ushort2), srcdata, sizes->uv1);
-            }
-        }
-        if (err) {
-            utils::slog.e << "Unable to decode vertex buffer." << utils::io::endl;
-            return {};
-        }
+    if (decoded.vertices) {
         if (destructor) {
-            destructor((void*) vertexData, verticesSize, user);
+            destructor((void*) decoded.vertexData, verticesSize, user);
         }
-        auto freecb = [](void* buffer, size_t size, void* user) { free(buffer); };
-        mesh.vertexBuffer->setBufferAt(*engine, 0,
-                IndexBuffer::BufferDescriptor(uncompressed, uncompressedSize, freecb, nullptr));
+        mesh.vertexBuffer->setBufferAt(*engine, 0, VertexBuffer::BufferDescriptor(
+                decoded.vertices, decoded.verticesSize, freecb, nullptr));
+        decoded.vertices = nullptr;
     } else {
         mesh.vertexBuffer->setBufferAt(*engine, 0,
-                VertexBuffer::BufferDescriptor(vertexData, verticesSize, destructor, user));
+                VertexBuffer::BufferDescriptor(decoded.vertexData, verticesSize, destructor, user));
     }
 
     mesh.renderable = utils::EntityManager::get().create();
@@ -254,7 +429,8 @@ MeshReader::Mesh MeshReader::loadMeshFromBuffer(filament::Engine* engine,
         builder.geometry(i, RenderableManager::PrimitiveType::TRIANGLES,
                             mesh.vertexBuffer, mesh.indexBuffer, parts[i].offset,
                             parts[i].minIndex, parts[i].maxIndex, parts[i].indexCount);
-        const auto& materialName = partsMaterial[i];
+        const auto& materialName = i < decoded.partsMaterial.size() ?
+                decoded.partsMaterial[i] : std::string(DEFAULT_MATERIAL);
         const auto miter = materials.find(materialName);
         if (miter == materials.end()) {
             builder.material(i, defaultmi);
@@ -268,4 +444,81 @@ MeshReader::Mesh MeshReader::loadMeshFromBuffer(filament::Engine* engine,
     return mesh;
 }
 
+// Builds a mesh decoded from file, the buffers keep the file alive until they've been uploaded.
+MeshReader::Mesh buildMesh(filament::Engine* engine, DecodedMesh& decoded, MeshFile* file,
+        MeshReader::MaterialRegistry& materials) {
+    // one reference for the indices and one for the vertices
+    file->acquire();
+    file->acquire();
+    return buildMesh(engine, decoded, &MeshFile::release, file, materials);
+}
+
+} // anonymous namespace
+
+namespace filamesh {
+
+MeshReader::Mesh MeshReader::loadMeshFromFile(filament::Engine* engine, const utils::Path& path,
+        MaterialRegistry& materials) {
+    Mesh mesh;
+    MeshFile* file = MeshFile::open(path);
+    if (file) {
+        DecodedMesh decoded;
+        if (decodeMesh(file->data(), file->size(), decoded)) {
+            mesh = buildMesh(engine, decoded, file, materials);
+        }
+        file->release();
+    }
+    return mesh;
+}
+
+void MeshReader::loadMeshesFromFiles(filament::Engine* engine, utils::JobSystem& js,
+        const utils::Path* paths, size_t count, MaterialRegistry& materials, Mesh* meshes) {
+    struct Pending {
+        MeshFile* file = nullptr;
+        DecodedMesh decoded;
+        bool valid = false;
+    };
+    std::vector<Pending> pending(count);
+
+    // map and decode the files concurrently, this doesn't involve the engine
+    auto decode = [paths, &pending](uint32_t start, uint32_t n) {
+        for (uint32_t i = start, e = start + n; i < e; i++) {
+            Pending& p = pending[i];
+            p.file = MeshFile::open(paths[i]);
+            p.valid = p.file && decodeMesh(p.file->data(), p.file->size(), p.decoded);
+        }
+    };
+    auto* job = utils::jobs::parallel_for(js, nullptr, 0, uint32_t(count),
+            std::cref(decode), utils::jobs::CountSplitter<1>());
+    js.runAndWait(job);
+
+    // then create the buffers and renderables on the engine's thread
+    for (size_t i = 0; i < count; i++) {
+        Pending& p = pending[i];
+        meshes[i] = p.valid ? buildMesh(engine, p.decoded, p.file, materials) : Mesh{};
+        if (p.file) {
+            p.file->release();
+        }
+    }
+}
+
+MeshReader::Mesh MeshReader::loadMeshFromBuffer(filament::Engine* engine,
+        void const* data, Callback destructor, void* user,
+        MaterialInstance* defaultMaterial) {
+    MaterialRegistry reg;
+    reg[DEFAULT_MATERIAL] = defaultMaterial;
+    return loadMeshFromBuffer(engine, data, destructor, user, reg);
+}
+
+MeshReader::Mesh MeshReader::loadMeshFromBuffer(filament::Engine* engine,
+        void const* data, Callback destructor, void* user,
+        MaterialRegistry& materials) {
+    // the size of the buffer is unknown
+    DecodedMesh decoded;
+    if (!decodeMesh(data, std::numeric_limits<size_t>::max(), decoded)) {
+        return {};
+    }
+    return buildMesh(engine, decoded, destructor, user, materials);
+}
+
 } // namespace filamesh
@@ -27,8 +27,13 @@
 #include <math/quat.h>
 #include <math/vec3.h>
 
+#include <utils/JobSystem.h>
+#include <utils/Path.h>
+
 #include <gtest/gtest.h>
 
+#include <cstdlib>
+#include <fstream>
 #include <strstream>
 
 using namespace filament;
@@ -108,13 +113,22 @@ class FilameshTest : public testing::Test {
 protected:
     void SetUp() override {
         engine = Engine::create(Engine::Backend::NOOP);
+        const char* dir = getenv("TMPDIR");
+        dir = dir ? dir : getenv("TEMP");
+        meshPath = utils::Path(dir ? dir : "/tmp").concat("FilameshTest.filamesh");
     }
 
     void TearDown() override {
         Engine::destroy(&engine);
+        if (meshPath.exists()) {
+            meshPath.unlinkFile();
+        }
     }
 
     Engine* engine = nullptr;
+
+    // temporary file the tests can write a mesh to
+    utils::Path meshPath;
 };
 
 template<typename T>
@@ -122,6 +136,48 @@ void write(std::ostream& out, const T* data, size_t nbytes) {
     out.write((const char*) data, nbytes);
 }
 
+// Header of a single-triangle mesh made of interleavedVertices, with 1 UV set
+static Header interleavedHeader() {
+    return Header {
+        .version = VERSION,
+        .parts = 1,
+        .aabb = unitBox,
+        .flags = INTERLEAVED | TEXCOORD_SNORM16,
+        .offsetPosition = offsetof(InterleavedVertex, position),
+        .offsetTangents = offsetof(InterleavedVertex, tangent),
+        .offsetColor = offsetof(InterleavedVertex, color),
+        .offsetUV0 = offsetof(InterleavedVertex, uv0),
+        .offsetUV1 = maxint,
+        .stridePosition = sizeof(InterleavedVertex),
+        .strideTangents = sizeof(InterleavedVertex),
+        .strideColor = sizeof(InterleavedVertex),
+        .strideUV0 = sizeof(InterleavedVertex),
+        .strideUV1 = maxint,
+        .vertexCount = vertexCount,
+        .vertexSize = sizeof(interleavedVertices),
+        .indexType = IndexType::UI16,
+        .indexCount = 3,
+        .indexSize = sizeof(uint16_t) * 3
+    };
+}
+
+// Serializes the interleaved single-triangle mesh with one "DefaultMaterial"
+static void writeInterleavedMesh(std::ostream& stream) {
+    const Header header = interleavedHeader();
+    const uint32_t nmats = 1;
+    const string matname = "DefaultMaterial";
+    const uint32_t matnamelength = matname.size();
+
+    write(stream, MAGICID, sizeof(MAGICID));
+    write(stream, &header, sizeof(header));
+    write(stream, interleavedVertices, sizeof(interleavedVertices));
+    write(stream, indices, sizeof(indices));
+    write(stream, parts, sizeof(parts));
+    write(stream, &nmats, sizeof(nmats));
+    write(stream, &matnamelength, sizeof(matnamelength));
+    write(stream, matname.c_str(), matnamelength + 1);
+}
+
 TEST_F(FilameshTest, NonInterleaved) {
     // Serialize a single-triangle mesh with 1 UV set
     const Header header {
@@ -169,40 +225,8 @@ TEST_F(FilameshTest, NonInterleaved) {
 
 TEST_F(FilameshTest, Interleaved) {
     // Serialize a single-triangle mesh with 1 UV set
-    const Header header {
-        .version = VERSION,
-        .parts = 1,
-        .aabb = unitBox,
-        .flags = INTERLEAVED | TEXCOORD_SNORM16,
-        .offsetPosition = offsetof(InterleavedVertex, position),
-        .offsetTangents = offsetof(InterleavedVertex, tangent),
-        .offsetColor = offsetof(InterleavedVertex, color),
-        .offsetUV0 = offsetof(InterleavedVertex, uv0),
-        .offsetUV1 = maxint,
-        .stridePosition = sizeof(InterleavedVertex),
-        .strideTangents = sizeof(InterleavedVertex),
-        .strideColor = sizeof(InterleavedVertex),
-        .strideUV0 = sizeof(InterleavedVertex),
-        .strideUV1 = maxint,
-        .vertexCount = vertexCount,
-        .vertexSize = sizeof(interleavedVertices),
-        .indexType = IndexType::UI16,
-        .indexCount = 3,
-        .indexSize = sizeof(uint16_t) * 3
-    };
-    const uint32_t nmats = 1;
-    const string matname = "DefaultMaterial";
-    const uint32_t matnamelength = matname.size();
-
     stringstream stream(ios_base::out);
-    write(stream, MAGICID, sizeof(MAGICID));
-    write(stream, &header, sizeof(header));
-    write(stream, interleavedVertices, sizeof(interleavedVertices));
-    write(stream, indices, sizeof(indices));
-    write(stream, parts, sizeof(parts));
-    write(stream, &nmats, sizeof(nmats));
-    write(stream, &matnamelength, sizeof(matnamelength));
-    write(stream, matname.c_str(), matnamelength + 1);
+    writeInterleavedMesh(stream);
 
     // Deserialize the mesh as a smoke test.
     MaterialInstance* mi = engine->getDefaultMaterial()->createInstance();
@@ -216,6 +240,84 @@ TEST_F(FilameshTest, Interleaved) {
     engine->destroy(mi);
 }
 
+TEST_F(FilameshTest, LoadFromFiles) {
+    // Serialize a single-triangle mesh to a file, removed by TearDown()
+    const utils::Path& path = meshPath;
+    {
+        ofstream stream(path.c_str(), ios::binary);
+        writeInterleavedMesh(stream);
+    }
+
+    MaterialInstance* mi = engine->getDefaultMaterial()->createInstance();
+    MeshReader::MaterialRegistry materials;
+    materials["DefaultMaterial"] = mi;
+    auto& rm = engine->getRenderableManager();
+
+    // a single mesh
+    auto mesh = MeshReader::loadMeshFromFile(engine, path, materials);
+    EXPECT_EQ(rm.getPrimitiveCount(rm.getInstance(mesh.renderable)), 1);
+
+    // several meshes at once, the last file doesn't exist
+    utils::JobSystem js;
+    js.adopt();
+    const utils::Path paths[] = {
+            path, path, path.getParent() + "missing.filamesh" };
+    MeshReader::Mesh meshes[3];
+    MeshReader::loadMeshesFromFiles(engine, js, paths, 3, materials, meshes);
+    js.emancipate();
+    EXPECT_EQ(rm.getPrimitiveCount(rm.getInstance(meshes[0].renderable)), 1);
+    EXPECT_EQ(rm.getPrimitiveCount(rm.getInstance(meshes[1].renderable)), 1);
+    EXPECT_TRUE(meshes[2].renderable.isNull());
+    EXPECT_EQ(meshes[2].vertexBuffer, nullptr);
+
+    // Cleanup, this releases the files.
+    for (auto const& m : { mesh, meshes[0], meshes[1] }) {
+        engine->destroy(m.renderable);
+        engine->destroy(m.vertexBuffer);
+        engine->destroy(m.indexBuffer);
+    }
+    engine->destroy(mi);
+}
+
+TEST_F(FilameshTest, TruncatedFile) {
+    stringstream mesh(ios_base::out);
+    writeInterleavedMesh(mesh);
+    const string data = mesh.str();
+
+    MaterialInstance* mi = engine->getDefaultMaterial()->createInstance();
+    MeshReader::MaterialRegistry materials;
+    materials["DefaultMaterial"] = mi;
+
+    // every truncation, including in the middle of the header and of the material names,
+    // fails to load instead of reading past the end of the file
+    for (size_t size : { size_t(4), sizeof(MAGICID) + sizeof(Header) / 2,
+            sizeof(MAGICID) + sizeof(Header) + sizeof(interleavedVertices) / 2,
+            data.size() - sizeof(parts), data.size() - 4, data.size() - 1 }) {
+        {
+            ofstream stream(meshPath.c_str(), ios::binary);
+            stream.write(data.data(), size);
+        }
+        auto truncated = MeshReader::loadMeshFromFile(engine, meshPath, materials);
+        EXPECT_TRUE(truncated.renderable.isNull()) << "size " << size;
+        EXPECT_EQ(truncated.vertexBuffer, nullptr);
+    }
+
+    // a header whose sizes point past the end of the file
+    Header header = interleavedHeader();
+    header.indexSize = 0x10000000;
+    {
+        ofstream stream(meshPath.c_str(), ios::binary);
+        write(stream, MAGICID, sizeof(MAGICID));
+        write(stream, &header, sizeof(header));
+        write(stream, interleavedVertices, sizeof(interleavedVertices));
+        write(stream, indices, sizeof(indices));
+    }
+    auto corrupt = MeshReader::loadMeshFromFile(engine, meshPath, materials);
+    EXPECT_TRUE(corrupt.renderable.isNull());
+
+    engine->destroy(mi);
+}
+
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -19,6 +19,10 @@
 
 #include <image/LinearImage.h>
 
+namespace utils {
+class JobSystem;
+}
+
 namespace image {
 
 /**
@@ -110,6 +114,19 @@ LinearImage resampleImage(const LinearImage& source, uint32_t width, uint32_t he
 LinearImage resampleImage(const LinearImage& source, uint32_t width, uint32_t height,
         Filter filter = Filter::DEFAULT);
 
+/**
+ * Same as resampleImage, but bands of rows are resampled concurrently on the given job system,
+ * which the calling thread must have adopted. This is the preferred path for large images.
+ */
+LinearImage resampleImage(utils::JobSystem& js, const LinearImage& source,
+        uint32_t width, uint32_t height, const ImageSampler& sampler);
+
+/**
+ * Same as resampleImage, using the given job system.
+ */
+LinearImage resampleImage(utils::JobSystem& js, const LinearImage& source,
+        uint32_t width, uint32_t height, Filter filter = Filter::DEFAULT);
+
 /**
  * Computes a single sample for the given texture coordinate and writes the resulting color
  * components into the given output holder.
@@ -139,6 +156,13 @@ void computeSingleSample(const LinearImage& source, float x, float y, SingleSamp
  */
 void generateMipmaps(const LinearImage& source, Filter, LinearImage* result, uint32_t mipCount);
 
+/**
+ * Same as generateMipmaps, but each miplevel is resampled using the given job system, which the
+ * calling thread must have adopted.
+ */
+void generateMipmaps(utils::JobSystem& js, const LinearImage& source, Filter,
+        LinearImage* result, uint32_t mipCount);
+
 /**
  * Returns the number of miplevels it would take to downsample the given image down to 1x1. This
  * number does not include the original image (i.e. mip 0).
@@ -76,6 +76,23 @@ public:
      */
     KtxBundle(uint8_t const* bytes, uint32_t nbytes);
 
+    /**
+     * Creates a read-only bundle that indexes the blobs of the given serialized data in place,
+     * rather than copying them. The data must outlive the bundle. setBlob() and allocateBlob()
+     * fail on read-only bundles.
+     */
+    static KtxBundle* createView(uint8_t const* bytes, uint32_t nbytes);
+
+    /**
+     * Creates a read-only bundle over the memory-mapped contents of the given KTX file. The
+     * mapping is owned by the bundle and released when the bundle is destroyed. Returns nullptr
+     * if the file can't be read or isn't a valid KTX file.
+     *
+     * Combined with KtxUtility::createTexture(), this lets texture data go straight from the file
+     * to the driver, without intermediate copies.
+     */
+    static KtxBundle* mapFile(const char* path);
+
     /**
      * Serializes the bundle into the given target memory. Returns false if there's not enough
      * memory.
@@ -118,7 +135,8 @@ public:
 
     /**
      * Retrieves a weak reference to a given data blob. Returns false if the given blob index is out
-     * of bounds, or if the blob at the given index is empty.
+     * of bounds, or if the blob at the given index is empty. The data of read-only bundles must
+     * not be modified.
      */
     bool getBlob(KtxBlobIndex index, uint8_t** data, uint32_t* size) const;
 
@@ -254,6 +272,10 @@ public:
     static constexpr uint32_t SRGB8_ALPHA8_ETC2_EAC = 0x9279;
 
 private:
+    KtxBundle();
+    // returns false if the data is malformed
+    bool deserialize(uint8_t const* bytes, uint32_t nbytes, bool inPlace);
+
     image::KtxInfo mInfo = {};
     uint32_t mNumMipLevels;
     uint32_t mArrayLength;
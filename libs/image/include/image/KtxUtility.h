@@ -146,6 +146,10 @@ namespace KtxUtility {
      * Creates a Texture object from a KTX bundle, populates all of its faces and miplevels,
      * and automatically destroys the bundle after all the texture data has been uploaded.
      *
+     * The texture data is handed to the driver without copies, so bundles created with
+     * KtxBundle::mapFile() are uploaded straight from the mapped file, which is unmapped once
+     * the upload is complete.
+     *
      * @param engine Used to create the Filament Texture
      * @param ktx In-memory representation of a KTX file
      * @param srgb Forces the KTX-specified format into an SRGB format if possible
@@ -159,6 +163,21 @@ namespace KtxUtility {
         return createTexture(engine, *ktx, srgb, rgbm, freeKtx, ktx);
     }
 
+    /**
+     * Creates a Texture object from a KTX file, populates all of its faces and miplevels from
+     * a memory mapping of the file, and releases the mapping after all the texture data has been
+     * uploaded. Returns nullptr if the file can't be read.
+     *
+     * @param engine Used to create the Filament Texture
+     * @param path Path to the KTX file
+     * @param srgb Forces the KTX-specified format into an SRGB format if possible
+     * @param rgbm Interpret alpha as an HDR multiplier
+     */
+    inline Texture* createTexture(Engine* engine, const char* path, bool srgb, bool rgbm) {
+        KtxBundle* ktx = KtxBundle::mapFile(path);
+        return ktx ? createTexture(engine, ktx, srgb, rgbm) : nullptr;
+    }
+
     template<typename T>
     T toCompressedFilamentEnum(uint32_t format) {
         switch (format) {
@@ -19,6 +19,8 @@
 
 #include <math/vec3.h>
 #include <math/vec4.h>
+#include <utils/compiler.h>
+#include <utils/JobSystem.h>
 #include <utils/Panic.h>
 #include <utils/CString.h>
 
@@ -130,7 +132,7 @@ void generateMadProgram(uint32_t ntarget, uint32_t nsource, float left, float ri
     // the [0,1] domain. If this were a huge number, the filtered results would look the same, but
     // the filter would perform very poorly because it would be iterating over a lot more samples
     // than necessary.
-    const float filterBounds = domainScale * std::abs(filter.boundingRadius);
+    const float filterBounds = std::abs(filter.boundingRadius) / domainScale;
 
     // Iterate through target samples. "xtarget" points to the center of each target pixel.
     float xtarget = dtarget / 2.0f;
@@ -141,9 +143,12 @@ void generateMadProgram(uint32_t ntarget, uint32_t nsource, float left, float ri
         uint32_t count = 0;
         float sum = 0;
 
-        // Iterate through source samples that lie within the bounded region.
-        const auto isource_lower = int32_t((xtarget - filterBounds) * nsource);
-        const auto isource_upper = int32_t(std::ceil((xtarget + filterBounds) * nsource));
+        // Iterate through source samples that lie within the bounded region, which is mapped
+        // from the source range to the whole row.
+        const float xlower = left + (xtarget - filterBounds) * (right - left);
+        const float xupper = left + (xtarget + filterBounds) * (right - left);
+        const auto isource_lower = int32_t(std::min(xlower, xupper) * nsource);
+        const auto isource_upper = int32_t(std::ceil(std::max(xlower, xupper) * nsource));
         for (int32_t isource = isource_lower; isource <= isource_upper; ++isource) {
             const float xsource = (((isource + 0.5f) / nsource) - left) / (right - left);
             const bool outside_image = isource < 0 || isource >= int32_t(nsource);
@@ -206,22 +211,26 @@ FilterFunction createFilterFunction(Filter ftype) {
 }
 
 template <class VecT>
-void normalizeImpl(LinearImage& image) {
-    const uint32_t width = image.getWidth(), height = image.getHeight();
-    auto vecs = (VecT*) image.getPixelRef();
-    for (uint32_t n = 0; n < width * height; ++n) {
+void normalizeImpl(float* pixels, uint32_t count) {
+    auto vecs = (VecT*) pixels;
+    for (uint32_t n = 0; n < count; ++n) {
         vecs[n] = normalize(vecs[n]);
     }
 }
 
+// Normalizes count pixels of a 3 or 4 channel image.
+void normalize(float* pixels, uint32_t count, uint32_t channels) {
+    if (channels == 3) {
+      normalizeImpl< filament::math::float3>(pixels, count);
+    } else {
+      normalizeImpl< filament::math::float4>(pixels, count);
+    }
+}
+
 void normalize(LinearImage& image) {
     ASSERT_PRECONDITION(image.getChannels() == 3 || image.getChannels() == 4,
                         "Must be a 3 or 4 channel image");
-    if (image.getChannels() == 3) {
-      normalizeImpl< filament::math::float3>(image);
-    } else {
-      normalizeImpl< filament::math::float4>(image);
-    }
+    normalize(image.getPixelRef(), image.getWidth() * image.getHeight(), image.getChannels());
 }
 
 LinearImage resampleImage1D(const LinearImage& source, MadProgram* program,
@@ -276,6 +285,132 @@ LinearImage resampleImage1D(const LinearImage& source, MadProgram* program,
     return result;
 }
 
+// The parallel passes below process bands of this many rows per job.
+constexpr uint32_t JOBS_ROW_COUNT = 16;
+
+Filter resolveFilter(Filter filter, uint32_t ntarget, uint32_t nsource) {
+    if (filter == Filter::DEFAULT) {
+        filter = ntarget > nsource ? Filter::MITCHELL : Filter::LANCZOS;
+    }
+    return filter;
+}
+
+// Resizes the image horizontally like resampleImage1D, but without the transpose and with the
+// rows split across jobs. The MAD program is kept single-channel so the inner loop runs over
+// the channels of a source pixel.
+LinearImage resampleRows(utils::JobSystem& js, const LinearImage& source,
+        uint32_t twidth, Filter filter, float left, float right, float filterRadiusMultiplier) {
+    const uint32_t swidth = source.getWidth();
+    const uint32_t sheight = source.getHeight();
+    const uint32_t nchan = source.getChannels();
+    filter = resolveFilter(filter, twidth, swidth);
+
+    MadProgram program;
+    generateMadProgram(twidth, swidth, left, right, createFilterFunction(filter),
+            filterRadiusMultiplier, &program);
+
+    LinearImage result(twidth, sheight, nchan);
+    const bool minimum = filter == Filter::MINIMUM;
+    const bool normals = filter == Filter::GAUSSIAN_NORMALS;
+    float const* const sourcePixels = source.getPixelRef();
+    float* const targetPixels = result.getPixelRef();
+
+    auto work = [&](uint32_t start, uint32_t count) {
+        for (uint32_t row = start, end = start + count; row < end; ++row) {
+            float const* UTILS_RESTRICT sourceRow = sourcePixels + size_t(row) * swidth * nchan;
+            float* UTILS_RESTRICT targetRow = targetPixels + size_t(row) * twidth * nchan;
+            if (minimum) {
+                std::fill_n(targetRow, twidth * nchan, std::numeric_limits<float>::max());
+                for (auto mad : program) {
+                    float const* src = sourceRow + mad.sourceIndex * int32_t(nchan);
+                    float* dst = targetRow + mad.targetIndex * nchan;
+                    for (uint32_t c = 0; c < nchan; ++c) {
+                        dst[c] = std::min(src[c], dst[c]);
+                    }
+                }
+                continue;
+            }
+            for (auto mad : program) {
+                float const* src = sourceRow + mad.sourceIndex * int32_t(nchan);
+                float* dst = targetRow + mad.targetIndex * nchan;
+                for (uint32_t c = 0; c < nchan; ++c) {
+                    dst[c] += src[c] * mad.weight;
+                }
+            }
+            if (normals) {
+                normalize(targetRow, twidth, nchan);
+            }
+        }
+    };
+
+    auto job = utils::jobs::parallel_for(js, nullptr, 0, sheight, std::cref(work),
+            utils::jobs::CountSplitter<JOBS_ROW_COUNT, 8>());
+    js.runAndWait(job);
+    return result;
+}
+
+// Resizes the image vertically, each target row is a weighted sum of whole source rows, which
+// makes the inner loop contiguous and easy to vectorize. The rows are split across jobs.
+LinearImage resampleColumns(utils::JobSystem& js, const LinearImage& source,
+        uint32_t theight, Filter filter, float top, float bottom, float filterRadiusMultiplier) {
+    const uint32_t width = source.getWidth();
+    const uint32_t sheight = source.getHeight();
+    const uint32_t nchan = source.getChannels();
+    filter = resolveFilter(filter, theight, sheight);
+
+    MadProgram program;
+    generateMadProgram(theight, sheight, top, bottom, createFilterFunction(filter),
+            filterRadiusMultiplier, &program);
+
+    // The instructions are sorted by target, find where the ones of each target row start.
+    std::vector<uint32_t> offsets(theight + 1, uint32_t(program.size()));
+    for (uint32_t i = uint32_t(program.size()); i-- > 0;) {
+        offsets[program[i].targetIndex] = i;
+    }
+    for (uint32_t row = theight; row-- > 0;) {
+        offsets[row] = std::min(offsets[row], offsets[row + 1]);
+    }
+
+    LinearImage result(width, theight, nchan);
+    const bool minimum = filter == Filter::MINIMUM;
+    const bool normals = filter == Filter::GAUSSIAN_NORMALS;
+    const size_t rowSize = size_t(width) * nchan;
+    float const* const sourcePixels = source.getPixelRef();
+    float* const targetPixels = result.getPixelRef();
+
+    auto work = [&](uint32_t start, uint32_t count) {
+        for (uint32_t row = start, end = start + count; row < end; ++row) {
+            float* UTILS_RESTRICT targetRow = targetPixels + row * rowSize;
+            if (minimum) {
+                std::fill_n(targetRow, rowSize, std::numeric_limits<float>::max());
+            }
+            for (uint32_t i = offsets[row]; i < offsets[row + 1]; ++i) {
+                const MadInstruction mad = program[i];
+                float const* UTILS_RESTRICT sourceRow =
+                        sourcePixels + size_t(mad.sourceIndex) * rowSize;
+                const float weight = mad.weight;
+                if (minimum) {
+                    for (size_t j = 0; j < rowSize; ++j) {
+                        targetRow[j] = std::min(sourceRow[j], targetRow[j]);
+                    }
+                } else {
+                    for (size_t j = 0; j < rowSize; ++j) {
+                        targetRow[j] += sourceRow[j] * weight;
+                    }
+                }
+            }
+            if (normals) {
+                normalize(targetRow, width, nchan);
+            }
+        }
+    };
+
+    auto job = utils::jobs::parallel_for(js, nullptr, 0, theight, std::cref(work),
+            utils::jobs::CountSplitter<JOBS_ROW_COUNT, 8>());
+    js.runAndWait(job);
+    return result;
+}
+
 } // anonymous namespace
 
 namespace image {
@@ -313,6 +448,33 @@ LinearImage resampleImage(const LinearImage& source, uint32_t width, uint32_t he
     });
 }
 
+LinearImage resampleImage(utils::JobSystem& js, const LinearImage& source,
+        uint32_t width, uint32_t height, const ImageSampler& sampler) {
+    ASSERT_PRECONDITION(
+        sampler.east.mode == Boundary::EXCLUDE &&
+        sampler.north.mode == Boundary::EXCLUDE &&
+        sampler.west.mode == Boundary::EXCLUDE &&
+        sampler.south.mode == Boundary::EXCLUDE, "Not yet implemented.");
+    ASSERT_PRECONDITION((sampler.horizontalFilter != Filter::GAUSSIAN_NORMALS &&
+        sampler.verticalFilter != Filter::GAUSSIAN_NORMALS) ||
+        source.getChannels() == 3 || source.getChannels() == 4,
+        "Must be a 3 or 4 channel image");
+    const float radius = sampler.filterRadiusMultiplier;
+    const Region& region = sampler.sourceRegion;
+    LinearImage result = resampleRows(js, source, width, sampler.horizontalFilter,
+            region.left, region.right, radius);
+    return resampleColumns(js, result, height, sampler.verticalFilter,
+            region.top, region.bottom, radius);
+}
+
+LinearImage resampleImage(utils::JobSystem& js, const LinearImage& source,
+        uint32_t width, uint32_t height, Filter filter) {
+    return resampleImage(js, source, width, height, ImageSampler {
+        .horizontalFilter = filter,
+        .verticalFilter = filter
+    });
+}
+
 void computeSingleSample(const LinearImage& source, float x, float y, SingleSample* result,
         Filter filter) {
     const float radius = 1.0f;
@@ -346,6 +508,18 @@ void generateMipmaps(const LinearImage& source, Filter filter, LinearImage* resu
     }
 }
 
+void generateMipmaps(utils::JobSystem& js, const LinearImage& source, Filter filter,
+        LinearImage* result, uint32_t mips) {
+    mips = std::min(mips, getMipmapCount(source));
+    uint32_t width = source.getWidth();
+    uint32_t height = source.getHeight();
+    for (uint32_t n = 0; n < mips; ++n) {
+       width = std::max(width >> 1, 1u);
+       height = std::max(height >> 1, 1u);
+       result[n] = resampleImage(js, source, width, height, filter);
+    }
+}
+
 uint32_t getMipmapCount(const LinearImage& source) {
     uint32_t width = source.getWidth();
     uint32_t height = source.getHeight();
@@ -18,10 +18,25 @@
 
 #include <utils/Panic.h>
 
+#include <limits>
 #include <string>
 #include <vector>
 #include <unordered_map>
 
+#include <fcntl.h>
+#if !defined(WIN32)
+#    include <unistd.h>
+#else
+#    include <io.h>
+#endif
+
+#if !defined(WIN32) && !defined(__EMSCRIPTEN__)
+#    include <sys/mman.h>
+#    define HAS_MMAP 1
+#else
+#    define HAS_MMAP 0
+#endif
+
 namespace {
 
 struct SerializationHeader {
@@ -60,8 +75,30 @@ struct KtxBlobList {
     std::vector<uint8_t> blobs;
     std::vector<uint32_t> sizes;
 
+    // Read-only bundles don't store their blobs, they point into the serialized data instead.
+    std::vector<uint8_t const*> views;
+
+    // The file mapped by KtxBundle::mapFile(), if any.
+    void* mapping = nullptr;
+    size_t mappingSize = 0;
+
+    ~KtxBlobList() {
+        if (mapping) {
+#if HAS_MMAP
+            munmap(mapping, mappingSize);
+#else
+            free(mapping);
+#endif
+        }
+    }
+
+    bool isReadOnly() const { return !views.empty(); }
+
     // Obtains a pointer to the given blob.
     uint8_t* get(uint32_t blobIndex) {
+        if (isReadOnly()) {
+            return const_cast<uint8_t*>(views[blobIndex]);
+        }
         uint8_t* result = blobs.data();
         for (uint32_t i = 0; i < blobIndex; ++i) {
             result += sizes[i];
@@ -106,13 +143,74 @@ KtxBundle::KtxBundle(uint32_t numMipLevels, uint32_t arrayLength, bool isCubemap
     mBlobs->sizes.resize(numMipLevels * arrayLength * mNumCubeFaces);
 }
 
+KtxBundle::KtxBundle() : mBlobs(new KtxBlobList), mMetadata(new KtxMetadata) {
+}
+
 KtxBundle::KtxBundle(uint8_t const* bytes, uint32_t nbytes) :
         mBlobs(new KtxBlobList), mMetadata(new KtxMetadata) {
-    ASSERT_PRECONDITION(sizeof(SerializationHeader) <= nbytes, "KTX buffer is too small");
+    ASSERT_PRECONDITION(deserialize(bytes, nbytes, false), "Invalid KTX data");
+}
+
+KtxBundle* KtxBundle::createView(uint8_t const* bytes, uint32_t nbytes) {
+    KtxBundle* bundle = new KtxBundle();
+    ASSERT_PRECONDITION(bundle->deserialize(bytes, nbytes, true), "Invalid KTX data");
+    return bundle;
+}
+
+KtxBundle* KtxBundle::mapFile(const char* path) {
+#if !defined(WIN32)
+    int fd = ::open(path, O_RDONLY);
+#else
+    int fd = ::open(path, O_RDONLY | O_BINARY);
+#endif
+    if (fd < 0) {
+        return nullptr;
+    }
+    const off_t end = lseek(fd, 0, SEEK_END);
+    lseek(fd, 0, SEEK_SET);
+    // KTX sizes are 32 bits
+    if (end < 0 || uint64_t(end) > std::numeric_limits<uint32_t>::max()) {
+        close(fd);
+        return nullptr;
+    }
+    const size_t size = (size_t) end;
+    void* data = nullptr;
+#if HAS_MMAP
+    data = size ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    data = data == MAP_FAILED ? nullptr : data;
+#else
+    data = malloc(size);
+    if (data && size_t(read(fd, data, size)) != size) {
+        free(data);
+        data = nullptr;
+    }
+#endif
+    close(fd);
+    if (!data) {
+        return nullptr;
+    }
+
+    // the bundle owns the mapping from now on, even if the file is malformed
+    KtxBundle* bundle = new KtxBundle();
+    bundle->mBlobs->mapping = data;
+    bundle->mBlobs->mappingSize = size;
+    if (!bundle->deserialize((uint8_t const*) data, (uint32_t) size, true)) {
+        delete bundle;
+        return nullptr;
+    }
+    return bundle;
+}
+
+bool KtxBundle::deserialize(uint8_t const* bytes, uint32_t nbytes, bool inPlace) {
+    if (nbytes < sizeof(SerializationHeader)) {
+        return false;
+    }
 
     // First, "parse" the header by casting it to a struct.
     SerializationHeader const* header = (SerializationHeader const*) bytes;
-    ASSERT_PRECONDITION(memcmp(header->magic, MAGIC, 12) == 0, "KTX has unexpected identifier");
+    if (memcmp(header->magic, MAGIC, 12) != 0) {
+        return false;
+    }
     mInfo = header->info;
 
     // The spec allows 0 or 1 for the number of array layers and mipmap levels, but we replace 0
@@ -127,12 +225,25 @@ KtxBundle::KtxBundle(uint8_t const* bytes, uint32_t nbytes) :
     // We use std::string to store both the key and the value. Note that the spec says the value can
     // be a binary blob that contains null characters.
     uint8_t const* pdata = bytes + sizeof(SerializationHeader);
+    if (header->bytesOfKeyValueData > nbytes - sizeof(SerializationHeader)) {
+        return false;
+    }
     uint8_t const* end = pdata + header->bytesOfKeyValueData;
     while (pdata < end) {
+        if (end - pdata < (ptrdiff_t) sizeof(uint32_t)) {
+            return false;
+        }
         const uint32_t keyAndValueByteSize = *((uint32_t const*) pdata);
         pdata += sizeof(uint32_t);
-        std::string key((const char*) pdata);
-        uint8_t const* pval = pdata + key.size() + 1;
+        if (keyAndValueByteSize > size_t(end - pdata)) {
+            return false;
+        }
+        uint8_t const* keyEnd = (uint8_t const*) memchr(pdata, 0, keyAndValueByteSize);
+        if (!keyEnd) {
+            return false;
+        }
+        std::string key((const char*) pdata, (const char*) keyEnd);
+        uint8_t const* pval = keyEnd + 1;
         pdata += keyAndValueByteSize;
         std::string val((const char*) pval, (const char*) pdata);
         mMetadata->keyvals.insert({key, val});
@@ -140,6 +251,9 @@ KtxBundle::KtxBundle(uint8_t const* bytes, uint32_t nbytes) :
         pdata += paddingSize;
     }
 
+    // bytesOfKeyValueData includes the padding, tolerate a missing padding on the last entry
+    pdata = end;
+
     // There is no compressed format that has a block size that is not a multiple of 4, so these
     // two padding constants can be safely hardcoded to 0. They are here for spec consistency.
     const uint32_t cubePadding = 0;
@@ -149,24 +263,40 @@ KtxBundle::KtxBundle(uint8_t const* bytes, uint32_t nbytes) :
     const bool isNonArrayCube = mNumCubeFaces > 1 && mArrayLength == 1;
     const uint32_t facesPerMip = mArrayLength * mNumCubeFaces;
 
-    // Extract blobs from the serialized byte stream.
+    // Extract blobs from the serialized byte stream, or just index them for read-only bundles.
     const uint32_t totalSize = nbytes - (pdata - bytes);
-    mBlobs->blobs.resize(totalSize);
+    if (inPlace) {
+        mBlobs->views.resize(mBlobs->sizes.size());
+    } else {
+        mBlobs->blobs.resize(totalSize);
+    }
     for (uint32_t mipmap = 0; mipmap < mNumMipLevels; ++mipmap) {
+        if (size_t(bytes + nbytes - pdata) < sizeof(uint32_t)) {
+            return false;
+        }
         const uint32_t imageSize = *((uint32_t const*) pdata);
         const uint32_t faceSize = isNonArrayCube ? imageSize : (imageSize / facesPerMip);
-        const uint32_t levelSize = faceSize * mNumCubeFaces * mArrayLength;
+        const uint64_t levelSize = uint64_t(faceSize) * mNumCubeFaces * mArrayLength;
         pdata += sizeof(uint32_t);
-        memcpy(mBlobs->get(flatten(this, {mipmap, 0, 0})), pdata, levelSize);
+        if (uint64_t(bytes + nbytes - pdata) < levelSize) {
+            return false;
+        }
+        if (!inPlace) {
+            memcpy(mBlobs->get(flatten(this, {mipmap, 0, 0})), pdata, levelSize);
+        }
         for (uint32_t layer = 0; layer < mArrayLength; ++layer) {
             for (uint32_t face = 0; face < mNumCubeFaces; ++face) {
                 mBlobs->sizes[flatten(this, {mipmap, layer, face})] = faceSize;
+                if (inPlace) {
+                    mBlobs->views[flatten(this, {mipmap, layer, face})] = pdata;
+                }
                 pdata += faceSize;
                 pdata += cubePadding;
             }
         }
         pdata += mipPadding;
     }
+    return true;
 }
 
 bool KtxBundle::serialize(uint8_t* destination, uint32_t numBytes) const {
@@ -302,6 +432,9 @@ bool KtxBundle::getBlob(KtxBlobIndex index, uint8_t** data, uint32_t* size) cons
 }
 
 bool KtxBundle::setBlob(KtxBlobIndex index, uint8_t const* data, uint32_t size) {
+    if (mBlobs->isReadOnly()) {
+        return false;
+    }
     if (index.mipLevel >= mNumMipLevels || index.arrayIndex >= mArrayLength ||
             index.cubeFace >= mNumCubeFaces) {
         return false;
@@ -316,6 +449,9 @@ bool KtxBundle::setBlob(KtxBlobIndex index, uint8_t const* data, uint32_t size)
 }
 
 bool KtxBundle::allocateBlob(KtxBlobIndex index, uint32_t size) {
+    if (mBlobs->isReadOnly()) {
+        return false;
+    }
     if (index.mipLevel >= mNumMipLevels || index.arrayIndex >= mArrayLength ||
             index.cubeFace >= mNumCubeFaces) {
         return false;
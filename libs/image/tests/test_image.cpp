@@ -26,12 +26,14 @@
 
 #include <gtest/gtest.h>
 
+#include <utils/JobSystem.h>
 #include <utils/Panic.h>
 #include <utils/Path.h>
 
 #include <math/vec3.h>
 #include <math/vec4.h>
 
+#include <cstdlib>
 #include <fstream>
 #include <string>
 #include <sstream>
@@ -76,6 +78,9 @@ static void updateOrCompare(const LinearImage& limg, const utils::Path& fname);
 // Subtracts two images, does an abs(), then normalizes such that min/max transform to 0/1.
 static LinearImage diffImages(const LinearImage& a, const LinearImage& b);
 
+// Returns a path in the system's temporary directory.
+static utils::Path getTemporaryPath(const char* name);
+
 TEST_F(ImageTest, LuminanceFilters) { // NOLINT
     auto tiny = createGrayFromAscii("000 010 000");
     ASSERT_EQ(tiny.getWidth(), 3);
@@ -310,6 +315,88 @@ TEST_F(ImageTest, Mipmaps) { // NOLINT
     }
 }
 
+TEST_F(ImageTest, ParallelResampling) { // NOLINT
+    utils::JobSystem js;
+    js.adopt();
+
+    // The job system path must match the serial path, for all filters and both minification
+    // and magnification.
+    LinearImage src = createNormalMap(100);
+    const Filter filters[] = { Filter::BOX, Filter::NEAREST, Filter::HERMITE,
+            Filter::GAUSSIAN_SCALARS, Filter::GAUSSIAN_NORMALS, Filter::MITCHELL,
+            Filter::LANCZOS, Filter::MINIMUM };
+    for (Filter filter : filters) {
+        for (uint32_t size : { 37u, 211u }) {
+            LinearImage a = resampleImage(src, size, size / 2, filter);
+            LinearImage b = resampleImage(js, src, size, size / 2, filter);
+            ASSERT_EQ(a.getWidth(), b.getWidth());
+            ASSERT_EQ(a.getHeight(), b.getHeight());
+            const uint32_t count = a.getWidth() * a.getHeight() * a.getChannels();
+            for (uint32_t i = 0; i < count; i++) {
+                ASSERT_NEAR(a.getPixelRef()[i], b.getPixelRef()[i], 1e-5f);
+            }
+        }
+    }
+
+    const uint32_t count = getMipmapCount(src);
+    vector<LinearImage> mips(count), parallelMips(count);
+    generateMipmaps(src, Filter::LANCZOS, mips.data(), count);
+    generateMipmaps(js, src, Filter::LANCZOS, parallelMips.data(), count);
+    for (uint32_t level = 0; level < count; ++level) {
+        LinearImage const& a = mips[level];
+        LinearImage const& b = parallelMips[level];
+        ASSERT_EQ(a.getWidth(), b.getWidth());
+        ASSERT_EQ(a.getHeight(), b.getHeight());
+        for (uint32_t i = 0; i < a.getWidth() * a.getHeight() * a.getChannels(); i++) {
+            ASSERT_NEAR(a.getPixelRef()[i], b.getPixelRef()[i], 1e-5f);
+        }
+    }
+
+    js.emancipate();
+}
+
+TEST_F(ImageTest, RowCodecs) { // NOLINT
+    // Images encoded and decoded a band of rows at a time must match whole image coding.
+    LinearImage src = createColorFromAscii("12 34 56 78 12 34 56 78 12 34 56 78 12");
+    src = resampleImage(src, 40, 21, Filter::NEAREST);
+    const uint32_t width = src.getWidth(), height = src.getHeight();
+    const uint32_t bandHeight = 4;
+
+    using Format = ImageEncoder::Format;
+    for (Format format : { Format::PNG, Format::HDR, Format::PSD }) {
+        std::stringstream full, bands;
+        ASSERT_TRUE(ImageEncoder::encode(full, format, src, "", "test"));
+        auto encoder = ImageEncoder::createRowEncoder(bands, format, width, height, 3, "", "test");
+        ASSERT_NE(encoder, nullptr);
+        for (uint32_t row = 0; row < height; row += bandHeight) {
+            LinearImage band = cropRegion(src, 0, row, width,
+                    std::min(row + bandHeight, height));
+            ASSERT_TRUE(encoder->encodeRows(band));
+        }
+        EXPECT_EQ(encoder->getRow(), height);
+        EXPECT_EQ(full.str(), bands.str());
+
+        istringstream fullStream(full.str()), bandsStream(bands.str());
+        LinearImage image = ImageDecoder::decode(fullStream, "test",
+                ImageDecoder::ColorSpace::LINEAR);
+        auto decoder = ImageDecoder::createRowDecoder(bandsStream, "test",
+                ImageDecoder::ColorSpace::LINEAR);
+        ASSERT_NE(decoder, nullptr);
+        ASSERT_EQ(decoder->getWidth(), width);
+        ASSERT_EQ(decoder->getHeight(), height);
+        ASSERT_EQ(decoder->getChannels(), 3u);
+        for (uint32_t row = 0; row < height; row += bandHeight) {
+            LinearImage band = decoder->decodeRows(bandHeight);
+            ASSERT_TRUE(band.isValid());
+            ASSERT_EQ(band.getHeight(), std::min(bandHeight, height - row));
+            for (uint32_t i = 0; i < width * band.getHeight() * 3; i++) {
+                ASSERT_EQ(band.getPixelRef()[i], image.getPixelRef(0, row)[i]);
+            }
+        }
+        EXPECT_FALSE(decoder->decodeRows(bandHeight).isValid());
+    }
+}
+
 TEST_F(ImageTest, Ktx) { // NOLINT
     uint8_t foo[] = {1, 2, 3};
     uint8_t* data;
@@ -375,6 +462,75 @@ TEST_F(ImageTest, Ktx) { // NOLINT
     }
 }
 
+TEST_F(ImageTest, KtxView) { // NOLINT
+    // A read-only bundle must index the blobs of the serialized data in place.
+    KtxBundle original(2, 1, true);
+    vector<uint8_t> level0(16 * 16), level1(8 * 8);
+    for (uint32_t face = 0; face < 6; face++) {
+        std::fill(level0.begin(), level0.end(), uint8_t(face));
+        std::fill(level1.begin(), level1.end(), uint8_t(face + 6));
+        ASSERT_TRUE(original.setBlob({0, 0, face}, level0.data(), level0.size()));
+        ASSERT_TRUE(original.setBlob({1, 0, face}, level1.data(), level1.size()));
+    }
+    original.setMetadata("foo", "bar");
+    vector<uint8_t> serialized(original.getSerializedLength());
+    ASSERT_TRUE(original.serialize(serialized.data(), serialized.size()));
+
+    std::unique_ptr<KtxBundle> view(KtxBundle::createView(serialized.data(), serialized.size()));
+    ASSERT_EQ(view->getNumMipLevels(), 2);
+    ASSERT_TRUE(view->isCubemap());
+    ASSERT_EQ(string(view->getMetadata("foo")), "bar");
+    for (uint32_t level = 0; level < 2; level++) {
+        for (uint32_t face = 0; face < 6; face++) {
+            uint8_t* data;
+            uint32_t size;
+            uint8_t* expected;
+            uint32_t expectedSize;
+            ASSERT_TRUE(view->getBlob({level, 0, face}, &data, &size));
+            ASSERT_TRUE(original.getBlob({level, 0, face}, &expected, &expectedSize));
+            ASSERT_GE(data, serialized.data());
+            ASSERT_LE(data + size, serialized.data() + serialized.size());
+            ASSERT_EQ(size, expectedSize);
+            ASSERT_EQ(memcmp(data, expected, size), 0);
+        }
+    }
+    ASSERT_FALSE(view->setBlob({0, 0, 0}, level0.data(), level0.size()));
+    ASSERT_FALSE(view->allocateBlob({0, 0, 0}, 4));
+
+    vector<uint8_t> reserialized(view->getSerializedLength());
+    ASSERT_TRUE(view->serialize(reserialized.data(), reserialized.size()));
+    ASSERT_EQ(reserialized, serialized);
+
+    ASSERT_EQ(KtxBundle::mapFile("missing.ktx"), nullptr);
+
+    // a truncated file isn't a valid KTX file
+    const utils::Path truncated = getTemporaryPath("ImageTest_KtxView.ktx");
+    {
+        std::ofstream out(truncated.getPath(), std::ios::binary);
+        out.write((char const*) serialized.data(), serialized.size() / 2);
+    }
+    EXPECT_EQ(KtxBundle::mapFile(truncated.c_str()), nullptr);
+    utils::Path(truncated).unlinkFile();
+
+    if (g_comparisonMode == ComparisonMode::COMPARE) {
+        const auto path = g_comparisonPath + "conftestimage_R11_EAC.ktx";
+        std::unique_ptr<KtxBundle> mapped(KtxBundle::mapFile(path.c_str()));
+        ASSERT_NE(mapped, nullptr);
+        ASSERT_EQ(mapped->getInfo().pixelWidth, 64);
+        ASSERT_EQ(mapped->getInfo().pixelHeight, 32);
+        uint8_t* data;
+        uint32_t size;
+        ASSERT_TRUE(mapped->getBlob({0, 0, 0}, &data, &size));
+        ASSERT_EQ(size, 1024);
+    }
+}
+
+static utils::Path getTemporaryPath(const char* name) {
+    const char* dir = getenv("TMPDIR");
+    dir = dir ? dir : getenv("TEMP");
+    return utils::Path(dir ? dir : "/tmp").concat(name);
+}
+
 static void printUsage(const char* name) {
     string exec_name(utils::Path(name).getName());
     string usage(
@@ -18,6 +18,7 @@
 #define IMAGE_IMAGEDECODER_H_
 
 #include <iosfwd>
+#include <memory>
 #include <string>
 
 #include <image/LinearImage.h>
@@ -35,6 +36,39 @@ public:
     static LinearImage decode(std::istream& stream, const std::string& sourceName,
             ColorSpace sourceSpace = ColorSpace::SRGB);
 
+    class RowDecoder;
+
+    /*
+     * Creates a decoder that decodes an image a band of rows at a time, from top to bottom, which
+     * bounds the memory needed to process large images. PNG and HDR images are decoded
+     * incrementally, other formats are decoded in one go and then handed out in bands.
+     * Returns nullptr if the format is not recognized or if the header is invalid.
+     */
+    static std::unique_ptr<RowDecoder> createRowDecoder(std::istream& stream,
+            const std::string& sourceName, ColorSpace sourceSpace = ColorSpace::SRGB);
+
+    class RowDecoder {
+    public:
+        virtual ~RowDecoder() = default;
+
+        uint32_t getWidth() const noexcept { return mWidth; }
+        uint32_t getHeight() const noexcept { return mHeight; }
+        uint32_t getChannels() const noexcept { return mChannels; }
+
+        // number of rows decoded so far
+        uint32_t getRow() const noexcept { return mRow; }
+
+        // Returns linear floating-point data for the next (at most) count rows, or a non-valid
+        // image once all rows have been decoded or if an error occured.
+        virtual LinearImage decodeRows(uint32_t count) = 0;
+
+    protected:
+        uint32_t mWidth = 0;
+        uint32_t mHeight = 0;
+        uint32_t mChannels = 0;
+        uint32_t mRow = 0;
+    };
+
     class Decoder {
     public:
         virtual LinearImage decode() = 0;
@@ -60,6 +94,9 @@ private:
         PSD,
         EXR
     };
+
+    // identifies the format from the signature, the stream position is left untouched
+    static Format getFormat(std::istream& stream);
 };
 
 } // namespace image
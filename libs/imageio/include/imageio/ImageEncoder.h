@@ -18,6 +18,7 @@
 #define IMAGE_IMAGEENCODER_H_
 
 #include <iosfwd>
+#include <memory>
 #include <string>
 
 #include <image/LinearImage.h>
@@ -49,6 +50,43 @@ public:
     static Format chooseFormat(const std::string& name, bool forceLinear = false);
     static std::string chooseExtension(Format format);
 
+    class RowEncoder;
+
+    /*
+     * Creates an encoder that consumes an image a band of rows at a time, from top to bottom,
+     * which bounds the memory needed to process large images. PNG and HDR images are encoded
+     * incrementally, other formats are accumulated and encoded once the last row is received.
+     * Returns nullptr if the format can't encode the given number of channels.
+     */
+    static std::unique_ptr<RowEncoder> createRowEncoder(std::ostream& stream, Format format,
+            uint32_t width, uint32_t height, uint32_t channels,
+            const std::string& compression, const std::string& destName);
+
+    class RowEncoder {
+    public:
+        virtual ~RowEncoder() = default;
+
+        uint32_t getWidth() const noexcept { return mWidth; }
+        uint32_t getHeight() const noexcept { return mHeight; }
+        uint32_t getChannels() const noexcept { return mChannels; }
+
+        // number of rows encoded so far, the image is complete when this reaches the height
+        uint32_t getRow() const noexcept { return mRow; }
+
+        // Consumes linear floating-point data for the next rows, which must have the width and
+        // channel count of the image. Returns false if unable to encode.
+        virtual bool encodeRows(const LinearImage& rows) = 0;
+
+    protected:
+        // checks that rows is the next band of the image
+        bool isValidBand(const LinearImage& rows) const noexcept;
+
+        uint32_t mWidth = 0;
+        uint32_t mHeight = 0;
+        uint32_t mChannels = 0;
+        uint32_t mRow = 0;
+    };
+
     class Encoder {
     public:
         virtual bool encode(const LinearImage& image) = 0;
@@ -18,6 +18,7 @@
 
 #include <imageio/ImageDecoder.h>
 
+#include <algorithm>
 #include <cstdint>
 #include <cstring> // for memcmp
 #include <istream>
@@ -63,6 +64,12 @@ private:
     // ImageDecoder::Decoder interface
     LinearImage decode() override;
 
+    friend class PNGRowDecoder;
+
+    // reads the header and sets up the conversion to 16 bits RGB or RGBA rows
+    void readInfo();
+    LinearImage toLinearImage(uint32_t height, const uint8_t* rows) const;
+
     static void cb_error(png_structp, png_const_charp);
     static void cb_stream(png_structp png, png_bytep buffer, png_size_t size);
 
@@ -73,6 +80,11 @@ private:
     png_infop mInfo = nullptr;
     std::istream& mStream;
     std::streampos mStreamStartPos;
+    int mColorType = 0;
+    int mPasses = 1;
+    uint32_t mWidth = 0;
+    uint32_t mHeight = 0;
+    size_t mRowBytes = 0;
 };
 
 // -----------------------------------------------------------------------------------------------
@@ -92,10 +104,18 @@ private:
     // ImageDecoder::Decoder interface
     LinearImage decode() override;
 
+    friend class HDRRowDecoder;
+
+    void readHeader();
+    void readScanline(filament::math::float3* row);
+
     static const char sigRadiance[];
     static const char sigRGBE[];
     std::istream& mStream;
     std::streampos mStreamStartPos;
+    uint32_t mWidth = 0;
+    uint32_t mHeight = 0;
+    std::unique_ptr<uint8_t[]> mRGBE;
 };
 
 // -----------------------------------------------------------------------------------------------
@@ -145,29 +165,106 @@ private:
 
 // -----------------------------------------------------------------------------------------------
 
-LinearImage ImageDecoder::decode(std::istream& stream, const std::string& sourceName,
-        ColorSpace sourceSpace) {
+class PNGRowDecoder : public ImageDecoder::RowDecoder {
+public:
+    static PNGRowDecoder* create(std::istream& stream, ImageDecoder::ColorSpace colorSpace);
+
+    PNGRowDecoder(const PNGRowDecoder&) = delete;
+    PNGRowDecoder& operator=(const PNGRowDecoder&) = delete;
+
+    ~PNGRowDecoder() override;
+
+    // ImageDecoder::RowDecoder interface
+    LinearImage decodeRows(uint32_t count) override;
+
+private:
+    explicit PNGRowDecoder(PNGDecoder* decoder);
+
+    PNGDecoder* mDecoder;
+    // interlaced images can only be decoded as a whole, they are kept here
+    std::unique_ptr<uint8_t[]> mImageData;
+};
+
+// -----------------------------------------------------------------------------------------------
+
+class HDRRowDecoder : public ImageDecoder::RowDecoder {
+public:
+    static HDRRowDecoder* create(std::istream& stream);
+
+    HDRRowDecoder(const HDRRowDecoder&) = delete;
+    HDRRowDecoder& operator=(const HDRRowDecoder&) = delete;
+
+    ~HDRRowDecoder() override;
 
-    Format format = Format::NONE;
+    // ImageDecoder::RowDecoder interface
+    LinearImage decodeRows(uint32_t count) override;
 
+private:
+    explicit HDRRowDecoder(HDRDecoder* decoder);
+
+    HDRDecoder* mDecoder;
+};
+
+// -----------------------------------------------------------------------------------------------
+
+// Hands out an image that was decoded in one go, for formats that can't be decoded incrementally.
+class LinearRowDecoder : public ImageDecoder::RowDecoder {
+public:
+    explicit LinearRowDecoder(LinearImage image);
+
+    // ImageDecoder::RowDecoder interface
+    LinearImage decodeRows(uint32_t count) override;
+
+private:
+    LinearImage mImage;
+};
+
+// -----------------------------------------------------------------------------------------------
+
+ImageDecoder::Format ImageDecoder::getFormat(std::istream& stream) {
     std::streampos pos = stream.tellg();
-    char buf[16];
+    char buf[16] = {};
     stream.read(buf, sizeof(buf));
+    stream.clear();
+    stream.seekg(pos);
 
     if (PNGDecoder::checkSignature(buf)) {
-        format = Format::PNG;
+        return Format::PNG;
     } else if (HDRDecoder::checkSignature(buf)) {
-        format = Format::HDR;
+        return Format::HDR;
     } else if (PSDDecoder::checkSignature(buf)) {
-        format = Format::PSD;
+        return Format::PSD;
     } else if (EXRDecoder::checkSignature(buf)) {
-        format = Format::EXR;
+        return Format::EXR;
     }
+    return Format::NONE;
+}
 
-    stream.seekg(pos);
+std::unique_ptr<ImageDecoder::RowDecoder> ImageDecoder::createRowDecoder(std::istream& stream,
+        const std::string& sourceName, ColorSpace sourceSpace) {
+    switch (getFormat(stream)) {
+        case Format::NONE:
+            return nullptr;
+        case Format::PNG:
+            return std::unique_ptr<RowDecoder>(PNGRowDecoder::create(stream, sourceSpace));
+        case Format::HDR:
+            return std::unique_ptr<RowDecoder>(HDRRowDecoder::create(stream));
+        case Format::PSD:
+        case Format::EXR: {
+            LinearImage image = decode(stream, sourceName, sourceSpace);
+            if (!image.isValid()) {
+                return nullptr;
+            }
+            return std::unique_ptr<RowDecoder>(new LinearRowDecoder(image));
+        }
+    }
+}
+
+LinearImage ImageDecoder::decode(std::istream& stream, const std::string& sourceName,
+        ColorSpace sourceSpace) {
 
     std::unique_ptr<Decoder> decoder;
-    switch (format) {
+    switch (getFormat(stream)) {
         case Format::NONE:
             return LinearImage();
         case Format::PNG:
@@ -232,70 +329,77 @@ PNGDecoder::~PNGDecoder() {
     png_destroy_read_struct(&mPNG, &mInfo, nullptr);
 }
 
-LinearImage PNGDecoder::decode() {
-    std::unique_ptr<uint8_t[]> imageData;
-    try {
-        mInfo = png_create_info_struct(mPNG);
-        png_read_info(mPNG, mInfo);
+void PNGDecoder::readInfo() {
+    mInfo = png_create_info_struct(mPNG);
+    png_read_info(mPNG, mInfo);
 
-        int colorType = png_get_color_type(mPNG, mInfo);
-        int bitDepth = png_get_bit_depth(mPNG, mInfo);
+    mColorType = png_get_color_type(mPNG, mInfo);
+    int bitDepth = png_get_bit_depth(mPNG, mInfo);
 
-        if (colorType == PNG_COLOR_TYPE_PALETTE) {
-            png_set_palette_to_rgb(mPNG);
-        }
-        if (colorType == PNG_COLOR_TYPE_GRAY) {
-            png_set_gray_to_rgb(mPNG);
-        }
+    if (mColorType == PNG_COLOR_TYPE_PALETTE) {
+        png_set_palette_to_rgb(mPNG);
+    }
+    if (mColorType == PNG_COLOR_TYPE_GRAY) {
+        png_set_gray_to_rgb(mPNG);
+    }
+    if (getColorSpace() == ImageDecoder::ColorSpace::SRGB) {
+        png_set_alpha_mode(mPNG, PNG_ALPHA_PNG, PNG_DEFAULT_sRGB);
+    } else {
+        png_set_alpha_mode(mPNG, PNG_ALPHA_PNG, PNG_GAMMA_LINEAR);
+    }
+    if (bitDepth < 16) {
+        png_set_expand_16(mPNG);
+    }
+    mPasses = png_set_interlace_handling(mPNG);
+
+    png_read_update_info(mPNG, mInfo);
+    mWidth  = png_get_image_width(mPNG, mInfo);
+    mHeight = png_get_image_height(mPNG, mInfo);
+    mRowBytes = png_get_rowbytes(mPNG, mInfo);
+}
+
+LinearImage PNGDecoder::toLinearImage(uint32_t height, const uint8_t* rows) const {
+    if (mColorType == PNG_COLOR_TYPE_RGBA) {
         if (getColorSpace() == ImageDecoder::ColorSpace::SRGB) {
-            png_set_alpha_mode(mPNG, PNG_ALPHA_PNG, PNG_DEFAULT_sRGB);
+            return toLinearWithAlpha<uint16_t>(mWidth, height, mRowBytes, rows,
+                    [ ](uint16_t v) -> uint16_t { return ntohs(v); },
+                    sRGBToLinear< filament::math::float4>);
         } else {
-            png_set_alpha_mode(mPNG, PNG_ALPHA_PNG, PNG_GAMMA_LINEAR);
+            return toLinearWithAlpha<uint16_t>(mWidth, height, mRowBytes, rows,
+                    [ ](uint16_t v) -> uint16_t { return ntohs(v); },
+                    [ ](const filament::math::float4& color) ->  filament::math::float4 { return color; });
         }
-        if (bitDepth < 16) {
-            png_set_expand_16(mPNG);
+    } else {
+        // Convert to linear float (PNG 16 stores data in network order (big endian).
+        if (getColorSpace() == ImageDecoder::ColorSpace::SRGB) {
+            return toLinear<uint16_t>(mWidth, height, mRowBytes, rows,
+                    [ ](uint16_t v) -> uint16_t { return ntohs(v); },
+                    sRGBToLinear< filament::math::float3>);
+        } else {
+            return toLinear<uint16_t>(mWidth, height, mRowBytes, rows,
+                    [ ](uint16_t v) -> uint16_t { return ntohs(v); },
+                    [ ](const filament::math::float3& color) ->  filament::math::float3 { return color; });
         }
+    }
+}
 
-        png_read_update_info(mPNG, mInfo);
-        uint32_t width  = png_get_image_width(mPNG, mInfo);
-        uint32_t height = png_get_image_height(mPNG, mInfo);
-        size_t rowBytes = png_get_rowbytes(mPNG, mInfo);
+LinearImage PNGDecoder::decode() {
+    try {
+        readInfo();
 
-        imageData = std::make_unique<uint8_t[]>(height * rowBytes);
-        std::unique_ptr<png_bytep[]> rowPointers(new png_bytep[height]);
-        for (size_t y = 0 ; y < height ; y++) {
-            rowPointers[y] = &imageData[y * rowBytes];
+        std::unique_ptr<uint8_t[]> imageData(new uint8_t[mHeight * mRowBytes]);
+        std::unique_ptr<png_bytep[]> rowPointers(new png_bytep[mHeight]);
+        for (size_t y = 0 ; y < mHeight ; y++) {
+            rowPointers[y] = &imageData[y * mRowBytes];
         }
         png_read_image(mPNG, rowPointers.get());
         png_read_end(mPNG, mInfo);
 
-        if (colorType == PNG_COLOR_TYPE_RGBA) {
-            if (getColorSpace() == ImageDecoder::ColorSpace::SRGB) {
-                return toLinearWithAlpha<uint16_t>(width, height, rowBytes, imageData,
-                        [ ](uint16_t v) -> uint16_t { return ntohs(v); },
-                        sRGBToLinear< filament::math::float4>);
-            } else {
-                return toLinearWithAlpha<uint16_t>(width, height, rowBytes, imageData,
-                        [ ](uint16_t v) -> uint16_t { return ntohs(v); },
-                        [ ](const filament::math::float4& color) ->  filament::math::float4 { return color; });
-            }
-        } else {
-            // Convert to linear float (PNG 16 stores data in network order (big endian).
-            if (getColorSpace() == ImageDecoder::ColorSpace::SRGB) {
-                return toLinear<uint16_t>(width, height, rowBytes, imageData,
-                        [ ](uint16_t v) -> uint16_t { return ntohs(v); },
-                        sRGBToLinear< filament::math::float3>);
-            } else {
-                return toLinear<uint16_t>(width, height, rowBytes, imageData,
-                        [ ](uint16_t v) -> uint16_t { return ntohs(v); },
-                        [ ](const filament::math::float3& color) ->  filament::math::float3 { return color; });
-            }
-        }
+        return toLinearImage(mHeight, imageData.get());
     } catch(std::runtime_error& e) {
         // reset the stream, like we found it
         std::cerr << "Runtime error while decoding PNG: " << e.what() << std::endl;
         mStream.seekg(mStreamStartPos);
-        imageData.release();
     }
     return LinearImage();
 }
@@ -342,99 +446,107 @@ HDRDecoder::HDRDecoder(std::istream& stream)
 
 HDRDecoder::~HDRDecoder() = default;
 
-LinearImage HDRDecoder::decode() {
-    try {
-        float gamma;
-        float exposure;
-        char sy, sx;
-        unsigned int height, width;
-
-        {
-            char buf[1024];
-            do {
-                char format[128];
-                mStream.getline(buf, sizeof(buf), 0xa);
-                if (buf[0] == '#') continue;
-                sscanf(buf, "FORMAT=%127s", format); // NOLINT
-                sscanf(buf, "GAMMA=%f", &gamma); // NOLINT
-                sscanf(buf, "EXPOSURE=%f", &exposure); // NOLINT
-                if ((sscanf(buf, "%cY %u %cX %u", &sy, &height, &sx, &width) == 4)||   // NOLINT
-                    (sscanf(buf, "%cX %u %cY %u", &sx, &width, &sy, &height) == 4)) {  // NOLINT
-                    break;
-                }
-            } while (true);
+void HDRDecoder::readHeader() {
+    float gamma;
+    float exposure;
+    char sy, sx;
+    unsigned int height, width;
+
+    char buf[1024];
+    do {
+        char format[128];
+        mStream.getline(buf, sizeof(buf), 0xa);
+        if (!mStream.good()) {
+            throw std::runtime_error("invalid header");
         }
+        if (buf[0] == '#') continue;
+        sscanf(buf, "FORMAT=%127s", format); // NOLINT
+        sscanf(buf, "GAMMA=%f", &gamma); // NOLINT
+        sscanf(buf, "EXPOSURE=%f", &exposure); // NOLINT
+        if ((sscanf(buf, "%cY %u %cX %u", &sy, &height, &sx, &width) == 4)||   // NOLINT
+            (sscanf(buf, "%cX %u %cY %u", &sx, &width, &sy, &height) == 4)) {  // NOLINT
+            break;
+        }
+    } while (true);
 
-        LinearImage image(width, height, 3);
+    // the scanlines are returned in the order of the file, regardless of sx and sy
+    mWidth = width;
+    mHeight = height;
+    mRGBE.reset(new uint8_t[width * 4]);
+}
 
-        if (sx == '-') image = horizontalFlip(image);
-        if (sy == '+') image = verticalFlip(image);
-
-        uint16_t w;
-        uint16_t magic;
-        std::unique_ptr<uint8_t[]> rgbe(new uint8_t[width * 4]);
-
-        if (width < 8 || width > 32767) {
-            for (uint32_t y = 0; y < height; y++) {
-                 filament::math::float3* i = reinterpret_cast< filament::math::float3*>(image.getPixelRef(0, y));
-                mStream.read((char*) &rgbe, width * 4);
-                // (rgb/256) * 2^(e-128)
-                size_t pixel = 0;
-                for (size_t x = 0; x < width; x++, pixel += 4) {
-                     filament::math::float3 v(rgbe[pixel], rgbe[pixel + 1], rgbe[pixel + 2]);
-                    i[x] = v * std::ldexp(1.0f, rgbe[pixel + 3] - (128 + 8));
-                }
-            }
-        } else {
-            for (uint32_t y = 0; y < height; y++) {
-                //std::cout << "line: " << y << std::endl;
-                mStream.read((char*) &magic, 2);
-                if (magic != 0x0202) {
-                    throw std::runtime_error("invalid scanline (magic)");
-                }
-                mStream.read((char*) &w, 2);
-                if (ntohs(w) != width) {
-                    throw std::runtime_error("invalid scanline (width)");
-                }
+void HDRDecoder::readScanline(filament::math::float3* row) {
+    const uint32_t width = mWidth;
+    uint8_t* const rgbe = mRGBE.get();
+
+    if (width < 8 || width > 32767) {
+        mStream.read((char*) rgbe, width * 4);
+        // (rgb/256) * 2^(e-128)
+        size_t pixel = 0;
+        for (size_t x = 0; x < width; x++, pixel += 4) {
+            filament::math::float3 v(rgbe[pixel], rgbe[pixel + 1], rgbe[pixel + 2]);
+            row[x] = v * std::ldexp(1.0f, rgbe[pixel + 3] - (128 + 8));
+        }
+        return;
+    }
 
-                char* d = (char*) rgbe.get();
-                for (size_t p = 0; p < 4; p++) {
-                    size_t num_bytes = 0;
-                    while (num_bytes < width) {
-                        uint8_t rle_count;
-                        mStream.read((char*) &rle_count, 1);
-                        if (rle_count > 128) {
-                            char v;
-                            mStream.read(&v, 1);
-                            memset(d, v, size_t(rle_count - 128));
-                            d += rle_count - 128;
-                            num_bytes += rle_count - 128;
-                        } else {
-                            if (rle_count == 0) {
-                                throw std::runtime_error("run length is zero");
-                            }
-                            mStream.read(d, rle_count);
-                            d += rle_count;
-                            num_bytes += rle_count;
-                        }
-                    }
-                }
+    uint16_t w;
+    uint16_t magic;
+    mStream.read((char*) &magic, 2);
+    if (magic != 0x0202) {
+        throw std::runtime_error("invalid scanline (magic)");
+    }
+    mStream.read((char*) &w, 2);
+    if (ntohs(w) != width) {
+        throw std::runtime_error("invalid scanline (width)");
+    }
 
-                uint8_t const* r = &rgbe[0];
-                uint8_t const* g = &rgbe[width];
-                uint8_t const* b = &rgbe[2 * width];
-                uint8_t const* e = &rgbe[3 * width];
-                 filament::math::float3* i = reinterpret_cast< filament::math::float3*>(image.getPixelRef(0, y));
-                // (rgb/256) * 2^(e-128)
-                for (size_t x = 0; x < width; x++, r++, g++, b++, e++) {
-                     filament::math::float3 v(r[0], g[0], b[0]);
-                    i[x] = v * std::ldexp(1.0f, e[0] - (128 + 8));
+    char* d = (char*) rgbe;
+    for (size_t p = 0; p < 4; p++) {
+        size_t num_bytes = 0;
+        while (num_bytes < width) {
+            uint8_t rle_count;
+            mStream.read((char*) &rle_count, 1);
+            const size_t run = rle_count > 128 ? rle_count - 128 : rle_count;
+            if (num_bytes + run > width) {
+                throw std::runtime_error("invalid scanline (run length)");
+            }
+            if (rle_count > 128) {
+                char v;
+                mStream.read(&v, 1);
+                memset(d, v, size_t(rle_count - 128));
+                d += rle_count - 128;
+                num_bytes += rle_count - 128;
+            } else {
+                if (rle_count == 0) {
+                    throw std::runtime_error("run length is zero");
                 }
+                mStream.read(d, rle_count);
+                d += rle_count;
+                num_bytes += rle_count;
             }
         }
+    }
 
-        return image;
+    uint8_t const* r = &rgbe[0];
+    uint8_t const* g = &rgbe[width];
+    uint8_t const* b = &rgbe[2 * width];
+    uint8_t const* e = &rgbe[3 * width];
+    // (rgb/256) * 2^(e-128)
+    for (size_t x = 0; x < width; x++, r++, g++, b++, e++) {
+        filament::math::float3 v(r[0], g[0], b[0]);
+        row[x] = v * std::ldexp(1.0f, e[0] - (128 + 8));
+    }
+}
 
+LinearImage HDRDecoder::decode() {
+    try {
+        readHeader();
+        LinearImage image(mWidth, mHeight, 3);
+        for (uint32_t y = 0; y < mHeight; y++) {
+            readScanline(image.get<filament::math::float3>(0, y));
+        }
+        return image;
     } catch(std::runtime_error& e) {
         // reset the stream, like we found it
         std::cerr << "Runtime error while decoding HDR: " << e.what() << std::endl;
@@ -626,4 +738,140 @@ LinearImage EXRDecoder::decode() {
     return LinearImage();
 }
 
+// -----------------------------------------------------------------------------------------------
+
+PNGRowDecoder* PNGRowDecoder::create(std::istream& stream, ImageDecoder::ColorSpace colorSpace) {
+    PNGDecoder* decoder = PNGDecoder::create(stream);
+    decoder->setColorSpace(colorSpace);
+    try {
+        decoder->readInfo();
+    } catch(std::runtime_error& e) {
+        std::cerr << "Runtime error while decoding PNG: " << e.what() << std::endl;
+        stream.seekg(decoder->mStreamStartPos);
+        delete decoder;
+        return nullptr;
+    }
+    return new PNGRowDecoder(decoder);
+}
+
+PNGRowDecoder::PNGRowDecoder(PNGDecoder* decoder) : mDecoder(decoder) {
+    mWidth = decoder->mWidth;
+    mHeight = decoder->mHeight;
+    mChannels = decoder->mColorType == PNG_COLOR_TYPE_RGBA ? 4 : 3;
+}
+
+PNGRowDecoder::~PNGRowDecoder() {
+    delete mDecoder;
+}
+
+LinearImage PNGRowDecoder::decodeRows(uint32_t count) {
+    count = std::min(count, mHeight - mRow);
+    if (count == 0) {
+        return LinearImage();
+    }
+
+    PNGDecoder& decoder = *mDecoder;
+    const size_t rowBytes = decoder.mRowBytes;
+    try {
+        if (decoder.mPasses > 1) {
+            if (!mImageData) {
+                mImageData.reset(new uint8_t[mHeight * rowBytes]);
+                std::unique_ptr<png_bytep[]> rowPointers(new png_bytep[mHeight]);
+                for (size_t y = 0 ; y < mHeight ; y++) {
+                    rowPointers[y] = &mImageData[y * rowBytes];
+                }
+                png_read_image(decoder.mPNG, rowPointers.get());
+                png_read_end(decoder.mPNG, decoder.mInfo);
+            }
+            LinearImage rows = decoder.toLinearImage(count, &mImageData[mRow * rowBytes]);
+            mRow += count;
+            return rows;
+        }
+
+        std::unique_ptr<uint8_t[]> data(new uint8_t[count * rowBytes]);
+        std::unique_ptr<png_bytep[]> rowPointers(new png_bytep[count]);
+        for (size_t y = 0 ; y < count ; y++) {
+            rowPointers[y] = &data[y * rowBytes];
+        }
+        png_read_rows(decoder.mPNG, rowPointers.get(), nullptr, count);
+        mRow += count;
+        if (mRow == mHeight) {
+            png_read_end(decoder.mPNG, decoder.mInfo);
+        }
+        return decoder.toLinearImage(count, data.get());
+    } catch(std::runtime_error& e) {
+        std::cerr << "Runtime error while decoding PNG: " << e.what() << std::endl;
+        mRow = mHeight;
+    }
+    return LinearImage();
+}
+
+// -----------------------------------------------------------------------------------------------
+
+HDRRowDecoder* HDRRowDecoder::create(std::istream& stream) {
+    HDRDecoder* decoder = HDRDecoder::create(stream);
+    try {
+        decoder->readHeader();
+    } catch(std::runtime_error& e) {
+        std::cerr << "Runtime error while decoding HDR: " << e.what() << std::endl;
+        stream.seekg(decoder->mStreamStartPos);
+        delete decoder;
+        return nullptr;
+    }
+    return new HDRRowDecoder(decoder);
+}
+
+HDRRowDecoder::HDRRowDecoder(HDRDecoder* decoder) : mDecoder(decoder) {
+    mWidth = decoder->mWidth;
+    mHeight = decoder->mHeight;
+    mChannels = 3;
+}
+
+HDRRowDecoder::~HDRRowDecoder() {
+    delete mDecoder;
+}
+
+LinearImage HDRRowDecoder::decodeRows(uint32_t count) {
+    count = std::min(count, mHeight - mRow);
+    if (count == 0) {
+        return LinearImage();
+    }
+    try {
+        LinearImage rows(mWidth, count, 3);
+        for (uint32_t y = 0; y < count; y++) {
+            mDecoder->readScanline(rows.get<filament::math::float3>(0, y));
+        }
+        mRow += count;
+        return rows;
+    } catch(std::runtime_error& e) {
+        std::cerr << "Runtime error while decoding HDR: " << e.what() << std::endl;
+        mRow = mHeight;
+    }
+    return LinearImage();
+}
+
+// -----------------------------------------------------------------------------------------------
+
+LinearRowDecoder::LinearRowDecoder(LinearImage image) : mImage(image) {
+    mWidth = image.getWidth();
+    mHeight = image.getHeight();
+    mChannels = image.getChannels();
+}
+
+LinearImage LinearRowDecoder::decodeRows(uint32_t count) {
+    count = std::min(count, mHeight - mRow);
+    if (count == 0) {
+        return LinearImage();
+    }
+    LinearImage rows(mWidth, count, mChannels);
+    memcpy(rows.getPixelRef(), mImage.getPixelRef(0, mRow),
+            sizeof(float) * mWidth * count * mChannels);
+    mRow += count;
+    if (mRow == mHeight) {
+        // the rows have all been handed out, release the image
+        mImage = LinearImage();
+    }
+    return rows;
+}
+
 } // namespace image
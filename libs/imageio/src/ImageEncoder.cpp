@@ -69,7 +69,14 @@ private:
     // ImageEncoder::Encoder interface
     bool encode(const LinearImage& image) override;
 
-    int chooseColorType(const LinearImage& image) const;
+    friend class PNGRowEncoder;
+
+    bool isSupported(size_t channels) const;
+    void writeHeader(size_t width, size_t height, size_t channels);
+    void writeRows(const LinearImage& rows);
+    void writeEnd();
+
+    int chooseColorType(size_t channels) const;
     uint32_t getChannelsCount() const;
 
     static void cb_error(png_structp png, png_const_charp error);
@@ -102,6 +109,11 @@ private:
     // ImageEncoder::Encoder interface
     bool encode(const LinearImage& image) override;
 
+    friend class HDRRowEncoder;
+
+    void writeHeader(size_t width, size_t height);
+    void writeRows(const LinearImage& rows);
+
     static void float2rgbe(uint8_t rgbe[4], const float3& in);
     static size_t countRepeats(uint8_t const* data, size_t length);
     static size_t countNonRepeats(uint8_t const* data, size_t length);
@@ -187,6 +199,107 @@ private:
 
 // ------------------------------------------------------------------------------------------------
 
+class PNGRowEncoder : public ImageEncoder::RowEncoder {
+public:
+    static PNGRowEncoder* create(std::ostream& stream, PNGEncoder::PixelFormat format,
+            uint32_t width, uint32_t height, uint32_t channels);
+
+    PNGRowEncoder(const PNGRowEncoder&) = delete;
+    PNGRowEncoder& operator=(const PNGRowEncoder&) = delete;
+
+    ~PNGRowEncoder() override;
+
+    // ImageEncoder::RowEncoder interface
+    bool encodeRows(const LinearImage& rows) override;
+
+private:
+    PNGRowEncoder(PNGEncoder* encoder, uint32_t width, uint32_t height, uint32_t channels);
+
+    PNGEncoder* mEncoder;
+};
+
+// ------------------------------------------------------------------------------------------------
+
+class HDRRowEncoder : public ImageEncoder::RowEncoder {
+public:
+    static HDRRowEncoder* create(std::ostream& stream, uint32_t width, uint32_t height);
+
+    HDRRowEncoder(const HDRRowEncoder&) = delete;
+    HDRRowEncoder& operator=(const HDRRowEncoder&) = delete;
+
+    ~HDRRowEncoder() override;
+
+    // ImageEncoder::RowEncoder interface
+    bool encodeRows(const LinearImage& rows) override;
+
+private:
+    HDRRowEncoder(HDREncoder* encoder, uint32_t width, uint32_t height);
+
+    HDREncoder* mEncoder;
+};
+
+// ------------------------------------------------------------------------------------------------
+
+// Accumulates the rows of an image, for formats that can't be encoded incrementally.
+class LinearRowEncoder : public ImageEncoder::RowEncoder {
+public:
+    LinearRowEncoder(std::ostream& stream, ImageEncoder::Format format,
+            uint32_t width, uint32_t height, uint32_t channels,
+            const std::string& compression, const std::string& destName);
+
+    // ImageEncoder::RowEncoder interface
+    bool encodeRows(const LinearImage& rows) override;
+
+private:
+    std::ostream& mStream;
+    ImageEncoder::Format mFormat;
+    std::string mCompression;
+    std::string mDestName;
+    LinearImage mImage;
+};
+
+// ------------------------------------------------------------------------------------------------
+
+std::unique_ptr<ImageEncoder::RowEncoder> ImageEncoder::createRowEncoder(std::ostream& stream,
+        Format format, uint32_t width, uint32_t height, uint32_t channels,
+        const std::string& compression, const std::string& destName) {
+    switch (format) {
+        case Format::PNG:
+            return std::unique_ptr<RowEncoder>(PNGRowEncoder::create(stream,
+                    PNGEncoder::PixelFormat::sRGB, width, height, channels));
+        case Format::PNG_LINEAR:
+            return std::unique_ptr<RowEncoder>(PNGRowEncoder::create(stream,
+                    PNGEncoder::PixelFormat::LINEAR_RGB, width, height, channels));
+        case Format::RGBM:
+            return std::unique_ptr<RowEncoder>(PNGRowEncoder::create(stream,
+                    PNGEncoder::PixelFormat::RGBM, width, height, channels));
+        case Format::HDR:
+            if (channels != 3) {
+                return nullptr;
+            }
+            return std::unique_ptr<RowEncoder>(HDRRowEncoder::create(stream, width, height));
+        case Format::PSD:
+        case Format::EXR:
+        case Format::DDS:
+        case Format::DDS_LINEAR:
+            return std::unique_ptr<RowEncoder>(new LinearRowEncoder(stream, format,
+                    width, height, channels, compression, destName));
+    }
+}
+
+bool ImageEncoder::RowEncoder::isValidBand(const LinearImage& rows) const noexcept {
+    if (rows.getWidth() != mWidth || rows.getChannels() != mChannels ||
+            rows.getHeight() > mHeight - mRow) {
+        std::cerr << "Cannot encode rows: " << rows.getWidth() << "x" << rows.getHeight()
+                << ", " << rows.getChannels() << " channels, at row " << mRow << " of a "
+                << mWidth << "x" << mHeight << " image." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// ------------------------------------------------------------------------------------------------
+
 bool ImageEncoder::encode(std::ostream& stream, Format format, const LinearImage& image,
         const std::string& compression, const std::string& destName) {
     std::unique_ptr<Encoder> encoder;
@@ -285,8 +398,7 @@ void PNGEncoder::init() {
     png_set_write_fn(mPNG, this, cb_stream, nullptr);
 }
 
-int PNGEncoder::chooseColorType(const LinearImage& image) const {
-    size_t channels = image.getChannels();
+int PNGEncoder::chooseColorType(size_t channels) const {
     switch (channels) {
         case 1:
             return PNG_COLOR_TYPE_GRAY;
@@ -311,60 +423,75 @@ uint32_t PNGEncoder::getChannelsCount() const {
     }
 }
 
-bool PNGEncoder::encode(const LinearImage& image) {
-    size_t srcChannels = image.getChannels();
-    if ((mFormat == PixelFormat::RGBM && srcChannels != 3) ||
-            (srcChannels != 1 && srcChannels != 3)) {
-        std::cerr << "Cannot encode PNG: " << srcChannels << " channels." << std::endl;
+bool PNGEncoder::isSupported(size_t channels) const {
+    if ((mFormat == PixelFormat::RGBM && channels != 3) || (channels != 1 && channels != 3)) {
+        std::cerr << "Cannot encode PNG: " << channels << " channels." << std::endl;
         return false;
     }
+    return true;
+}
 
-    try {
-        mInfo = png_create_info_struct(mPNG);
+void PNGEncoder::writeHeader(size_t width, size_t height, size_t channels) {
+    mInfo = png_create_info_struct(mPNG);
 
-        // Write header (8 bit colour depth)
-        size_t width = image.getWidth();
-        size_t height = image.getHeight();
-        png_set_IHDR(mPNG, mInfo, width, height,
-              8, chooseColorType(image), PNG_INTERLACE_NONE,
-              PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_BASE);
+    // Write header (8 bit colour depth)
+    png_set_IHDR(mPNG, mInfo, width, height,
+          8, chooseColorType(channels), PNG_INTERLACE_NONE,
+          PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_BASE);
 
-        if (mFormat == PixelFormat::LINEAR_RGB) {
-            png_set_gAMA(mPNG, mInfo, 1.0);
-        } else {
-            png_set_sRGB_gAMA_and_cHRM(mPNG, mInfo, PNG_sRGB_INTENT_PERCEPTUAL);
-        }
+    if (mFormat == PixelFormat::LINEAR_RGB) {
+        png_set_gAMA(mPNG, mInfo, 1.0);
+    } else {
+        png_set_sRGB_gAMA_and_cHRM(mPNG, mInfo, PNG_sRGB_INTENT_PERCEPTUAL);
+    }
 
-        png_write_info(mPNG, mInfo);
+    png_write_info(mPNG, mInfo);
+}
 
-        std::unique_ptr<png_bytep[]> row_pointers(new png_bytep[height]);
-        std::unique_ptr<uint8_t[]> data;
+void PNGEncoder::writeRows(const LinearImage& image) {
+    size_t srcChannels = image.getChannels();
+    size_t width = image.getWidth();
+    size_t height = image.getHeight();
 
-        uint32_t dstChannels;
-        if (srcChannels == 1) {
-            dstChannels = 1;
-            data = fromLinearToGrayscale<uint8_t>(image);
-        } else {
-            dstChannels = getChannelsCount();
-            switch (mFormat) {
-                case PixelFormat::RGBM:
-                    data = fromLinearToRGBM<uint8_t>(image);
-                    break;
-                case PixelFormat::sRGB:
-                case PixelFormat::LINEAR_RGB:
-                    data = fromLinearToRGB<uint8_t>(image);
-                    break;
-            }
-        }
+    std::unique_ptr<uint8_t[]> data;
 
-        for (size_t y = 0; y < height; y++) {
-            row_pointers[y] = reinterpret_cast<png_bytep>(&data[y * width * dstChannels *
-                    sizeof(uint8_t)]);
+    uint32_t dstChannels;
+    if (srcChannels == 1) {
+        dstChannels = 1;
+        data = fromLinearToGrayscale<uint8_t>(image);
+    } else {
+        dstChannels = getChannelsCount();
+        switch (mFormat) {
+            case PixelFormat::RGBM:
+                data = fromLinearToRGBM<uint8_t>(image);
+                break;
+            case PixelFormat::sRGB:
+            case PixelFormat::LINEAR_RGB:
+                data = fromLinearToRGB<uint8_t>(image);
+                break;
         }
+    }
 
-        png_write_image(mPNG, row_pointers.get());
-        png_write_end(mPNG, mInfo);
-        mStream.flush();
+    for (size_t y = 0; y < height; y++) {
+        png_write_row(mPNG, reinterpret_cast<png_bytep>(&data[y * width * dstChannels *
+                sizeof(uint8_t)]));
+    }
+}
+
+void PNGEncoder::writeEnd() {
+    png_write_end(mPNG, mInfo);
+    mStream.flush();
+}
+
+bool PNGEncoder::encode(const LinearImage& image) {
+    if (!isSupported(image.getChannels())) {
+        return false;
+    }
+
+    try {
+        writeHeader(image.getWidth(), image.getHeight(), image.getChannels());
+        writeRows(image);
+        writeEnd();
     } catch (std::runtime_error& e) {
         // reset the stream, like we found it
         std::cerr << "Runtime error while encoding PNG: " << e.what() << std::endl;
@@ -474,66 +601,72 @@ void HDREncoder::rle(std::ostream& out, uint8_t const* data, size_t length) {
     }
 }
 
-bool HDREncoder::encode(const LinearImage& image) {
-    if (image.getChannels() != 3) {
-        return false;
-    }
+void HDREncoder::writeHeader(size_t width, size_t height) {
+    // Write header (8 bit color depth)
+    mStream << "#?RADIANCE" << std::endl;
+    mStream << "# cmgen" << std::endl;
+    mStream << "FORMAT=32-bit_rle_rgbe" << std::endl;
+    mStream << "GAMMA=" << std::to_string(1) << std::endl;
+    mStream << "EXPOSURE=" << std::to_string(0) << std::endl;
+    mStream << std::endl;
+    mStream << "-Y " << std::to_string(height) << " "
+            << "+X " << std::to_string(width) << std::endl;
+}
 
-    try {
-        // Write header (8 bit color depth)
-        size_t width = image.getWidth();
-        size_t height = image.getHeight();
+void HDREncoder::writeRows(const LinearImage& image) {
+    size_t width = image.getWidth();
+    size_t height = image.getHeight();
 
-        mStream << "#?RADIANCE" << std::endl;
-        mStream << "# cmgen" << std::endl;
-        mStream << "FORMAT=32-bit_rle_rgbe" << std::endl;
-        mStream << "GAMMA=" << std::to_string(1) << std::endl;
-        mStream << "EXPOSURE=" << std::to_string(0) << std::endl;
-        mStream << std::endl;
-        mStream << "-Y " << std::to_string(height) << " "
-                << "+X " << std::to_string(width) << std::endl;
-
-        // The Radiance format is not expected to use RLE encoding when
-        // scanlines are less than 8 pixels or more than 32,767 pixels
-        if (width < 8 || width > 32767) {
-            for (uint32_t y = 0; y < height; y++) {
-                uint8_t p[4];
-                auto data = image.get<float3>(0, y);
-                for (size_t x = 0; x < width; ++x, ++data) {
-                    float2rgbe(p, *data);
-                    mStream.write((char*) &p, 4);
-                }
+    // The Radiance format is not expected to use RLE encoding when
+    // scanlines are less than 8 pixels or more than 32,767 pixels
+    if (width < 8 || width > 32767) {
+        for (uint32_t y = 0; y < height; y++) {
+            uint8_t p[4];
+            auto data = image.get<float3>(0, y);
+            for (size_t x = 0; x < width; ++x, ++data) {
+                float2rgbe(p, *data);
+                mStream.write((char*) &p, 4);
             }
-        } else {
-            std::unique_ptr<uint8_t[]> rgbe(new uint8_t[width*4]);
-            uint8_t* const r = &rgbe[0];
-            uint8_t* const g = &rgbe[width];
-            uint8_t* const b = &rgbe[2*width];
-            uint8_t* const e = &rgbe[3*width];
-            uint16_t magic = 0x0202;
-            uint16_t widthNetwork = htons(width);
-
-            for (uint32_t y = 0; y < height; y++) {
-                // convert one scanline to RGBE
-                uint8_t p[4];
-                auto data = image.get<float3>(0, y);
-                for (size_t x = 0; x < width; ++x, ++data) {
-                    float2rgbe(p, *data);
-                    r[x] = p[0];
-                    g[x] = p[1];
-                    b[x] = p[2];
-                    e[x] = p[3];
-                }
-                // now RLE-compress each plane
-                mStream.write((char*) &magic, 2);
-                mStream.write((char*) &widthNetwork, 2);
-                rle(mStream, r, width);
-                rle(mStream, g, width);
-                rle(mStream, b, width);
-                rle(mStream, e, width);
+        }
+    } else {
+        std::unique_ptr<uint8_t[]> rgbe(new uint8_t[width*4]);
+        uint8_t* const r = &rgbe[0];
+        uint8_t* const g = &rgbe[width];
+        uint8_t* const b = &rgbe[2*width];
+        uint8_t* const e = &rgbe[3*width];
+        uint16_t magic = 0x0202;
+        uint16_t widthNetwork = htons(width);
+
+        for (uint32_t y = 0; y < height; y++) {
+            // convert one scanline to RGBE
+            uint8_t p[4];
+            auto data = image.get<float3>(0, y);
+            for (size_t x = 0; x < width; ++x, ++data) {
+                float2rgbe(p, *data);
+                r[x] = p[0];
+                g[x] = p[1];
+                b[x] = p[2];
+                e[x] = p[3];
             }
+            // now RLE-compress each plane
+            mStream.write((char*) &magic, 2);
+            mStream.write((char*) &widthNetwork, 2);
+            rle(mStream, r, width);
+            rle(mStream, g, width);
+            rle(mStream, b, width);
+            rle(mStream, e, width);
         }
+    }
+}
 
+bool HDREncoder::encode(const LinearImage& image) {
+    if (image.getChannels() != 3) {
+        return false;
+    }
+
+    try {
+        writeHeader(image.getWidth(), image.getHeight());
+        writeRows(image);
         mStream.flush();
     } catch(std::runtime_error& e) {
         // reset the stream, like we found it
@@ -1119,4 +1252,119 @@ bool DDSEncoder::encode(const LinearImage& image) {
     return true;
 }
 
+//-------------------------------------------------------------------------------------------------
+
+PNGRowEncoder* PNGRowEncoder::create(std::ostream& stream, PNGEncoder::PixelFormat format,
+        uint32_t width, uint32_t height, uint32_t channels) {
+    PNGEncoder* encoder = PNGEncoder::create(stream, format);
+    if (!encoder->isSupported(channels)) {
+        delete encoder;
+        return nullptr;
+    }
+    try {
+        encoder->writeHeader(width, height, channels);
+    } catch (std::runtime_error& e) {
+        std::cerr << "Runtime error while encoding PNG: " << e.what() << std::endl;
+        stream.seekp(encoder->mStreamStartPos);
+        delete encoder;
+        return nullptr;
+    }
+    return new PNGRowEncoder(encoder, width, height, channels);
+}
+
+PNGRowEncoder::PNGRowEncoder(PNGEncoder* encoder,
+        uint32_t width, uint32_t height, uint32_t channels) : mEncoder(encoder) {
+    mWidth = width;
+    mHeight = height;
+    mChannels = channels;
+}
+
+PNGRowEncoder::~PNGRowEncoder() {
+    delete mEncoder;
+}
+
+bool PNGRowEncoder::encodeRows(const LinearImage& rows) {
+    if (!isValidBand(rows)) {
+        return false;
+    }
+    try {
+        mEncoder->writeRows(rows);
+        mRow += rows.getHeight();
+        if (mRow == mHeight) {
+            mEncoder->writeEnd();
+        }
+    } catch (std::runtime_error& e) {
+        // reset the stream, like we found it
+        std::cerr << "Runtime error while encoding PNG: " << e.what() << std::endl;
+        mEncoder->mStream.seekp(mEncoder->mStreamStartPos);
+        return false;
+    }
+    return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+HDRRowEncoder* HDRRowEncoder::create(std::ostream& stream, uint32_t width, uint32_t height) {
+    HDREncoder* encoder = HDREncoder::create(stream);
+    encoder->writeHeader(width, height);
+    return new HDRRowEncoder(encoder, width, height);
+}
+
+HDRRowEncoder::HDRRowEncoder(HDREncoder* encoder, uint32_t width, uint32_t height)
+        : mEncoder(encoder) {
+    mWidth = width;
+    mHeight = height;
+    mChannels = 3;
+}
+
+HDRRowEncoder::~HDRRowEncoder() {
+    delete mEncoder;
+}
+
+bool HDRRowEncoder::encodeRows(const LinearImage& rows) {
+    if (!isValidBand(rows)) {
+        return false;
+    }
+    try {
+        mEncoder->writeRows(rows);
+        mRow += rows.getHeight();
+        if (mRow == mHeight) {
+            mEncoder->mStream.flush();
+        }
+    } catch(std::runtime_error& e) {
+        // reset the stream, like we found it
+        std::cerr << "Runtime error while encoding HDR: " << e.what() << std::endl;
+        mEncoder->mStream.seekp(mEncoder->mStreamStartPos);
+        return false;
+    }
+    return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+LinearRowEncoder::LinearRowEncoder(std::ostream& stream, ImageEncoder::Format format,
+        uint32_t width, uint32_t height, uint32_t channels,
+        const std::string& compression, const std::string& destName)
+        : mStream(stream), mFormat(format), mCompression(compression), mDestName(destName),
+          mImage(width, height, channels) {
+    mWidth = width;
+    mHeight = height;
+    mChannels = channels;
+}
+
+bool LinearRowEncoder::encodeRows(const LinearImage& rows) {
+    if (!isValidBand(rows)) {
+        return false;
+    }
+    memcpy(mImage.getPixelRef(0, mRow), rows.getPixelRef(),
+            sizeof(float) * mWidth * rows.getHeight() * mChannels);
+    mRow += rows.getHeight();
+    if (mRow == mHeight) {
+        bool result = ImageEncoder::encode(mStream, mFormat, mImage, mCompression, mDestName);
+        mImage = LinearImage();
+        return result;
+    }
+    return true;
+}
+
 } // namespace image
@@ -57,6 +57,66 @@ static void BM_JobSystemAsChildren4k(benchmark::State& state) {
     state.SetItemsProcessed((int64_t)state.iterations() * 4096);
 }
 
+static void BM_JobSystemAsChildren12k(benchmark::State& state) {
+    JobSystem js;
+    js.adopt();
+
+    // more jobs alive at once than fit in a single pool
+    {
+        PerformanceCounters pc(state);
+        for (auto _ : state) {
+            auto root = js.create(nullptr, &emptyJob);
+            for (size_t i = 0; i < 12287; i++) {
+                js.run(js.create(root, &emptyJob), JobSystem::DONT_SIGNAL);
+            }
+            js.runAndWait(root);
+        }
+    }
+    state.SetItemsProcessed((int64_t)state.iterations() * 12288);
+}
+
+static void BM_JobSystemHighPriorityChildren4k(benchmark::State& state) {
+    JobSystem js;
+    js.adopt();
+
+    {
+        PerformanceCounters pc(state);
+        for (auto _ : state) {
+            auto root = js.create(nullptr, &emptyJob);
+            for (size_t i = 0; i < 4095; i++) {
+                js.run(js.create(root, &emptyJob), JobSystem::HIGH_PRIORITY);
+            }
+            js.runAndWait(root);
+        }
+    }
+    state.SetItemsProcessed((int64_t)state.iterations() * 4096);
+}
+
+static void BM_JobSystemContinuations4k(benchmark::State& state) {
+    JobSystem js;
+    js.adopt();
+
+    // a chain of 4096 jobs, each running after the previous one
+    {
+        PerformanceCounters pc(state);
+        for (auto _ : state) {
+            auto root = js.create(nullptr, &emptyJob);
+            auto first = js.create(root, &emptyJob);
+            auto previous = first;
+            for (size_t i = 0; i < 4095; i++) {
+                auto next = js.create(root, &emptyJob);
+                auto job = next;
+                // nothing in the chain runs before first does, so next stays valid
+                js.runAfter(previous, job);
+                previous = next;
+            }
+            js.run(first);
+            js.runAndWait(root);
+        }
+    }
+    state.SetItemsProcessed((int64_t)state.iterations() * 4096);
+}
+
 static void BM_JobSystemParallelFor(benchmark::State& state) {
     JobSystem js;
     js.adopt();
@@ -75,4 +135,7 @@ static void BM_JobSystemParallelFor(benchmark::State& state) {
 
 BENCHMARK(BM_JobSystem);
 BENCHMARK(BM_JobSystemAsChildren4k);
+BENCHMARK(BM_JobSystemAsChildren12k);
+BENCHMARK(BM_JobSystemHighPriorityChildren4k);
+BENCHMARK(BM_JobSystemContinuations4k);
 BENCHMARK(BM_JobSystemParallelFor);
@@ -21,6 +21,7 @@
 
 #include <atomic>
 #include <functional>
+#include <memory>
 #include <thread>
 #include <vector>
 
@@ -37,7 +38,11 @@
 namespace utils {
 
 class JobSystem {
-    static constexpr size_t MAX_JOB_COUNT = 4096;
+    // Jobs are allocated from pools of JOB_POOL_SIZE jobs, new pools are added as needed,
+    // up to MAX_JOB_COUNT jobs.
+    static constexpr size_t JOB_POOL_SIZE = 4096;
+    static constexpr size_t MAX_JOB_POOL_COUNT = 4;
+    static constexpr size_t MAX_JOB_COUNT = JOB_POOL_SIZE * MAX_JOB_POOL_COUNT;
     static_assert(MAX_JOB_COUNT <= 0x7FFE, "MAX_JOB_COUNT must be <= 0x7FFE");
     using WorkQueue = WorkStealingDequeue<uint16_t, MAX_JOB_COUNT>;
 
@@ -70,7 +75,8 @@ public:
         uint16_t parent;                                        //  2 |  2
         std::atomic<uint16_t> runningJobCount = { 1 };          //  2 |  2
         mutable std::atomic<uint16_t> refCount = { 1 };         //  2 |  2
-                                                                //  6 |  2 (padding)
+        std::atomic<uint16_t> continuation = { 0 };             //  2 |  2
+                                                                //  4 |  0 (padding)
                                                                 // 64 | 64
     };
 
@@ -249,8 +255,11 @@ public:
      * Current thread must be owned by JobSystem's thread pool. See adopt().
      *
      * The job can't be used after this call.
+     *
+     * HIGH_PRIORITY jobs are executed before all normal priority jobs, by any thread. Jobs run
+     * from a HIGH_PRIORITY job are HIGH_PRIORITY as well.
      */
-    enum runFlags { DONT_SIGNAL = 0x1 };
+    enum runFlags { DONT_SIGNAL = 0x1, HIGH_PRIORITY = 0x2 };
     void run(Job*& job, uint32_t flags = 0) noexcept;
     void run(Job*&& job, uint32_t flags = 0) noexcept { // allows run(createJob(...));
         Job* p = job;
@@ -265,6 +274,23 @@ public:
      */
     Job* runAndRetain(Job* job, uint32_t flags = 0) noexcept;
 
+    /*
+     * Runs job once predecessor and all its children have finished, without blocking the
+     * calling thread. Current thread must be owned by JobSystem's thread pool. See adopt().
+     *
+     * predecessor must either not have been run yet, or be retained by the caller. A job can
+     * have a single continuation; to run several jobs after a predecessor use a continuation
+     * that runs them, to run a job after several predecessors make them children of a common
+     * parent and use that parent as the predecessor.
+     *
+     * The job can't be used after this call (retain() it first to wait on it).
+     */
+    void runAfter(Job* predecessor, Job*& job, uint32_t flags = 0) noexcept;
+    void runAfter(Job* predecessor, Job*&& job, uint32_t flags = 0) noexcept {
+        Job* p = job;
+        runAfter(predecessor, p, flags);
+    }
+
     /*
      * Wait on a job and destroys it.
      * Current thread must be owned by JobSystem's thread pool. See adopt().
@@ -328,12 +354,16 @@ private:
         // make sure storage is cache-line aligned
         WorkQueue workQueue;
 
+        alignas(CACHELINE_SIZE)     // this causes 56-bytes padding
+        WorkQueue highPriorityQueue;
+
         // these are not accessed by the worker threads
         alignas(CACHELINE_SIZE)     // this causes 56-bytes padding
         JobSystem* js;
         std::thread thread;
         default_random_engine rndGen;
         uint32_t id;
+        bool highPriority = false;  // whether the job being executed is HIGH_PRIORITY
     };
 
     static_assert(sizeof(ThreadState) % CACHELINE_SIZE == 0,
@@ -345,6 +375,7 @@ private:
     void decRef(Job const* job) noexcept;
 
     Job* allocateJob() noexcept;
+    Job* growJobPool(size_t poolCount) noexcept;
     JobSystem::ThreadState* getStateToStealFrom(JobSystem::ThreadState& state) noexcept;
     bool hasJobCompleted(Job const* job) noexcept;
 
@@ -354,9 +385,28 @@ private:
     void loop(ThreadState* state) noexcept;
     bool execute(JobSystem::ThreadState& state) noexcept;
     void finish(Job* job) noexcept;
+    void schedule(ThreadState& state, Job* job, uint32_t flags) noexcept;
+
+    size_t getIndex(Job const* job) const noexcept {
+        // a job can't be used by a thread before its pool is published, so we can't miss it
+        const size_t poolCount = mJobPoolCount.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < poolCount; i++) {
+            size_t offset = (uintptr_t(job) - uintptr_t(mJobStorageBase[i])) / sizeof(Job);
+            if (offset < JOB_POOL_SIZE) {
+                return i * JOB_POOL_SIZE + offset;
+            }
+        }
+        assert(false);
+        return MAX_JOB_COUNT;
+    }
+
+    Job* getJob(size_t index) const noexcept {
+        assert(index < MAX_JOB_COUNT);
+        return &mJobStorageBase[index / JOB_POOL_SIZE][index % JOB_POOL_SIZE];
+    }
 
     void put(WorkQueue& workQueue, Job* job) noexcept {
-        size_t index = job - mJobStorageBase;
+        size_t index = getIndex(job);
         assert(index >= 0 && index < MAX_JOB_COUNT);
         workQueue.push(uint16_t(index + 1));
     }
@@ -364,15 +414,22 @@ private:
     Job* pop(WorkQueue& workQueue) noexcept {
         size_t index = workQueue.pop();
         assert(index <= MAX_JOB_COUNT);
-        return !index ? nullptr : &mJobStorageBase[index - 1];
+        return !index ? nullptr : getJob(index - 1);
     }
 
     Job* steal(WorkQueue& workQueue) noexcept {
         size_t index = workQueue.steal();
         assert(index <= MAX_JOB_COUNT);
-        return !index ? nullptr : &mJobStorageBase[index - 1];
+        return !index ? nullptr : getJob(index - 1);
     }
 
+    // Job::continuation holds the continuation's index + 1, CONTINUATION_HIGH_PRIORITY is set
+    // when it's a HIGH_PRIORITY job. CONTINUATION_DONE is set once the job has finished.
+    static constexpr uint16_t CONTINUATION_HIGH_PRIORITY = 0x8000;
+    static constexpr uint16_t CONTINUATION_DONE = 0xFFFF;
+    static_assert(MAX_JOB_COUNT < CONTINUATION_HIGH_PRIORITY - 1,
+            "continuation indices collide with CONTINUATION_HIGH_PRIORITY");
+
     // these have thread contention, keep them together
     utils::Mutex mLooperLock;
     utils::Condition mLooperCondition;
@@ -381,7 +438,12 @@ private:
     utils::Condition mWaiterCondition;
 
     std::atomic<uint32_t> mActiveJobs = { 0 };
-    utils::Arena<utils::ThreadSafeObjectPoolAllocator<Job>, LockingPolicy::NoLock> mJobPool;
+    std::atomic<uint32_t> mActiveHighPriorityJobs = { 0 };
+
+    using JobPool = utils::Arena<utils::ThreadSafeObjectPoolAllocator<Job>, LockingPolicy::NoLock>;
+    std::unique_ptr<JobPool> mJobPools[MAX_JOB_POOL_COUNT];
+    std::atomic<uint32_t> mJobPoolCount = { 0 };
+    utils::Mutex mJobPoolLock;                          // only taken to add a pool
 
     template <typename T>
     using aligned_vector = std::vector<T, utils::STLAlignedAllocator<T>>;
@@ -396,7 +458,7 @@ private:
     aligned_vector<ThreadState> mThreadStates;          // actual data is stored offline
     std::atomic<bool> mExitRequested = { false };       // this one is almost never written
     std::atomic<uint16_t> mAdoptedThreads = { 0 };      // this one is almost never written
-    Job* const mJobStorageBase;                         // Base for conversion to indices
+    Job* mJobStorageBase[MAX_JOB_POOL_COUNT] = {};      // Bases for conversion to indices
     uint16_t mThreadCount = 0;                          // total # of threads in the pool
     uint8_t mParallelSplitCount = 0;                    // # of split allowable in parallel_for
     Job* mMasterJob = nullptr;
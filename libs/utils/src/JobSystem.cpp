@@ -113,11 +113,12 @@ void JobSystem::setThreadAffinityById(size_t id) noexcept {
 }
 
 JobSystem::JobSystem(size_t threadCount, size_t adoptableThreadsCount) noexcept
-    : mJobPool("JobSystem Job pool", MAX_JOB_COUNT * sizeof(Job)),
-      mJobStorageBase(static_cast<Job *>(mJobPool.getAllocator().getCurrent()))
 {
     SYSTRACE_ENABLE();
 
+    // start with a single pool, more are added by allocateJob() if needed
+    growJobPool(0);
+
     if (threadCount == 0) {
         // default value, system dependant
         size_t hwThreads = std::thread::hardware_concurrency();
@@ -195,7 +196,7 @@ void JobSystem::decRef(Job const* job) noexcept {
         // TSAN doesn't handle standalone fences, we use memory_order_acq_rel instead
         std::atomic_thread_fence(std::memory_order_acquire);
 #endif
-        mJobPool.destroy(job);
+        mJobPools[getIndex(job) / JOB_POOL_SIZE]->destroy(job);
     }
 }
 
@@ -230,7 +231,44 @@ inline JobSystem::ThreadState& JobSystem::getState() noexcept {
 }
 
 JobSystem::Job* JobSystem::allocateJob() noexcept {
-    return mJobPool.make<Job>();
+    // memory_order_acquire is needed to see the pools published by growJobPool()
+    const size_t poolCount = mJobPoolCount.load(std::memory_order_acquire);
+    for (size_t i = 0; i < poolCount; i++) {
+        Job* const job = mJobPools[i]->make<Job>();
+        if (UTILS_LIKELY(job)) {
+            return job;
+        }
+    }
+    return growJobPool(poolCount);
+}
+
+UTILS_NOINLINE
+JobSystem::Job* JobSystem::growJobPool(size_t poolCount) noexcept {
+    SYSTRACE_CALL();
+
+    std::lock_guard<Mutex> lock(mJobPoolLock);
+
+    // another thread may have added a pool while we were waiting
+    size_t currentPoolCount = mJobPoolCount.load(std::memory_order_relaxed);
+    if (currentPoolCount != poolCount) {
+        Job* const job = mJobPools[currentPoolCount - 1]->make<Job>();
+        if (job || currentPoolCount == MAX_JOB_POOL_COUNT) {
+            return job;
+        }
+    }
+
+    if (currentPoolCount == MAX_JOB_POOL_COUNT) {
+        // we're out of jobs
+        return nullptr;
+    }
+
+    JobPool* const pool = new JobPool("JobSystem Job pool", JOB_POOL_SIZE * sizeof(Job));
+    mJobPools[currentPoolCount].reset(pool);
+    mJobStorageBase[currentPoolCount] = static_cast<Job*>(pool->getAllocator().getCurrent());
+
+    // memory_order_release is needed so the new pool is seen by allocateJob()
+    mJobPoolCount.store(uint32_t(currentPoolCount + 1), std::memory_order_release);
+    return pool->make<Job>();
 }
 
 inline JobSystem::ThreadState* JobSystem::getStateToStealFrom(JobSystem::ThreadState& state) noexcept {
@@ -245,7 +283,25 @@ inline JobSystem::ThreadState* JobSystem::getStateToStealFrom(JobSystem::ThreadS
 
 bool JobSystem::execute(JobSystem::ThreadState& state) noexcept {
 
-    Job* job = pop(state.workQueue);
+    bool highPriority = true;
+    Job* job = pop(state.highPriorityQueue);
+    if (job == nullptr && mActiveHighPriorityJobs.load(std::memory_order_relaxed)) {
+        // high priority jobs are pending somewhere, look for them before our own queue
+        const size_t threadCount = mThreadCount + mAdoptedThreads.load(std::memory_order_relaxed);
+        const size_t first = state.rndGen() % threadCount;
+        for (size_t i = 0; i < threadCount && !job; i++) {
+            ThreadState& stateToStealFrom = mThreadStates[(first + i) % threadCount];
+            if (&stateToStealFrom != &state) {
+                job = steal(stateToStealFrom.highPriorityQueue);
+            }
+        }
+    }
+
+    if (job == nullptr) {
+        highPriority = false;
+        job = pop(state.workQueue);
+    }
+
     if (job == nullptr) {
         // our queue is empty, try to steal a job
         do {
@@ -254,7 +310,11 @@ bool JobSystem::execute(JobSystem::ThreadState& state) noexcept {
                 stateToStealFrom = getStateToStealFrom(state);
                 // don't steal from our own queue
             } while (stateToStealFrom == &state);
-            job = steal(stateToStealFrom->workQueue);
+            job = steal(stateToStealFrom->highPriorityQueue);
+            highPriority = job != nullptr;
+            if (!job) {
+                job = steal(stateToStealFrom->workQueue);
+            }
             // nullptr -> nothing to steal in that queue either, if there are active jobs,
             // continue to try stealing one.
         } while (!job && mActiveJobs.load(std::memory_order_relaxed) && !exitRequested());
@@ -267,9 +327,17 @@ bool JobSystem::execute(JobSystem::ThreadState& state) noexcept {
         assert(activeJobs); // whoops, we were already at 0
         SYSTRACE_VALUE32("JobSystem::activeJobs", activeJobs - 1);
 
+        if (highPriority) {
+            mActiveHighPriorityJobs.fetch_sub(1, std::memory_order_relaxed);
+        }
+
         if (UTILS_LIKELY(job->function)) {
             SYSTRACE_NAME("job->function");
+            // jobs can be executed recursively (e.g. from waitAndRelease())
+            const bool wasHighPriority = state.highPriority;
+            state.highPriority = highPriority;
             job->function(job->storage, *this, job);
+            state.highPriority = wasHighPriority;
         }
         finish(job);
     }
@@ -306,8 +374,6 @@ void JobSystem::finish(Job* job) noexcept {
     bool notify = false;
 
     // terminate this job and notify its parent
-    auto& jobPool = mJobPool;
-    Job* const storage = mJobStorageBase;
     do {
         // std::memory_order_release here is needed to synchronize with JobSystem::wait()
         // which needs to "see" all changes that happened before the job terminated.
@@ -320,9 +386,17 @@ void JobSystem::finish(Job* job) noexcept {
 #if !__has_feature(thread_sanitizer)
             std::atomic_thread_fence(std::memory_order_acquire);
 #endif
-            // no more work, destroy this job and notify its the parent
+            // no more work, schedule its continuation, destroy this job and notify its the parent
             notify = true;
-            Job* const parent = job->parent == 0x7FFF ? nullptr : &storage[job->parent];
+            // memory_order_acq_rel is needed to synchronize with runAfter()
+            uint16_t continuation = job->continuation.exchange(CONTINUATION_DONE,
+                    std::memory_order_acq_rel);
+            if (continuation) {
+                Job* const next = getJob((continuation & ~CONTINUATION_HIGH_PRIORITY) - 1u);
+                schedule(getState(), next,
+                        (continuation & CONTINUATION_HIGH_PRIORITY) ? HIGH_PRIORITY : 0);
+            }
+            Job* const parent = job->parent == 0x7FFF ? nullptr : getJob(job->parent);
             decRef(job);
             job = parent;
         } else {
@@ -356,7 +430,7 @@ JobSystem::Job* JobSystem::create(JobSystem::Job* parent, JobFunc func) noexcept
             // can't create a child job of a terminated parent
             assert(parentJobCount > 0);
 
-            index = parent - mJobStorageBase;
+            index = getIndex(parent);
             assert(index < MAX_JOB_COUNT);
         }
         job->function = func;
@@ -381,19 +455,18 @@ void JobSystem::release(JobSystem::Job*& job) noexcept {
     job = nullptr;
 }
 
-void JobSystem::run(JobSystem::Job*& job, uint32_t flags) noexcept {
-#if HEAVY_SYSTRACE
-    SYSTRACE_CALL();
-#endif
-
-    ThreadState& state(getState());
-
+void JobSystem::schedule(ThreadState& state, Job* job, uint32_t flags) noexcept {
     // increase the active job count before we add the job to the queue, because otherwise
     // the job could run and finish before the counter is incremented, which would trigger
     // an assert() in execute(). Either way, it's not "wrong", but the assert() is useful.
     uint32_t activeJobs = mActiveJobs.fetch_add(1, std::memory_order_relaxed);
 
-    put(state.workQueue, job);
+    if (flags & HIGH_PRIORITY) {
+        mActiveHighPriorityJobs.fetch_add(1, std::memory_order_relaxed);
+        put(state.highPriorityQueue, job);
+    } else {
+        put(state.workQueue, job);
+    }
 
     SYSTRACE_CONTEXT();
     SYSTRACE_VALUE32("JobSystem::activeJobs", activeJobs + 1);
@@ -404,11 +477,50 @@ void JobSystem::run(JobSystem::Job*& job, uint32_t flags) noexcept {
         { std::lock_guard<Mutex> lock(mLooperLock); }
         mLooperCondition.notify_one();
     }
+}
+
+void JobSystem::run(JobSystem::Job*& job, uint32_t flags) noexcept {
+#if HEAVY_SYSTRACE
+    SYSTRACE_CALL();
+#endif
+
+    ThreadState& state(getState());
+
+    // jobs run from a high priority job inherit its priority
+    if (state.highPriority) {
+        flags |= HIGH_PRIORITY;
+    }
+
+    schedule(state, job, flags);
 
     // after run() returns, the job is virtually invalid (it'll die on its own)
     job = nullptr;
 }
 
+void JobSystem::runAfter(Job* predecessor, Job*& job, uint32_t flags) noexcept {
+    assert(predecessor && job);
+
+    ThreadState& state(getState());
+    if (state.highPriority) {
+        flags |= HIGH_PRIORITY;
+    }
+
+    // if the predecessor hasn't finished, it'll schedule the job when it does.
+    // memory_order_acq_rel is needed to synchronize with finish()
+    uint16_t expected = 0;
+    const uint16_t continuation = uint16_t(getIndex(job) + 1) |
+            ((flags & HIGH_PRIORITY) ? CONTINUATION_HIGH_PRIORITY : 0);
+    if (!predecessor->continuation.compare_exchange_strong(expected, continuation,
+            std::memory_order_acq_rel, std::memory_order_acquire)) {
+        // a job can only have a single continuation
+        assert(expected == CONTINUATION_DONE);
+        schedule(state, job, flags);
+    }
+
+    // after runAfter() returns, the job is virtually invalid (it'll die on its own)
+    job = nullptr;
+}
+
 JobSystem::Job* JobSystem::runAndRetain(JobSystem::Job* job, uint32_t flags) noexcept {
     JobSystem::Job* retained = retain(job);
     run(job, flags);
@@ -482,7 +594,8 @@ void JobSystem::emancipate() {
 
 io::ostream& operator<<(io::ostream& out, JobSystem const& js) {
     for (auto const& item : js.mThreadStates) {
-        out << size_t(item.id) << ": " << item.workQueue.getCount() << io::endl;
+        out << size_t(item.id) << ": " << item.workQueue.getCount()
+            << " (high priority: " << item.highPriorityQueue.getCount() << ")" << io::endl;
     }
     return out;
 }
@@ -22,7 +22,9 @@
 #include <math/vec3.h>
 #include <math/mat3.h>
 
+#include <algorithm>
 #include <array>
+#include <mutex>
 #include <thread>
 #include <utils/Allocator.h>
 
@@ -342,5 +344,121 @@ TEST(JobSystem, JobSystemDelegates) {
     EXPECT_EQ(4, functor.result);
 
 
+    js.emancipate();
+}
+
+TEST(JobSystem, JobSystemHighPriority) {
+    JobSystem js(1, 1);
+    js.adopt();
+
+    // keep the worker thread busy, so the jobs below are all executed by this thread
+    std::atomic_bool blocked = { false };
+    std::atomic_bool unblock = { false };
+    JobSystem::Job* blocker = js.runAndRetain(jobs::createJob(js, nullptr, [&]() {
+        blocked = true;
+        while (!unblock) {
+            std::this_thread::yield();
+        }
+    }));
+    while (!blocked) {
+        std::this_thread::yield();
+    }
+
+    std::vector<int> order;
+    JobSystem::Job* root = js.createJob();
+    for (int i = 0; i < 16; i++) {
+        js.run(jobs::createJob(js, root, [&order]() { order.push_back(0); }),
+                JobSystem::DONT_SIGNAL);
+    }
+    for (int i = 0; i < 16; i++) {
+        // children of a high priority job are high priority as well
+        js.run(js.createJob(root, [&order](JobSystem& js, JobSystem::Job* parent) {
+            order.push_back(1);
+            js.run(jobs::createJob(js, parent, [&order]() { order.push_back(1); }),
+                    JobSystem::DONT_SIGNAL);
+        }), JobSystem::DONT_SIGNAL | JobSystem::HIGH_PRIORITY);
+    }
+    js.runAndWait(root);
+
+    unblock = true;
+    js.waitAndRelease(blocker);
+
+    ASSERT_EQ(48, order.size());
+    EXPECT_TRUE(std::is_partitioned(order.begin(), order.end(), [](int p) { return p == 1; }));
+    EXPECT_EQ(32, std::count(order.begin(), order.end(), 1));
+
+    js.emancipate();
+}
+
+TEST(JobSystem, JobSystemContinuations) {
+    JobSystem js;
+    js.adopt();
+
+    std::mutex lock;
+    std::vector<char> order;
+    auto record = [&](char c) {
+        return [&, c]() {
+            std::lock_guard<std::mutex> guard(lock);
+            order.push_back(c);
+        };
+    };
+
+    // a -> b -> c, all children of root so we can wait on them
+    JobSystem::Job* root = js.createJob();
+    JobSystem::Job* a = jobs::createJob(js, root, record('a'));
+    JobSystem::Job* b = jobs::createJob(js, root, record('b'));
+    JobSystem::Job* c = jobs::createJob(js, root, record('c'));
+    js.runAfter(b, c);
+    js.runAfter(a, b);
+    js.run(a);
+    js.runAndWait(root);
+    EXPECT_EQ((std::vector<char>{ 'a', 'b', 'c' }), order);
+
+    // (x, y) -> z, joined through their parent
+    order.clear();
+    root = js.createJob();
+    JobSystem::Job* join = js.createJob(root);
+    JobSystem::Job* z = jobs::createJob(js, root, record('z'));
+    js.run(jobs::createJob(js, join, record('x')));
+    js.run(jobs::createJob(js, join, record('y')));
+    js.runAfter(join, z);
+    js.run(join);
+    js.runAndWait(root);
+    ASSERT_EQ(3, order.size());
+    EXPECT_EQ('z', order[2]);
+
+    // the predecessor has already finished
+    order.clear();
+    JobSystem::Job* done = jobs::createJob(js, nullptr, record('d'));
+    JobSystem::Job* retainedDone = js.retain(done);
+    js.runAndWait(done);
+    JobSystem::Job* e = jobs::createJob(js, nullptr, record('e'));
+    JobSystem::Job* retainedE = js.retain(e);
+    js.runAfter(retainedDone, e);
+    js.release(retainedDone);
+    js.waitAndRelease(retainedE);
+    EXPECT_EQ((std::vector<char>{ 'd', 'e' }), order);
+
+    js.emancipate();
+}
+
+TEST(JobSystem, JobSystemManyJobs) {
+    JobSystem js;
+    js.adopt();
+
+    // more jobs alive at once than fit in a single pool
+    std::atomic_int calls = { 0 };
+    std::vector<JobSystem::Job*> children(12000);
+    JobSystem::Job* root = js.createJob();
+    for (auto& child : children) {
+        child = js.createJob(root, [&calls](JobSystem&, JobSystem::Job*) { calls++; });
+        ASSERT_NE(nullptr, child);
+    }
+    for (auto& child : children) {
+        js.run(child);
+    }
+    js.runAndWait(root);
+    EXPECT_EQ(12000, calls.load());
+
     js.emancipate();
 }
@@ -68,15 +68,14 @@ bool IBL::loadFromKtx(const std::string& prefix) {
         }
     }
 
-    auto createKtx = [] (Path path) {
-        using namespace std;
-        ifstream file(path.getPath(), ios::binary);
-        vector<uint8_t> contents((istreambuf_iterator<char>(file)), {});
-        return new image::KtxBundle(contents.data(), contents.size());
-    };
-
-    KtxBundle* iblKtx = createKtx(iblPath);
-    KtxBundle* skyKtx = createKtx(skyPath);
+    // The files are mapped rather than read, the textures are uploaded straight from the mappings.
+    KtxBundle* iblKtx = KtxBundle::mapFile(iblPath.c_str());
+    KtxBundle* skyKtx = KtxBundle::mapFile(skyPath.c_str());
+    if (!iblKtx || !skyKtx) {
+        delete iblKtx;
+        delete skyKtx;
+        return false;
+    }
 
     mSkyboxTexture = KtxUtility::createTexture(&mEngine, skyKtx, false, true);
     mTexture = KtxUtility::createTexture(&mEngine, iblKtx, false, true);
@@ -83,11 +83,13 @@ int main(int argc, char** argv) {
         auto& rcm = engine->getRenderableManager();
         auto& em = utils::EntityManager::get();
 
-        // Create textures. The KTX bundles are freed by KtxUtility.
-        auto albedo = new image::KtxBundle(TEXTURES_ALBEDO_S3TC_DATA, TEXTURES_ALBEDO_S3TC_SIZE);
-        auto ao = new image::KtxBundle(TEXTURES_AO_DATA, TEXTURES_AO_SIZE);
-        auto metallic = new image::KtxBundle(TEXTURES_METALLIC_DATA, TEXTURES_METALLIC_SIZE);
-        auto roughness = new image::KtxBundle(TEXTURES_ROUGHNESS_DATA, TEXTURES_ROUGHNESS_SIZE);
+        // Create textures. The KTX bundles are freed by KtxUtility. The resources are static, so
+        // the bundles can point into them rather than copy them.
+        using image::KtxBundle;
+        auto albedo = KtxBundle::createView(TEXTURES_ALBEDO_S3TC_DATA, TEXTURES_ALBEDO_S3TC_SIZE);
+        auto ao = KtxBundle::createView(TEXTURES_AO_DATA, TEXTURES_AO_SIZE);
+        auto metallic = KtxBundle::createView(TEXTURES_METALLIC_DATA, TEXTURES_METALLIC_SIZE);
+        auto roughness = KtxBundle::createView(TEXTURES_ROUGHNESS_DATA, TEXTURES_ROUGHNESS_SIZE);
         app.albedo = KtxUtility::createTexture(engine, albedo, true, false);
         app.ao = KtxUtility::createTexture(engine, ao, false, false);
         app.metallic = KtxUtility::createTexture(engine, metallic, false, false);
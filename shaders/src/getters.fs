@@ -24,7 +24,34 @@ vec2 getUV1() {
 #endif
 
 #if defined(HAS_SHADOWING) && defined(HAS_DIRECTIONAL_LIGHTING)
+/**
+ * Returns the shadow cascade covering the current fragment, i.e. the number of cascades
+ * whose far plane is in front of the fragment. Returns the cascade count when the fragment
+ * is beyond the last cascade.
+ */
+uint getShadowCascade() {
+    HIGHP float z = (getViewFromWorldMatrix() * vec4(vertex_worldPosition, 1.0)).z;
+    bvec4 greaterThanSplits = lessThan(vec4(z), frameUniforms.cascadeSplits);
+    return uint(dot(vec4(greaterThanSplits), vec4(1.0)));
+}
+
+/**
+ * Computes the position of the current fragment in the shadow map, including the normal
+ * and constant biases. Fragments beyond the last cascade are mapped to the near plane of
+ * the shadow map, so they are never in shadow.
+ */
 HIGHP vec3 getLightSpacePosition() {
-    return vertex_lightSpacePosition.xyz * (1.0 / vertex_lightSpacePosition.w);
+    uint cascade = getShadowCascade();
+    if (cascade >= uint(frameUniforms.shadowBias.z)) {
+        return vec3(0.5, 0.5, 0.0);
+    }
+
+    float texelSize = frameUniforms.cascadeTexelSize[cascade];
+    HIGHP vec3 p = vertex_worldPosition +
+            vertex_shadowNormalOffset * (frameUniforms.shadowBias.y * texelSize);
+    HIGHP vec4 lightSpacePosition = frameUniforms.lightFromWorldMatrix[cascade] * vec4(p, 1.0);
+    lightSpacePosition.z -= frameUniforms.shadowBias.x * frameUniforms.cascadeDepthScale[cascade];
+
+    return lightSpacePosition.xyz * (1.0 / lightSpacePosition.w);
 }
 #endif
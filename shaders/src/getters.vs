@@ -2,18 +2,40 @@
 // Uniforms access
 //------------------------------------------------------------------------------
 
-mat4 getLightFromWorldMatrix() {
-    return frameUniforms.lightFromWorldMatrix;
+#if defined(HAS_INSTANCING)
+#if defined(CODEGEN_TARGET_VULKAN_ENVIRONMENT)
+#define INSTANCE_INDEX gl_InstanceIndex
+#else
+#define INSTANCE_INDEX gl_InstanceID
+#endif
+
+// each instance is stored as 7 vec4, the 4 columns of the world transform followed by the
+// 3 columns of the normal transform
+uint getInstanceOffset() {
+    return uint(INSTANCE_INDEX) * 7u;
 }
+#endif
 
 /** @public-api */
 mat4 getWorldFromModelMatrix() {
+#if defined(HAS_INSTANCING)
+    uint i = getInstanceOffset();
+    return mat4(instancesUniforms.instances[i + 0u], instancesUniforms.instances[i + 1u],
+                instancesUniforms.instances[i + 2u], instancesUniforms.instances[i + 3u]);
+#else
     return objectUniforms.worldFromModelMatrix;
+#endif
 }
 
 /** @public-api */
 mat3 getWorldFromModelNormalMatrix() {
+#if defined(HAS_INSTANCING)
+    uint i = getInstanceOffset();
+    return mat3(instancesUniforms.instances[i + 4u].xyz, instancesUniforms.instances[i + 5u].xyz,
+                instancesUniforms.instances[i + 6u].xyz);
+#else
     return objectUniforms.worldFromModelNormalMatrix;
+#endif
 }
 
 //------------------------------------------------------------------------------
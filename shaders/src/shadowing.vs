@@ -4,12 +4,12 @@
 
 #if defined(HAS_SHADOWING) && defined(HAS_DIRECTIONAL_LIGHTING)
 /**
- * Computes the light space position of the specified world space point.
- * The returned point may contain a bias to attempt to eliminate common
- * shadowing artifacts such as "acne". To achieve this, the world space
- * normal at the point must also be passed to this function.
+ * Computes the direction and relative amount by which a point must be moved along the
+ * specified world space normal to attempt to eliminate common shadowing artifacts such
+ * as "acne". The offset is scaled by the normal bias and the size of a shadow map texel
+ * in the fragment shader, once the shadow cascade is known.
  */
-vec4 getLightSpacePosition(const vec3 p, const vec3 n) {
+vec3 getShadowNormalOffset(const vec3 n) {
     float NoL = saturate(dot(n, frameUniforms.lightDirection));
 
 #ifdef TARGET_MOBILE
@@ -18,10 +18,6 @@ vec4 getLightSpacePosition(const vec3 p, const vec3 n) {
     float normalBias = sqrt(1.0 - NoL * NoL);
 #endif
 
-    vec3 offsetPosition = p + n * (normalBias * frameUniforms.shadowBias.y);
-    vec4 lightSpacePosition = (getLightFromWorldMatrix() * vec4(offsetPosition, 1.0));
-    lightSpacePosition.z -= frameUniforms.shadowBias.x;
-
-    return lightSpacePosition;
+    return n * normalBias;
 }
 #endif
@@ -57,8 +57,12 @@ static void usage(char* name) {
             "       Reflect the specified metadata as JSON: parameters\n\n"
             "   --variant-filter=<filter>, -V <filter>\n"
             "       Filter out specified comma-separated variants:\n"
-            "           directionalLighting, dynamicLighting, shadowReceiver, skinning\n"
+            "           directionalLighting, dynamicLighting, shadowReceiver, skinning,\n"
+            "           instancing\n"
             "       This variant filter is merged the filter from the material, if any\n\n"
+            "   --workers=<n>, -j <n>\n"
+            "       Number of threads used to compile the shaders, 0 (default) picks a number\n"
+            "       based on the available cores and 1 compiles on the calling thread only\n\n"
             "   --version, -v\n"
             "       Print the material version number\n\n"
             "Internal use and debugging only:\n"
@@ -101,6 +105,8 @@ static uint8_t parseVariantFilter(const std::string& arg) {
             variantFilter |= filament::Variant::SHADOW_RECEIVER;
         } else if (item == "skinning") {
             variantFilter |= filament::Variant::SKINNING;
+        } else if (item == "instancing") {
+            variantFilter |= filament::Variant::INSTANCING;
         }
     }
     return variantFilter;
@@ -111,7 +117,7 @@ CommandlineConfig::CommandlineConfig(int argc, char** argv) : Config(), mArgc(ar
 }
 
 bool CommandlineConfig::parse() {
-    static constexpr const char* OPTSTR = "hlxo:f:dm:a:p:OSEr:vV:g";
+    static constexpr const char* OPTSTR = "hlxo:f:dm:a:p:OSEr:vV:gj:";
     static const struct option OPTIONS[] = {
             { "help",                    no_argument, nullptr, 'h' },
             { "license",                 no_argument, nullptr, 'l' },
@@ -130,6 +136,7 @@ bool CommandlineConfig::parse() {
             { "reflect",           required_argument, nullptr, 'r' },
             { "print",                   no_argument, nullptr, 't' },
             { "version",                 no_argument, nullptr, 'v' },
+            { "workers",           required_argument, nullptr, 'j' },
             { nullptr, 0, nullptr, 0 }  // termination of the option list
     };
 
@@ -236,6 +243,17 @@ bool CommandlineConfig::parse() {
             case 't':
                 mPrintShaders = true;
                 break;
+            case 'j': {
+                char* end = nullptr;
+                long workers = strtol(arg.c_str(), &end, 10);
+                if (arg.empty() || *end || workers < 0) {
+                    std::cerr << "Invalid number of workers. Must be a positive integer or 0."
+                            << std::endl;
+                    return false;
+                }
+                mWorkerCount = size_t(workers);
+                break;
+            }
         }
     }
 
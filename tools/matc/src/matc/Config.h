@@ -119,6 +119,11 @@ public:
         return mVariantFilter;
     }
 
+    // number of threads used to compile the shaders, 0 means automatic
+    size_t getWorkerCount() const noexcept {
+        return mWorkerCount;
+    }
+
 protected:
     bool mDebug = false;
     bool mIsValid = true;
@@ -130,6 +135,7 @@ protected:
     OutputFormat mOutputFormat = OutputFormat::BLOB;
     TargetApi mTargetApi = TargetApi::OPENGL;
     uint8_t mVariantFilter = 0;
+    size_t mWorkerCount = 0;
 };
 
 }
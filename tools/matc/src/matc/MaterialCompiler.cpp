@@ -24,6 +24,8 @@
 
 #include <filamat/Enums.h>
 
+#include <utils/JobSystem.h>
+
 #include "MaterialLexeme.h"
 #include "MaterialLexer.h"
 #include "JsonishLexer.h"
@@ -274,7 +276,7 @@ bool MaterialCompiler::run(const Config& config) {
         .variantFilter(config.getVariantFilter() | builder.getVariantFilter());
 
     // Write builder.build() to output.
-    Package package = builder.build();
+    Package package = build(builder, config.getWorkerCount());
     if (!package.isValid()) {
         std::cerr << "Could not compile material " << input->getName() << std::endl;
         return false;
@@ -282,6 +284,18 @@ bool MaterialCompiler::run(const Config& config) {
     return writePackage(package, config);
 }
 
+Package MaterialCompiler::build(MaterialBuilder& builder, size_t workerCount) const noexcept {
+    if (workerCount == 1) {
+        return builder.build();
+    }
+    // the calling thread is adopted, so it counts as one of the workers
+    JobSystem js(workerCount ? workerCount - 1 : 0);
+    js.adopt();
+    Package package = builder.build(js);
+    js.emancipate();
+    return package;
+}
+
 bool MaterialCompiler::checkParameters(const Config& config) {
     // Check for input file.
     if (config.getInput() == nullptr) {
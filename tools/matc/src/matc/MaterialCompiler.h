@@ -64,6 +64,9 @@ private:
     bool ignoreLexemeJSON(const JsonishValue*, filamat::MaterialBuilder& builder) const noexcept;
     bool isValidJsonStart(const char* buffer, size_t size) const noexcept;
 
+    // builds the package using workerCount threads, 0 means automatic
+    filamat::Package build(filamat::MaterialBuilder& builder, size_t workerCount) const noexcept;
+
     // Member function pointer type, this is used to implement a Command design
     // pattern.
     using MaterialConfigProcessor = bool (MaterialCompiler::*)
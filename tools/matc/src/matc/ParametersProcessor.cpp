@@ -133,6 +133,7 @@ ParametersProcessor::ParametersProcessor() {
     mStringToVariant["dynamicLighting"] = filament::Variant::DYNAMIC_LIGHTING;
     mStringToVariant["shadowReceiver"] = filament::Variant::SHADOW_RECEIVER;
     mStringToVariant["skinning"] = filament::Variant::SKINNING;
+    mStringToVariant["instancing"] = filament::Variant::INSTANCING;
 }
 
 bool ParametersProcessor::process(filamat::MaterialBuilder& builder, const JsonishObject& jsonObject) {
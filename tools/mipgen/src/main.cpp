@@ -24,6 +24,7 @@
 #include <imageio/ImageDecoder.h>
 #include <imageio/ImageEncoder.h>
 
+#include <utils/JobSystem.h>
 #include <utils/Path.h>
 
 #include <getopt/getopt.h>
@@ -276,7 +277,12 @@ int main(int argc, char* argv[]) {
     puts("Generating miplevels...");
     uint32_t count = getMipmapCount(sourceImage);
     vector<LinearImage> miplevels(count);
-    generateMipmaps(sourceImage, g_filter, miplevels.data(), count);
+    {
+        JobSystem js;
+        js.adopt();
+        generateMipmaps(js, sourceImage, g_filter, miplevels.data(), count);
+        js.emancipate();
+    }
 
     if (g_ktxContainer) {
         puts("Writing KTX file to disk...");
@@ -34,6 +34,8 @@ static image::ImageEncoder::Format g_format = image::ImageEncoder::Format::PNG;
 static bool g_formatSpecified = false;
 static std::string g_compression = "";
 
+static constexpr uint32_t BAND_HEIGHT = 64;
+
 static void blend(const LinearImage& normal, const LinearImage& detail, LinearImage output);
 
 static void printUsage(const char* name) {
@@ -158,40 +160,35 @@ int main(int argc, char* argv[]) {
     }
 
     // make sure we load the normal maps as linear data
-    std::ifstream inputStream(normalMap, std::ios::binary);
-    LinearImage normalImage = ImageDecoder::decode(inputStream, normalMap,
+    std::ifstream normalStream(normalMap, std::ios::binary);
+    auto normalDecoder = ImageDecoder::createRowDecoder(normalStream, normalMap,
             ImageDecoder::ColorSpace::LINEAR);
-    if (!normalImage.isValid()) {
+    if (!normalDecoder) {
         std::cerr << "The input normal map is invalid: " << normalMap << std::endl;
         exit(1);
     }
-    inputStream.close();
 
-    inputStream.open(detailMap, std::ios::binary);
-    LinearImage detailImage = ImageDecoder::decode(inputStream, detailMap,
+    std::ifstream detailStream(detailMap, std::ios::binary);
+    auto detailDecoder = ImageDecoder::createRowDecoder(detailStream, detailMap,
             ImageDecoder::ColorSpace::LINEAR);
-    if (!detailImage.isValid()) {
+    if (!detailDecoder) {
         std::cerr << "The detail normal map is invalid: " << detailMap << std::endl;
         exit(1);
     }
-    inputStream.close();
 
     // TODO: handle normal maps of different sizes
-    if (normalImage.getWidth() != detailImage.getWidth() ||
-            normalImage.getHeight() != detailImage.getHeight()) {
+    if (normalDecoder->getWidth() != detailDecoder->getWidth() ||
+            normalDecoder->getHeight() != detailDecoder->getHeight()) {
         std::cerr << "The normal and detail maps must have the same dimensions:" << std::endl
-                << "    Normal map: " << normalImage.getWidth() << "x" << normalImage.getHeight()
-                << std::endl
-                << "    Detail map: " << detailImage.getWidth() << "x" << detailImage.getHeight()
-                << std::endl;
+                << "    Normal map: " << normalDecoder->getWidth() << "x"
+                << normalDecoder->getHeight() << std::endl
+                << "    Detail map: " << detailDecoder->getWidth() << "x"
+                << detailDecoder->getHeight() << std::endl;
         exit(1);
     }
 
-    size_t width = normalImage.getWidth();
-    size_t height = normalImage.getHeight();
-    LinearImage image(width, height, 3);
-
-    blend(normalImage, detailImage, image);
+    uint32_t width = normalDecoder->getWidth();
+    uint32_t height = normalDecoder->getHeight();
 
     if (!g_formatSpecified) {
         g_format = ImageEncoder::chooseFormat(outputMap);
@@ -203,7 +200,30 @@ int main(int argc, char* argv[]) {
         exit(1);
     }
 
-    ImageEncoder::encode(outputStream, g_format, image, g_compression, outputMap.getPath());
+    auto encoder = ImageEncoder::createRowEncoder(outputStream, g_format, width, height, 3,
+            g_compression, outputMap.getPath());
+    if (!encoder) {
+        std::cerr << "The output format is not supported: " << outputMap << std::endl;
+        exit(1);
+    }
+
+    // blend a band of rows at a time, this bounds memory usage for large maps
+    for (uint32_t row = 0; row < height; row += BAND_HEIGHT) {
+        LinearImage normalImage = normalDecoder->decodeRows(BAND_HEIGHT);
+        LinearImage detailImage = detailDecoder->decodeRows(BAND_HEIGHT);
+        if (!normalImage.isValid() || !detailImage.isValid()) {
+            std::cerr << "An error occurred while decoding the input maps." << std::endl;
+            exit(1);
+        }
+
+        LinearImage image(width, normalImage.getHeight(), 3);
+        blend(normalImage, detailImage, image);
+
+        if (!encoder->encodeRows(image)) {
+            std::cerr << "An error occurred while encoding the image." << std::endl;
+            exit(1);
+        }
+    }
 
     outputStream.close();
     if (!outputStream.good()) {
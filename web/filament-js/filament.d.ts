@@ -576,6 +576,7 @@ export enum View$DepthPrepass {
     DEFAULT,
     DISABLED,
     ENABLED,
+    ADAPTIVE,
 }
 
 export enum WrapMode {
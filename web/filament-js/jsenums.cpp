@@ -102,7 +102,8 @@ enum_<View::AntiAliasing>("View$AntiAliasing")
 enum_<View::DepthPrepass>("View$DepthPrepass")
     .value("DEFAULT", View::DepthPrepass::DEFAULT)
     .value("DISABLED", View::DepthPrepass::DISABLED)
-    .value("ENABLED", View::DepthPrepass::ENABLED);
+    .value("ENABLED", View::DepthPrepass::ENABLED)
+    .value("ADAPTIVE", View::DepthPrepass::ADAPTIVE);
 
 enum_<Camera::Projection>("Camera$Projection")
     .value("PERSPECTIVE", Camera::Projection::PERSPECTIVE)